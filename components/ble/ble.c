@@ -9,6 +9,11 @@
 #include "services/gatt/ble_svc_gatt.h"
 #include "services/ans/ble_svc_ans.h"
 #include "utils.h"
+#include "spsc_ring.h"
+#include "input_history.h"
+#include "state_codec.h"
+#include "frame_batch.h"
+#include "conn_control.h"
 
 static const char *TAG = "ble";
 
@@ -18,6 +23,59 @@ static uint16_t ble_connection_handle = BLE_HS_CONN_HANDLE_NONE;
 static ble_event_callback_t ble_event_cb = NULL;
 static uint16_t ble_connection_interval = 0;
 static uint16_t ble_latency = 0;
+static volatile uint16_t ble_mtu = BLE_ATT_MTU_DFLT;  // Set on the NimBLE task, read in ble_flush
+
+// Inbound: NimBLE task produces, game loop consumes in ble_poll
+static spsc_ring_t rx_ring;
+static ble_packet_t rx_slots[BLE_RX_QUEUE_SIZE];
+
+// Outbound: sends queue typed messages in tx_batch over a frame; ble_flush
+// packs them into frames for the transport. NimBLE's queues them for its
+// task, which drains them on tx_event.
+typedef struct {
+    uint16_t length;
+    uint8_t data[FRAME_BATCH_MAX_SIZE];
+} ble_frame_t;
+
+static frame_batch_t tx_batch;
+static spsc_ring_t tx_ring;
+static ble_frame_t tx_slots[BLE_TX_QUEUE_SIZE];
+static struct ble_npl_event tx_event;
+static uint32_t tx_sent = 0;
+static uint32_t tx_batches = 0;
+
+// Inbound frames are unpacked on the game loop, in ble_poll
+static frame_batch_t rx_batch;
+
+// NimBLE is the transport unless ble_set_transport picks another
+static bool nimble_send(void *state, const uint8_t *frame, size_t length);
+static void nimble_poll(void *state, transport_receive_fn fn, void *context);
+static bool nimble_connected(const void *state);
+static uint16_t nimble_frame_size(const void *state);
+
+static const transport_ops_t nimble_ops = {
+    .name = "nimble",
+    .send = nimble_send,
+    .poll = nimble_poll,
+    .connected = nimble_connected,
+    .frame_size = nimble_frame_size,
+};
+
+static const transport_t nimble_transport = { &nimble_ops, NULL };
+static const transport_t *ble_transport = &nimble_transport;
+
+_Static_assert(sizeof(game_state_packet_t) <= BLE_PACKET_MAX_SIZE, "game state packet too large for queue");
+_Static_assert(sizeof(input_packet_t) <= BLE_PACKET_MAX_SIZE, "input packet too large for queue");
+_Static_assert(sizeof(config_packet_t) <= BLE_PACKET_MAX_SIZE, "config packet too large for queue");
+_Static_assert(INPUT_HISTORY_MAX_PACKET <= BLE_PACKET_MAX_SIZE, "input history packet too large for queue");
+_Static_assert(BLE_PACKET_MAX_SIZE <= FRAME_BATCH_MAX_MESSAGE, "queued packets must fit a frame message");
+// Racing traffic must still get through if the MTU exchange fails
+_Static_assert(FRAME_BATCH_HEADER_SIZE + INPUT_HISTORY_MAX_PACKET <= FRAME_BATCH_MIN_SIZE,
+               "input history must fit a default MTU notification");
+_Static_assert(FRAME_BATCH_HEADER_SIZE + STATE_CODEC_MAX_PACKET <= FRAME_BATCH_MIN_SIZE,
+               "state packets must fit a default MTU notification");
+_Static_assert(FRAME_BATCH_HEADER_SIZE + sizeof(config_packet_t) <= FRAME_BATCH_MIN_SIZE,
+               "config packets must fit a default MTU notification");
 
 // GATT service definition
 static const struct ble_gatt_svc_def gatt_services[] = {
@@ -64,6 +122,12 @@ static int ble_gatt_char_access(uint16_t conn_handle, uint16_t attr_handle,
                                struct ble_gatt_access_ctxt *ctxt, void *arg);
 static bool ble_validate_connection(void);
 static void ble_advertise(void);
+static void ble_queue_event(transport_event_t event, const uint8_t *data, size_t length);
+static void ble_queue_single(frame_batch_kind_t kind, const uint8_t *data, size_t length);
+static void ble_deliver(void *context, transport_event_t event, const uint8_t *data, size_t length);
+static void ble_deliver_message(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length);
+static esp_err_t ble_send_message(frame_batch_kind_t kind, const void *data, uint16_t length);
+static void ble_tx_event(struct ble_npl_event *ev);
 
 esp_err_t ble_init(void)
 {
@@ -71,6 +135,14 @@ esp_err_t ble_init(void)
     
     ESP_LOGI(TAG, "Initializing BLE stack");
     
+    spsc_ring_init(&rx_ring, rx_slots, sizeof(ble_packet_t), BLE_RX_QUEUE_SIZE);
+    spsc_ring_init(&tx_ring, tx_slots, sizeof(ble_frame_t), BLE_TX_QUEUE_SIZE);
+    frame_batch_init(&tx_batch, BLE_ATT_MTU_DFLT - FRAME_BATCH_ATT_HEADER);
+    frame_batch_init(&rx_batch, BLE_ATT_MTU_DFLT - FRAME_BATCH_ATT_HEADER);
+    ble_npl_event_init(&tx_event, ble_tx_event, NULL);
+    tx_sent = 0;
+    tx_batches = 0;
+    
     // Initialize NimBLE host configuration
     ble_hs_cfg.reset_cb = ble_on_reset;
     ble_hs_cfg.sync_cb = ble_on_sync;
@@ -260,14 +332,20 @@ esp_err_t ble_send_game_state(const game_state_packet_t *state)
         return ESP_ERR_INVALID_STATE;
     }
     
-    int rc = ble_gatts_notify(ble_connection_handle, game_state_val_handle,
-                             (uint8_t *)state, sizeof(game_state_packet_t));
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Failed to send game state: %d", rc);
-        return ESP_FAIL;
+    return ble_send_message(FRAME_BATCH_STATE, state, sizeof(game_state_packet_t));
+}
+
+esp_err_t ble_send_state_delta(const uint8_t *data, uint16_t length)
+{
+    if (!data || length == 0 || length > BLE_PACKET_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    return ESP_OK;
+
+    if (!ble_validate_connection()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return ble_send_message(FRAME_BATCH_STATE, data, length);
 }
 
 esp_err_t ble_send_input(const input_packet_t *input)
@@ -280,14 +358,20 @@ esp_err_t ble_send_input(const input_packet_t *input)
         return ESP_ERR_INVALID_STATE;
     }
     
-    int rc = ble_gatts_notify(ble_connection_handle, input_val_handle,
-                             (uint8_t *)input, sizeof(input_packet_t));
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Failed to send input: %d", rc);
-        return ESP_FAIL;
+    return ble_send_message(FRAME_BATCH_INPUT, input, sizeof(input_packet_t));
+}
+
+esp_err_t ble_send_input_history(const uint8_t *data, uint16_t length)
+{
+    if (!data || length == 0 || length > BLE_PACKET_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    return ESP_OK;
+
+    if (!ble_validate_connection()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return ble_send_message(FRAME_BATCH_INPUT, data, length);
 }
 
 esp_err_t ble_send_config(const config_packet_t *config)
@@ -300,14 +384,39 @@ esp_err_t ble_send_config(const config_packet_t *config)
         return ESP_ERR_INVALID_STATE;
     }
     
-    int rc = ble_gatts_notify(ble_connection_handle, config_val_handle,
-                             (uint8_t *)config, sizeof(config_packet_t));
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Failed to send config: %d", rc);
-        return ESP_FAIL;
+    return ble_send_message(FRAME_BATCH_EVENT, config, sizeof(config_packet_t));
+}
+
+void ble_flush(void)
+{
+    ble_frame_t frame;
+
+    frame_batch_set_capacity(&tx_batch, transport_frame_size(ble_transport));
+    while ((frame.length = (uint16_t)frame_batch_next(&tx_batch, frame.data)) > 0) {
+        transport_send(ble_transport, frame.data, frame.length);
     }
-    
-    return ESP_OK;
+}
+
+void ble_poll(void)
+{
+    transport_poll(ble_transport, ble_deliver, NULL);
+}
+
+void ble_set_transport(const transport_t *transport)
+{
+    ble_transport = transport ? transport : &nimble_transport;
+}
+
+void ble_get_queue_stats(ble_queue_stats_t *stats)
+{
+    stats->rx_pending = spsc_ring_count(&rx_ring);
+    stats->tx_pending = spsc_ring_count(&tx_ring);
+    stats->rx_dropped = rx_ring.dropped;
+    stats->tx_dropped = tx_ring.dropped;
+    stats->tx_sent = tx_sent;
+    stats->tx_messages = tx_batch.messages_queued;
+    stats->tx_batches = tx_batches;
+    stats->mtu = ble_mtu;
 }
 
 ble_state_t ble_get_state(void)
@@ -317,19 +426,13 @@ ble_state_t ble_get_state(void)
 
 bool ble_is_connected(void)
 {
-    return (ble_state == BLE_STATE_CONNECTED && 
-            ble_connection_handle != BLE_HS_CONN_HANDLE_NONE);
+    return transport_connected(ble_transport);
 }
 
 static bool ble_validate_connection(void)
 {
-    if (ble_connection_handle == BLE_HS_CONN_HANDLE_NONE) {
-        ESP_LOGW(TAG, "Invalid connection handle");
-        return false;
-    }
-    
-    if (ble_state != BLE_STATE_CONNECTED) {
-        ESP_LOGW(TAG, "BLE not in connected state");
+    if (!transport_connected(ble_transport)) {
+        ESP_LOGW(TAG, "%s transport not connected", ble_transport->ops->name);
         return false;
     }
     
@@ -365,7 +468,7 @@ void ble_update_connection_parameters(uint16_t interval, uint16_t latency, uint1
     struct ble_gap_upd_params params;
     int rc;
     
-    if (!ble_is_connected()) {
+    if (!nimble_connected(NULL)) {
         return;
     }
     
@@ -381,6 +484,20 @@ void ble_update_connection_parameters(uint16_t interval, uint16_t latency, uint1
     }
 }
 
+void ble_set_phy(uint8_t phy)
+{
+    uint8_t mask = phy == BLE_PHY_2M ? BLE_GAP_LE_PHY_2M_MASK : BLE_GAP_LE_PHY_1M_MASK;
+
+    if (!nimble_connected(NULL)) {
+        return;
+    }
+
+    int rc = ble_gap_set_prefered_le_phy(ble_connection_handle, mask, mask, BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Failed to set PHY: %d", rc);
+    }
+}
+
 // BLE event handler
 static int ble_gap_event(struct ble_gap_event *event, void *arg)
 {
@@ -398,12 +515,18 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
                     ble_connection_interval = desc.conn_itvl;
                     ble_latency = desc.conn_latency;
                 }
+
+                // Frames stay at the default size until the peer agrees
+                // to CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU
+                ble_mtu = BLE_ATT_MTU_DFLT;
+                rc = ble_gattc_exchange_mtu(ble_connection_handle, NULL, NULL);
+                if (rc != 0) {
+                    ESP_LOGW(TAG, "Failed to start MTU exchange: %d", rc);
+                }
                 
                 ESP_LOGI(TAG, "BLE connected, handle=%d", ble_connection_handle);
                 
-                if (ble_event_cb) {
-                    ble_event_cb(0, NULL, 0); // Connected event
-                }
+                ble_queue_event(TRANSPORT_CONNECTED, NULL, 0);
             } else {
                 ESP_LOGE(TAG, "BLE connection failed: %d", event->connect.status);
                 ble_state = BLE_STATE_IDLE;
@@ -415,9 +538,7 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
             ble_state = BLE_STATE_DISCONNECTED;
             ble_connection_handle = 0xFFFF;
             
-            if (ble_event_cb) {
-                ble_event_cb(1, NULL, 0); // Disconnected event
-            }
+            ble_queue_event(TRANSPORT_DISCONNECTED, NULL, 0);
             break;
             
         case BLE_GAP_EVENT_ADV_COMPLETE:
@@ -428,7 +549,18 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
             break;
             
         case BLE_GAP_EVENT_CONN_UPDATE:
-            ESP_LOGI(TAG, "Connection parameters updated");
+            rc = ble_gap_conn_find(event->conn_update.conn_handle, &desc);
+            if (event->conn_update.status == 0 && rc == 0) {
+                ble_connection_interval = desc.conn_itvl;
+                ble_latency = desc.conn_latency;
+            }
+            ESP_LOGI(TAG, "Connection parameters updated: status %d, interval %d, latency %d",
+                     event->conn_update.status, ble_connection_interval, ble_latency);
+            break;
+
+        case BLE_GAP_EVENT_MTU:
+            ESP_LOGI(TAG, "MTU %d", event->mtu.value);
+            ble_mtu = event->mtu.value;
             break;
             
         default:
@@ -447,27 +579,24 @@ static int ble_gatt_char_access(uint16_t conn_handle, uint16_t attr_handle,
     switch (uuid) {
         case BLE_GAME_STATE_CHAR_UUID:
             if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
-                // Handle incoming game state
-                if (ble_event_cb && ctxt->om->om_len == sizeof(game_state_packet_t)) {
-                    ble_event_cb(2, ctxt->om->om_data, ctxt->om->om_len);
-                }
+                // A frame_batch frame: input, state and config messages
+                // packed together, unpacked by ble_poll
+                ble_queue_event(TRANSPORT_FRAME, ctxt->om->om_data, ctxt->om->om_len);
             }
             break;
             
         case BLE_INPUT_CHAR_UUID:
             if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
-                // Handle incoming input
-                if (ble_event_cb && ctxt->om->om_len == sizeof(input_packet_t)) {
-                    ble_event_cb(3, ctxt->om->om_data, ctxt->om->om_len);
-                }
+                // Handle incoming input: an input_history packet, so any length
+                ble_queue_single(FRAME_BATCH_INPUT, ctxt->om->om_data, ctxt->om->om_len);
             }
             break;
             
         case BLE_CONFIG_CHAR_UUID:
             if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
                 // Handle incoming config
-                if (ble_event_cb && ctxt->om->om_len == sizeof(config_packet_t)) {
-                    ble_event_cb(4, ctxt->om->om_data, ctxt->om->om_len);
+                if (ctxt->om->om_len == sizeof(config_packet_t)) {
+                    ble_queue_single(FRAME_BATCH_EVENT, ctxt->om->om_data, ctxt->om->om_len);
                 }
             }
             break;
@@ -479,6 +608,160 @@ static int ble_gatt_char_access(uint16_t conn_handle, uint16_t attr_handle,
     return 0;
 }
 
+// Runs on the NimBLE task; the game loop picks the event up in ble_poll
+static void ble_queue_event(transport_event_t event, const uint8_t *data, size_t length)
+{
+    ble_packet_t packet;
+
+    if (length > FRAME_BATCH_MAX_SIZE) {
+        return;
+    }
+
+    packet.event = (uint8_t)event;
+    packet.length = (uint16_t)length;
+    if (length > 0) {
+        memcpy(packet.data, data, length);
+    }
+
+    if (!spsc_ring_push(&rx_ring, &packet)) {
+        ESP_LOGW(TAG, "RX queue full, dropped event %d", event);
+    }
+}
+
+// Writes to the input and config characteristics carry one bare message;
+// they are queued as a frame of their own
+static void ble_queue_single(frame_batch_kind_t kind, const uint8_t *data, size_t length)
+{
+    uint8_t frame[FRAME_BATCH_HEADER_SIZE + FRAME_BATCH_MAX_MESSAGE];
+
+    length = frame_batch_wrap(kind, data, length, frame);
+    if (length > 0) {
+        ble_queue_event(TRANSPORT_FRAME, frame, length);
+    }
+}
+
+// Runs on the game loop for each event the transport hands ble_poll
+static void ble_deliver(void *context, transport_event_t event, const uint8_t *data, size_t length)
+{
+    switch (event) {
+        case TRANSPORT_CONNECTED:
+            if (ble_event_cb) {
+                ble_event_cb(0, NULL, 0);
+            }
+            break;
+
+        case TRANSPORT_DISCONNECTED:
+            if (ble_event_cb) {
+                ble_event_cb(1, NULL, 0);
+            }
+            break;
+
+        case TRANSPORT_FRAME:
+            frame_batch_decode(&rx_batch, data, length, ble_deliver_message, NULL);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Each message of a received frame, as its callback event
+static void ble_deliver_message(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length)
+{
+    if (!ble_event_cb) {
+        return;
+    }
+
+    switch (kind) {
+        case FRAME_BATCH_STATE:
+            ble_event_cb(2, data, (uint16_t)length);
+            break;
+
+        case FRAME_BATCH_INPUT:
+            ble_event_cb(3, data, (uint16_t)length);
+            break;
+
+        case FRAME_BATCH_EVENT:
+            if (length == sizeof(config_packet_t)) {
+                ble_event_cb(4, data, (uint16_t)length);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Runs on the game loop; the message goes out on the next ble_flush
+static esp_err_t ble_send_message(frame_batch_kind_t kind, const void *data, uint16_t length)
+{
+    if (!frame_batch_add(&tx_batch, kind, data, length)) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Drains the outbound queue on the NimBLE task; every frame goes out on
+// the game state characteristic
+static void ble_tx_event(struct ble_npl_event *ev)
+{
+    ble_frame_t frame;
+    uint32_t sent = 0;
+
+    while (spsc_ring_pop(&tx_ring, &frame)) {
+        // The link may have dropped since the frame was queued
+        if (!nimble_connected(NULL)) {
+            continue;
+        }
+
+        int rc = ble_gatts_notify(ble_connection_handle, game_state_val_handle, frame.data, frame.length);
+        if (rc != 0) {
+            ESP_LOGE(TAG, "Failed to send notification: %d", rc);
+            continue;
+        }
+        sent++;
+    }
+
+    tx_sent += sent;
+    tx_batches++;
+}
+
+// NimBLE transport: frames are handed to the host task through tx_ring, and
+// come back from it through rx_ring
+static bool nimble_send(void *state, const uint8_t *frame, size_t length)
+{
+    ble_frame_t slot;
+
+    slot.length = (uint16_t)length;
+    memcpy(slot.data, frame, length);
+    if (!spsc_ring_push(&tx_ring, &slot)) {
+        return false;
+    }
+    // The event is only queued once however many frames are waiting
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &tx_event);
+    return true;
+}
+
+static void nimble_poll(void *state, transport_receive_fn fn, void *context)
+{
+    ble_packet_t packet;
+
+    // Bounded so a flood from the peer cannot stall the frame
+    for (int i = 0; i < BLE_RX_QUEUE_SIZE && spsc_ring_pop(&rx_ring, &packet); i++) {
+        fn(context, (transport_event_t)packet.event, packet.length ? packet.data : NULL, packet.length);
+    }
+}
+
+static bool nimble_connected(const void *state)
+{
+    return ble_state == BLE_STATE_CONNECTED && ble_connection_handle != BLE_HS_CONN_HANDLE_NONE;
+}
+
+static uint16_t nimble_frame_size(const void *state)
+{
+    return ble_mtu - FRAME_BATCH_ATT_HEADER;
+}
+
 // NimBLE host task
 void ble_host_task(void *param)
 {
@@ -504,14 +787,15 @@ void ble_on_sync(void)
         ESP_LOGE(TAG, "Failed to set 2M PHY preference: %d", rc);
     }
     
-    // Configure connection parameters for low latency
+    // Connections start on the menu profile; protocol_link_control
+    // tightens them for races once connected
     struct ble_gap_conn_params conn_params = {
         .scan_itvl = 0x0010,
         .scan_window = 0x0010,
-        .itvl_min = BLE_GAP_INITIAL_CONN_ITVL_MIN,
-        .itvl_max = BLE_GAP_INITIAL_CONN_ITVL_MAX,
-        .latency = 0,
-        .supervision_timeout = BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
+        .itvl_min = CONN_CONTROL_IDLE_INTERVAL,
+        .itvl_max = CONN_CONTROL_IDLE_INTERVAL,
+        .latency = CONN_CONTROL_IDLE_LATENCY,
+        .supervision_timeout = CONN_CONTROL_TIMEOUT,
         .min_ce_len = BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
         .max_ce_len = BLE_GAP_INITIAL_CONN_MAX_CE_LEN,
     };
@@ -0,0 +1,233 @@
+#include "clock_sync.h"
+#include <string.h>
+
+#define TIME_MASK ((1ll << 48) - 1)
+
+static void add_sample(clock_sync_t *sync, const clock_sync_sample_t *sample);
+static void update_skew(clock_sync_t *sync, const clock_sync_sample_t *sample);
+static int64_t offset_at(const clock_sync_t *sync, int64_t now_us);
+
+void clock_sync_init(clock_sync_t *sync, bool is_reference, uint32_t frame_rate_hz)
+{
+    memset(sync, 0, sizeof(clock_sync_t));
+    sync->is_reference = is_reference;
+    sync->frame_rate_hz = frame_rate_hz;
+}
+
+void clock_sync_encode(const clock_sync_message_t *message, uint8_t *buffer)
+{
+    buffer[0] = message->type;
+    buffer[1] = message->sequence;
+    for (int i = 0; i < 4; i++) {
+        buffer[2 + i] = (uint8_t)(message->origin_us >> (8 * i));
+    }
+    uint64_t time = (uint64_t)message->time_us & TIME_MASK;
+    for (int i = 0; i < 6; i++) {
+        buffer[6 + i] = (uint8_t)(time >> (8 * i));
+    }
+}
+
+bool clock_sync_decode(const uint8_t *data, size_t length, clock_sync_message_t *message)
+{
+    if (length != CLOCK_SYNC_PACKET_SIZE || data[0] < CLOCK_SYNC_PING || data[0] > CLOCK_SYNC_PONG) {
+        return false;
+    }
+    message->type = data[0];
+    message->sequence = data[1];
+    message->origin_us = 0;
+    for (int i = 0; i < 4; i++) {
+        message->origin_us |= (uint32_t)data[2 + i] << (8 * i);
+    }
+    uint64_t time = 0;
+    for (int i = 0; i < 6; i++) {
+        time |= (uint64_t)data[6 + i] << (8 * i);
+    }
+    message->time_us = (int64_t)time;
+    return true;
+}
+
+bool clock_sync_poll(clock_sync_t *sync, int64_t now_us, clock_sync_message_t *ping)
+{
+    if (now_us < sync->next_ping_us) {
+        return false;
+    }
+
+    bool send_epoch = sync->is_reference && sync->epoch_valid;
+    ping->type = send_epoch ? CLOCK_SYNC_PING_EPOCH : CLOCK_SYNC_PING;
+    ping->sequence = sync->next_sequence++;
+    ping->origin_us = (uint32_t)now_us;
+    ping->time_us = send_epoch ? sync->epoch_us : 0;
+
+    sync->pings_sent++;
+    sync->next_ping_us = now_us + (sync->pongs_received < CLOCK_SYNC_WINDOW ? CLOCK_SYNC_FAST_INTERVAL_US
+                                                                          : CLOCK_SYNC_PING_INTERVAL_US);
+    return true;
+}
+
+bool clock_sync_handle(clock_sync_t *sync, const clock_sync_message_t *message, int64_t now_us,
+                       clock_sync_message_t *reply)
+{
+    if (message->type == CLOCK_SYNC_PING || message->type == CLOCK_SYNC_PING_EPOCH) {
+        if (message->type == CLOCK_SYNC_PING_EPOCH && !sync->is_reference) {
+            sync->epoch_valid = true;
+            sync->epoch_us = message->time_us;
+        }
+        reply->type = CLOCK_SYNC_PONG;
+        reply->sequence = message->sequence;
+        reply->origin_us = message->origin_us;
+        reply->time_us = now_us;
+        return true;
+    }
+
+    if (message->type == CLOCK_SYNC_PONG) {
+        // Only the low bits of the send time came back; the RTT is their
+        // difference
+        uint32_t rtt = (uint32_t)now_us - message->origin_us;
+        if (rtt > CLOCK_SYNC_MAX_RTT_US) {
+            sync->samples_rejected++;
+            return false;
+        }
+        sync->pongs_received++;
+
+        // The peer stamped the reply halfway through the round trip,
+        // assuming the two directions take as long
+        clock_sync_sample_t sample = {
+            .offset_us = message->time_us - now_us + rtt / 2,
+            .rtt_us = rtt,
+            .local_us = now_us,
+        };
+        add_sample(sync, &sample);
+    }
+    return false;
+}
+
+int64_t clock_sync_reference_time(const clock_sync_t *sync, int64_t now_us)
+{
+    if (sync->is_reference || !sync->synced) {
+        return now_us;
+    }
+    return now_us + offset_at(sync, now_us);
+}
+
+void clock_sync_start_timeline(clock_sync_t *sync, int64_t now_us)
+{
+    if (!sync->is_reference) {
+        return;
+    }
+    sync->epoch_valid = true;
+    sync->epoch_us = now_us;
+    // Tell the peer straight away
+    sync->next_ping_us = now_us;
+}
+
+bool clock_sync_frame(const clock_sync_t *sync, int64_t now_us, uint32_t *frame)
+{
+    if (!sync->epoch_valid || (!sync->is_reference && !sync->synced)) {
+        return false;
+    }
+    int64_t elapsed = clock_sync_reference_time(sync, now_us) - sync->epoch_us;
+    *frame = elapsed > 0 ? (uint32_t)(elapsed * sync->frame_rate_hz / 1000000) : 0;
+    return true;
+}
+
+int clock_sync_pace(clock_sync_t *sync, uint32_t local_frame, int64_t now_us)
+{
+    uint32_t target;
+    if (!clock_sync_frame(sync, now_us, &target)) {
+        return 1;
+    }
+
+    // Start correcting a couple of frames out, stop once level again, so
+    // jitter in the estimate does not flip it back and forth
+    int32_t ahead = (int32_t)(local_frame - target);
+    if (sync->pace_direction == 0) {
+        if (ahead >= CLOCK_SYNC_PACE_START) {
+            sync->pace_direction = 1;
+        } else if (ahead <= -CLOCK_SYNC_PACE_START) {
+            sync->pace_direction = -1;
+        }
+    } else if ((sync->pace_direction > 0 && ahead <= 0) || (sync->pace_direction < 0 && ahead >= 0)) {
+        sync->pace_direction = 0;
+    }
+
+    if (sync->pace_ticks < CLOCK_SYNC_PACE_SPACING) {
+        sync->pace_ticks++;
+    }
+    if (sync->pace_direction == 0 || sync->pace_ticks < CLOCK_SYNC_PACE_SPACING) {
+        return 1;
+    }
+    sync->pace_ticks = 0;
+    if (sync->pace_direction > 0) {
+        sync->frames_skipped++;
+        return 0;
+    }
+    sync->frames_added++;
+    return 2;
+}
+
+// Keeps the window, then moves the estimate toward its lowest RTT sample:
+// the one least delayed by queueing, so the least lopsided
+static void add_sample(clock_sync_t *sync, const clock_sync_sample_t *sample)
+{
+    sync->samples[sync->next_sample] = *sample;
+    sync->next_sample = (sync->next_sample + 1) % CLOCK_SYNC_WINDOW;
+    if (sync->sample_count < CLOCK_SYNC_WINDOW) {
+        sync->sample_count++;
+    }
+    update_skew(sync, sample);
+
+    const clock_sync_sample_t *best = &sync->samples[0];
+    for (int i = 1; i < sync->sample_count; i++) {
+        if (sync->samples[i].rtt_us < best->rtt_us) {
+            best = &sync->samples[i];
+        }
+    }
+    int64_t measured = best->offset_us;
+    if (sync->skew_valid) {
+        measured += (int64_t)(sync->skew_ppm * (float)(sample->local_us - best->local_us) / 1e6f);
+    }
+
+    if (!sync->synced) {
+        sync->offset_us = measured;
+        sync->synced = true;
+    } else {
+        int64_t predicted = offset_at(sync, sample->local_us);
+        sync->offset_us = predicted + (measured - predicted) / 8;
+    }
+    sync->offset_time_us = sample->local_us;
+    sync->rtt_us = best->rtt_us;
+}
+
+// Drift between the clocks, from the best sample of each interval
+static void update_skew(clock_sync_t *sync, const clock_sync_sample_t *sample)
+{
+    if (!sync->synced) {
+        sync->skew_interval_start_us = sample->local_us;
+        sync->skew_best = *sample;
+        return;
+    }
+    if (sample->rtt_us < sync->skew_best.rtt_us) {
+        sync->skew_best = *sample;
+    }
+    if (sample->local_us - sync->skew_interval_start_us < CLOCK_SYNC_SKEW_INTERVAL_US) {
+        return;
+    }
+
+    const clock_sync_sample_t *previous = &sync->skew_previous;
+    if (sync->skew_previous_valid && sync->skew_best.local_us > previous->local_us) {
+        float measured = (float)(sync->skew_best.offset_us - previous->offset_us) * 1e6f /
+                         (float)(sync->skew_best.local_us - previous->local_us);
+        sync->skew_ppm = sync->skew_valid ? sync->skew_ppm + (measured - sync->skew_ppm) / 4 : measured;
+        sync->skew_valid = true;
+    }
+    sync->skew_previous = sync->skew_best;
+    sync->skew_previous_valid = true;
+    // The next interval starts empty
+    sync->skew_interval_start_us = sample->local_us;
+    sync->skew_best.rtt_us = UINT32_MAX;
+}
+
+static int64_t offset_at(const clock_sync_t *sync, int64_t now_us)
+{
+    return sync->offset_us + (int64_t)(sync->skew_ppm * (float)(now_us - sync->offset_time_us) / 1e6f);
+}
@@ -0,0 +1,153 @@
+#include "conn_control.h"
+#include <string.h>
+
+#define INTERVAL_UNIT_US 1250
+
+static const uint16_t race_intervals[CONN_CONTROL_RACE_LEVELS] = { 6, 8, 12, 16, 24 };
+
+static uint8_t max_level(uint16_t update_rate_hz);
+static void start_window(conn_control_t *control, const conn_control_input_t *input);
+static void clear_periods(conn_control_t *control);
+static bool request(conn_control_t *control, int64_t now_us, conn_control_params_t *params);
+
+void conn_control_init(conn_control_t *control)
+{
+    memset(control, 0, sizeof(conn_control_t));
+}
+
+bool conn_control_update(conn_control_t *control, const conn_control_input_t *input, int64_t now_us,
+                         conn_control_params_t *params)
+{
+    // Entering or leaving a race changes the profile at once
+    conn_control_mode_t mode = input->racing ? CONN_CONTROL_RACE : CONN_CONTROL_IDLE;
+    if (!control->started || mode != control->mode) {
+        control->started = true;
+        control->mode = mode;
+        control->level = 0;
+        control->phy = CONN_CONTROL_PHY_2M;
+        control->next_period_us = now_us + CONN_CONTROL_PERIOD_US;
+        start_window(control, input);
+        return request(control, now_us, params);
+    }
+
+    if (mode == CONN_CONTROL_IDLE || now_us < control->next_period_us) {
+        return false;
+    }
+    control->next_period_us = now_us + CONN_CONTROL_PERIOD_US;
+
+    // Updates must not queue behind a longer interval, whatever the link
+    uint8_t ceiling = max_level(input->update_rate_hz);
+    if (control->level > ceiling) {
+        control->level = ceiling;
+        control->tightened++;
+        start_window(control, input);
+        return request(control, now_us, params);
+    }
+
+    // Loss over a window long enough to mean something
+    uint32_t delivered = input->frames_delivered - control->window_delivered;
+    uint32_t recovered = input->frames_recovered - control->window_recovered;
+    bool have_loss = delivered >= CONN_CONTROL_MIN_FRAMES;
+    if (have_loss) {
+        control->loss_percent = recovered * 100 / delivered;
+        start_window(control, input);
+    }
+
+    if (now_us < control->hold_until_us) {
+        return false;
+    }
+
+    // Count periods on each side of the bands; anything between resets them
+    bool slow = input->rtt_us > CONN_CONTROL_RTT_HIGH_US;
+    bool fast = input->rtt_us > 0 && input->rtt_us < CONN_CONTROL_RTT_LOW_US;
+    control->slow_periods = slow ? control->slow_periods + 1 : 0;
+    control->fast_periods = fast ? control->fast_periods + 1 : 0;
+    if (have_loss) {
+        bool lossy = control->loss_percent > CONN_CONTROL_LOSS_HIGH_PERCENT;
+        bool clean = control->loss_percent < CONN_CONTROL_LOSS_LOW_PERCENT;
+        control->lossy_periods = lossy ? control->lossy_periods + 1 : 0;
+        control->clean_periods = clean ? control->clean_periods + 1 : 0;
+    }
+
+    bool changed = false;
+    if (control->phy == CONN_CONTROL_PHY_2M && control->lossy_periods >= CONN_CONTROL_TIGHTEN_PERIODS) {
+        control->phy = CONN_CONTROL_PHY_1M;
+        control->phy_changes++;
+        changed = true;
+    } else if (control->phy == CONN_CONTROL_PHY_1M && control->clean_periods >= CONN_CONTROL_LOOSEN_PERIODS) {
+        control->phy = CONN_CONTROL_PHY_2M;
+        control->phy_changes++;
+        changed = true;
+    }
+
+    if (control->level > 0 && control->slow_periods >= CONN_CONTROL_TIGHTEN_PERIODS) {
+        control->level--;
+        control->tightened++;
+        changed = true;
+    } else if (control->level < ceiling && control->fast_periods >= CONN_CONTROL_LOOSEN_PERIODS &&
+               control->lossy_periods == 0) {
+        control->level++;
+        control->loosened++;
+        changed = true;
+    }
+
+    return changed ? request(control, now_us, params) : false;
+}
+
+uint16_t conn_control_race_interval(uint8_t level)
+{
+    return race_intervals[level < CONN_CONTROL_RACE_LEVELS ? level : CONN_CONTROL_RACE_LEVELS - 1];
+}
+
+// Highest ladder level whose interval fits in one update period
+static uint8_t max_level(uint16_t update_rate_hz)
+{
+    if (update_rate_hz == 0) {
+        return CONN_CONTROL_RACE_LEVELS - 1;
+    }
+    uint32_t period_us = 1000000 / update_rate_hz;
+    uint8_t level = 0;
+    while (level + 1 < CONN_CONTROL_RACE_LEVELS && race_intervals[level + 1] * INTERVAL_UNIT_US <= period_us) {
+        level++;
+    }
+    return level;
+}
+
+static void start_window(conn_control_t *control, const conn_control_input_t *input)
+{
+    control->window_delivered = input->frames_delivered;
+    control->window_recovered = input->frames_recovered;
+}
+
+static void clear_periods(conn_control_t *control)
+{
+    control->slow_periods = 0;
+    control->fast_periods = 0;
+    control->lossy_periods = 0;
+    control->clean_periods = 0;
+}
+
+static bool request(conn_control_t *control, int64_t now_us, conn_control_params_t *params)
+{
+    if (control->mode == CONN_CONTROL_IDLE) {
+        control->current = (conn_control_params_t){
+            .interval = CONN_CONTROL_IDLE_INTERVAL,
+            .latency = CONN_CONTROL_IDLE_LATENCY,
+            .timeout = CONN_CONTROL_TIMEOUT,
+            .phy = CONN_CONTROL_PHY_1M,
+        };
+    } else {
+        control->current = (conn_control_params_t){
+            .interval = race_intervals[control->level],
+            .latency = 0,
+            .timeout = CONN_CONTROL_TIMEOUT,
+            .phy = control->phy,
+        };
+    }
+    // Measurements from before the change no longer apply
+    clear_periods(control);
+    control->hold_until_us = now_us + CONN_CONTROL_HOLD_US;
+    control->requests++;
+    *params = control->current;
+    return true;
+}
@@ -0,0 +1,47 @@
+#include "desync_check.h"
+#include <string.h>
+
+static bool add_hash(desync_check_t *check, desync_check_entry_t *own, const desync_check_entry_t *other,
+                     uint32_t frame, uint32_t hash);
+
+void desync_check_init(desync_check_t *check)
+{
+    memset(check, 0, sizeof(desync_check_t));
+}
+
+bool desync_check_add_local(desync_check_t *check, uint32_t frame, uint32_t hash)
+{
+    return add_hash(check, check->local, check->remote, frame, hash);
+}
+
+bool desync_check_add_remote(desync_check_t *check, uint32_t frame, uint32_t hash)
+{
+    return add_hash(check, check->remote, check->local, frame, hash);
+}
+
+static bool add_hash(desync_check_t *check, desync_check_entry_t *own, const desync_check_entry_t *other,
+                     uint32_t frame, uint32_t hash)
+{
+    desync_check_entry_t *entry = &own[frame & (DESYNC_CHECK_HISTORY - 1)];
+    if (entry->valid && entry->frame == frame) {
+        return false;
+    }
+    entry->frame = frame;
+    entry->hash = hash;
+    entry->valid = true;
+
+    const desync_check_entry_t *match = &other[frame & (DESYNC_CHECK_HISTORY - 1)];
+    if (!match->valid || match->frame != frame) {
+        return false;
+    }
+    check->checks++;
+    if (match->hash == hash) {
+        return false;
+    }
+    check->mismatches++;
+    if (!check->desynced) {
+        check->desynced = true;
+        check->first_desync_frame = frame;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+#include "frame_batch.h"
+#include <string.h>
+
+#define KIND_SHIFT 6
+#define LENGTH_MASK ((1u << KIND_SHIFT) - 1)
+
+_Static_assert(FRAME_BATCH_MAX_MESSAGE == LENGTH_MASK + 1, "length field must cover the largest message");
+_Static_assert(FRAME_BATCH_KINDS <= 1 << (8 - KIND_SHIFT), "kind field must cover every kind");
+
+static void clamp_capacity(frame_batch_t *batch, uint16_t capacity);
+
+void frame_batch_init(frame_batch_t *batch, uint16_t capacity)
+{
+    memset(batch, 0, sizeof(frame_batch_t));
+    clamp_capacity(batch, capacity);
+}
+
+void frame_batch_set_capacity(frame_batch_t *batch, uint16_t capacity)
+{
+    clamp_capacity(batch, capacity);
+}
+
+bool frame_batch_add(frame_batch_t *batch, frame_batch_kind_t kind, const uint8_t *data, size_t length)
+{
+    if (kind >= FRAME_BATCH_KINDS || length == 0 || length > FRAME_BATCH_MAX_MESSAGE) {
+        batch->messages_dropped++;
+        return false;
+    }
+    frame_batch_queue_t *queue = &batch->queues[kind];
+    if (queue->length + FRAME_BATCH_HEADER_SIZE + length > FRAME_BATCH_QUEUE_BYTES) {
+        batch->messages_dropped++;
+        return false;
+    }
+
+    queue->data[queue->length] = (uint8_t)(kind << KIND_SHIFT | (length - 1));
+    memcpy(&queue->data[queue->length + FRAME_BATCH_HEADER_SIZE], data, length);
+    queue->length += FRAME_BATCH_HEADER_SIZE + length;
+    batch->messages_queued++;
+    return true;
+}
+
+bool frame_batch_pending(const frame_batch_t *batch)
+{
+    for (int kind = 0; kind < FRAME_BATCH_KINDS; kind++) {
+        if (batch->queues[kind].sent < batch->queues[kind].length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t frame_batch_next(frame_batch_t *batch, uint8_t *buffer)
+{
+    size_t used = 0;
+
+    for (int kind = 0; kind < FRAME_BATCH_KINDS; kind++) {
+        frame_batch_queue_t *queue = &batch->queues[kind];
+        while (queue->sent < queue->length) {
+            size_t size = FRAME_BATCH_HEADER_SIZE + (queue->data[queue->sent] & LENGTH_MASK) + 1;
+            if (size > batch->capacity) {
+                // Would never fit, however empty the frame
+                batch->messages_dropped++;
+                queue->sent += size;
+                continue;
+            }
+            if (used + size > batch->capacity) {
+                // Later kinds may still have something small enough
+                break;
+            }
+            memcpy(&buffer[used], &queue->data[queue->sent], size);
+            used += size;
+            queue->sent += size;
+        }
+    }
+
+    if (used == 0) {
+        for (int kind = 0; kind < FRAME_BATCH_KINDS; kind++) {
+            batch->queues[kind].length = 0;
+            batch->queues[kind].sent = 0;
+        }
+        return 0;
+    }
+    batch->frames_sent++;
+    batch->bytes_sent += used;
+    return used;
+}
+
+size_t frame_batch_wrap(frame_batch_kind_t kind, const uint8_t *data, size_t length, uint8_t *buffer)
+{
+    if (kind >= FRAME_BATCH_KINDS || length == 0 || length > FRAME_BATCH_MAX_MESSAGE) {
+        return 0;
+    }
+    buffer[0] = (uint8_t)(kind << KIND_SHIFT | (length - 1));
+    memcpy(&buffer[FRAME_BATCH_HEADER_SIZE], data, length);
+    return FRAME_BATCH_HEADER_SIZE + length;
+}
+
+bool frame_batch_decode(frame_batch_t *batch, const uint8_t *data, size_t length, frame_batch_fn fn,
+                        void *context)
+{
+    // Every header must be a known kind and every message whole
+    size_t offset = 0;
+    while (offset < length) {
+        if (data[offset] >> KIND_SHIFT >= FRAME_BATCH_KINDS) {
+            batch->malformed++;
+            return false;
+        }
+        offset += FRAME_BATCH_HEADER_SIZE + (data[offset] & LENGTH_MASK) + 1;
+    }
+    if (length == 0 || offset != length) {
+        batch->malformed++;
+        return false;
+    }
+
+    batch->frames_received++;
+    for (offset = 0; offset < length;) {
+        size_t message_length = (data[offset] & LENGTH_MASK) + 1;
+        fn(context, (frame_batch_kind_t)(data[offset] >> KIND_SHIFT), &data[offset + FRAME_BATCH_HEADER_SIZE],
+           message_length);
+        batch->messages_received++;
+        offset += FRAME_BATCH_HEADER_SIZE + message_length;
+    }
+    return true;
+}
+
+static void clamp_capacity(frame_batch_t *batch, uint16_t capacity)
+{
+    if (capacity < FRAME_BATCH_MIN_SIZE) {
+        capacity = FRAME_BATCH_MIN_SIZE;
+    } else if (capacity > FRAME_BATCH_MAX_SIZE) {
+        capacity = FRAME_BATCH_MAX_SIZE;
+    }
+    batch->capacity = capacity;
+}
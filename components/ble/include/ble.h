@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include "esp_err.h"
 #include "game_types.h"
+#include "frame_batch.h"
+#include "transport.h"
 
 // BLE configuration
 #define BLE_DEVICE_NAME             "Mode7Racer"
@@ -14,6 +16,15 @@
 #define BLE_INPUT_CHAR_UUID         0x2A57  // Analog characteristic
 #define BLE_CONFIG_CHAR_UUID        0x2A58  // Aggregate characteristic
 
+// Queues between the NimBLE host task and the game loop (powers of two)
+#define BLE_RX_QUEUE_SIZE           16      // Frames and connection events
+#define BLE_TX_QUEUE_SIZE           8       // Notifications, each a frame_batch frame
+#define BLE_PACKET_MAX_SIZE         40      // Largest message carried by the queues
+
+// PHYs for ble_set_phy
+#define BLE_PHY_1M                  1
+#define BLE_PHY_2M                  2
+
 // BLE connection states
 typedef enum {
     BLE_STATE_IDLE,
@@ -63,6 +74,25 @@ typedef struct __attribute__((packed)) {
     uint32_t checksum;            // CRC32 checksum
 } config_packet_t;
 
+// Received frame or connection event, queued by the NimBLE transport
+typedef struct {
+    uint8_t event;                // transport_event_t
+    uint16_t length;
+    uint8_t data[FRAME_BATCH_MAX_SIZE];
+} ble_packet_t;
+
+// Queue statistics
+typedef struct {
+    uint32_t rx_pending;
+    uint32_t tx_pending;
+    uint32_t rx_dropped;          // Events lost because the game loop fell behind
+    uint32_t tx_dropped;          // Sends rejected because the host task fell behind
+    uint32_t tx_sent;             // Notifications
+    uint32_t tx_messages;         // Messages packed into them
+    uint32_t tx_batches;
+    uint16_t mtu;                 // Negotiated ATT MTU
+} ble_queue_stats_t;
+
 // BLE event callback type
 typedef void (*ble_event_callback_t)(uint8_t event_type, const uint8_t *data, uint16_t length);
 
@@ -78,9 +108,28 @@ esp_err_t ble_stop_scanning(void);
 
 // Data transmission
 esp_err_t ble_send_game_state(const game_state_packet_t *state);
+// Encoded by state_codec; replaces game_state_packet_t on the wire
+esp_err_t ble_send_state_delta(const uint8_t *data, uint16_t length);
 esp_err_t ble_send_input(const input_packet_t *input);
+// Encoded by input_history; replaces input_packet_t on the wire
+esp_err_t ble_send_input_history(const uint8_t *data, uint16_t length);
 esp_err_t ble_send_config(const config_packet_t *config);
 
+// Sends are queued as typed messages; flush packs everything queued so far
+// into as few frames as the transport allows, input first, then state,
+// then config, and sends them. Call once a frame, from the game loop only.
+void ble_flush(void);
+
+// Deliver received events to the registered callback on the calling task.
+// The callback never runs on the NimBLE task. Call from the game loop only.
+void ble_poll(void);
+
+// Carries the game over another link, such as a transport_loopback end,
+// instead of NimBLE; NULL goes back to NimBLE. Call from the game loop,
+// between races.
+void ble_set_transport(const transport_t *transport);
+void ble_get_queue_stats(ble_queue_stats_t *stats);
+
 // State queries
 ble_state_t ble_get_state(void);
 bool ble_is_connected(void);
@@ -92,6 +141,9 @@ void ble_register_callback(ble_event_callback_t callback);
 
 // Utility functions
 uint16_t ble_calculate_latency(void);
+// Interval in 1.25 ms units, timeout in 10 ms units; the peer may refuse.
+// The new interval shows in ble_get_connection_interval once in effect.
 void ble_update_connection_parameters(uint16_t interval, uint16_t latency, uint16_t timeout);
+void ble_set_phy(uint8_t phy);
 
 #endif // _BLE_H_
\ No newline at end of file
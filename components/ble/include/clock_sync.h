@@ -0,0 +1,112 @@
+#ifndef _CLOCK_SYNC_H_
+#define _CLOCK_SYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Message types; they share the config characteristic, told apart from
+// game configuration by config_type
+#define CLOCK_SYNC_PING         0xc0
+#define CLOCK_SYNC_PING_EPOCH   0xc1   // Ping from the reference carrying the timeline epoch
+#define CLOCK_SYNC_PONG         0xc2
+
+// Encoded message, the size of config_packet_t
+#define CLOCK_SYNC_PACKET_SIZE  12
+
+#define CLOCK_SYNC_WINDOW       8           // Samples kept; the lowest RTT one wins
+#define CLOCK_SYNC_PING_INTERVAL_US 250000
+#define CLOCK_SYNC_FAST_INTERVAL_US 50000   // Until the window has filled once
+#define CLOCK_SYNC_MAX_RTT_US   500000      // Slower replies are discarded
+#define CLOCK_SYNC_SKEW_INTERVAL_US 10000000  // Baseline for the drift estimate
+
+// Pacing: start correcting at CLOCK_SYNC_PACE_START frames off the shared
+// timeline, stop once level, and adjust at most once per
+// CLOCK_SYNC_PACE_SPACING ticks
+#define CLOCK_SYNC_PACE_START   2
+#define CLOCK_SYNC_PACE_SPACING 8
+
+typedef struct {
+    uint8_t type;
+    uint8_t sequence;
+    uint32_t origin_us;            // Low 32 bits of the pinger's clock; echoed by the pong
+    int64_t time_us;               // Pong: responder's clock. Epoch ping: the epoch. 48 bits on the wire
+} clock_sync_message_t;
+
+typedef struct {
+    int64_t offset_us;             // Peer clock minus local clock
+    uint32_t rtt_us;
+    int64_t local_us;              // When the pong arrived
+} clock_sync_sample_t;
+
+// One per link. Both sides ping; the reference (the host) owns the
+// timeline, the other side maps its clock onto the reference's.
+typedef struct {
+    bool is_reference;
+    uint32_t frame_rate_hz;
+
+    // Pinging
+    uint8_t next_sequence;
+    int64_t next_ping_us;
+
+    // Samples and the filtered estimate: offset_us at offset_time_us, moving
+    // by skew_ppm
+    clock_sync_sample_t samples[CLOCK_SYNC_WINDOW];
+    uint8_t sample_count;
+    uint8_t next_sample;
+    bool synced;
+    int64_t offset_us;
+    int64_t offset_time_us;
+    float skew_ppm;
+    uint32_t rtt_us;               // RTT of the sample the estimate last used
+    int64_t skew_interval_start_us;
+    clock_sync_sample_t skew_best;      // Lowest RTT sample of the current skew interval
+    clock_sync_sample_t skew_previous;  // And of the one before
+    bool skew_previous_valid;
+    bool skew_valid;
+
+    // Shared timeline: frame 0 at epoch_us on the reference clock
+    bool epoch_valid;
+    int64_t epoch_us;
+
+    // Pacing
+    int8_t pace_direction;         // 0 level, 1 running ahead, -1 behind
+    uint8_t pace_ticks;            // Since the last correction
+
+    // Statistics
+    uint32_t pings_sent;
+    uint32_t pongs_received;
+    uint32_t samples_rejected;
+    uint32_t frames_skipped;
+    uint32_t frames_added;
+} clock_sync_t;
+
+void clock_sync_init(clock_sync_t *sync, bool is_reference, uint32_t frame_rate_hz);
+
+void clock_sync_encode(const clock_sync_message_t *message, uint8_t *buffer);
+// Returns false if the buffer is not a clock sync message
+bool clock_sync_decode(const uint8_t *data, size_t length, clock_sync_message_t *message);
+
+// Fills a ping when one is due
+bool clock_sync_poll(clock_sync_t *sync, int64_t now_us, clock_sync_message_t *ping);
+
+// Handles a message from the peer. Returns true with reply filled when a
+// pong should go back.
+bool clock_sync_handle(clock_sync_t *sync, const clock_sync_message_t *message, int64_t now_us,
+                       clock_sync_message_t *reply);
+
+// The reference clock now; the local clock until synced
+int64_t clock_sync_reference_time(const clock_sync_t *sync, int64_t now_us);
+
+// Reference side: frame 0 of the shared timeline is now. The next pings
+// carry it to the peer.
+void clock_sync_start_timeline(clock_sync_t *sync, int64_t now_us);
+
+// Frame of the shared timeline due now. False until an epoch is known.
+bool clock_sync_frame(const clock_sync_t *sync, int64_t now_us, uint32_t *frame);
+
+// Frames to simulate this tick (0, 1 or 2) for a simulation that has run
+// local_frame frames, nudging it back onto the shared timeline
+int clock_sync_pace(clock_sync_t *sync, uint32_t local_frame, int64_t now_us);
+
+#endif // _CLOCK_SYNC_H_
@@ -0,0 +1,90 @@
+#ifndef _CONN_CONTROL_H_
+#define _CONN_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONN_CONTROL_PERIOD_US 1000000      // Measurements judged once a second
+#define CONN_CONTROL_HOLD_US 5000000        // Left alone after a change while the link settles
+#define CONN_CONTROL_TIGHTEN_PERIODS 2      // Bad periods in a row before reacting
+#define CONN_CONTROL_LOOSEN_PERIODS 10      // Good periods in a row before relaxing
+#define CONN_CONTROL_RTT_HIGH_US 50000
+#define CONN_CONTROL_RTT_LOW_US 30000
+#define CONN_CONTROL_LOSS_HIGH_PERCENT 10
+#define CONN_CONTROL_LOSS_LOW_PERCENT 2
+#define CONN_CONTROL_MIN_FRAMES 30          // Fewer frames than this say nothing about loss
+
+// Connection intervals in 1.25 ms units, supervision timeout in 10 ms units
+#define CONN_CONTROL_RACE_LEVELS 5          // 7.5, 10, 15, 20 and 30 ms
+#define CONN_CONTROL_IDLE_INTERVAL 40       // 50 ms in menus
+#define CONN_CONTROL_IDLE_LATENCY 4         // Peripheral may skip 4 events in 5
+#define CONN_CONTROL_TIMEOUT 400            // 4 s
+
+typedef enum {
+    CONN_CONTROL_PHY_1M = 1,               // Longer reach, fewer losses
+    CONN_CONTROL_PHY_2M = 2                // Half the air time per packet
+} conn_control_phy_t;
+
+typedef enum {
+    CONN_CONTROL_IDLE,                     // Menus and lobby: save power
+    CONN_CONTROL_RACE
+} conn_control_mode_t;
+
+typedef struct {
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+    conn_control_phy_t phy;
+} conn_control_params_t;
+
+// What the link looks like now. The frame counters are cumulative, as
+// input_history keeps them; recovered frames were lost the first time.
+typedef struct {
+    bool racing;
+    uint32_t rtt_us;                       // 0 until measured
+    uint32_t frames_delivered;
+    uint32_t frames_recovered;
+    uint16_t update_rate_hz;               // State updates the race needs per second
+} conn_control_input_t;
+
+// Chooses connection parameters. Menus get a long interval with peripheral
+// latency; a race starts on the tightest interval and 2M PHY, then steps
+// along the interval ladder and between PHYs as RTT and loss stay outside
+// their bands: tighter quickly, looser slowly, never longer than an update
+// period, and nothing for a while after each change.
+typedef struct {
+    bool started;
+    conn_control_mode_t mode;
+    uint8_t level;                         // Index into the race intervals
+    conn_control_phy_t phy;
+    conn_control_params_t current;
+
+    int64_t next_period_us;
+    int64_t hold_until_us;
+    uint32_t window_delivered;             // Counters at the start of the loss window
+    uint32_t window_recovered;
+    uint32_t loss_percent;                 // Of the last complete window
+
+    // Consecutive periods on each side of the bands
+    uint8_t slow_periods;
+    uint8_t fast_periods;
+    uint8_t lossy_periods;
+    uint8_t clean_periods;
+
+    // Statistics
+    uint32_t requests;
+    uint32_t tightened;
+    uint32_t loosened;
+    uint32_t phy_changes;
+} conn_control_t;
+
+void conn_control_init(conn_control_t *control);
+
+// Call often; true when params should be requested from the link
+bool conn_control_update(conn_control_t *control, const conn_control_input_t *input, int64_t now_us,
+                         conn_control_params_t *params);
+
+// Race interval of a ladder level, in 1.25 ms units
+uint16_t conn_control_race_interval(uint8_t level);
+
+#endif // _CONN_CONTROL_H_
@@ -0,0 +1,38 @@
+#ifndef _DESYNC_CHECK_H_
+#define _DESYNC_CHECK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DESYNC_CHECK_HISTORY 64            // Hashes kept per side, by frame; a power of two
+
+typedef struct {
+    uint32_t frame;
+    uint32_t hash;
+    bool valid;
+} desync_check_entry_t;
+
+// Compares the low 32 bits of the confirmed world hash (world_state) on
+// both peers. Local hashes are added as frames are confirmed, remote ones
+// as state packets bring them; each frame is compared once, when both
+// sides have it. The two confirmed frames rarely line up every frame, so
+// the history spans a second of either lagging the other.
+typedef struct {
+    desync_check_entry_t local[DESYNC_CHECK_HISTORY];
+    desync_check_entry_t remote[DESYNC_CHECK_HISTORY];
+    bool desynced;
+    uint32_t first_desync_frame;   // Valid once desynced
+
+    // Statistics
+    uint32_t checks;
+    uint32_t mismatches;
+} desync_check_t;
+
+void desync_check_init(desync_check_t *check);
+
+// Each returns true if this hash disagrees with the other side's for the
+// same frame. A frame already held for that side is ignored.
+bool desync_check_add_local(desync_check_t *check, uint32_t frame, uint32_t hash);
+bool desync_check_add_remote(desync_check_t *check, uint32_t frame, uint32_t hash);
+
+#endif // _DESYNC_CHECK_H_
@@ -0,0 +1,75 @@
+#ifndef _FRAME_BATCH_H_
+#define _FRAME_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_BATCH_ATT_HEADER 3        // Opcode and handle ahead of each notification's value
+#define FRAME_BATCH_MIN_SIZE 20         // Default ATT MTU of 23
+#define FRAME_BATCH_MAX_SIZE 253        // CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU of 256
+#define FRAME_BATCH_HEADER_SIZE 1       // Kind in the top 2 bits, length - 1 in the low 6
+#define FRAME_BATCH_MAX_MESSAGE 64
+#define FRAME_BATCH_QUEUE_BYTES 256     // Per kind, headers included
+
+// Priority order: a frame is packed from the first kind down
+typedef enum {
+    FRAME_BATCH_INPUT,
+    FRAME_BATCH_STATE,
+    FRAME_BATCH_EVENT,
+    FRAME_BATCH_KINDS
+} frame_batch_kind_t;
+
+// Called for each message of a frame, in order
+typedef void (*frame_batch_fn)(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length);
+
+typedef struct {
+    uint8_t data[FRAME_BATCH_QUEUE_BYTES];  // Header and payload of each message, oldest first
+    uint16_t length;
+    uint16_t sent;                 // Bytes already packed into frames
+} frame_batch_queue_t;
+
+// Typed messages queued over a frame and packed into as few notifications
+// as the MTU allows, so input, state and clock messages share one
+// connection event instead of taking one notification each. Messages are
+// never split; within a kind they keep their order.
+typedef struct {
+    uint16_t capacity;             // Bytes per notification: ATT MTU less its header
+    frame_batch_queue_t queues[FRAME_BATCH_KINDS];
+
+    // Statistics
+    uint32_t messages_queued;
+    uint32_t messages_dropped;     // Queue full, or larger than a notification
+    uint32_t frames_sent;
+    uint32_t bytes_sent;           // Headers included
+    uint32_t frames_received;
+    uint32_t messages_received;
+    uint32_t malformed;
+} frame_batch_t;
+
+void frame_batch_init(frame_batch_t *batch, uint16_t capacity);
+
+// Follows the negotiated MTU; clamped to FRAME_BATCH_MIN_SIZE..MAX_SIZE
+void frame_batch_set_capacity(frame_batch_t *batch, uint16_t capacity);
+
+// Queues a message of 1..FRAME_BATCH_MAX_MESSAGE bytes for the next flush.
+// False if its queue is full.
+bool frame_batch_add(frame_batch_t *batch, frame_batch_kind_t kind, const uint8_t *data, size_t length);
+
+bool frame_batch_pending(const frame_batch_t *batch);
+
+// Packs the next frame into buffer, which holds at least capacity bytes:
+// input messages first, then state, then events, as many as fit. Call
+// until it returns 0, after which the queues are empty.
+size_t frame_batch_next(frame_batch_t *batch, uint8_t *buffer);
+
+// Writes one message as a frame of its own, for links that deliver
+// messages singly. Returns the frame length, 0 if the message is invalid.
+size_t frame_batch_wrap(frame_batch_kind_t kind, const uint8_t *data, size_t length, uint8_t *buffer);
+
+// Checks the whole frame, then hands fn each message. False, without
+// calling fn, for a malformed frame.
+bool frame_batch_decode(frame_batch_t *batch, const uint8_t *data, size_t length, frame_batch_fn fn,
+                        void *context);
+
+#endif // _FRAME_BATCH_H_
@@ -0,0 +1,68 @@
+#ifndef _INPUT_HISTORY_H_
+#define _INPUT_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "physics.h"
+
+// Local frames kept for resending, and the most one packet carries.
+// A power of two, at most 1 << INPUT_HISTORY_COUNT_BITS.
+#define INPUT_HISTORY_FRAMES 32
+
+#define INPUT_HISTORY_FRAME_BITS 16     // Frame numbers travel as their low 16 bits
+#define INPUT_HISTORY_COUNT_BITS 5      // Frames in the packet, and run lengths, minus one
+#define INPUT_HISTORY_THROTTLE_BITS 7   // Throttle and brake 0..100
+#define INPUT_HISTORY_STEERING_BITS 8   // -100..100
+#define INPUT_HISTORY_BUTTON_BITS 8
+
+// One notification at the default ATT MTU with its frame_batch header;
+// frames that do not fit wait for the next packet
+#define INPUT_HISTORY_MAX_PACKET 19
+
+// Called for each frame a packet carries that the receiver had not had yet
+typedef void (*input_history_fn)(void *context, uint8_t player, uint32_t frame, const physics_input_t *input);
+
+// One per link. Each packet carries the local frames the peer has not
+// acknowledged, oldest first and run-length encoded, plus the ack for the
+// peer's frames, so a lost packet is covered by the next one.
+typedef struct {
+    uint8_t player_id;
+    uint8_t frames_per_packet;     // INPUT_HISTORY_FRAMES; 1 sends only the newest, as input_packet_t did
+
+    // Sending
+    physics_input_t sent[INPUT_HISTORY_FRAMES];  // Input for frame f at f % INPUT_HISTORY_FRAMES
+    uint32_t next_frame;           // One past the newest local frame
+    uint32_t peer_ack;             // The peer has every local frame below this
+
+    // Receiving
+    uint32_t received_until;       // Every peer frame below this was delivered; sent back as the ack
+    uint32_t received_mask;        // Bit i: frame received_until + i arrived out of order and was delivered
+
+    // Statistics
+    uint32_t packets_sent;
+    uint32_t bytes_sent;
+    uint32_t frames_sent;          // Including repeats
+    uint32_t packets_received;
+    uint32_t frames_delivered;
+    uint32_t frames_recovered;     // Delivered as a repeat: their first packet was lost or late
+    uint32_t frames_lost;          // Given up on, a newer frame being INPUT_HISTORY_FRAMES ahead
+    uint32_t malformed;
+} input_history_t;
+
+void input_history_init(input_history_t *history, uint8_t player_id);
+
+// Local input for the next frame; frames must be pushed in order
+void input_history_push(input_history_t *history, uint32_t frame, const physics_input_t *input);
+
+// Packs the unacknowledged frames, oldest first, as many as fit in size
+// (the newest alone when all are acked). Returns the packet length, 0 if
+// nothing has been pushed or not even one frame fits.
+size_t input_history_encode(input_history_t *history, uint8_t *buffer, size_t size);
+
+// Takes the peer's ack and hands fn the frames not delivered before,
+// oldest first. Returns false for a malformed packet.
+bool input_history_decode(input_history_t *history, const uint8_t *data, size_t length, input_history_fn fn,
+                          void *context);
+
+#endif // _INPUT_HISTORY_H_
@@ -0,0 +1,66 @@
+#ifndef _JITTER_BUFFER_H_
+#define _JITTER_BUFFER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "state_codec.h"
+
+#define JITTER_BUFFER_SIZE 16                   // Snapshots held, a power of two
+#define JITTER_BUFFER_MIN_DELAY_US 10000
+#define JITTER_BUFFER_MAX_DELAY_US 250000
+#define JITTER_BUFFER_JITTER_MULTIPLIER 3       // Jitter margins in the delay
+#define JITTER_BUFFER_MAX_EXTRAPOLATION_US 100000  // Then the car holds still
+#define JITTER_BUFFER_SLEW_DIVISOR 20           // Playout runs at most 5% fast or slow while the delay moves
+#define JITTER_BUFFER_RESET_US 500000           // Off by more than this, the playout clock jumps
+
+typedef struct {
+    state_codec_car_t state;
+    int64_t time_us;               // Sender simulation time: frame / frame rate
+} jitter_buffer_entry_t;
+
+// Remote car snapshots ordered by sender time. The car is shown as it was
+// a little while ago, interpolated between the snapshots either side, so
+// packets arriving unevenly still give even motion. The delay is the send
+// interval plus a few jitter margins and follows the link as it changes.
+typedef struct {
+    uint32_t frame_rate_hz;
+    jitter_buffer_entry_t entries[JITTER_BUFFER_SIZE];  // Oldest first
+    uint8_t count;
+
+    // Arrival statistics; transit is arrival minus sender time, so it
+    // includes the unknown clock offset, which cancels out
+    bool have_transit;
+    int64_t transit_us;            // Smoothed
+    int64_t last_transit_us;
+    int64_t last_time_us;          // Sender time of the newest snapshot
+    uint32_t jitter_us;            // Mean deviation of transit between packets (RFC 3550)
+    uint32_t interval_us;          // Smoothed sender time between packets
+
+    // Playout: sender time shown = local time - playout_offset_us
+    bool playing;
+    uint32_t target_delay_us;
+    int64_t playout_offset_us;
+    int64_t last_sample_us;
+    int64_t last_render_time_us;
+
+    // Statistics
+    uint32_t received;
+    uint32_t late;                 // Older than what was already shown
+    uint32_t duplicates;
+    uint32_t interpolated;
+    uint32_t extrapolated;
+    uint32_t held;                 // Past the extrapolation limit, or before the oldest snapshot
+} jitter_buffer_t;
+
+void jitter_buffer_init(jitter_buffer_t *buffer, uint32_t frame_rate_hz);
+
+void jitter_buffer_push(jitter_buffer_t *buffer, const state_codec_car_t *state, int64_t arrival_us);
+
+// The remote car to show at local time now_us. False until a snapshot has
+// arrived.
+bool jitter_buffer_sample(jitter_buffer_t *buffer, int64_t now_us, state_codec_car_t *state);
+
+// Current delay behind the newest sender time, as playout sees it
+uint32_t jitter_buffer_delay(const jitter_buffer_t *buffer);
+
+#endif // _JITTER_BUFFER_H_
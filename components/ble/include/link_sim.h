@@ -0,0 +1,53 @@
+#ifndef _LINK_SIM_H_
+#define _LINK_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "frame_batch.h"
+
+#define LINK_SIM_QUEUE 64                  // Packets in flight per direction
+#define LINK_SIM_MAX_PACKET FRAME_BATCH_MAX_SIZE
+
+typedef struct {
+    uint32_t latency_us;                   // Every packet
+    uint32_t jitter_us;                    // Plus up to this much
+    uint32_t loss_percent;
+    uint32_t reorder_percent;              // Held back behind the packets after them
+    uint32_t seed;
+} link_sim_config_t;
+
+typedef struct {
+    int64_t deliver_us;
+    uint16_t length;
+    uint8_t data[LINK_SIM_MAX_PACKET];
+} link_sim_packet_t;
+
+// One direction of an impaired link. Packets arrive in order, as BLE
+// delivers them, unless picked for reordering: those take an extra
+// latency and let later packets pass.
+typedef struct {
+    link_sim_config_t config;
+    link_sim_packet_t packets[LINK_SIM_QUEUE];
+    uint8_t count;
+    uint32_t rng;
+    int64_t last_deliver_us;               // In-order packets never arrive before this
+
+    // Statistics
+    uint32_t sent;
+    uint32_t lost;
+    uint32_t reordered;
+    uint32_t overflowed;                   // Queue full: dropped as a congested link would
+    uint32_t delivered;
+} link_sim_t;
+
+void link_sim_init(link_sim_t *link, const link_sim_config_t *config);
+
+// Takes a packet sent at now_us; false if it will never arrive
+bool link_sim_send(link_sim_t *link, const uint8_t *data, size_t length, int64_t now_us);
+
+// The next packet due by now_us, earliest first, into buffer (at least
+// LINK_SIM_MAX_PACKET bytes). Returns its length, 0 when none is due.
+size_t link_sim_receive(link_sim_t *link, int64_t now_us, uint8_t *buffer);
+
+#endif // _LINK_SIM_H_
@@ -0,0 +1,95 @@
+#ifndef _NET_TELEMETRY_H_
+#define _NET_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NET_TELEMETRY_BUCKETS     16        // The last one takes everything above the others
+#define NET_TELEMETRY_PERIOD_US   1000000   // Log line and resimulation window
+#define NET_TELEMETRY_LINE_SIZE   256
+
+typedef enum {
+    NET_TELEMETRY_RTT,                      // us, per clock sync pong
+    NET_TELEMETRY_ONE_WAY,                  // us, per state packet once the timeline is shared
+    NET_TELEMETRY_JITTER,                   // us, change in transit time between state packets
+    NET_TELEMETRY_ROLLBACK_DEPTH,           // Frames, per rollback
+    NET_TELEMETRY_RESIMULATED,              // Frames resimulated, per second
+    NET_TELEMETRY_METRICS
+} net_telemetry_metric_t;
+
+typedef enum {
+    NET_TELEMETRY_INPUT,
+    NET_TELEMETRY_STATE,
+    NET_TELEMETRY_CLOCK,
+    NET_TELEMETRY_TYPES
+} net_telemetry_type_t;
+
+typedef struct {
+    uint32_t counts[NET_TELEMETRY_BUCKETS];
+    uint32_t samples;
+    uint32_t max;
+    uint64_t sum;
+} net_telemetry_histogram_t;
+
+typedef struct {
+    uint32_t packets;
+    uint32_t bytes;                         // Message bytes, without frame headers
+} net_telemetry_counter_t;
+
+// Everything recorded since the last reset; a plain copy, so it can be
+// diffed, logged or sent off the device
+typedef struct {
+    net_telemetry_histogram_t histograms[NET_TELEMETRY_METRICS];
+    net_telemetry_counter_t sent[NET_TELEMETRY_TYPES];
+    net_telemetry_counter_t received[NET_TELEMETRY_TYPES];
+    uint32_t inputs_delivered;              // Remote input frames, first time each
+    uint32_t inputs_recovered;              // Of those, the ones a lost or late packet held up
+    uint32_t inputs_lost;
+    int64_t since_us;
+} net_telemetry_snapshot_t;
+
+// Fixed buckets and counters, so a sample costs a few compares and adds
+// and nothing is allocated; cheap enough to stay on in every race. Single
+// threaded: record and tick from the game loop.
+typedef struct {
+    net_telemetry_snapshot_t totals;
+    net_telemetry_snapshot_t logged;        // Totals at the last log line
+    int64_t last_transit_us;
+    bool have_transit;
+    int64_t period_start_us;
+    uint32_t period_resimulated;
+} net_telemetry_t;
+
+void net_telemetry_init(net_telemetry_t *telemetry, int64_t now_us);
+void net_telemetry_reset(net_telemetry_t *telemetry, int64_t now_us);
+void net_telemetry_snapshot(const net_telemetry_t *telemetry, net_telemetry_snapshot_t *snapshot);
+
+void net_telemetry_record(net_telemetry_t *telemetry, net_telemetry_metric_t metric, uint32_t value);
+
+// A state packet sent for the frame that began at send_us on the sender's
+// clock arrived at arrival_us on ours. The clocks need not agree: jitter
+// is the change in the difference from one packet to the next (RFC 3550).
+void net_telemetry_record_transit(net_telemetry_t *telemetry, int64_t send_us, int64_t arrival_us);
+
+void net_telemetry_record_rollback(net_telemetry_t *telemetry, uint32_t depth, uint32_t resimulated);
+
+void net_telemetry_count_sent(net_telemetry_t *telemetry, net_telemetry_type_t type, size_t bytes);
+void net_telemetry_count_received(net_telemetry_t *telemetry, net_telemetry_type_t type, size_t bytes);
+void net_telemetry_count_inputs(net_telemetry_t *telemetry, uint32_t delivered, uint32_t recovered, uint32_t lost);
+
+// Call every step. Once a period it closes the resimulation window and,
+// if line is not NULL, writes a one-line summary of what was recorded
+// since the previous one (NET_TELEMETRY_LINE_SIZE bytes). Returns true
+// when a period closed.
+bool net_telemetry_tick(net_telemetry_t *telemetry, int64_t now_us, char *line, size_t size);
+
+// Upper bound of the bucket holding the given percentile; the largest
+// value seen for the last bucket. 0 with no samples.
+uint32_t net_telemetry_percentile(const net_telemetry_histogram_t *histogram, net_telemetry_metric_t metric,
+                                  uint32_t percent);
+
+// Upper bound of a bucket; UINT32_MAX for the last
+uint32_t net_telemetry_bucket_bound(net_telemetry_metric_t metric, int bucket);
+
+#endif // _NET_TELEMETRY_H_
@@ -4,14 +4,24 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "ble.h"
 #include "game_types.h"
 #include "physics.h"
+#include "rollback.h"
+#include "state_codec.h"
+#include "input_history.h"
+#include "clock_sync.h"
+#include "jitter_buffer.h"
+#include "conn_control.h"
+#include "net_telemetry.h"
+#include "desync_check.h"
 
 // Protocol configuration
 #define PROTOCOL_INPUT_BUFFER_SIZE      64
 #define PROTOCOL_MAX_LATENCY_SAMPLES    100
 #define PROTOCOL_PREDICTION_THRESHOLD   5.0f  // 5 units distance
-#define PROTOCOL_MAX_PREDICTION_FRAMES  8     // Maximum frames to predict ahead
+#define PROTOCOL_MAX_PREDICTION_FRAMES  ROLLBACK_MAX_FRAMES  // Maximum frames to predict ahead
+#define PROTOCOL_FRAME_RATE_HZ          STATE_CODEC_FRAMES_PER_SECOND  // Shared timeline rate
 
 // Protocol statistics structure
 typedef struct {
@@ -45,6 +55,36 @@ typedef struct {
     uint32_t jitter;
 } protocol_state_t;
 
+// Inputs by frame, for prediction
+typedef struct {
+    input_packet_t inputs[PROTOCOL_INPUT_BUFFER_SIZE];
+    uint32_t start_frame;
+    uint32_t count;
+} protocol_input_buffer_t;
+
+// Everything the protocol keeps about one link
+typedef struct {
+    protocol_state_t state;
+    protocol_input_buffer_t local_inputs;
+    protocol_input_buffer_t remote_inputs;
+    protocol_prediction_state_t prediction;
+    state_codec_t state_codec;             // Baselines for both directions of the state packets
+    rollback_t *rollback;                  // Fed with remote inputs, if the race is networked
+    input_history_t input_history;         // Local inputs resent until acked, and the ack for the peer's
+    clock_sync_t clock_sync;               // Offset to the host's clock and the shared frame timeline
+    jitter_buffer_t remote_playout;        // Remote car states, played out a jitter margin behind
+    conn_control_t conn_control;           // Connection interval and PHY for the current link quality
+    desync_check_t desync_check;           // Confirmed world hashes of both peers, compared frame by frame
+
+    // Histograms and counters of the link, the engine counts already
+    // taken, and the last line logged
+    net_telemetry_t telemetry;
+    uint32_t telemetry_rollbacks;
+    uint32_t telemetry_resimulated;
+    uint32_t telemetry_lines;
+    char telemetry_line[NET_TELEMETRY_LINE_SIZE];
+} protocol_context_t;
+
 // Protocol initialization
 esp_err_t protocol_init(bool is_host);
 void protocol_reset(void);
@@ -62,12 +102,58 @@ void protocol_unpack_game_state(const game_state_packet_t *packet,
 void protocol_unpack_input(const input_packet_t *packet, 
                           float *throttle, float *brake, float *steering);
 
+// Compact state packets (state_codec): a delta against the last state the
+// peer acked, or a keyframe. Encode returns the length, 0 on failure.
+// Decoded states also go into the jitter buffer, which sets the jitter
+// statistic; sample_remote_state gives the remote car to show now, a
+// jitter margin behind and interpolated, false until a state has arrived.
+size_t protocol_encode_game_state(const physics_world_t *world, uint8_t car, uint32_t frame,
+                                  uint8_t *buffer, size_t size);
+bool protocol_decode_game_state(const uint8_t *data, size_t length, state_codec_car_t *state);
+bool protocol_sample_remote_state(state_codec_car_t *state);
+
+// Input history packets (input_history): every frame the peer has not acked
+// rides along, so one lost notification costs nothing. Store each local
+// frame once, then encode a packet every step; decoded frames fill the
+// remote input buffer and go to the rollback engine.
+void protocol_store_frame_input(const physics_input_t *input, uint32_t frame);
+size_t protocol_encode_input_history(uint8_t *buffer, size_t size);
+bool protocol_decode_input_history(const uint8_t *data, size_t length);
+
 // Input prediction and synchronization
 void protocol_store_local_input(const input_state_t *input, uint32_t frame);
 bool protocol_predict_remote_input(uint32_t frame, input_packet_t *predicted_input);
 bool protocol_should_rollback(uint32_t frame, const car_physics_t *predicted, 
                              const car_physics_t *actual, float threshold);
 
+// Clock sync (clock_sync) over the config characteristic: poll sends a
+// ping when one is due; handle_config takes every config packet and
+// returns false for those that are not clock messages. The host starts the
+// shared frame timeline at race start; pace_frames says how many frames
+// (0..2) this step should simulate to stay on it. avg_latency is half the
+// filtered RTT.
+void protocol_clock_poll(void);
+bool protocol_handle_config(const uint8_t *data, size_t length);
+void protocol_start_timeline(void);
+int protocol_pace_frames(uint32_t local_frame);
+
+// Connection parameters (conn_control) follow the link: call every step
+// while connected with whether a race is on and the state update rate it
+// needs; RTT comes from clock sync and loss from the input history.
+void protocol_link_control(bool racing, uint16_t update_rate_hz);
+
+// Remote inputs unpacked while an engine is set are forwarded to it, which
+// rolls back on the next advance if they differ from its prediction. NULL
+// detaches it. Either way the input history restarts at frame 0.
+void protocol_set_rollback(rollback_t *rollback);
+
+// Desync checks (desync_check): state packets carry the engine's confirmed
+// world hash, and check_desync, called after each step's advances, records
+// ours. Either side logs an error on a mismatch; check_desync returns true
+// when it found one. History restarts with each engine.
+bool protocol_check_desync(void);
+void protocol_get_desync(desync_check_t *check);
+
 // Frame management
 void protocol_advance_frame(void);
 
@@ -77,6 +163,19 @@ void protocol_handle_connection(bool connected);
 // Statistics
 void protocol_get_stats(protocol_stats_t *stats);
 
+// Telemetry (net_telemetry) of the link: RTT, one-way delay, jitter,
+// rollback depth, resimulation and per type traffic. Call poll every step;
+// it picks up the engine's rollbacks and logs a line once a second.
+// Counts run from the last reset or reconnection.
+void protocol_telemetry_poll(void);
+void protocol_get_telemetry(net_telemetry_snapshot_t *snapshot);
+void protocol_reset_telemetry(void);
+
+// The context every other call works on. The game keeps the built-in one;
+// host rigs racing two peers in one process give each its own, selected
+// before each step and protocol_init once. NULL selects the built-in one.
+void protocol_select(protocol_context_t *context);
+
 // Utility functions
 uint16_t protocol_estimate_latency(void);
 bool protocol_is_input_late(uint32_t frame_number);
@@ -0,0 +1,99 @@
+#ifndef _STATE_CODEC_H_
+#define _STATE_CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "physics.h"
+
+// Quantisation: what the remote car needs on screen, not what physics holds
+#define STATE_CODEC_POSITION_SHIFT 12   // 16.16 to 1/16 unit
+#define STATE_CODEC_POSITION_BITS  20   // +-32768 units
+#define STATE_CODEC_VELOCITY_SHIFT 11   // 16.16 to 1/32 unit/s
+#define STATE_CODEC_VELOCITY_BITS  15   // +-512 units/s
+#define STATE_CODEC_HEADING_BITS   12   // 1/4096 turn, about 0.09 degrees
+#define STATE_CODEC_LAP_BITS       8
+#define STATE_CODEC_CHECKPOINT_BITS 4   // PHYSICS_MAX_CHECKPOINTS
+
+// Packets are numbered modulo 64
+#define STATE_CODEC_SEQUENCE_BITS  6
+#define STATE_CODEC_FRAME_DELTA_BITS 6  // Frames since the baseline, else a keyframe
+#define STATE_CODEC_FRAMES_PER_SECOND PHYSICS_RATE_HZ
+#define STATE_CODEC_HASH_AGE_BITS  6    // Frames from the hashed frame to the packet's
+// Sent and received states kept as baselines. A power of two; when the peer
+// has acked nothing this recent the next packet is a keyframe.
+#define STATE_CODEC_HISTORY        16
+
+// Largest encoded packet (a keyframe with an ack is 18 bytes); with its
+// frame_batch header it fits a notification at the default ATT MTU. The
+// world hash only goes in packets that stay within it, deltas in practice.
+#define STATE_CODEC_MAX_PACKET     19
+
+// One car's state as sent, in quantised units
+typedef struct {
+    uint32_t frame;
+    int32_t position_x;
+    int32_t position_y;
+    int32_t velocity_x;
+    int32_t velocity_y;
+    uint16_t heading;
+    uint8_t checkpoint;
+    uint8_t lap;
+    bool finished;
+    // Low 32 bits of the sender's confirmed world hash (world_state), for
+    // desync checks. Left out, and invalid on decode, when it does not fit.
+    bool hash_valid;
+    uint32_t hash_frame;
+    uint32_t hash;
+} state_codec_car_t;
+
+typedef struct {
+    state_codec_car_t state;
+    uint8_t sequence;
+    bool valid;
+} state_codec_entry_t;
+
+// One per link. Both directions share it: outgoing packets carry the ack
+// for the peer's packets, incoming ones carry the peer's ack for ours.
+typedef struct {
+    uint8_t player_id;
+
+    // Sending
+    uint8_t next_sequence;
+    state_codec_entry_t sent[STATE_CODEC_HISTORY];
+    bool peer_ack_valid;
+    uint8_t peer_ack;              // Newest of our packets the peer decoded
+
+    // Receiving
+    state_codec_entry_t received[STATE_CODEC_HISTORY];
+    bool ack_valid;
+    uint8_t ack;                   // Newest of the peer's packets we decoded
+
+    // Statistics
+    uint32_t keyframes_sent;
+    uint32_t deltas_sent;
+    uint32_t bytes_sent;
+    uint32_t packets_decoded;
+    uint32_t missing_baselines;    // Deltas dropped because their baseline was lost
+    uint32_t malformed;
+} state_codec_t;
+
+void state_codec_init(state_codec_t *codec, uint8_t player_id);
+
+// Quantise a car from the world, or write a decoded state back into it.
+// Apply leaves the rest of the car (mass, drag, ...) alone. Quantise leaves
+// no hash; the caller adds one if it has it.
+void state_codec_quantise(const physics_world_t *world, uint8_t car, uint32_t frame, state_codec_car_t *state);
+void state_codec_apply(const state_codec_car_t *state, physics_world_t *world, uint8_t car);
+
+// Encodes a delta against the newest baseline the peer has acked, or a
+// keyframe when there is none. Returns the packet length, 0 if size is too
+// small. state is stored as a future baseline.
+size_t state_codec_encode(state_codec_t *codec, const state_codec_car_t *state, uint8_t *buffer, size_t size);
+
+// Decodes a packet from the peer. Returns false, without acking it, if the
+// packet is malformed or its baseline was never received.
+bool state_codec_decode(state_codec_t *codec, const uint8_t *data, size_t length, state_codec_car_t *state,
+                        uint8_t *player_id);
+
+#endif // _STATE_CODEC_H_
@@ -0,0 +1,56 @@
+#ifndef _TRANSPORT_H_
+#define _TRANSPORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    TRANSPORT_CONNECTED,
+    TRANSPORT_DISCONNECTED,
+    TRANSPORT_FRAME                        // data holds one frame_batch frame
+} transport_event_t;
+
+typedef int64_t (*transport_clock_fn)(void);
+
+typedef void (*transport_receive_fn)(void *context, transport_event_t event, const uint8_t *data, size_t length);
+
+// The link under ble_send_* and the BLE event callback: it carries whole
+// frame_batch frames and reports connection changes in order with them.
+// The NimBLE backend lives in ble.c; transport_loopback and transport_udp
+// let host builds race each other over a simulated link.
+typedef struct {
+    const char *name;
+    bool (*send)(void *state, const uint8_t *frame, size_t length);
+    // Hands fn every event due since the last poll, on the calling task
+    void (*poll)(void *state, transport_receive_fn fn, void *context);
+    bool (*connected)(const void *state);
+    uint16_t (*frame_size)(const void *state);  // Largest frame, for frame_batch_set_capacity
+} transport_ops_t;
+
+typedef struct {
+    const transport_ops_t *ops;
+    void *state;
+} transport_t;
+
+static inline bool transport_send(const transport_t *transport, const uint8_t *frame, size_t length)
+{
+    return transport->ops->send(transport->state, frame, length);
+}
+
+static inline void transport_poll(const transport_t *transport, transport_receive_fn fn, void *context)
+{
+    transport->ops->poll(transport->state, fn, context);
+}
+
+static inline bool transport_connected(const transport_t *transport)
+{
+    return transport->ops->connected(transport->state);
+}
+
+static inline uint16_t transport_frame_size(const transport_t *transport)
+{
+    return transport->ops->frame_size(transport->state);
+}
+
+#endif // _TRANSPORT_H_
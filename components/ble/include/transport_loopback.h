@@ -0,0 +1,44 @@
+#ifndef _TRANSPORT_LOOPBACK_H_
+#define _TRANSPORT_LOOPBACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
+#include "link_sim.h"
+
+typedef struct transport_loopback_end {
+    link_sim_t inbound;                    // Frames on their way to this end
+    struct transport_loopback_end *peer;
+    struct transport_loopback *loopback;
+    bool reported_up;                      // Last connection state handed to poll
+    uint32_t reported_session;
+
+    // Statistics
+    uint32_t frames_sent;
+    uint32_t frames_received;
+} transport_loopback_end_t;
+
+// Two endpoints in one process, each direction an impaired link_sim. Time
+// comes from clock, so a test can run a race faster than real time.
+typedef struct transport_loopback {
+    transport_loopback_end_t ends[2];
+    transport_clock_fn clock;
+    uint16_t frame_size;
+    bool up;
+    uint32_t session;                      // Counts the times the link came up
+} transport_loopback_t;
+
+// Both directions take config; the second is seeded differently. The link
+// starts up. frame_size 0 means FRAME_BATCH_MAX_SIZE.
+void transport_loopback_init(transport_loopback_t *loopback, const link_sim_config_t *config,
+                             transport_clock_fn clock, uint16_t frame_size);
+
+// The transport for end 0 or 1
+void transport_loopback_endpoint(transport_loopback_t *loopback, int end, transport_t *transport);
+
+// Takes the link down, losing whatever is in flight, or brings it back.
+// Each end sees the change on its next poll, as a disconnect and a fresh
+// connect even if the link was back before it polled.
+void transport_loopback_set_up(transport_loopback_t *loopback, bool up);
+
+#endif // _TRANSPORT_LOOPBACK_H_
@@ -0,0 +1,48 @@
+#ifndef _TRANSPORT_UDP_H_
+#define _TRANSPORT_UDP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
+#include "link_sim.h"
+
+#define TRANSPORT_UDP_HELLO_US   100000    // Empty datagrams until the peer is heard
+#define TRANSPORT_UDP_IDLE_US    250000    // And whenever nothing else has gone for this long
+#define TRANSPORT_UDP_TIMEOUT_US 2000000   // Silence after which the link is down
+
+// A link to a peer on 127.0.0.1, one frame per datagram, for racing two
+// host processes. Outgoing frames pass through a link_sim first; empty
+// keepalives skip it, so the link comes up however lossy it is. Host
+// builds only: not part of the ESP-IDF component.
+typedef struct {
+    int socket;
+    uint16_t port;
+    uint16_t peer_port;
+    link_sim_t outbound;
+    transport_clock_fn clock;
+    uint16_t frame_size;
+    bool connected;
+    bool reported_up;
+    int64_t last_heard_us;
+    int64_t last_sent_us;
+
+    // Statistics
+    uint32_t datagrams_sent;
+    uint32_t datagrams_received;
+    uint32_t keepalives_sent;
+    uint32_t send_errors;
+} transport_udp_t;
+
+// Binds port on 127.0.0.1, 0 for any free one. clock NULL uses
+// CLOCK_MONOTONIC; frame_size 0 means FRAME_BATCH_MAX_SIZE. False if the
+// socket cannot be set up.
+bool transport_udp_open(transport_udp_t *udp, uint16_t port, uint16_t peer_port, const link_sim_config_t *config,
+                        transport_clock_fn clock, uint16_t frame_size);
+void transport_udp_close(transport_udp_t *udp);
+
+// For a peer that bound port 0
+void transport_udp_set_peer(transport_udp_t *udp, uint16_t peer_port);
+
+void transport_udp_endpoint(transport_udp_t *udp, transport_t *transport);
+
+#endif // _TRANSPORT_UDP_H_
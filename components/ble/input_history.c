@@ -0,0 +1,241 @@
+#include "input_history.h"
+#include "bitstream.h"
+#include <string.h>
+
+#define FRAME_MASK ((1u << INPUT_HISTORY_FRAME_BITS) - 1)
+#define INPUT_BITS (2 * INPUT_HISTORY_THROTTLE_BITS + INPUT_HISTORY_STEERING_BITS + INPUT_HISTORY_BUTTON_BITS)
+#define HEADER_BITS (1 + 2 * INPUT_HISTORY_FRAME_BITS + INPUT_HISTORY_COUNT_BITS)
+
+// Runs after the first name the fields that differ from the run before
+#define FIELD_THROTTLE 0x1
+#define FIELD_BRAKE 0x2
+#define FIELD_STEERING 0x4
+#define FIELD_BUTTONS 0x8
+#define FIELD_MASK_BITS 4
+
+_Static_assert(INPUT_HISTORY_FRAMES <= 1 << INPUT_HISTORY_COUNT_BITS, "count field must cover the history");
+_Static_assert((INPUT_HISTORY_FRAMES & (INPUT_HISTORY_FRAMES - 1)) == 0, "history must be a power of two");
+
+typedef struct {
+    physics_input_t input;
+    uint32_t length;
+} run_t;
+
+static uint32_t extend_frame(uint32_t low, uint32_t reference);
+static unsigned changed_fields(const physics_input_t *input, const physics_input_t *previous);
+static unsigned run_bits(unsigned fields, bool first);
+static void write_input(bit_writer_t *writer, const physics_input_t *input, unsigned fields);
+static void read_input(bit_reader_t *reader, physics_input_t *input, unsigned fields);
+
+void input_history_init(input_history_t *history, uint8_t player_id)
+{
+    memset(history, 0, sizeof(input_history_t));
+    history->player_id = player_id;
+    history->frames_per_packet = INPUT_HISTORY_FRAMES;
+}
+
+void input_history_push(input_history_t *history, uint32_t frame, const physics_input_t *input)
+{
+    // Frames before the first one pushed were never held
+    if (history->next_frame == 0 && history->peer_ack < frame) {
+        history->peer_ack = frame;
+    }
+    history->sent[frame % INPUT_HISTORY_FRAMES] = *input;
+    history->next_frame = frame + 1;
+}
+
+size_t input_history_encode(input_history_t *history, uint8_t *buffer, size_t size)
+{
+    if (history->next_frame == 0) {
+        return 0;
+    }
+
+    uint32_t window = history->frames_per_packet;
+    if (window == 0 || window > INPUT_HISTORY_FRAMES) {
+        window = INPUT_HISTORY_FRAMES;
+    }
+    uint32_t start = history->next_frame > window ? history->next_frame - window : 0;
+    if (history->peer_ack > start) {
+        start = history->peer_ack;
+    }
+    if (start >= history->next_frame) {
+        start = history->next_frame - 1;
+    }
+
+    // Group into runs, oldest first, while the packet has room
+    run_t runs[INPUT_HISTORY_FRAMES];
+    uint32_t run_count = 0;
+    uint32_t frame_count = 0;
+    size_t bits = HEADER_BITS;
+    for (uint32_t frame = start; frame < history->next_frame; frame++) {
+        const physics_input_t *input = &history->sent[frame % INPUT_HISTORY_FRAMES];
+        if (run_count > 0) {
+            unsigned fields = changed_fields(input, &runs[run_count - 1].input);
+            if (fields == 0) {
+                runs[run_count - 1].length++;
+                frame_count++;
+                continue;
+            }
+            bits += run_bits(fields, false);
+        } else {
+            bits += run_bits(0, true);
+        }
+        if (bits > size * 8) {
+            break;
+        }
+        runs[run_count].input = *input;
+        runs[run_count].length = 1;
+        run_count++;
+        frame_count++;
+    }
+    if (frame_count == 0) {
+        return 0;
+    }
+
+    bit_writer_t writer;
+    bit_writer_init(&writer, buffer, size);
+    bit_write(&writer, history->player_id, 1);
+    bit_write(&writer, history->received_until & FRAME_MASK, INPUT_HISTORY_FRAME_BITS);
+    bit_write(&writer, start & FRAME_MASK, INPUT_HISTORY_FRAME_BITS);
+    bit_write(&writer, frame_count - 1, INPUT_HISTORY_COUNT_BITS);
+    for (uint32_t i = 0; i < run_count; i++) {
+        bit_write(&writer, runs[i].length - 1, INPUT_HISTORY_COUNT_BITS);
+        if (i == 0) {
+            write_input(&writer, &runs[i].input, FIELD_THROTTLE | FIELD_BRAKE | FIELD_STEERING | FIELD_BUTTONS);
+        } else {
+            unsigned fields = changed_fields(&runs[i].input, &runs[i - 1].input);
+            bit_write(&writer, fields, FIELD_MASK_BITS);
+            write_input(&writer, &runs[i].input, fields);
+        }
+    }
+    if (writer.overflow) {
+        return 0;
+    }
+
+    size_t length = bit_writer_bytes(&writer);
+    history->packets_sent++;
+    history->bytes_sent += length;
+    history->frames_sent += frame_count;
+    return length;
+}
+
+bool input_history_decode(input_history_t *history, const uint8_t *data, size_t length, input_history_fn fn,
+                          void *context)
+{
+    bit_reader_t reader;
+    bit_reader_init(&reader, data, length);
+
+    uint8_t player = bit_read(&reader, 1);
+    uint32_t ack_low = bit_read(&reader, INPUT_HISTORY_FRAME_BITS);
+    uint32_t start_low = bit_read(&reader, INPUT_HISTORY_FRAME_BITS);
+    uint32_t frame_count = bit_read(&reader, INPUT_HISTORY_COUNT_BITS) + 1;
+
+    physics_input_t inputs[1 << INPUT_HISTORY_COUNT_BITS];
+    uint32_t decoded = 0;
+    physics_input_t input = {0};
+    while (decoded < frame_count && !reader.overflow) {
+        uint32_t run_length = bit_read(&reader, INPUT_HISTORY_COUNT_BITS) + 1;
+        if (decoded == 0) {
+            read_input(&reader, &input, FIELD_THROTTLE | FIELD_BRAKE | FIELD_STEERING | FIELD_BUTTONS);
+        } else {
+            read_input(&reader, &input, bit_read(&reader, FIELD_MASK_BITS));
+        }
+        if (run_length > frame_count - decoded || input.throttle > 100 || input.brake > 100) {
+            break;
+        }
+        for (uint32_t i = 0; i < run_length; i++) {
+            inputs[decoded++] = input;
+        }
+    }
+    if (reader.overflow || decoded != frame_count) {
+        history->malformed++;
+        return false;
+    }
+    history->packets_received++;
+
+    // The peer's ack can only move forward, and never past what was sent
+    uint32_t ack = extend_frame(ack_low, history->next_frame);
+    if (ack > history->peer_ack && ack <= history->next_frame) {
+        history->peer_ack = ack;
+    }
+
+    uint32_t start = extend_frame(start_low, history->received_until);
+    uint32_t end = start + frame_count;
+    for (uint32_t frame = start; frame < end; frame++) {
+        if (frame < history->received_until) {
+            continue;
+        }
+        // Too far ahead to track: give up on the oldest missing frames
+        while (frame - history->received_until >= INPUT_HISTORY_FRAMES) {
+            if (!(history->received_mask & 1)) {
+                history->frames_lost++;
+            }
+            history->received_mask >>= 1;
+            history->received_until++;
+        }
+        uint32_t bit = 1u << (frame - history->received_until);
+        if (history->received_mask & bit) {
+            continue;
+        }
+        history->received_mask |= bit;
+        if (fn) {
+            fn(context, player, frame, &inputs[frame - start]);
+        }
+        history->frames_delivered++;
+        if (frame + 1 < end) {
+            history->frames_recovered++;
+        }
+    }
+    while (history->received_mask & 1) {
+        history->received_mask >>= 1;
+        history->received_until++;
+    }
+    return true;
+}
+
+// Nearest frame to reference with the given low bits
+static uint32_t extend_frame(uint32_t low, uint32_t reference)
+{
+    int16_t offset = (int16_t)(uint16_t)(low - (reference & FRAME_MASK));
+    int64_t frame = (int64_t)reference + offset;
+    return frame < 0 ? 0 : (uint32_t)frame;
+}
+
+static unsigned changed_fields(const physics_input_t *input, const physics_input_t *previous)
+{
+    unsigned fields = 0;
+    if (input->throttle != previous->throttle) fields |= FIELD_THROTTLE;
+    if (input->brake != previous->brake) fields |= FIELD_BRAKE;
+    if (input->steering != previous->steering) fields |= FIELD_STEERING;
+    if (input->buttons != previous->buttons) fields |= FIELD_BUTTONS;
+    return fields;
+}
+
+static unsigned run_bits(unsigned fields, bool first)
+{
+    if (first) {
+        return INPUT_HISTORY_COUNT_BITS + INPUT_BITS;
+    }
+    unsigned bits = INPUT_HISTORY_COUNT_BITS + FIELD_MASK_BITS;
+    if (fields & FIELD_THROTTLE) bits += INPUT_HISTORY_THROTTLE_BITS;
+    if (fields & FIELD_BRAKE) bits += INPUT_HISTORY_THROTTLE_BITS;
+    if (fields & FIELD_STEERING) bits += INPUT_HISTORY_STEERING_BITS;
+    if (fields & FIELD_BUTTONS) bits += INPUT_HISTORY_BUTTON_BITS;
+    return bits;
+}
+
+static void write_input(bit_writer_t *writer, const physics_input_t *input, unsigned fields)
+{
+    if (fields & FIELD_THROTTLE) bit_write(writer, input->throttle, INPUT_HISTORY_THROTTLE_BITS);
+    if (fields & FIELD_BRAKE) bit_write(writer, input->brake, INPUT_HISTORY_THROTTLE_BITS);
+    if (fields & FIELD_STEERING) bit_write(writer, (uint8_t)input->steering, INPUT_HISTORY_STEERING_BITS);
+    if (fields & FIELD_BUTTONS) bit_write(writer, input->buttons, INPUT_HISTORY_BUTTON_BITS);
+}
+
+static void read_input(bit_reader_t *reader, physics_input_t *input, unsigned fields)
+{
+    if (fields & FIELD_THROTTLE) input->throttle = bit_read(reader, INPUT_HISTORY_THROTTLE_BITS);
+    if (fields & FIELD_BRAKE) input->brake = bit_read(reader, INPUT_HISTORY_THROTTLE_BITS);
+    if (fields & FIELD_STEERING) input->steering = (int8_t)bit_read_signed(reader, INPUT_HISTORY_STEERING_BITS);
+    if (fields & FIELD_BUTTONS) input->buttons = bit_read(reader, INPUT_HISTORY_BUTTON_BITS);
+}
@@ -0,0 +1,186 @@
+#include "jitter_buffer.h"
+#include <string.h>
+
+#define HEADING_STEPS (1 << STATE_CODEC_HEADING_BITS)
+// Velocity steps are 1/32 unit/s and position steps 1/16 unit
+#define VELOCITY_TO_POSITION (1 << (STATE_CODEC_POSITION_SHIFT - STATE_CODEC_VELOCITY_SHIFT))
+
+static int32_t lerp(int32_t a, int32_t b, int64_t t, int64_t span);
+static void interpolate(const jitter_buffer_entry_t *a, const jitter_buffer_entry_t *b, int64_t time,
+                        state_codec_car_t *state);
+static void extrapolate(const jitter_buffer_entry_t *entry, int64_t elapsed_us, state_codec_car_t *state);
+
+void jitter_buffer_init(jitter_buffer_t *buffer, uint32_t frame_rate_hz)
+{
+    memset(buffer, 0, sizeof(jitter_buffer_t));
+    buffer->frame_rate_hz = frame_rate_hz;
+    buffer->target_delay_us = JITTER_BUFFER_MIN_DELAY_US;
+}
+
+void jitter_buffer_push(jitter_buffer_t *buffer, const state_codec_car_t *state, int64_t arrival_us)
+{
+    int64_t time = (int64_t)state->frame * 1000000 / buffer->frame_rate_hz;
+    buffer->received++;
+
+    if (buffer->playing && time <= buffer->last_render_time_us) {
+        buffer->late++;
+        return;
+    }
+
+    // Insert in sender time order; reordered packets slot in behind
+    int position = buffer->count;
+    while (position > 0 && buffer->entries[position - 1].time_us >= time) {
+        if (buffer->entries[position - 1].time_us == time) {
+            buffer->duplicates++;
+            return;
+        }
+        position--;
+    }
+    if (buffer->count == JITTER_BUFFER_SIZE) {
+        if (position == 0) {
+            buffer->late++;
+            return;
+        }
+        memmove(&buffer->entries[0], &buffer->entries[1], (position - 1) * sizeof(jitter_buffer_entry_t));
+        position--;
+    } else {
+        memmove(&buffer->entries[position + 1], &buffer->entries[position],
+                (buffer->count - position) * sizeof(jitter_buffer_entry_t));
+        buffer->count++;
+    }
+    buffer->entries[position].state = *state;
+    buffer->entries[position].time_us = time;
+
+    // Link statistics from packets in sender order only
+    int64_t transit = arrival_us - time;
+    if (!buffer->have_transit) {
+        buffer->have_transit = true;
+        buffer->transit_us = transit;
+    } else if (time > buffer->last_time_us) {
+        int64_t deviation = transit - buffer->last_transit_us;
+        if (deviation < 0) {
+            deviation = -deviation;
+        }
+        buffer->jitter_us += ((int64_t)deviation - (int64_t)buffer->jitter_us) / 16;
+        int64_t gap = time - buffer->last_time_us;
+        buffer->interval_us = buffer->interval_us ? buffer->interval_us + (gap - (int64_t)buffer->interval_us) / 8
+                                                  : (uint32_t)gap;
+        buffer->transit_us += (transit - buffer->transit_us) / 16;
+    } else {
+        return;
+    }
+    buffer->last_transit_us = transit;
+    buffer->last_time_us = time;
+
+    uint32_t delay = buffer->interval_us + JITTER_BUFFER_JITTER_MULTIPLIER * buffer->jitter_us;
+    if (delay < JITTER_BUFFER_MIN_DELAY_US) {
+        delay = JITTER_BUFFER_MIN_DELAY_US;
+    } else if (delay > JITTER_BUFFER_MAX_DELAY_US) {
+        delay = JITTER_BUFFER_MAX_DELAY_US;
+    }
+    buffer->target_delay_us = delay;
+}
+
+bool jitter_buffer_sample(jitter_buffer_t *buffer, int64_t now_us, state_codec_car_t *state)
+{
+    if (buffer->count == 0) {
+        return false;
+    }
+
+    // Move the playout clock toward the target gradually: the car runs a
+    // little fast or slow rather than jumping
+    int64_t target = buffer->transit_us + buffer->target_delay_us;
+    if (!buffer->playing) {
+        buffer->playing = true;
+        buffer->playout_offset_us = target;
+        buffer->last_render_time_us = now_us - target;
+    } else {
+        int64_t error = target - buffer->playout_offset_us;
+        int64_t step = (now_us - buffer->last_sample_us) / JITTER_BUFFER_SLEW_DIVISOR;
+        if (error > JITTER_BUFFER_RESET_US || error < -JITTER_BUFFER_RESET_US) {
+            buffer->playout_offset_us = target;
+        } else if (error > step) {
+            buffer->playout_offset_us += step;
+        } else if (error < -step) {
+            buffer->playout_offset_us -= step;
+        } else {
+            buffer->playout_offset_us = target;
+        }
+    }
+    buffer->last_sample_us = now_us;
+
+    // Never backwards
+    int64_t time = now_us - buffer->playout_offset_us;
+    if (time < buffer->last_render_time_us) {
+        time = buffer->last_render_time_us;
+    }
+    buffer->last_render_time_us = time;
+
+    // Snapshots wholly behind the playout time are done with
+    while (buffer->count > 1 && buffer->entries[1].time_us <= time) {
+        memmove(&buffer->entries[0], &buffer->entries[1], (buffer->count - 1) * sizeof(jitter_buffer_entry_t));
+        buffer->count--;
+    }
+
+    const jitter_buffer_entry_t *oldest = &buffer->entries[0];
+    if (time < oldest->time_us) {
+        buffer->held++;
+        *state = oldest->state;
+    } else if (buffer->count > 1) {
+        buffer->interpolated++;
+        interpolate(oldest, &buffer->entries[1], time, state);
+    } else {
+        int64_t elapsed = time - oldest->time_us;
+        if (elapsed > JITTER_BUFFER_MAX_EXTRAPOLATION_US) {
+            buffer->held++;
+            elapsed = JITTER_BUFFER_MAX_EXTRAPOLATION_US;
+        } else if (elapsed > 0) {
+            buffer->extrapolated++;
+        }
+        extrapolate(oldest, elapsed, state);
+    }
+    state->frame = (uint32_t)(time * buffer->frame_rate_hz / 1000000);
+    return true;
+}
+
+uint32_t jitter_buffer_delay(const jitter_buffer_t *buffer)
+{
+    return buffer->playing ? (uint32_t)(buffer->playout_offset_us - buffer->transit_us) : buffer->target_delay_us;
+}
+
+static int32_t lerp(int32_t a, int32_t b, int64_t t, int64_t span)
+{
+    return a + (int32_t)(((int64_t)b - a) * t / span);
+}
+
+static void interpolate(const jitter_buffer_entry_t *a, const jitter_buffer_entry_t *b, int64_t time,
+                        state_codec_car_t *state)
+{
+    int64_t t = time - a->time_us;
+    int64_t span = b->time_us - a->time_us;
+
+    *state = a->state;
+    state->position_x = lerp(a->state.position_x, b->state.position_x, t, span);
+    state->position_y = lerp(a->state.position_y, b->state.position_y, t, span);
+    state->velocity_x = lerp(a->state.velocity_x, b->state.velocity_x, t, span);
+    state->velocity_y = lerp(a->state.velocity_y, b->state.velocity_y, t, span);
+
+    // The short way round
+    int32_t turn = (int32_t)b->state.heading - a->state.heading;
+    if (turn >= HEADING_STEPS / 2) {
+        turn -= HEADING_STEPS;
+    } else if (turn < -HEADING_STEPS / 2) {
+        turn += HEADING_STEPS;
+    }
+    state->heading = (uint16_t)(lerp(a->state.heading, a->state.heading + turn, t, span) & (HEADING_STEPS - 1));
+}
+
+static void extrapolate(const jitter_buffer_entry_t *entry, int64_t elapsed_us, state_codec_car_t *state)
+{
+    *state = entry->state;
+    if (elapsed_us <= 0) {
+        return;
+    }
+    state->position_x += (int32_t)((int64_t)entry->state.velocity_x * elapsed_us / (VELOCITY_TO_POSITION * 1000000ll));
+    state->position_y += (int32_t)((int64_t)entry->state.velocity_y * elapsed_us / (VELOCITY_TO_POSITION * 1000000ll));
+}
@@ -0,0 +1,82 @@
+#include "link_sim.h"
+#include <string.h>
+
+static uint32_t next_random(link_sim_t *link);
+
+void link_sim_init(link_sim_t *link, const link_sim_config_t *config)
+{
+    memset(link, 0, sizeof(link_sim_t));
+    link->config = *config;
+    link->rng = config->seed ? config->seed : 0x9e3779b9u;
+    link->last_deliver_us = INT64_MIN;
+}
+
+bool link_sim_send(link_sim_t *link, const uint8_t *data, size_t length, int64_t now_us)
+{
+    if (length > LINK_SIM_MAX_PACKET) {
+        return false;
+    }
+    link->sent++;
+    if (next_random(link) % 100 < link->config.loss_percent) {
+        link->lost++;
+        return false;
+    }
+    if (link->count == LINK_SIM_QUEUE) {
+        link->overflowed++;
+        return false;
+    }
+
+    int64_t deliver = now_us + link->config.latency_us;
+    if (link->config.jitter_us) {
+        deliver += next_random(link) % (link->config.jitter_us + 1);
+    }
+    if (next_random(link) % 100 < link->config.reorder_percent) {
+        // Held back a full latency more; the packets behind it overtake
+        deliver += link->config.latency_us + link->config.jitter_us;
+        link->reordered++;
+    } else {
+        if (deliver < link->last_deliver_us) {
+            deliver = link->last_deliver_us;
+        }
+        link->last_deliver_us = deliver;
+    }
+
+    link_sim_packet_t *packet = &link->packets[link->count++];
+    packet->deliver_us = deliver;
+    packet->length = (uint16_t)length;
+    memcpy(packet->data, data, length);
+    return true;
+}
+
+size_t link_sim_receive(link_sim_t *link, int64_t now_us, uint8_t *buffer)
+{
+    // Earliest due; ties go to the one sent first, which sits lower
+    int next = -1;
+    for (int i = 0; i < link->count; i++) {
+        if (link->packets[i].deliver_us <= now_us &&
+            (next < 0 || link->packets[i].deliver_us < link->packets[next].deliver_us)) {
+            next = i;
+        }
+    }
+    if (next < 0) {
+        return 0;
+    }
+
+    size_t length = link->packets[next].length;
+    memcpy(buffer, link->packets[next].data, length);
+    // Keep the rest in send order
+    memmove(&link->packets[next], &link->packets[next + 1], (link->count - next - 1) * sizeof(link_sim_packet_t));
+    link->count--;
+    link->delivered++;
+    return length;
+}
+
+static uint32_t next_random(link_sim_t *link)
+{
+    uint32_t x = link->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    link->rng = x;
+    return x;
+}
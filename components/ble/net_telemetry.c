@@ -0,0 +1,201 @@
+#include "net_telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LAST_BUCKET (NET_TELEMETRY_BUCKETS - 1)
+
+// Upper bounds, inclusive, of all but the last bucket. Finer where a good
+// link sits, coarser out where only "bad" matters.
+static const uint32_t bucket_bounds[NET_TELEMETRY_METRICS][LAST_BUCKET] = {
+    [NET_TELEMETRY_RTT] = { 10000, 15000, 20000, 25000, 30000, 35000, 40000, 50000, 60000, 70000, 80000, 100000,
+                            125000, 150000, 200000 },
+    [NET_TELEMETRY_ONE_WAY] = { 5000, 7500, 10000, 12500, 15000, 17500, 20000, 25000, 30000, 35000, 40000, 50000,
+                                62500, 75000, 100000 },
+    [NET_TELEMETRY_JITTER] = { 1000, 2000, 3000, 4000, 5000, 6000, 8000, 10000, 12000, 15000, 20000, 25000, 30000,
+                               40000, 50000 },
+    [NET_TELEMETRY_ROLLBACK_DEPTH] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    [NET_TELEMETRY_RESIMULATED] = { 0, 5, 10, 20, 30, 40, 60, 80, 100, 120, 150, 200, 250, 300, 400 },
+};
+
+static const char *type_names[NET_TELEMETRY_TYPES] = { "in", "st", "ck" };
+
+static void histogram_add(net_telemetry_histogram_t *histogram, const uint32_t *bounds, uint32_t value);
+static void histogram_diff(const net_telemetry_histogram_t *now, const net_telemetry_histogram_t *then,
+                           net_telemetry_histogram_t *diff);
+
+void net_telemetry_init(net_telemetry_t *telemetry, int64_t now_us)
+{
+    memset(telemetry, 0, sizeof(net_telemetry_t));
+    net_telemetry_reset(telemetry, now_us);
+}
+
+void net_telemetry_reset(net_telemetry_t *telemetry, int64_t now_us)
+{
+    memset(&telemetry->totals, 0, sizeof(telemetry->totals));
+    telemetry->totals.since_us = now_us;
+    telemetry->logged = telemetry->totals;
+    telemetry->have_transit = false;
+    telemetry->period_start_us = now_us;
+    telemetry->period_resimulated = 0;
+}
+
+void net_telemetry_snapshot(const net_telemetry_t *telemetry, net_telemetry_snapshot_t *snapshot)
+{
+    *snapshot = telemetry->totals;
+}
+
+void net_telemetry_record(net_telemetry_t *telemetry, net_telemetry_metric_t metric, uint32_t value)
+{
+    histogram_add(&telemetry->totals.histograms[metric], bucket_bounds[metric], value);
+}
+
+void net_telemetry_record_transit(net_telemetry_t *telemetry, int64_t send_us, int64_t arrival_us)
+{
+    int64_t transit = arrival_us - send_us;
+
+    if (telemetry->have_transit) {
+        int64_t change = transit - telemetry->last_transit_us;
+        if (change < 0) {
+            change = -change;
+        }
+        net_telemetry_record(telemetry, NET_TELEMETRY_JITTER, change > UINT32_MAX ? UINT32_MAX : (uint32_t)change);
+    }
+    telemetry->last_transit_us = transit;
+    telemetry->have_transit = true;
+}
+
+void net_telemetry_record_rollback(net_telemetry_t *telemetry, uint32_t depth, uint32_t resimulated)
+{
+    net_telemetry_record(telemetry, NET_TELEMETRY_ROLLBACK_DEPTH, depth);
+    telemetry->period_resimulated += resimulated;
+}
+
+void net_telemetry_count_sent(net_telemetry_t *telemetry, net_telemetry_type_t type, size_t bytes)
+{
+    telemetry->totals.sent[type].packets++;
+    telemetry->totals.sent[type].bytes += (uint32_t)bytes;
+}
+
+void net_telemetry_count_received(net_telemetry_t *telemetry, net_telemetry_type_t type, size_t bytes)
+{
+    telemetry->totals.received[type].packets++;
+    telemetry->totals.received[type].bytes += (uint32_t)bytes;
+}
+
+void net_telemetry_count_inputs(net_telemetry_t *telemetry, uint32_t delivered, uint32_t recovered, uint32_t lost)
+{
+    telemetry->totals.inputs_delivered += delivered;
+    telemetry->totals.inputs_recovered += recovered;
+    telemetry->totals.inputs_lost += lost;
+}
+
+bool net_telemetry_tick(net_telemetry_t *telemetry, int64_t now_us, char *line, size_t size)
+{
+    if (now_us - telemetry->period_start_us < NET_TELEMETRY_PERIOD_US) {
+        return false;
+    }
+
+    // Resimulated frames per second, scaled if the game loop was late to tick
+    int64_t elapsed = now_us - telemetry->period_start_us;
+    uint32_t resimulated = (uint32_t)((int64_t)telemetry->period_resimulated * NET_TELEMETRY_PERIOD_US / elapsed);
+    net_telemetry_record(telemetry, NET_TELEMETRY_RESIMULATED, resimulated);
+    telemetry->period_start_us = now_us;
+    telemetry->period_resimulated = 0;
+
+    if (line != NULL) {
+        const net_telemetry_snapshot_t *now = &telemetry->totals;
+        const net_telemetry_snapshot_t *then = &telemetry->logged;
+        net_telemetry_histogram_t period[NET_TELEMETRY_METRICS];
+        for (int i = 0; i < NET_TELEMETRY_METRICS; i++) {
+            histogram_diff(&now->histograms[i], &then->histograms[i], &period[i]);
+        }
+        uint32_t delivered = now->inputs_delivered - then->inputs_delivered;
+        uint32_t recovered = now->inputs_recovered - then->inputs_recovered;
+        uint32_t lost = now->inputs_lost - then->inputs_lost;
+
+        // Delays in ms as p50/p95, then per type packets/bytes sent and received
+        int length = snprintf(line, size,
+                              "rtt %lu/%lu owd %lu/%lu jit %lu/%lu rb %lu d%lu/%lu resim %lu frames %lu rec %lu lost %lu",
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_RTT], NET_TELEMETRY_RTT,
+                                                                      50) / 1000,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_RTT], NET_TELEMETRY_RTT,
+                                                                      95) / 1000,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_ONE_WAY],
+                                                                      NET_TELEMETRY_ONE_WAY, 50) / 1000,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_ONE_WAY],
+                                                                      NET_TELEMETRY_ONE_WAY, 95) / 1000,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_JITTER],
+                                                                      NET_TELEMETRY_JITTER, 50) / 1000,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_JITTER],
+                                                                      NET_TELEMETRY_JITTER, 95) / 1000,
+                              (unsigned long)period[NET_TELEMETRY_ROLLBACK_DEPTH].samples,
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_ROLLBACK_DEPTH],
+                                                                      NET_TELEMETRY_ROLLBACK_DEPTH, 50),
+                              (unsigned long)net_telemetry_percentile(&period[NET_TELEMETRY_ROLLBACK_DEPTH],
+                                                                      NET_TELEMETRY_ROLLBACK_DEPTH, 95),
+                              (unsigned long)resimulated, (unsigned long)delivered, (unsigned long)recovered,
+                              (unsigned long)lost);
+        for (int i = 0; i < NET_TELEMETRY_TYPES && length > 0 && (size_t)length < size; i++) {
+            length += snprintf(line + length, size - (size_t)length, " %s %lu/%lu:%lu/%lu", type_names[i],
+                               (unsigned long)(now->sent[i].packets - then->sent[i].packets),
+                               (unsigned long)(now->sent[i].bytes - then->sent[i].bytes),
+                               (unsigned long)(now->received[i].packets - then->received[i].packets),
+                               (unsigned long)(now->received[i].bytes - then->received[i].bytes));
+        }
+    }
+    telemetry->logged = telemetry->totals;
+    return true;
+}
+
+uint32_t net_telemetry_percentile(const net_telemetry_histogram_t *histogram, net_telemetry_metric_t metric,
+                                  uint32_t percent)
+{
+    if (histogram->samples == 0) {
+        return 0;
+    }
+
+    // Smallest bucket with at least percent of the samples at or below it
+    uint64_t wanted = ((uint64_t)histogram->samples * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < LAST_BUCKET; i++) {
+        seen += histogram->counts[i];
+        if (seen >= wanted && seen > 0) {
+            return bucket_bounds[metric][i];
+        }
+    }
+    return histogram->max > bucket_bounds[metric][LAST_BUCKET - 1] ? histogram->max
+                                                                   : bucket_bounds[metric][LAST_BUCKET - 1];
+}
+
+uint32_t net_telemetry_bucket_bound(net_telemetry_metric_t metric, int bucket)
+{
+    return bucket < LAST_BUCKET ? bucket_bounds[metric][bucket] : UINT32_MAX;
+}
+
+static void histogram_add(net_telemetry_histogram_t *histogram, const uint32_t *bounds, uint32_t value)
+{
+    int bucket = 0;
+
+    while (bucket < LAST_BUCKET && value > bounds[bucket]) {
+        bucket++;
+    }
+    histogram->counts[bucket]++;
+    histogram->samples++;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+// Counts and sum over the period; the largest value since the reset, as a
+// period's own maximum cannot be recovered from two totals
+static void histogram_diff(const net_telemetry_histogram_t *now, const net_telemetry_histogram_t *then,
+                           net_telemetry_histogram_t *diff)
+{
+    for (int i = 0; i < NET_TELEMETRY_BUCKETS; i++) {
+        diff->counts[i] = now->counts[i] - then->counts[i];
+    }
+    diff->samples = now->samples - then->samples;
+    diff->sum = now->sum - then->sum;
+    diff->max = now->max;
+}
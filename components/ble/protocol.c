@@ -1,5 +1,7 @@
 #include "protocol.h"
+#include <string.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "game_types.h"
 #include "physics.h"
 #include "utils.h"
@@ -7,46 +9,42 @@
 
 static const char *TAG = "protocol";
 
-// Protocol state
-static protocol_state_t protocol_state = {
-    .is_host = false,
-    .is_connected = false,
-    .local_player_id = 0,
-    .remote_player_id = 1,
-    .current_frame = 0,
-    .last_received_frame = 0,
-    .latency_samples = 0,
-    .avg_latency = 0,
-    .jitter = 0
-};
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
 
-// Ring buffers for input prediction and rollback
-typedef struct {
-    input_packet_t inputs[PROTOCOL_INPUT_BUFFER_SIZE];
-    uint32_t start_frame;
-    uint32_t count;
-} input_buffer_t;
+// The game's one link; host rigs select one context per peer
+static protocol_context_t default_context = {
+    .state = { .remote_player_id = 1 },
+};
+static protocol_context_t *protocol = &default_context;
 
-static input_buffer_t local_input_buffer = {0};
-static input_buffer_t remote_input_buffer = {0};
+_Static_assert(CLOCK_SYNC_PACKET_SIZE == sizeof(config_packet_t), "clock sync rides the config characteristic");
 
-// Prediction and interpolation state
-static protocol_prediction_state_t prediction_state = {0};
+static void store_remote_input(const input_packet_t *packet);
+static void deliver_remote_input(void *context, uint8_t player, uint32_t frame, const physics_input_t *input);
+static void send_clock_message(const clock_sync_message_t *message);
+static void record_state_arrival(uint32_t frame, int64_t now_us);
 
 // Initialize protocol system
 esp_err_t protocol_init(bool is_host)
 {
-    memset(&protocol_state, 0, sizeof(protocol_state));
-    memset(&local_input_buffer, 0, sizeof(local_input_buffer));
-    memset(&remote_input_buffer, 0, sizeof(remote_input_buffer));
-    memset(&prediction_state, 0, sizeof(prediction_state));
-    
-    protocol_state.is_host = is_host;
-    protocol_state.local_player_id = is_host ? 0 : 1;
-    protocol_state.remote_player_id = is_host ? 1 : 0;
+    memset(&protocol->state, 0, sizeof(protocol->state));
+    memset(&protocol->local_inputs, 0, sizeof(protocol->local_inputs));
+    memset(&protocol->remote_inputs, 0, sizeof(protocol->remote_inputs));
+    memset(&protocol->prediction, 0, sizeof(protocol->prediction));
+    
+    protocol->state.is_host = is_host;
+    protocol->state.local_player_id = is_host ? 0 : 1;
+    protocol->state.remote_player_id = is_host ? 1 : 0;
+    state_codec_init(&protocol->state_codec, protocol->state.local_player_id);
+    input_history_init(&protocol->input_history, protocol->state.local_player_id);
+    clock_sync_init(&protocol->clock_sync, is_host, PROTOCOL_FRAME_RATE_HZ);
+    jitter_buffer_init(&protocol->remote_playout, PROTOCOL_FRAME_RATE_HZ);
+    conn_control_init(&protocol->conn_control);
+    net_telemetry_init(&protocol->telemetry, esp_timer_get_time());
+    desync_check_init(&protocol->desync_check);
     
     ESP_LOGI(TAG, "Protocol initialized - Host: %s, Local ID: %d", 
-             is_host ? "true" : "false", protocol_state.local_player_id);
+             is_host ? "true" : "false", protocol->state.local_player_id);
     
     return ESP_OK;
 }
@@ -57,8 +55,8 @@ void protocol_pack_game_state(const physics_world_t *world,
                              game_state_packet_t *packet)
 {
     packet->game_state = 0; // Racing state
-    packet->player_id = protocol_state.local_player_id;
-    packet->frame_number = protocol_state.current_frame;
+    packet->player_id = protocol->state.local_player_id;
+    packet->frame_number = protocol->state.current_frame;
     
     // Convert fixed-point to network format (int32_t)
     packet->car_position_x = car->position.x;
@@ -67,23 +65,11 @@ void protocol_pack_game_state(const physics_world_t *world,
     packet->car_velocity_y = car->velocity.y;
     packet->car_heading = car->heading;
     
-    // Calculate current checkpoint and lap
-    packet->checkpoint_index = 0;
-    packet->lap_count = 0;
-    packet->race_finished = 0;
-    
-    // Find current checkpoint
-    for (int i = 0; i < world->checkpoint_count; i++) {
-        if (world->checkpoints[i].passed) {
-            packet->checkpoint_index = i;
-            packet->lap_count = world->checkpoints[i].lap_count;
-            
-            if (packet->lap_count >= world->total_laps) {
-                packet->race_finished = 1;
-            }
-            break;
-        }
-    }
+    // Current checkpoint and lap come from the car's own progress
+    int car_index = car - world->cars;
+    packet->checkpoint_index = world->progress[car_index].next_checkpoint;
+    packet->lap_count = world->progress[car_index].lap;
+    packet->race_finished = world->race_finished[car_index] ? 1 : 0;
     
     packet->timestamp = esp_timer_get_time() / 1000; // Milliseconds
     packet->checksum = crc16((uint8_t *)packet, sizeof(game_state_packet_t) - sizeof(uint16_t));
@@ -92,8 +78,8 @@ void protocol_pack_game_state(const physics_world_t *world,
 // Convert input state to input packet
 void protocol_pack_input(const input_state_t *input, input_packet_t *packet)
 {
-    packet->player_id = protocol_state.local_player_id;
-    packet->frame_number = protocol_state.current_frame;
+    packet->player_id = protocol->state.local_player_id;
+    packet->frame_number = protocol->state.current_frame;
     packet->timestamp = esp_timer_get_time() / 1000;
     
     // Map input values to -100 to 100 range
@@ -103,10 +89,10 @@ void protocol_pack_input(const input_state_t *input, input_packet_t *packet)
     
     // Pack button states
     packet->buttons = 0;
-    if (input->buttons & BUTTON_A) packet->buttons |= 0x01;
-    if (input->buttons & BUTTON_B) packet->buttons |= 0x02;
-    if (input->buttons & BUTTON_START) packet->buttons |= 0x04;
-    if (input->buttons & BUTTON_SELECT) packet->buttons |= 0x08;
+    if (input->buttons & BUTTON_BOOST) packet->buttons |= 0x01;
+    if (input->buttons & BUTTON_HANDBRAKE) packet->buttons |= 0x02;
+    if (input->buttons & BUTTON_HORN) packet->buttons |= 0x04;
+    if (input->buttons & BUTTON_PAUSE) packet->buttons |= 0x08;
     
     packet->checksum = crc16((uint8_t *)packet, sizeof(input_packet_t) - sizeof(uint16_t));
 }
@@ -115,7 +101,7 @@ void protocol_pack_input(const input_state_t *input, input_packet_t *packet)
 void protocol_unpack_input(const input_packet_t *packet, 
                           float *throttle, float *brake, float *steering)
 {
-    if (packet->player_id != protocol_state.remote_player_id) {
+    if (packet->player_id != protocol->state.remote_player_id) {
         ESP_LOGW(TAG, "Input packet for wrong player ID: %d", packet->player_id);
         return;
     }
@@ -132,22 +118,224 @@ void protocol_unpack_input(const input_packet_t *packet,
     *brake = (float)packet->brake / 100.0f;
     *steering = (float)packet->steering / 100.0f;
     
-    // Store in input buffer for prediction
-    uint32_t buffer_index = (packet->frame_number - remote_input_buffer.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
-    if (packet->frame_number >= remote_input_buffer.start_frame && 
-        packet->frame_number < remote_input_buffer.start_frame + PROTOCOL_INPUT_BUFFER_SIZE) {
+    store_remote_input(packet);
+}
+
+void protocol_store_frame_input(const physics_input_t *input, uint32_t frame)
+{
+    input_history_push(&protocol->input_history, frame, input);
+}
+
+size_t protocol_encode_input_history(uint8_t *buffer, size_t size)
+{
+    size_t length = input_history_encode(&protocol->input_history, buffer, size);
+    if (length) {
+        net_telemetry_count_sent(&protocol->telemetry, NET_TELEMETRY_INPUT, length);
+    }
+    return length;
+}
+
+bool protocol_decode_input_history(const uint8_t *data, size_t length)
+{
+    input_history_t *history = &protocol->input_history;
+    uint32_t delivered = history->frames_delivered;
+    uint32_t recovered = history->frames_recovered;
+    uint32_t lost = history->frames_lost;
+
+    net_telemetry_count_received(&protocol->telemetry, NET_TELEMETRY_INPUT, length);
+    if (!input_history_decode(history, data, length, deliver_remote_input, NULL)) {
+        ESP_LOGW(TAG, "Malformed input history packet");
+        return false;
+    }
+    net_telemetry_count_inputs(&protocol->telemetry, history->frames_delivered - delivered,
+                               history->frames_recovered - recovered, history->frames_lost - lost);
+    return true;
+}
+
+void protocol_clock_poll(void)
+{
+    clock_sync_message_t ping;
+    if (clock_sync_poll(&protocol->clock_sync, esp_timer_get_time(), &ping)) {
+        send_clock_message(&ping);
+    }
+}
+
+bool protocol_handle_config(const uint8_t *data, size_t length)
+{
+    clock_sync_message_t message, reply;
+    if (!clock_sync_decode(data, length, &message)) {
+        return false;
+    }
+
+    net_telemetry_count_received(&protocol->telemetry, NET_TELEMETRY_CLOCK, length);
+    uint32_t pongs = protocol->clock_sync.pongs_received;
+    if (clock_sync_handle(&protocol->clock_sync, &message, esp_timer_get_time(), &reply)) {
+        send_clock_message(&reply);
+    }
+    if (protocol->clock_sync.pongs_received != pongs) {
+        protocol->state.latency_samples++;
+        protocol->state.avg_latency = protocol->clock_sync.rtt_us / 2000;
+        net_telemetry_record(&protocol->telemetry, NET_TELEMETRY_RTT, protocol->clock_sync.rtt_us);
+        ESP_LOGD(TAG, "Clock offset %lld us, RTT %lu us, skew %.0f ppm", (long long)protocol->clock_sync.offset_us,
+                 (unsigned long)protocol->clock_sync.rtt_us, protocol->clock_sync.skew_ppm);
+    }
+    return true;
+}
+
+void protocol_start_timeline(void)
+{
+    clock_sync_start_timeline(&protocol->clock_sync, esp_timer_get_time());
+}
+
+int protocol_pace_frames(uint32_t local_frame)
+{
+    return clock_sync_pace(&protocol->clock_sync, local_frame, esp_timer_get_time());
+}
+
+void protocol_link_control(bool racing, uint16_t update_rate_hz)
+{
+    conn_control_input_t input = {
+        .racing = racing,
+        .rtt_us = protocol->clock_sync.synced ? protocol->clock_sync.rtt_us : 0,
+        .frames_delivered = protocol->input_history.frames_delivered,
+        .frames_recovered = protocol->input_history.frames_recovered + protocol->input_history.frames_lost,
+        .update_rate_hz = update_rate_hz,
+    };
+    conn_control_params_t params;
+    if (!conn_control_update(&protocol->conn_control, &input, esp_timer_get_time(), &params)) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Link: interval %u.%02u ms, latency %u, %s PHY (rtt %lu us, loss %lu%%)",
+             params.interval * 125 / 100, params.interval * 125 % 100, params.latency,
+             params.phy == CONN_CONTROL_PHY_2M ? "2M" : "1M", (unsigned long)input.rtt_us,
+             (unsigned long)protocol->conn_control.loss_percent);
+    ble_update_connection_parameters(params.interval, params.latency, params.timeout);
+    ble_set_phy(params.phy == CONN_CONTROL_PHY_2M ? BLE_PHY_2M : BLE_PHY_1M);
+}
+
+static void send_clock_message(const clock_sync_message_t *message)
+{
+    config_packet_t packet;
+    clock_sync_encode(message, (uint8_t *)&packet);
+    ble_send_config(&packet);
+    net_telemetry_count_sent(&protocol->telemetry, NET_TELEMETRY_CLOCK, sizeof(packet));
+}
+
+// A state is the world at the start of its frame, sent from the step that
+// simulated the frame before. That step's start on the sender's timeline
+// against the arrival here: jitter always, one-way delay once both ends
+// share the timeline. The delay includes however far into its step the
+// sender got before sending.
+static void record_state_arrival(uint32_t frame, int64_t now_us)
+{
+    int64_t frame_us = (int64_t)(frame > 0 ? frame - 1 : 0) * 1000000 / PROTOCOL_FRAME_RATE_HZ;
+    net_telemetry_record_transit(&protocol->telemetry, frame_us, now_us);
+
+    bool synced = protocol->clock_sync.is_reference || protocol->clock_sync.synced;
+    if (protocol->rollback && protocol->clock_sync.epoch_valid && synced) {
+        int64_t delay = clock_sync_reference_time(&protocol->clock_sync, now_us) - protocol->clock_sync.epoch_us -
+                        frame_us;
+        net_telemetry_record(&protocol->telemetry, NET_TELEMETRY_ONE_WAY, delay > 0 ? (uint32_t)delay : 0);
+    }
+}
+
+// Each frame of a history packet, the first time it arrives
+static void deliver_remote_input(void *context, uint8_t player, uint32_t frame, const physics_input_t *input)
+{
+    if (player != protocol->state.remote_player_id) {
+        ESP_LOGW(TAG, "Input history for wrong player ID: %d", player);
+        return;
+    }
+
+    input_packet_t packet = {
+        .player_id = player,
+        .throttle = (int8_t)input->throttle,
+        .brake = (int8_t)input->brake,
+        .steering = input->steering,
+        .buttons = input->buttons,
+        .frame_number = frame,
+    };
+    store_remote_input(&packet);
+}
+
+// Fills the remote input buffer and feeds the rollback engine
+static void store_remote_input(const input_packet_t *packet)
+{
+    uint32_t buffer_index = (packet->frame_number - protocol->remote_inputs.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
+    if (packet->frame_number >= protocol->remote_inputs.start_frame && 
+        packet->frame_number < protocol->remote_inputs.start_frame + PROTOCOL_INPUT_BUFFER_SIZE) {
         
-        remote_input_buffer.inputs[buffer_index] = *packet;
-        remote_input_buffer.count = MAX(remote_input_buffer.count, 
-                                       packet->frame_number - remote_input_buffer.start_frame + 1);
+        protocol->remote_inputs.inputs[buffer_index] = *packet;
+        protocol->remote_inputs.count = MAX(protocol->remote_inputs.count, 
+                                       packet->frame_number - protocol->remote_inputs.start_frame + 1);
+    }
+
+    if (protocol->rollback) {
+        physics_input_t input = {
+            .throttle = (uint8_t)MAX(packet->throttle, 0),
+            .brake = (uint8_t)MAX(packet->brake, 0),
+            .steering = packet->steering,
+            .buttons = packet->buttons,
+        };
+        rollback_add_remote_input(protocol->rollback, protocol->state.remote_player_id, packet->frame_number, &input);
     }
 }
 
+size_t protocol_encode_game_state(const physics_world_t *world, uint8_t car, uint32_t frame,
+                                  uint8_t *buffer, size_t size)
+{
+    state_codec_car_t state;
+    state_codec_quantise(world, car, frame, &state);
+    uint64_t hash;
+    if (protocol->rollback && rollback_confirmed_hash(protocol->rollback, &state.hash_frame, &hash)) {
+        state.hash_valid = true;
+        state.hash = (uint32_t)hash;
+    }
+    size_t length = state_codec_encode(&protocol->state_codec, &state, buffer, size);
+    if (length) {
+        net_telemetry_count_sent(&protocol->telemetry, NET_TELEMETRY_STATE, length);
+    }
+    return length;
+}
+
+bool protocol_decode_game_state(const uint8_t *data, size_t length, state_codec_car_t *state)
+{
+    uint8_t player_id;
+    net_telemetry_count_received(&protocol->telemetry, NET_TELEMETRY_STATE, length);
+    if (!state_codec_decode(&protocol->state_codec, data, length, state, &player_id)) {
+        ESP_LOGD(TAG, "State packet dropped (missing baselines %lu, malformed %lu)",
+                 (unsigned long)protocol->state_codec.missing_baselines,
+                 (unsigned long)protocol->state_codec.malformed);
+        return false;
+    }
+    if (player_id != protocol->state.remote_player_id) {
+        ESP_LOGW(TAG, "State packet for wrong player ID: %d", player_id);
+        return false;
+    }
+    protocol->state.last_received_frame = state->frame;
+    if (state->hash_valid && desync_check_add_remote(&protocol->desync_check, state->hash_frame, state->hash)) {
+        ESP_LOGE(TAG, "Desync: peer's state at frame %lu differs (%lu of %lu checks)",
+                 (unsigned long)state->hash_frame, (unsigned long)protocol->desync_check.mismatches,
+                 (unsigned long)protocol->desync_check.checks);
+    }
+    int64_t now = esp_timer_get_time();
+    record_state_arrival(state->frame, now);
+    jitter_buffer_push(&protocol->remote_playout, state, now);
+    protocol->state.jitter = protocol->remote_playout.jitter_us / 1000;
+    return true;
+}
+
+bool protocol_sample_remote_state(state_codec_car_t *state)
+{
+    return jitter_buffer_sample(&protocol->remote_playout, esp_timer_get_time(), state);
+}
+
 // Convert game state packet to physics state
 void protocol_unpack_game_state(const game_state_packet_t *packet, 
                                car_physics_t *car, physics_world_t *world)
 {
-    if (packet->player_id != protocol_state.remote_player_id) {
+    if (packet->player_id != protocol->state.remote_player_id) {
         ESP_LOGW(TAG, "Game state packet for wrong player ID: %d", packet->player_id);
         return;
     }
@@ -167,47 +355,36 @@ void protocol_unpack_game_state(const game_state_packet_t *packet,
     car->heading = packet->car_heading;
     
     // Update checkpoint and lap info
+    int car_index = car - world->cars;
     if (packet->checkpoint_index < world->checkpoint_count) {
-        world->checkpoints[packet->checkpoint_index].passed = true;
-        world->checkpoints[packet->checkpoint_index].lap_count = packet->lap_count;
-    }
-    
-    // Calculate latency
-    uint32_t current_time = esp_timer_get_time() / 1000;
-    uint32_t latency = current_time - packet->timestamp;
-    
-    if (protocol_state.latency_samples < PROTOCOL_MAX_LATENCY_SAMPLES) {
-        protocol_state.latency_samples++;
-        protocol_state.avg_latency = (protocol_state.avg_latency * (protocol_state.latency_samples - 1) + latency) / 
-                                     protocol_state.latency_samples;
-    } else {
-        protocol_state.avg_latency = (protocol_state.avg_latency * (PROTOCOL_MAX_LATENCY_SAMPLES - 1) + latency) / 
-                                     PROTOCOL_MAX_LATENCY_SAMPLES;
+        world->progress[car_index].next_checkpoint = packet->checkpoint_index;
+        world->progress[car_index].lap = packet->lap_count;
+        world->race_finished[car_index] = packet->race_finished != 0;
     }
     
-    protocol_state.last_received_frame = packet->frame_number;
-    
-    ESP_LOGD(TAG, "Latency: %d ms, Avg: %d ms", latency, protocol_state.avg_latency);
+    // Latency comes from clock sync: the two clocks are unrelated, so the
+    // packet's timestamp says nothing on its own
+    protocol->state.last_received_frame = packet->frame_number;
 }
 
 // Store local input for prediction
 void protocol_store_local_input(const input_state_t *input, uint32_t frame)
 {
-    uint32_t buffer_index = (frame - local_input_buffer.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
+    uint32_t buffer_index = (frame - protocol->local_inputs.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
     
-    if (frame >= local_input_buffer.start_frame && 
-        frame < local_input_buffer.start_frame + PROTOCOL_INPUT_BUFFER_SIZE) {
+    if (frame >= protocol->local_inputs.start_frame && 
+        frame < protocol->local_inputs.start_frame + PROTOCOL_INPUT_BUFFER_SIZE) {
         
-        protocol_pack_input(input, &local_input_buffer.inputs[buffer_index]);
-        local_input_buffer.count = MAX(local_input_buffer.count, 
-                                     frame - local_input_buffer.start_frame + 1);
+        protocol_pack_input(input, &protocol->local_inputs.inputs[buffer_index]);
+        protocol->local_inputs.count = MAX(protocol->local_inputs.count, 
+                                     frame - protocol->local_inputs.start_frame + 1);
     }
 }
 
 // Predict remote input for frame prediction
 bool protocol_predict_remote_input(uint32_t frame, input_packet_t *predicted_input)
 {
-    if (remote_input_buffer.count == 0) {
+    if (protocol->remote_inputs.count == 0) {
         // No remote input received yet, use neutral input
         predicted_input->throttle = 0;
         predicted_input->brake = 0;
@@ -217,9 +394,9 @@ bool protocol_predict_remote_input(uint32_t frame, input_packet_t *predicted_inp
         return true;
     }
     
-    uint32_t buffer_index = (frame - remote_input_buffer.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
+    uint32_t buffer_index = (frame - protocol->remote_inputs.start_frame) % PROTOCOL_INPUT_BUFFER_SIZE;
     
-    if (frame < remote_input_buffer.start_frame) {
+    if (frame < protocol->remote_inputs.start_frame) {
         // Frame is before our buffer, use neutral input
         predicted_input->throttle = 0;
         predicted_input->brake = 0;
@@ -229,17 +406,17 @@ bool protocol_predict_remote_input(uint32_t frame, input_packet_t *predicted_inp
         return true;
     }
     
-    if (frame < remote_input_buffer.start_frame + remote_input_buffer.count) {
+    if (frame < protocol->remote_inputs.start_frame + protocol->remote_inputs.count) {
         // We have actual input for this frame
-        *predicted_input = remote_input_buffer.inputs[buffer_index];
+        *predicted_input = protocol->remote_inputs.inputs[buffer_index];
         return true;
     }
     
     // Extrapolate from last known input
-    uint32_t last_frame = remote_input_buffer.start_frame + remote_input_buffer.count - 1;
+    uint32_t last_frame = protocol->remote_inputs.start_frame + protocol->remote_inputs.count - 1;
     uint32_t last_index = last_frame % PROTOCOL_INPUT_BUFFER_SIZE;
     
-    *predicted_input = remote_input_buffer.inputs[last_index];
+    *predicted_input = protocol->remote_inputs.inputs[last_index];
     predicted_input->frame_number = frame;
     
     return true;
@@ -265,48 +442,120 @@ bool protocol_should_rollback(uint32_t frame, const car_physics_t *predicted,
     return distance_error_f > threshold || heading_error_f > 0.1f; // 0.1 rad ~ 5.7 degrees
 }
 
+void protocol_set_rollback(rollback_t *rollback)
+{
+    protocol->rollback = rollback;
+    protocol->telemetry_rollbacks = rollback ? rollback->rollbacks : 0;
+    protocol->telemetry_resimulated = rollback ? rollback->resimulated_frames : 0;
+    // Frame numbers restart with each engine
+    input_history_init(&protocol->input_history, protocol->state.local_player_id);
+    desync_check_init(&protocol->desync_check);
+}
+
+bool protocol_check_desync(void)
+{
+    uint32_t frame;
+    uint64_t hash;
+    if (!protocol->rollback || !rollback_confirmed_hash(protocol->rollback, &frame, &hash)) {
+        return false;
+    }
+    if (!desync_check_add_local(&protocol->desync_check, frame, (uint32_t)hash)) {
+        return false;
+    }
+    ESP_LOGE(TAG, "Desync: state at frame %lu differs from the peer's (%lu of %lu checks)",
+             (unsigned long)frame, (unsigned long)protocol->desync_check.mismatches,
+             (unsigned long)protocol->desync_check.checks);
+    return true;
+}
+
+void protocol_get_desync(desync_check_t *check)
+{
+    *check = protocol->desync_check;
+}
+
 // Update protocol state for new frame
 void protocol_advance_frame(void)
 {
-    protocol_state.current_frame++;
+    protocol->state.current_frame++;
     
     // Clean up old input data
-    uint32_t buffer_end = local_input_buffer.start_frame + local_input_buffer.count;
-    if (protocol_state.current_frame > buffer_end + PROTOCOL_INPUT_BUFFER_SIZE / 2) {
-        local_input_buffer.start_frame = protocol_state.current_frame - PROTOCOL_INPUT_BUFFER_SIZE / 4;
-        local_input_buffer.count = PROTOCOL_INPUT_BUFFER_SIZE / 4;
+    uint32_t buffer_end = protocol->local_inputs.start_frame + protocol->local_inputs.count;
+    if (protocol->state.current_frame > buffer_end + PROTOCOL_INPUT_BUFFER_SIZE / 2) {
+        protocol->local_inputs.start_frame = protocol->state.current_frame - PROTOCOL_INPUT_BUFFER_SIZE / 4;
+        protocol->local_inputs.count = PROTOCOL_INPUT_BUFFER_SIZE / 4;
     }
     
-    buffer_end = remote_input_buffer.start_frame + remote_input_buffer.count;
-    if (protocol_state.current_frame > buffer_end + PROTOCOL_INPUT_BUFFER_SIZE / 2) {
-        remote_input_buffer.start_frame = protocol_state.current_frame - PROTOCOL_INPUT_BUFFER_SIZE / 4;
-        remote_input_buffer.count = PROTOCOL_INPUT_BUFFER_SIZE / 4;
+    buffer_end = protocol->remote_inputs.start_frame + protocol->remote_inputs.count;
+    if (protocol->state.current_frame > buffer_end + PROTOCOL_INPUT_BUFFER_SIZE / 2) {
+        protocol->remote_inputs.start_frame = protocol->state.current_frame - PROTOCOL_INPUT_BUFFER_SIZE / 4;
+        protocol->remote_inputs.count = PROTOCOL_INPUT_BUFFER_SIZE / 4;
     }
 }
 
 // Get protocol statistics
 void protocol_get_stats(protocol_stats_t *stats)
 {
-    stats->avg_latency = protocol_state.avg_latency;
-    stats->current_frame = protocol_state.current_frame;
-    stats->last_received_frame = protocol_state.last_received_frame;
-    stats->jitter = protocol_state.jitter;
-    stats->is_host = protocol_state.is_host;
-    stats->is_connected = protocol_state.is_connected;
+    stats->avg_latency = protocol->state.avg_latency;
+    stats->current_frame = protocol->state.current_frame;
+    stats->last_received_frame = protocol->state.last_received_frame;
+    stats->jitter = protocol->state.jitter;
+    stats->is_host = protocol->state.is_host;
+    stats->is_connected = protocol->state.is_connected;
+}
+
+void protocol_telemetry_poll(void)
+{
+    // Remote inputs land once per step, ahead of its advances, so at most
+    // one of them rolls back
+    const rollback_t *rollback = protocol->rollback;
+    if (rollback && rollback->rollbacks != protocol->telemetry_rollbacks) {
+        net_telemetry_record_rollback(&protocol->telemetry, rollback->last_rollback_depth,
+                                      rollback->resimulated_frames - protocol->telemetry_resimulated);
+        protocol->telemetry_rollbacks = rollback->rollbacks;
+        protocol->telemetry_resimulated = rollback->resimulated_frames;
+    }
+
+    if (net_telemetry_tick(&protocol->telemetry, esp_timer_get_time(), protocol->telemetry_line,
+                           sizeof(protocol->telemetry_line))) {
+        protocol->telemetry_lines++;
+        ESP_LOGI(TAG, "%s", protocol->telemetry_line);
+    }
+}
+
+void protocol_select(protocol_context_t *context)
+{
+    protocol = context ? context : &default_context;
+}
+
+void protocol_get_telemetry(net_telemetry_snapshot_t *snapshot)
+{
+    net_telemetry_snapshot(&protocol->telemetry, snapshot);
+}
+
+void protocol_reset_telemetry(void)
+{
+    net_telemetry_reset(&protocol->telemetry, esp_timer_get_time());
 }
 
 // Reset protocol state
 void protocol_reset(void)
 {
-    protocol_state.current_frame = 0;
-    protocol_state.last_received_frame = 0;
-    protocol_state.latency_samples = 0;
-    protocol_state.avg_latency = 0;
-    protocol_state.jitter = 0;
-    
-    memset(&local_input_buffer, 0, sizeof(local_input_buffer));
-    memset(&remote_input_buffer, 0, sizeof(remote_input_buffer));
-    memset(&prediction_state, 0, sizeof(prediction_state));
+    protocol->state.current_frame = 0;
+    protocol->state.last_received_frame = 0;
+    protocol->state.latency_samples = 0;
+    protocol->state.avg_latency = 0;
+    protocol->state.jitter = 0;
+    
+    memset(&protocol->local_inputs, 0, sizeof(protocol->local_inputs));
+    memset(&protocol->remote_inputs, 0, sizeof(protocol->remote_inputs));
+    memset(&protocol->prediction, 0, sizeof(protocol->prediction));
+    state_codec_init(&protocol->state_codec, protocol->state.local_player_id);
+    input_history_init(&protocol->input_history, protocol->state.local_player_id);
+    clock_sync_init(&protocol->clock_sync, protocol->state.is_host, PROTOCOL_FRAME_RATE_HZ);
+    jitter_buffer_init(&protocol->remote_playout, PROTOCOL_FRAME_RATE_HZ);
+    conn_control_init(&protocol->conn_control);
+    net_telemetry_reset(&protocol->telemetry, esp_timer_get_time());
+    desync_check_init(&protocol->desync_check);
     
     ESP_LOGI(TAG, "Protocol state reset");
 }
@@ -314,7 +563,7 @@ void protocol_reset(void)
 // Handle connection state changes
 void protocol_handle_connection(bool connected)
 {
-    protocol_state.is_connected = connected;
+    protocol->state.is_connected = connected;
     
     if (!connected) {
         protocol_reset();
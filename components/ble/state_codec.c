@@ -0,0 +1,370 @@
+#include "state_codec.h"
+#include "bitstream.h"
+#include <string.h>
+
+#define SEQUENCE_MASK ((1u << STATE_CODEC_SEQUENCE_BITS) - 1)
+#define HEADING_MASK ((1u << STATE_CODEC_HEADING_BITS) - 1)
+#define HASH_BITS (STATE_CODEC_HASH_AGE_BITS + 32)
+#define TWO_PI_FIXED16 411775  // 2 * pi in 16.16
+
+// Delta field classes: a 2-bit tag, then the payload
+#define DELTA_SAME 0           // Equal to the baseline
+#define DELTA_SMALL 1          // Zigzag delta in DELTA_SMALL_BITS
+#define DELTA_MEDIUM 2         // Zigzag delta in DELTA_MEDIUM_BITS
+#define DELTA_ABSOLUTE 3       // The value itself at full width
+#define DELTA_SMALL_BITS 5
+#define DELTA_MEDIUM_BITS 10
+
+// A delta names its baseline by how many packets back it is
+#define BASELINE_OFFSET_BITS 4
+_Static_assert(STATE_CODEC_HISTORY == 1 << BASELINE_OFFSET_BITS, "baseline offset must cover the history");
+
+// Velocity steps times frames to position steps
+#define DEAD_RECKONING_DIVISOR \
+    ((int64_t)STATE_CODEC_FRAMES_PER_SECOND << (STATE_CODEC_POSITION_SHIFT - STATE_CODEC_VELOCITY_SHIFT))
+
+static int32_t quantise(fixed16_t value, unsigned shift, unsigned bits);
+static int32_t extrapolate(int32_t position, int32_t velocity, uint32_t frames);
+static bool sequence_newer(uint8_t a, uint8_t b);
+static const state_codec_car_t *find_baseline(const state_codec_entry_t *history, uint8_t sequence);
+static void write_field(bit_writer_t *writer, int32_t delta, uint32_t value, unsigned bits);
+static int32_t read_field(bit_reader_t *reader, int32_t baseline, unsigned bits);
+static void write_keyframe(bit_writer_t *writer, const state_codec_car_t *state);
+static void write_delta(bit_writer_t *writer, const state_codec_car_t *state, const state_codec_car_t *baseline,
+                        uint8_t baseline_offset);
+static void write_header(const state_codec_t *codec, bit_writer_t *writer, bool keyframe, uint8_t sequence);
+static void write_hash(bit_writer_t *writer, const state_codec_car_t *state);
+static void read_hash(bit_reader_t *reader, state_codec_car_t *state);
+
+void state_codec_init(state_codec_t *codec, uint8_t player_id)
+{
+    memset(codec, 0, sizeof(state_codec_t));
+    codec->player_id = player_id;
+}
+
+void state_codec_quantise(const physics_world_t *world, uint8_t car, uint32_t frame, state_codec_car_t *state)
+{
+    const car_physics_t *physics = &world->cars[car];
+    const physics_car_progress_t *progress = &world->progress[car];
+
+    state->frame = frame;
+    state->position_x = quantise(physics->position.x, STATE_CODEC_POSITION_SHIFT, STATE_CODEC_POSITION_BITS);
+    state->position_y = quantise(physics->position.y, STATE_CODEC_POSITION_SHIFT, STATE_CODEC_POSITION_BITS);
+    state->velocity_x = quantise(physics->velocity.x, STATE_CODEC_VELOCITY_SHIFT, STATE_CODEC_VELOCITY_BITS);
+    state->velocity_y = quantise(physics->velocity.y, STATE_CODEC_VELOCITY_SHIFT, STATE_CODEC_VELOCITY_BITS);
+    // Binary angle rounded to the nearest step; wraps with the turn
+    state->heading = (uint16_t)(((uint32_t)fixed_to_angle16(physics->heading) +
+                                 (1u << (15 - STATE_CODEC_HEADING_BITS))) >> (16 - STATE_CODEC_HEADING_BITS)) &
+                     HEADING_MASK;
+    state->checkpoint = progress->next_checkpoint & ((1u << STATE_CODEC_CHECKPOINT_BITS) - 1);
+    state->lap = progress->lap;
+    state->finished = world->race_finished[car];
+    state->hash_valid = false;
+    state->hash_frame = 0;
+    state->hash = 0;
+}
+
+void state_codec_apply(const state_codec_car_t *state, physics_world_t *world, uint8_t car)
+{
+    car_physics_t *physics = &world->cars[car];
+
+    physics->position.x = state->position_x * (1 << STATE_CODEC_POSITION_SHIFT);
+    physics->position.y = state->position_y * (1 << STATE_CODEC_POSITION_SHIFT);
+    physics->velocity.x = state->velocity_x * (1 << STATE_CODEC_VELOCITY_SHIFT);
+    physics->velocity.y = state->velocity_y * (1 << STATE_CODEC_VELOCITY_SHIFT);
+    physics->heading = (fixed16_t)(((int64_t)state->heading * TWO_PI_FIXED16) >> STATE_CODEC_HEADING_BITS);
+    physics->speed = vec2_length(physics->velocity);
+
+    if (state->checkpoint < world->checkpoint_count || world->checkpoint_count == 0) {
+        world->progress[car].next_checkpoint = state->checkpoint;
+        world->progress[car].lap = state->lap;
+        world->race_finished[car] = state->finished;
+    }
+}
+
+size_t state_codec_encode(state_codec_t *codec, const state_codec_car_t *state, uint8_t *buffer, size_t size)
+{
+    uint8_t sequence = codec->next_sequence;
+    uint8_t scratch[STATE_CODEC_MAX_PACKET];
+    bit_writer_t writer;
+
+    // An ack this old may name a slot reused since; stop trusting it
+    if (codec->peer_ack_valid && ((sequence - codec->peer_ack) & SEQUENCE_MASK) >= STATE_CODEC_HISTORY) {
+        codec->peer_ack_valid = false;
+    }
+    const state_codec_car_t *baseline = codec->peer_ack_valid ? find_baseline(codec->sent, codec->peer_ack) : NULL;
+    if (baseline && (state->frame < baseline->frame ||
+                     state->frame - baseline->frame >= (1u << STATE_CODEC_FRAME_DELTA_BITS))) {
+        baseline = NULL;
+    }
+
+    // Keyframe, then a delta if there is a baseline and it is smaller
+    bit_writer_init(&writer, scratch, sizeof(scratch));
+    write_header(codec, &writer, true, sequence);
+    write_keyframe(&writer, state);
+    write_hash(&writer, state);
+    size_t length = bit_writer_bytes(&writer);
+    bool keyframe = true;
+
+    if (baseline) {
+        uint8_t delta[STATE_CODEC_MAX_PACKET];
+        bit_writer_t delta_writer;
+        bit_writer_init(&delta_writer, delta, sizeof(delta));
+        write_header(codec, &delta_writer, false, sequence);
+        write_delta(&delta_writer, state, baseline, (sequence - codec->peer_ack) & SEQUENCE_MASK);
+        write_hash(&delta_writer, state);
+        if (bit_writer_bytes(&delta_writer) < length) {
+            memcpy(scratch, delta, sizeof(delta));
+            length = bit_writer_bytes(&delta_writer);
+            keyframe = false;
+        }
+    }
+
+    if (length > size) {
+        return 0;
+    }
+    memcpy(buffer, scratch, length);
+
+    state_codec_entry_t *entry = &codec->sent[sequence & (STATE_CODEC_HISTORY - 1)];
+    entry->state = *state;
+    entry->sequence = sequence;
+    entry->valid = true;
+    codec->next_sequence = (sequence + 1) & SEQUENCE_MASK;
+
+    if (keyframe) {
+        codec->keyframes_sent++;
+    } else {
+        codec->deltas_sent++;
+    }
+    codec->bytes_sent += (uint32_t)length;
+    return length;
+}
+
+bool state_codec_decode(state_codec_t *codec, const uint8_t *data, size_t length, state_codec_car_t *state,
+                        uint8_t *player_id)
+{
+    bit_reader_t reader;
+    bit_reader_init(&reader, data, length);
+
+    bool keyframe = bit_read(&reader, 1) != 0;
+    uint8_t player = (uint8_t)bit_read(&reader, 1);
+    uint8_t sequence = (uint8_t)bit_read(&reader, STATE_CODEC_SEQUENCE_BITS);
+    if (bit_read(&reader, 1)) {
+        uint8_t ack = (uint8_t)bit_read(&reader, STATE_CODEC_SEQUENCE_BITS);
+        bool recent = ((codec->next_sequence - ack) & SEQUENCE_MASK) <= STATE_CODEC_HISTORY;
+        if (!reader.overflow && recent && find_baseline(codec->sent, ack) &&
+            (!codec->peer_ack_valid || sequence_newer(ack, codec->peer_ack))) {
+            codec->peer_ack = ack;
+            codec->peer_ack_valid = true;
+        }
+    }
+
+    state_codec_car_t decoded;
+    if (keyframe) {
+        decoded.frame = bit_read(&reader, 32);
+        decoded.position_x = bit_read_signed(&reader, STATE_CODEC_POSITION_BITS);
+        decoded.position_y = bit_read_signed(&reader, STATE_CODEC_POSITION_BITS);
+        decoded.velocity_x = bit_read_signed(&reader, STATE_CODEC_VELOCITY_BITS);
+        decoded.velocity_y = bit_read_signed(&reader, STATE_CODEC_VELOCITY_BITS);
+        decoded.heading = (uint16_t)bit_read(&reader, STATE_CODEC_HEADING_BITS);
+        decoded.checkpoint = (uint8_t)bit_read(&reader, STATE_CODEC_CHECKPOINT_BITS);
+        decoded.lap = (uint8_t)bit_read(&reader, STATE_CODEC_LAP_BITS);
+        decoded.finished = bit_read(&reader, 1) != 0;
+    } else {
+        uint8_t baseline_sequence = (sequence - bit_read(&reader, BASELINE_OFFSET_BITS)) & SEQUENCE_MASK;
+        const state_codec_car_t *baseline = find_baseline(codec->received, baseline_sequence);
+        if (!baseline) {
+            codec->missing_baselines++;
+            return false;
+        }
+        decoded.frame = baseline->frame + bit_read(&reader, STATE_CODEC_FRAME_DELTA_BITS);
+        uint32_t frames = decoded.frame - baseline->frame;
+        decoded.position_x = read_field(&reader, extrapolate(baseline->position_x, baseline->velocity_x, frames),
+                                        STATE_CODEC_POSITION_BITS);
+        decoded.position_y = read_field(&reader, extrapolate(baseline->position_y, baseline->velocity_y, frames),
+                                        STATE_CODEC_POSITION_BITS);
+        decoded.velocity_x = read_field(&reader, baseline->velocity_x, STATE_CODEC_VELOCITY_BITS);
+        decoded.velocity_y = read_field(&reader, baseline->velocity_y, STATE_CODEC_VELOCITY_BITS);
+        decoded.heading = (uint16_t)read_field(&reader, baseline->heading, STATE_CODEC_HEADING_BITS) & HEADING_MASK;
+        if (bit_read(&reader, 1)) {
+            decoded.checkpoint = (uint8_t)bit_read(&reader, STATE_CODEC_CHECKPOINT_BITS);
+            decoded.lap = (uint8_t)bit_read(&reader, STATE_CODEC_LAP_BITS);
+            decoded.finished = bit_read(&reader, 1) != 0;
+        } else {
+            decoded.checkpoint = baseline->checkpoint;
+            decoded.lap = baseline->lap;
+            decoded.finished = baseline->finished;
+        }
+    }
+    read_hash(&reader, &decoded);
+
+    if (reader.overflow) {
+        codec->malformed++;
+        return false;
+    }
+
+    state_codec_entry_t *entry = &codec->received[sequence & (STATE_CODEC_HISTORY - 1)];
+    entry->state = decoded;
+    entry->sequence = sequence;
+    entry->valid = true;
+    // A keyframe restarts the ack even if it looks older: after a long
+    // outage the sequence numbers may have lapped the last ack
+    if (keyframe || !codec->ack_valid || sequence_newer(sequence, codec->ack)) {
+        codec->ack = sequence;
+        codec->ack_valid = true;
+    }
+    codec->packets_decoded++;
+
+    *state = decoded;
+    if (player_id) {
+        *player_id = player;
+    }
+    return true;
+}
+
+// Rounds to the nearest step and saturates to a signed bits-wide field
+static int32_t quantise(fixed16_t value, unsigned shift, unsigned bits)
+{
+    int64_t q = ((int64_t)value + (1 << (shift - 1))) >> shift;
+    int64_t limit = (int64_t)1 << (bits - 1);
+    if (q >= limit) q = limit - 1;
+    if (q < -limit) q = -limit;
+    return (int32_t)q;
+}
+
+// Quantised position after frames at a quantised velocity, in integers so
+// both ends agree exactly
+static int32_t extrapolate(int32_t position, int32_t velocity, uint32_t frames)
+{
+    int64_t moved = (int64_t)velocity * frames;
+    return position + (int32_t)((moved + DEAD_RECKONING_DIVISOR / 2) / DEAD_RECKONING_DIVISOR);
+}
+
+// a is newer than b if it is less than half the sequence space ahead
+static bool sequence_newer(uint8_t a, uint8_t b)
+{
+    uint32_t ahead = (uint32_t)(a - b) & SEQUENCE_MASK;
+    return ahead != 0 && ahead < (1u << (STATE_CODEC_SEQUENCE_BITS - 1));
+}
+
+static const state_codec_car_t *find_baseline(const state_codec_entry_t *history, uint8_t sequence)
+{
+    const state_codec_entry_t *entry = &history[sequence & (STATE_CODEC_HISTORY - 1)];
+    return entry->valid && entry->sequence == sequence ? &entry->state : NULL;
+}
+
+static void write_field(bit_writer_t *writer, int32_t delta, uint32_t value, unsigned bits)
+{
+    uint32_t code = zigzag_encode(delta);
+    if (code == 0) {
+        bit_write(writer, DELTA_SAME, 2);
+    } else if (code < (1u << DELTA_SMALL_BITS)) {
+        bit_write(writer, DELTA_SMALL, 2);
+        bit_write(writer, code, DELTA_SMALL_BITS);
+    } else if (code < (1u << DELTA_MEDIUM_BITS) && DELTA_MEDIUM_BITS < bits) {
+        bit_write(writer, DELTA_MEDIUM, 2);
+        bit_write(writer, code, DELTA_MEDIUM_BITS);
+    } else {
+        bit_write(writer, DELTA_ABSOLUTE, 2);
+        bit_write(writer, value, bits);
+    }
+}
+
+// Headings come back modulo the turn; the caller masks them
+static int32_t read_field(bit_reader_t *reader, int32_t baseline, unsigned bits)
+{
+    switch (bit_read(reader, 2)) {
+        case DELTA_SAME:
+            return baseline;
+        case DELTA_SMALL:
+            return baseline + zigzag_decode(bit_read(reader, DELTA_SMALL_BITS));
+        case DELTA_MEDIUM:
+            return baseline + zigzag_decode(bit_read(reader, DELTA_MEDIUM_BITS));
+        default:
+            return bit_read_signed(reader, bits);
+    }
+}
+
+static void write_header(const state_codec_t *codec, bit_writer_t *writer, bool keyframe, uint8_t sequence)
+{
+    bit_write(writer, keyframe, 1);
+    bit_write(writer, codec->player_id & 1, 1);
+    bit_write(writer, sequence, STATE_CODEC_SEQUENCE_BITS);
+    bit_write(writer, codec->ack_valid, 1);
+    if (codec->ack_valid) {
+        bit_write(writer, codec->ack, STATE_CODEC_SEQUENCE_BITS);
+    }
+}
+
+static void write_keyframe(bit_writer_t *writer, const state_codec_car_t *state)
+{
+    bit_write(writer, state->frame, 32);
+    bit_write(writer, (uint32_t)state->position_x, STATE_CODEC_POSITION_BITS);
+    bit_write(writer, (uint32_t)state->position_y, STATE_CODEC_POSITION_BITS);
+    bit_write(writer, (uint32_t)state->velocity_x, STATE_CODEC_VELOCITY_BITS);
+    bit_write(writer, (uint32_t)state->velocity_y, STATE_CODEC_VELOCITY_BITS);
+    bit_write(writer, state->heading, STATE_CODEC_HEADING_BITS);
+    bit_write(writer, state->checkpoint, STATE_CODEC_CHECKPOINT_BITS);
+    bit_write(writer, state->lap, STATE_CODEC_LAP_BITS);
+    bit_write(writer, state->finished, 1);
+}
+
+static void write_delta(bit_writer_t *writer, const state_codec_car_t *state, const state_codec_car_t *baseline,
+                        uint8_t baseline_offset)
+{
+    bit_write(writer, baseline_offset, BASELINE_OFFSET_BITS);
+    uint32_t frames = state->frame - baseline->frame;
+    bit_write(writer, frames, STATE_CODEC_FRAME_DELTA_BITS);
+
+    // Positions relative to where the baseline velocity would have taken
+    // the car, which leaves only the change in velocity to send
+    write_field(writer, state->position_x - extrapolate(baseline->position_x, baseline->velocity_x, frames),
+                (uint32_t)state->position_x, STATE_CODEC_POSITION_BITS);
+    write_field(writer, state->position_y - extrapolate(baseline->position_y, baseline->velocity_y, frames),
+                (uint32_t)state->position_y, STATE_CODEC_POSITION_BITS);
+    write_field(writer, state->velocity_x - baseline->velocity_x, (uint32_t)state->velocity_x,
+                STATE_CODEC_VELOCITY_BITS);
+    write_field(writer, state->velocity_y - baseline->velocity_y, (uint32_t)state->velocity_y,
+                STATE_CODEC_VELOCITY_BITS);
+
+    // Shortest way round the turn
+    int32_t turn = 1 << STATE_CODEC_HEADING_BITS;
+    int32_t heading_delta = (((int32_t)state->heading - baseline->heading + turn / 2) & (turn - 1)) - turn / 2;
+    write_field(writer, heading_delta, state->heading, STATE_CODEC_HEADING_BITS);
+
+    bool progress_changed = state->checkpoint != baseline->checkpoint || state->lap != baseline->lap ||
+                            state->finished != baseline->finished;
+    bit_write(writer, progress_changed, 1);
+    if (progress_changed) {
+        bit_write(writer, state->checkpoint, STATE_CODEC_CHECKPOINT_BITS);
+        bit_write(writer, state->lap, STATE_CODEC_LAP_BITS);
+        bit_write(writer, state->finished, 1);
+    }
+}
+
+// A flag, then the hash and how many frames before the packet's it was
+// taken, if the packet has room left for them
+static void write_hash(bit_writer_t *writer, const state_codec_car_t *state)
+{
+    uint32_t age = state->frame - state->hash_frame;
+    bool send = state->hash_valid && state->hash_frame <= state->frame &&
+                age < (1u << STATE_CODEC_HASH_AGE_BITS) &&
+                writer->bit + 1 + HASH_BITS <= STATE_CODEC_MAX_PACKET * 8;
+    bit_write(writer, send, 1);
+    if (send) {
+        bit_write(writer, age, STATE_CODEC_HASH_AGE_BITS);
+        bit_write(writer, state->hash, 32);
+    }
+}
+
+static void read_hash(bit_reader_t *reader, state_codec_car_t *state)
+{
+    state->hash_valid = bit_read(reader, 1) != 0;
+    if (state->hash_valid) {
+        state->hash_frame = state->frame - bit_read(reader, STATE_CODEC_HASH_AGE_BITS);
+        state->hash = bit_read(reader, 32);
+    } else {
+        state->hash_frame = 0;
+        state->hash = 0;
+    }
+}
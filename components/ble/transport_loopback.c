@@ -0,0 +1,108 @@
+#include "transport_loopback.h"
+#include <string.h>
+
+#define SECOND_SEED 0x5bd1e995u
+
+static bool loopback_send(void *state, const uint8_t *frame, size_t length);
+static void loopback_poll(void *state, transport_receive_fn fn, void *context);
+static bool loopback_connected(const void *state);
+static uint16_t loopback_frame_size(const void *state);
+
+static const transport_ops_t loopback_ops = {
+    .name = "loopback",
+    .send = loopback_send,
+    .poll = loopback_poll,
+    .connected = loopback_connected,
+    .frame_size = loopback_frame_size,
+};
+
+void transport_loopback_init(transport_loopback_t *loopback, const link_sim_config_t *config,
+                             transport_clock_fn clock, uint16_t frame_size)
+{
+    memset(loopback, 0, sizeof(transport_loopback_t));
+    loopback->clock = clock;
+    loopback->frame_size = frame_size ? frame_size : FRAME_BATCH_MAX_SIZE;
+    loopback->up = true;
+    loopback->session = 1;
+
+    link_sim_config_t second = *config;
+    second.seed = config->seed ^ SECOND_SEED;
+    link_sim_init(&loopback->ends[0].inbound, config);
+    link_sim_init(&loopback->ends[1].inbound, &second);
+    for (int i = 0; i < 2; i++) {
+        loopback->ends[i].peer = &loopback->ends[1 - i];
+        loopback->ends[i].loopback = loopback;
+    }
+}
+
+void transport_loopback_endpoint(transport_loopback_t *loopback, int end, transport_t *transport)
+{
+    transport->ops = &loopback_ops;
+    transport->state = &loopback->ends[end ? 1 : 0];
+}
+
+void transport_loopback_set_up(transport_loopback_t *loopback, bool up)
+{
+    if (!up) {
+        for (int i = 0; i < 2; i++) {
+            loopback->ends[i].inbound.count = 0;
+        }
+    }
+    if (up && !loopback->up) {
+        loopback->session++;
+    }
+    loopback->up = up;
+}
+
+static bool loopback_send(void *state, const uint8_t *frame, size_t length)
+{
+    transport_loopback_end_t *end = state;
+    transport_loopback_t *loopback = end->loopback;
+
+    if (!loopback->up || length > loopback->frame_size) {
+        return false;
+    }
+    end->frames_sent++;
+    // A frame the link loses was still sent as far as the sender knows
+    link_sim_send(&end->peer->inbound, frame, length, loopback->clock());
+    return true;
+}
+
+static void loopback_poll(void *state, transport_receive_fn fn, void *context)
+{
+    transport_loopback_end_t *end = state;
+    transport_loopback_t *loopback = end->loopback;
+    uint8_t frame[LINK_SIM_MAX_PACKET];
+    size_t length;
+
+    if (end->reported_up && (!loopback->up || end->reported_session != loopback->session)) {
+        end->reported_up = false;
+        fn(context, TRANSPORT_DISCONNECTED, NULL, 0);
+    }
+    if (loopback->up && !end->reported_up) {
+        end->reported_up = true;
+        end->reported_session = loopback->session;
+        fn(context, TRANSPORT_CONNECTED, NULL, 0);
+    }
+    if (!loopback->up) {
+        return;
+    }
+
+    int64_t now = loopback->clock();
+    while ((length = link_sim_receive(&end->inbound, now, frame)) > 0) {
+        end->frames_received++;
+        fn(context, TRANSPORT_FRAME, frame, length);
+    }
+}
+
+static bool loopback_connected(const void *state)
+{
+    const transport_loopback_end_t *end = state;
+    return end->loopback->up && end->reported_up && end->reported_session == end->loopback->session;
+}
+
+static uint16_t loopback_frame_size(const void *state)
+{
+    const transport_loopback_end_t *end = state;
+    return end->loopback->frame_size;
+}
@@ -0,0 +1,194 @@
+#include "transport_udp.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static bool udp_send(void *state, const uint8_t *frame, size_t length);
+static void udp_poll(void *state, transport_receive_fn fn, void *context);
+static bool udp_connected(const void *state);
+static uint16_t udp_frame_size(const void *state);
+static int64_t monotonic_us(void);
+static void send_datagram(transport_udp_t *udp, const uint8_t *data, size_t length, int64_t now_us);
+static void flush_outbound(transport_udp_t *udp, int64_t now_us);
+
+static const transport_ops_t udp_ops = {
+    .name = "udp",
+    .send = udp_send,
+    .poll = udp_poll,
+    .connected = udp_connected,
+    .frame_size = udp_frame_size,
+};
+
+bool transport_udp_open(transport_udp_t *udp, uint16_t port, uint16_t peer_port, const link_sim_config_t *config,
+                        transport_clock_fn clock, uint16_t frame_size)
+{
+    memset(udp, 0, sizeof(transport_udp_t));
+    udp->clock = clock ? clock : monotonic_us;
+    udp->frame_size = frame_size ? frame_size : FRAME_BATCH_MAX_SIZE;
+    udp->peer_port = peer_port;
+    link_sim_init(&udp->outbound, config);
+
+    udp->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp->socket < 0) {
+        return false;
+    }
+
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t size = sizeof(address);
+    if (bind(udp->socket, (struct sockaddr *)&address, size) != 0 ||
+        getsockname(udp->socket, (struct sockaddr *)&address, &size) != 0 ||
+        fcntl(udp->socket, F_SETFL, fcntl(udp->socket, F_GETFL) | O_NONBLOCK) != 0) {
+        close(udp->socket);
+        udp->socket = -1;
+        return false;
+    }
+    udp->port = ntohs(address.sin_port);
+    // Say hello on the first poll
+    udp->last_sent_us = udp->clock() - TRANSPORT_UDP_IDLE_US;
+    return true;
+}
+
+void transport_udp_close(transport_udp_t *udp)
+{
+    if (udp->socket >= 0) {
+        close(udp->socket);
+        udp->socket = -1;
+    }
+    udp->connected = false;
+}
+
+void transport_udp_set_peer(transport_udp_t *udp, uint16_t peer_port)
+{
+    udp->peer_port = peer_port;
+}
+
+void transport_udp_endpoint(transport_udp_t *udp, transport_t *transport)
+{
+    transport->ops = &udp_ops;
+    transport->state = udp;
+}
+
+static bool udp_send(void *state, const uint8_t *frame, size_t length)
+{
+    transport_udp_t *udp = state;
+
+    if (!udp->connected || length == 0 || length > udp->frame_size) {
+        return false;
+    }
+    // Out now if the link_sim has it due, otherwise from a later poll
+    int64_t now = udp->clock();
+    link_sim_send(&udp->outbound, frame, length, now);
+    flush_outbound(udp, now);
+    return true;
+}
+
+static void udp_poll(void *state, transport_receive_fn fn, void *context)
+{
+    transport_udp_t *udp = state;
+    uint8_t buffer[LINK_SIM_MAX_PACKET + 1];
+    struct sockaddr_in from;
+    socklen_t from_size;
+    ssize_t length;
+
+    if (udp->socket < 0) {
+        return;
+    }
+    int64_t now = udp->clock();
+    flush_outbound(udp, now);
+
+    for (;;) {
+        from_size = sizeof(from);
+        length = recvfrom(udp->socket, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_size);
+        if (length < 0) {
+            break;
+        }
+        if (ntohs(from.sin_port) != udp->peer_port || length > udp->frame_size) {
+            continue;
+        }
+        udp->datagrams_received++;
+        udp->last_heard_us = now;
+        if (!udp->connected) {
+            udp->connected = true;
+            // Answer at once so the peer comes up too
+            send_datagram(udp, NULL, 0, now);
+        }
+        if (!udp->reported_up) {
+            udp->reported_up = true;
+            fn(context, TRANSPORT_CONNECTED, NULL, 0);
+        }
+        if (length > 0) {
+            fn(context, TRANSPORT_FRAME, buffer, (size_t)length);
+        }
+    }
+
+    if (udp->connected && now - udp->last_heard_us > TRANSPORT_UDP_TIMEOUT_US) {
+        udp->connected = false;
+        udp->outbound.count = 0;
+    }
+    if (udp->reported_up && !udp->connected) {
+        udp->reported_up = false;
+        fn(context, TRANSPORT_DISCONNECTED, NULL, 0);
+    }
+
+    int64_t keepalive = udp->connected ? TRANSPORT_UDP_IDLE_US : TRANSPORT_UDP_HELLO_US;
+    if (now - udp->last_sent_us >= keepalive) {
+        udp->keepalives_sent++;
+        send_datagram(udp, NULL, 0, now);
+    }
+}
+
+static bool udp_connected(const void *state)
+{
+    const transport_udp_t *udp = state;
+    return udp->connected;
+}
+
+static uint16_t udp_frame_size(const void *state)
+{
+    const transport_udp_t *udp = state;
+    return udp->frame_size;
+}
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void send_datagram(transport_udp_t *udp, const uint8_t *data, size_t length, int64_t now_us)
+{
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+        .sin_port = htons(udp->peer_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (udp->peer_port == 0) {
+        return;
+    }
+    if (sendto(udp->socket, data, length, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+        // Nobody listening yet, or the buffer is full: a lost datagram
+        udp->send_errors++;
+        return;
+    }
+    udp->datagrams_sent++;
+    udp->last_sent_us = now_us;
+}
+
+static void flush_outbound(transport_udp_t *udp, int64_t now_us)
+{
+    uint8_t frame[LINK_SIM_MAX_PACKET];
+    size_t length;
+
+    while ((length = link_sim_receive(&udp->outbound, now_us, frame)) > 0) {
+        send_datagram(udp, frame, length, now_us);
+    }
+}
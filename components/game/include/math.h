@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Fixed-point types
 typedef int32_t fixed16_t;
@@ -22,24 +23,65 @@ typedef int64_t fixed32_t;
 #define INT_TO_FIXED16(i) ((fixed16_t)((i) * FIXED16_ONE))
 #define FIXED16_TO_INT(f) ((int32_t)((f) >> 16))
 
+// Binary angle: 65536 = one full turn, so wrap-around is free
+typedef uint16_t angle16_t;
+
+#define ANGLE16_QUARTER 0x4000
+#define ANGLE16_HALF    0x8000
+
+// Radians (16.16) to binary angle: 65536 / (2 * pi) in Q32
+#define RADIANS_TO_ANGLE16_Q32 683565276LL
+
 // Trigonometry constants
-#define SIN_TABLE_SIZE 1024
-#define SIN_TABLE_MASK (SIN_TABLE_SIZE - 1)
+#define SIN_TABLE_BITS 8
+#define SIN_TABLE_SIZE (1 << SIN_TABLE_BITS)  // Entries per quarter wave
+#define SIN_TABLE_FRAC_BITS (14 - SIN_TABLE_BITS)
+
+// Quarter-wave sine in 16.16; two extra entries let interpolation read
+// one past the peak without a bounds check
+extern const fixed16_t sin_table[SIN_TABLE_SIZE + 2];
+
+static inline angle16_t fixed_to_angle16(fixed16_t radians) {
+    return (angle16_t)(((int64_t)radians * RADIANS_TO_ANGLE16_Q32 + (1LL << 31)) >> 32);
+}
+
+// Nearest table entry, no interpolation (max error ~0.003)
+static inline fixed16_t angle16_sin(angle16_t angle) {
+    uint32_t offset = angle & (ANGLE16_QUARTER - 1);
+    if (angle & ANGLE16_QUARTER) offset = ANGLE16_QUARTER - offset;
+    uint32_t index = (offset + (1 << (SIN_TABLE_FRAC_BITS - 1))) >> SIN_TABLE_FRAC_BITS;
+    fixed16_t value = sin_table[index];
+    return (angle & ANGLE16_HALF) ? -value : value;
+}
+
+// Linearly interpolated between table entries (max error ~1 ulp)
+static inline fixed16_t angle16_sin_lerp(angle16_t angle) {
+    uint32_t offset = angle & (ANGLE16_QUARTER - 1);
+    if (angle & ANGLE16_QUARTER) offset = ANGLE16_QUARTER - offset;
+
+    uint32_t index = offset >> SIN_TABLE_FRAC_BITS;
+    int32_t frac = offset & ((1 << SIN_TABLE_FRAC_BITS) - 1);
+    fixed16_t a = sin_table[index];
+    fixed16_t b = sin_table[index + 1];
+    fixed16_t value = a + (((b - a) * frac + (1 << (SIN_TABLE_FRAC_BITS - 1))) >> SIN_TABLE_FRAC_BITS);
+    return (angle & ANGLE16_HALF) ? -value : value;
+}
+
+static inline fixed16_t angle16_cos(angle16_t angle) {
+    return angle16_sin((angle16_t)(angle + ANGLE16_QUARTER));
+}
 
-// Trigonometry functions
-extern const int16_t sin_table[SIN_TABLE_SIZE];
-extern const int16_t cos_table[SIN_TABLE_SIZE];
+static inline fixed16_t angle16_cos_lerp(angle16_t angle) {
+    return angle16_sin_lerp((angle16_t)(angle + ANGLE16_QUARTER));
+}
 
+// Radian entry points, used for car headings and rotations
 static inline fixed16_t fixed_sin(fixed16_t angle) {
-    int32_t index = (angle * SIN_TABLE_SIZE) / (2 * FIXED16_ONE);
-    index &= SIN_TABLE_MASK;
-    return (fixed16_t)sin_table[index] << 2;
+    return angle16_sin_lerp(fixed_to_angle16(angle));
 }
 
 static inline fixed16_t fixed_cos(fixed16_t angle) {
-    int32_t index = (angle * SIN_TABLE_SIZE) / (2 * FIXED16_ONE);
-    index = (index + SIN_TABLE_SIZE / 4) & SIN_TABLE_MASK;
-    return (fixed16_t)cos_table[index] << 2;
+    return angle16_cos_lerp(fixed_to_angle16(angle));
 }
 
 // Basic arithmetic
@@ -51,18 +93,70 @@ static inline fixed16_t fixed_div(fixed16_t a, fixed16_t b) {
     return (fixed16_t)(((int64_t)a << 16) / b);
 }
 
+// Integer square root rounded down, computed digit by digit so it needs
+// only shifts, adds and compares (no division)
+static inline uint32_t isqrt64(uint64_t n) {
+    if (n == 0) return 0;
+
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << ((63 - __builtin_clzll(n)) & ~1);
+
+    // Branch-free step: the compare becomes a mask, so random inputs cost
+    // no mispredicts
+    while (bit != 0) {
+        uint64_t trial = result + bit;
+        uint64_t take = -(uint64_t)(n >= trial);
+        n -= trial & take;
+        result = (result >> 1) + (bit & take);
+        bit >>= 2;
+    }
+
+    return (uint32_t)result;
+}
+
+// Square root in 16.16, exact to within 1 ulp. Runs the digit-by-digit
+// loop twice (integer bits, then fraction bits) to stay in 32-bit math.
 static inline fixed16_t fixed_sqrt(fixed16_t x) {
     if (x <= 0) return 0;
-    
-    fixed16_t result = x;
-    fixed16_t temp = 0;
-    
-    for (int i = 0; i < 16; i++) {
-        temp = fixed_div(x, result);
-        result = (result + temp) >> 1;
+
+    uint32_t num = (uint32_t)x;
+    uint32_t result = 0;
+    uint32_t bit = (num & 0xFFF00000) ? (1u << 30) : (1u << 18);
+
+    while (bit > num) {
+        bit >>= 2;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        while (bit != 0) {
+            uint32_t trial = result + bit;
+            uint32_t take = -(uint32_t)(num >= trial);
+            num -= trial & take;
+            result = (result >> 1) + (bit & take);
+            bit >>= 2;
+        }
+
+        if (pass == 0) {
+            // Shift in 16 more fraction bits. A remainder too large to
+            // shift is folded in by adding one half to the result first.
+            if (num > 0xFFFF) {
+                num -= result;
+                num = (num << 16) - 0x8000;
+                result = (result << 16) + 0x8000;
+            } else {
+                num <<= 16;
+                result <<= 16;
+            }
+            bit = 1u << 14;
+        }
+    }
+
+    // Round to nearest
+    if (num > result) {
+        result++;
     }
-    
-    return result;
+
+    return (fixed16_t)result;
 }
 
 // 2D vector operations
@@ -91,7 +185,10 @@ static inline fixed16_t vec2_dot(vec2_t a, vec2_t b) {
 }
 
 static inline fixed16_t vec2_length(vec2_t v) {
-    return fixed_sqrt(fixed_mul(v.x, v.x) + fixed_mul(v.y, v.y));
+    // The 32.32 sum of squares keeps full precision and cannot overflow
+    uint64_t sq = (uint64_t)((int64_t)v.x * v.x) + (uint64_t)((int64_t)v.y * v.y);
+    uint32_t length = isqrt64(sq);
+    return length > INT32_MAX ? INT32_MAX : (fixed16_t)length;
 }
 
 // 3D vector operations
@@ -113,14 +210,100 @@ void mat3_rotation(mat3_t *m, fixed16_t angle);
 void mat3_multiply(mat3_t *result, const mat3_t *a, const mat3_t *b);
 vec2_t mat3_transform(const mat3_t *m, vec2_t v);
 
-// Fast inverse square root approximation
+// 2D affine transforms: the 2x3 upper part of a mat3_t, with the constant
+// (0, 0, 1) bottom row dropped.
+//   x' = m[0][0] * x + m[0][1] * y + m[0][2]
+//   y' = m[1][0] * x + m[1][1] * y + m[1][2]
+typedef struct {
+    fixed16_t m[2][3];
+} affine2_t;
+
+void affine2_identity(affine2_t *m);
+void affine2_rotation(affine2_t *m, fixed16_t angle);
+void affine2_scaling(affine2_t *m, fixed16_t sx, fixed16_t sy);
+void affine2_translation(affine2_t *m, fixed16_t tx, fixed16_t ty);
+// Rotate by angle, then translate to position (local to world)
+void affine2_from_pose(affine2_t *m, vec2_t position, fixed16_t angle);
+// result = a * b, i.e. b is applied first. result may alias a or b.
+void affine2_compose(affine2_t *result, const affine2_t *a, const affine2_t *b);
+// Returns false and leaves result untouched if m is singular
+bool affine2_invert(affine2_t *result, const affine2_t *m);
+
+static inline vec2_t affine2_transform(const affine2_t *m, vec2_t v) {
+    return (vec2_t){
+        fixed_mul(m->m[0][0], v.x) + fixed_mul(m->m[0][1], v.y) + m->m[0][2],
+        fixed_mul(m->m[1][0], v.x) + fixed_mul(m->m[1][1], v.y) + m->m[1][2]
+    };
+}
+
+// Batched vector operations over arrays (math_batch.c). Results are
+// bit-identical to the single-vector functions on every backend; out
+// may alias an input.
+void vec2_add_batch(vec2_t *out, const vec2_t *a, const vec2_t *b, size_t count);
+void vec2_scale_batch(vec2_t *out, const vec2_t *v, fixed16_t s, size_t count);
+void vec2_dot_batch(fixed16_t *out, const vec2_t *a, const vec2_t *b, size_t count);
+void affine2_transform_batch(const affine2_t *m, vec2_t *out, const vec2_t *in, size_t count);
+const char *math_batch_backend(void);
+
+// Reciprocal square root
+#define RSQRT_TABLE_SIZE 48
+
+// 1/sqrt(m) seeds in Q30 for m in [0.25, 1), in steps of 1/64
+extern const uint32_t rsqrt_table[RSQRT_TABLE_SIZE];
+
+// 1/sqrt of value * 2^shift, returned in Q30. The even shift that brings
+// value into [2^30, 2^32) is stored in *shift. Table seed plus three
+// Newton steps, multiplies only.
+static inline uint32_t rsqrt_q30(uint64_t value, int *shift) {
+    int msb = 63 - __builtin_clzll(value);
+    int s = (31 - msb) & ~1;
+    uint32_t m = (uint32_t)(s >= 0 ? value << s : value >> -s);
+
+    uint64_t y = rsqrt_table[(m >> 26) - 16];
+    for (int i = 0; i < 3; i++) {
+        uint64_t my2 = ((y * y >> 30) * m) >> 32;
+        y = (y * ((3ULL << 30) - my2)) >> 31;
+    }
+
+    *shift = s;
+    return (uint32_t)y;
+}
+
+// 1/sqrt(x) in 16.16, correctly rounded, for any positive x
 static inline fixed16_t fixed_rsqrt(fixed16_t x) {
-    if (x <= 0) return FIXED16_ONE;
-    
-    int32_t i = 0x5F3759DF - (((int32_t)x) >> 1);
-    fixed16_t y = *(float *)&i;
-    y = fixed_mul(y, FIXED16_ONE - fixed_mul(fixed_mul(x, y), y) / 2);
-    return y;
+    if (x <= 0) return 0;
+
+    int shift;
+    uint32_t y = rsqrt_q30((uint32_t)x, &shift);
+    int out_shift = 22 - shift / 2;
+    uint64_t r = (y + (1u << (out_shift - 1))) >> out_shift;
+
+    // The Q30 estimate can land one off near a rounding boundary. r is
+    // right when (2r - 1)^2 * x <= 2^50 < (2r + 1)^2 * x; products that
+    // overflow are far above 2^50.
+    uint64_t product;
+    if (!__builtin_mul_overflow((2 * r + 1) * (2 * r + 1), (uint64_t)x, &product) && product <= (1ULL << 50)) {
+        r++;
+    } else if (r > 0 && (__builtin_mul_overflow((2 * r - 1) * (2 * r - 1), (uint64_t)x, &product) ||
+                         product > (1ULL << 50))) {
+        r--;
+    }
+    return (fixed16_t)r;
+}
+
+// Unit vector in the direction of v, or zero for a zero vector. One
+// reciprocal square root and two multiplies, no division.
+static inline vec2_t vec2_normalize(vec2_t v) {
+    uint64_t sq = (uint64_t)((int64_t)v.x * v.x) + (uint64_t)((int64_t)v.y * v.y);
+    if (sq == 0) return (vec2_t){0, 0};
+
+    int shift;
+    int64_t y = rsqrt_q30(sq, &shift);
+    int out_shift = 30 - shift / 2;
+    return (vec2_t){
+        (fixed16_t)((v.x * y) >> out_shift),
+        (fixed16_t)((v.y * y) >> out_shift)
+    };
 }
 
 #endif // _GAME_MATH_H_
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "input_replay.h"
+#include <stdio.h>
+#include <string.h>
+
+#define INPUT_SIZE 4                // Throttle, brake, steering, buttons
+#define RUN_LENGTH_MAX_BYTES 5      // LEB128 of a 32-bit count
+#define KNOWN_FLAGS (INPUT_REPLAY_FINAL_HASH | INPUT_REPLAY_TRUNCATED)
+
+static bool same_input(const physics_input_t *a, const physics_input_t *b);
+static bool write_run(input_replay_recorder_t *recorder);
+static bool read_run(input_replay_reader_t *reader);
+static uint32_t get_u32(const uint8_t *p);
+static uint8_t *put_u32(uint8_t *p, uint32_t value);
+
+void input_replay_record_init(input_replay_recorder_t *recorder, uint8_t *buffer, size_t size, uint8_t players,
+                              uint8_t track_id, uint32_t race_seed)
+{
+    memset(recorder, 0, sizeof(input_replay_recorder_t));
+    recorder->buffer = buffer;
+    recorder->size = size;
+    recorder->players = players < INPUT_REPLAY_MAX_PLAYERS ? players : INPUT_REPLAY_MAX_PLAYERS;
+    recorder->track_id = track_id;
+    recorder->race_seed = race_seed;
+    if (size < INPUT_REPLAY_HEADER_SIZE) {
+        recorder->flags = INPUT_REPLAY_TRUNCATED;
+    } else {
+        recorder->length = INPUT_REPLAY_HEADER_SIZE;
+    }
+}
+
+bool input_replay_record_frame(input_replay_recorder_t *recorder, const physics_input_t *inputs)
+{
+    if (recorder->flags & INPUT_REPLAY_TRUNCATED) {
+        return false;
+    }
+
+    bool same = recorder->run_length > 0;
+    for (int i = 0; i < recorder->players && same; i++) {
+        same = same_input(&inputs[i], &recorder->run[i]);
+    }
+    if (same && recorder->run_length < UINT32_MAX) {
+        recorder->run_length++;
+        recorder->frames++;
+        return true;
+    }
+
+    if (recorder->run_length > 0 && !write_run(recorder)) {
+        return false;
+    }
+    memcpy(recorder->run, inputs, recorder->players * sizeof(physics_input_t));
+    recorder->run_length = 1;
+    recorder->frames++;
+    return true;
+}
+
+uint32_t input_replay_record_rollback(input_replay_recorder_t *recorder, const rollback_t *rollback,
+                                      uint32_t end_frame)
+{
+    physics_input_t inputs[PHYSICS_MAX_CARS];
+    uint32_t recorded = 0;
+
+    while (recorder->frames < rollback->confirmed_frame && recorder->frames < end_frame) {
+        for (uint8_t player = 0; player < recorder->players; player++) {
+            inputs[player] = rollback_get_input(rollback, player, recorder->frames);
+        }
+        if (!input_replay_record_frame(recorder, inputs)) {
+            break;
+        }
+        recorded++;
+    }
+    return recorded;
+}
+
+size_t input_replay_record_finish(input_replay_recorder_t *recorder, bool hash_valid, uint64_t final_hash)
+{
+    if (recorder->size < INPUT_REPLAY_HEADER_SIZE) {
+        return 0;
+    }
+    if (recorder->run_length > 0) {
+        write_run(recorder);
+    }
+    // A truncated race did not end on the recorded frames
+    if (hash_valid && !(recorder->flags & INPUT_REPLAY_TRUNCATED)) {
+        recorder->flags |= INPUT_REPLAY_FINAL_HASH;
+    } else {
+        final_hash = 0;
+    }
+
+    uint8_t *p = recorder->buffer;
+    *p++ = INPUT_REPLAY_MAGIC;
+    *p++ = INPUT_REPLAY_VERSION;
+    *p++ = recorder->players;
+    *p++ = recorder->track_id;
+    p = put_u32(p, recorder->race_seed);
+    p = put_u32(p, recorder->frames);
+    *p++ = recorder->flags;
+    p = put_u32(p, (uint32_t)final_hash);
+    put_u32(p, (uint32_t)(final_hash >> 32));
+    return recorder->length;
+}
+
+bool input_replay_open(input_replay_reader_t *reader, const uint8_t *data, size_t length)
+{
+    if (length < INPUT_REPLAY_HEADER_SIZE || data[0] != INPUT_REPLAY_MAGIC || data[1] != INPUT_REPLAY_VERSION ||
+        data[2] == 0 || data[2] > INPUT_REPLAY_MAX_PLAYERS || (data[12] & ~KNOWN_FLAGS)) {
+        return false;
+    }
+
+    memset(reader, 0, sizeof(input_replay_reader_t));
+    reader->data = data;
+    reader->length = length;
+    reader->position = INPUT_REPLAY_HEADER_SIZE;
+    reader->players = data[2];
+    reader->track_id = data[3];
+    reader->race_seed = get_u32(&data[4]);
+    reader->frames = get_u32(&data[8]);
+    reader->flags = data[12];
+    reader->final_hash = (uint64_t)get_u32(&data[13]) | (uint64_t)get_u32(&data[17]) << 32;
+    return true;
+}
+
+bool input_replay_next(input_replay_reader_t *reader, physics_input_t *inputs)
+{
+    if (reader->frame >= reader->frames) {
+        return false;
+    }
+    if (reader->run_left == 0 && !read_run(reader)) {
+        // Malformed: nothing more comes out of it
+        reader->frames = reader->frame;
+        return false;
+    }
+
+    reader->run_left--;
+    reader->frame++;
+    memcpy(inputs, reader->inputs, reader->players * sizeof(physics_input_t));
+    return true;
+}
+
+// The same frame rollback's simulate_frame runs
+bool input_replay_step(input_replay_reader_t *reader, physics_world_t *world, float delta_time)
+{
+    physics_input_t inputs[PHYSICS_MAX_CARS];
+    if (!input_replay_next(reader, inputs)) {
+        return false;
+    }
+
+    for (uint8_t player = 0; player < reader->players; player++) {
+        physics_apply_input(&world->cars[player], &inputs[player], delta_time);
+    }
+    physics_update(world, delta_time);
+    return true;
+}
+
+uint32_t input_replay_play(input_replay_reader_t *reader, physics_world_t *world, float delta_time)
+{
+    uint32_t played = 0;
+    while (input_replay_step(reader, world, delta_time)) {
+        played++;
+    }
+    return played;
+}
+
+bool input_replay_save(const char *path, const uint8_t *data, size_t length)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && written;
+}
+
+size_t input_replay_load(const char *path, uint8_t *buffer, size_t size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t length = fread(buffer, 1, size, file);
+    bool complete = fgetc(file) == EOF;
+    fclose(file);
+    return complete ? length : 0;
+}
+
+static bool same_input(const physics_input_t *a, const physics_input_t *b)
+{
+    return a->throttle == b->throttle && a->brake == b->brake && a->steering == b->steering &&
+           a->buttons == b->buttons;
+}
+
+// Writes the open run, or marks the recording truncated and drops the run
+// if the buffer cannot take it
+static bool write_run(input_replay_recorder_t *recorder)
+{
+    uint8_t run[INPUT_REPLAY_RUN_MAX_SIZE];
+    uint8_t *p = run;
+    uint32_t length = recorder->run_length;
+    do {
+        *p++ = (uint8_t)((length & 0x7f) | (length > 0x7f ? 0x80 : 0));
+        length >>= 7;
+    } while (length);
+
+    uint8_t *changed = p;
+    size_t mask_size = INPUT_REPLAY_MASK_SIZE(recorder->players);
+    memset(changed, 0, mask_size);
+    p += mask_size;
+    for (int i = 0; i < recorder->players; i++) {
+        if (!same_input(&recorder->run[i], &recorder->previous[i])) {
+            changed[i / 8] |= (uint8_t)(1u << (i % 8));
+            *p++ = recorder->run[i].throttle;
+            *p++ = recorder->run[i].brake;
+            *p++ = (uint8_t)recorder->run[i].steering;
+            *p++ = recorder->run[i].buttons;
+        }
+    }
+
+    size_t size = (size_t)(p - run);
+    if (recorder->length + size > recorder->size) {
+        recorder->flags |= INPUT_REPLAY_TRUNCATED;
+        recorder->frames -= recorder->run_length;
+        recorder->run_length = 0;
+        return false;
+    }
+    memcpy(recorder->buffer + recorder->length, run, size);
+    recorder->length += size;
+    memcpy(recorder->previous, recorder->run, sizeof(recorder->previous));
+    recorder->run_length = 0;
+    recorder->runs++;
+    return true;
+}
+
+static bool read_run(input_replay_reader_t *reader)
+{
+    const uint8_t *data = reader->data;
+    uint32_t length = 0;
+    int bytes = 0;
+    uint8_t byte;
+    do {
+        if (reader->position >= reader->length || bytes == RUN_LENGTH_MAX_BYTES) {
+            return false;
+        }
+        byte = data[reader->position++];
+        length |= (uint32_t)(byte & 0x7f) << (7 * bytes++);
+    } while (byte & 0x80);
+
+    size_t mask_size = INPUT_REPLAY_MASK_SIZE(reader->players);
+    if (length == 0 || reader->position + mask_size > reader->length) {
+        return false;
+    }
+    const uint8_t *changed = &data[reader->position];
+    reader->position += mask_size;
+    // Bits past the last player must be clear
+    if (changed[mask_size - 1] >> (reader->players - 8 * (mask_size - 1))) {
+        return false;
+    }
+    for (int i = 0; i < reader->players; i++) {
+        if (!(changed[i / 8] & (1u << (i % 8)))) {
+            continue;
+        }
+        if (reader->position + INPUT_SIZE > reader->length) {
+            return false;
+        }
+        const uint8_t *p = &data[reader->position];
+        reader->inputs[i] = (physics_input_t){
+            .throttle = p[0],
+            .brake = p[1],
+            .steering = (int8_t)p[2],
+            .buttons = p[3],
+        };
+        reader->position += INPUT_SIZE;
+    }
+    reader->run_left = length;
+    return true;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
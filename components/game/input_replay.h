@@ -0,0 +1,107 @@
+#ifndef _INPUT_REPLAY_H_
+#define _INPUT_REPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "physics.h"
+#include "rollback.h"
+
+// A race as the quantised inputs of every car, frame by frame, behind the
+// track and seed it was run with. Replaying them from the same starting
+// world through physics_apply_input (and so physics_handle_input) and
+// physics_update, as rollback simulates a frame, gives back the race bit
+// for bit: the source of ghost cars and a deterministic simulation load.
+#define INPUT_REPLAY_MAGIC   0x52  // 'R'
+#define INPUT_REPLAY_VERSION 1     // Bump with any layout change; older versions are refused
+
+// Magic, version, players, track id, seed, frames, flags, final hash
+#define INPUT_REPLAY_HEADER_SIZE 21
+
+// The header counts players in a byte; a 256-car world records the first 255
+#define INPUT_REPLAY_MAX_PLAYERS (PHYSICS_MAX_CARS < 255 ? PHYSICS_MAX_CARS : 255)
+
+// Header flags
+#define INPUT_REPLAY_FINAL_HASH (1 << 0)  // final_hash is world_state_hash_world after the last frame
+#define INPUT_REPLAY_TRUNCATED  (1 << 1)  // The buffer filled before the race ended
+
+// After the header, runs of frames with the same inputs: the run length
+// (LEB128), a mask with a bit per player whose input differs from the
+// previous run (player i at bit i % 8 of byte i / 8, (players + 7) / 8
+// bytes), then throttle, brake, steering and buttons of each of those
+// players. A held input costs nothing per frame.
+#define INPUT_REPLAY_MASK_SIZE(players) (((players) + 7) / 8)
+#define INPUT_REPLAY_RUN_MAX_SIZE (5 + INPUT_REPLAY_MASK_SIZE(INPUT_REPLAY_MAX_PLAYERS) + 4 * INPUT_REPLAY_MAX_PLAYERS)
+
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t length;                 // Header included
+    uint8_t players;
+    uint8_t flags;
+    uint8_t track_id;
+    uint32_t race_seed;
+    uint32_t frames;               // Recorded so far, the open run included
+    physics_input_t run[PHYSICS_MAX_CARS];       // Inputs of the open run
+    physics_input_t previous[PHYSICS_MAX_CARS];  // Of the last run written
+    uint32_t run_length;
+
+    // Statistics
+    uint32_t runs;
+} input_replay_recorder_t;
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+    uint8_t players;
+    uint8_t flags;
+    uint8_t track_id;
+    uint32_t race_seed;
+    uint32_t frames;
+    uint64_t final_hash;
+    uint32_t frame;                // Next frame to read
+    uint32_t run_left;             // Frames left in the current run
+    physics_input_t inputs[PHYSICS_MAX_CARS];
+} input_replay_reader_t;
+
+// Records into buffer, which holds the replay once finished. players are
+// the cars whose inputs are recorded, from car 0, up to
+// INPUT_REPLAY_MAX_PLAYERS; the rest are left to physics alone on replay.
+void input_replay_record_init(input_replay_recorder_t *recorder, uint8_t *buffer, size_t size, uint8_t players,
+                              uint8_t track_id, uint32_t race_seed);
+
+// One frame's inputs, one per player. Returns false, and records nothing
+// more, once the buffer is full.
+bool input_replay_record_frame(input_replay_recorder_t *recorder, const physics_input_t *inputs);
+
+// Every frame the engine has confirmed since the last call, up to end_frame.
+// Call at least every ROLLBACK_INPUT_FRAMES frames; returns the frames
+// recorded.
+uint32_t input_replay_record_rollback(input_replay_recorder_t *recorder, const rollback_t *rollback,
+                                      uint32_t end_frame);
+
+// Closes the last run and writes the header. final_hash, if valid, is the
+// world's hash after the last recorded frame. Returns the replay's length.
+size_t input_replay_record_finish(input_replay_recorder_t *recorder, bool hash_valid, uint64_t final_hash);
+
+// Checks the header; false on a wrong magic, version or player count
+bool input_replay_open(input_replay_reader_t *reader, const uint8_t *data, size_t length);
+
+// Inputs of the next frame, one per player. False at the end of the
+// recording or on malformed data.
+bool input_replay_next(input_replay_reader_t *reader, physics_input_t *inputs);
+
+// Reads a frame and simulates it. False, without touching the world, at
+// the end.
+bool input_replay_step(input_replay_reader_t *reader, physics_world_t *world, float delta_time);
+
+// Plays every remaining frame; returns how many
+uint32_t input_replay_play(input_replay_reader_t *reader, physics_world_t *world, float delta_time);
+
+// Whole replays to and from a file: SPIFFS on the device, any path on the
+// host. Load returns the length, 0 if the file is missing or too large.
+bool input_replay_save(const char *path, const uint8_t *data, size_t length);
+size_t input_replay_load(const char *path, uint8_t *buffer, size_t size);
+
+#endif // _INPUT_REPLAY_H_
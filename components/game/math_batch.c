@@ -0,0 +1,203 @@
+#include "include/math.h"
+
+// Backend selection. 16.16 multiplies need the full 64-bit product, so a
+// backend is only used where the ISA has a widening 32x32 lane multiply:
+// SSE4.1 (pmuldq) and NEON (vmull.s32). The P4's PIE lanes only return
+// the low 32 bits, so the target builds the portable loops, which the
+// compiler turns into mul/mulh pairs. Define MATH_BATCH_PORTABLE to force
+// the portable backend on any host.
+#if !defined(MATH_BATCH_PORTABLE) && defined(__SSE4_1__)
+#define MATH_BATCH_SSE41 1
+#include <smmintrin.h>
+#elif !defined(MATH_BATCH_PORTABLE) && defined(__ARM_NEON)
+#define MATH_BATCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Portable backend, also used for the tails of the vector backends
+static void vec2_add_portable(vec2_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = vec2_add(a[i], b[i]);
+    }
+}
+
+static void vec2_scale_portable(vec2_t *out, const vec2_t *v, fixed16_t s, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = vec2_scale(v[i], s);
+    }
+}
+
+static void vec2_dot_portable(fixed16_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = vec2_dot(a[i], b[i]);
+    }
+}
+
+static void affine2_transform_portable(const affine2_t *m, vec2_t *out, const vec2_t *in, size_t count) {
+    fixed16_t m00 = m->m[0][0], m01 = m->m[0][1], m02 = m->m[0][2];
+    fixed16_t m10 = m->m[1][0], m11 = m->m[1][1], m12 = m->m[1][2];
+
+    for (size_t i = 0; i < count; i++) {
+        vec2_t v = in[i];
+        out[i].x = fixed_mul(m00, v.x) + fixed_mul(m01, v.y) + m02;
+        out[i].y = fixed_mul(m10, v.x) + fixed_mul(m11, v.y) + m12;
+    }
+}
+
+#if MATH_BATCH_SSE41
+
+// Four 16.16 products of a and b. pmuldq multiplies the even lanes, so the
+// odd lanes are shifted down for a second pass. Bits 16..47 of each 64-bit
+// product are the same for logical and arithmetic shifts, which keeps the
+// result identical to fixed_mul.
+static inline __m128i mul_fixed_x4(__m128i a, __m128i b) {
+    __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 16);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), 16);
+    return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+}
+
+void vec2_add_batch(vec2_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i va = _mm_loadu_si128((const __m128i *)&a[i]);
+        __m128i vb = _mm_loadu_si128((const __m128i *)&b[i]);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_add_epi32(va, vb));
+    }
+    vec2_add_portable(out + i, a + i, b + i, count - i);
+}
+
+void vec2_scale_batch(vec2_t *out, const vec2_t *v, fixed16_t s, size_t count) {
+    __m128i vs = _mm_set1_epi32(s);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i vv = _mm_loadu_si128((const __m128i *)&v[i]);
+        _mm_storeu_si128((__m128i *)&out[i], mul_fixed_x4(vv, vs));
+    }
+    vec2_scale_portable(out + i, v + i, s, count - i);
+}
+
+void vec2_dot_batch(fixed16_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i p0 = mul_fixed_x4(_mm_loadu_si128((const __m128i *)&a[i]),
+                                  _mm_loadu_si128((const __m128i *)&b[i]));
+        __m128i p1 = mul_fixed_x4(_mm_loadu_si128((const __m128i *)&a[i + 2]),
+                                  _mm_loadu_si128((const __m128i *)&b[i + 2]));
+        // Pairwise x + y: gather the x and y products, then add
+        __m128 f0 = _mm_castsi128_ps(p0), f1 = _mm_castsi128_ps(p1);
+        __m128i xs = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i ys = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128((__m128i *)&out[i], _mm_add_epi32(xs, ys));
+    }
+    vec2_dot_portable(out + i, a + i, b + i, count - i);
+}
+
+void affine2_transform_batch(const affine2_t *m, vec2_t *out, const vec2_t *in, size_t count) {
+    // Lanes are (x0, y0, x1, y1): each output lane takes the matrix row of
+    // its component times the input x and y of its point
+    __m128i row_x = _mm_setr_epi32(m->m[0][0], m->m[1][0], m->m[0][0], m->m[1][0]);
+    __m128i row_y = _mm_setr_epi32(m->m[0][1], m->m[1][1], m->m[0][1], m->m[1][1]);
+    __m128i offset = _mm_setr_epi32(m->m[0][2], m->m[1][2], m->m[0][2], m->m[1][2]);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+        __m128i xx = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i yy = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128i r = _mm_add_epi32(_mm_add_epi32(mul_fixed_x4(row_x, xx), mul_fixed_x4(row_y, yy)), offset);
+        _mm_storeu_si128((__m128i *)&out[i], r);
+    }
+    affine2_transform_portable(m, out + i, in + i, count - i);
+}
+
+const char *math_batch_backend(void) {
+    return "sse4.1";
+}
+
+#elif MATH_BATCH_NEON
+
+// Two 16.16 products. vshrn keeps the low 32 bits of the arithmetic
+// shift, which is exactly what fixed_mul returns.
+static inline int32x2_t mul_fixed_x2(int32x2_t a, int32x2_t b) {
+    return vshrn_n_s64(vmull_s32(a, b), 16);
+}
+
+static inline int32x4_t mul_fixed_x4(int32x4_t a, int32x4_t b) {
+    return vcombine_s32(mul_fixed_x2(vget_low_s32(a), vget_low_s32(b)),
+                        mul_fixed_x2(vget_high_s32(a), vget_high_s32(b)));
+}
+
+void vec2_add_batch(vec2_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        int32x4_t va = vld1q_s32(&a[i].x);
+        int32x4_t vb = vld1q_s32(&b[i].x);
+        vst1q_s32(&out[i].x, vaddq_s32(va, vb));
+    }
+    vec2_add_portable(out + i, a + i, b + i, count - i);
+}
+
+void vec2_scale_batch(vec2_t *out, const vec2_t *v, fixed16_t s, size_t count) {
+    int32x4_t vs = vdupq_n_s32(s);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        vst1q_s32(&out[i].x, mul_fixed_x4(vld1q_s32(&v[i].x), vs));
+    }
+    vec2_scale_portable(out + i, v + i, s, count - i);
+}
+
+void vec2_dot_batch(fixed16_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // De-interleave into x and y lanes
+        int32x4x2_t va = vld2q_s32(&a[i].x);
+        int32x4x2_t vb = vld2q_s32(&b[i].x);
+        int32x4_t px = mul_fixed_x4(va.val[0], vb.val[0]);
+        int32x4_t py = mul_fixed_x4(va.val[1], vb.val[1]);
+        vst1q_s32(&out[i], vaddq_s32(px, py));
+    }
+    vec2_dot_portable(out + i, a + i, b + i, count - i);
+}
+
+void affine2_transform_batch(const affine2_t *m, vec2_t *out, const vec2_t *in, size_t count) {
+    int32x4_t m00 = vdupq_n_s32(m->m[0][0]), m01 = vdupq_n_s32(m->m[0][1]), m02 = vdupq_n_s32(m->m[0][2]);
+    int32x4_t m10 = vdupq_n_s32(m->m[1][0]), m11 = vdupq_n_s32(m->m[1][1]), m12 = vdupq_n_s32(m->m[1][2]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int32x4x2_t v = vld2q_s32(&in[i].x);
+        int32x4x2_t r;
+        r.val[0] = vaddq_s32(vaddq_s32(mul_fixed_x4(m00, v.val[0]), mul_fixed_x4(m01, v.val[1])), m02);
+        r.val[1] = vaddq_s32(vaddq_s32(mul_fixed_x4(m10, v.val[0]), mul_fixed_x4(m11, v.val[1])), m12);
+        vst2q_s32(&out[i].x, r);
+    }
+    affine2_transform_portable(m, out + i, in + i, count - i);
+}
+
+const char *math_batch_backend(void) {
+    return "neon";
+}
+
+#else
+
+void vec2_add_batch(vec2_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    vec2_add_portable(out, a, b, count);
+}
+
+void vec2_scale_batch(vec2_t *out, const vec2_t *v, fixed16_t s, size_t count) {
+    vec2_scale_portable(out, v, s, count);
+}
+
+void vec2_dot_batch(fixed16_t *out, const vec2_t *a, const vec2_t *b, size_t count) {
+    vec2_dot_portable(out, a, b, count);
+}
+
+void affine2_transform_batch(const affine2_t *m, vec2_t *out, const vec2_t *in, size_t count) {
+    affine2_transform_portable(m, out, in, count);
+}
+
+const char *math_batch_backend(void) {
+    return "portable";
+}
+
+#endif
@@ -4,13 +4,83 @@
 
 static const char *TAG = "physics";
 static physics_world_t physics_world;
+static physics_tilemap_t physics_tilemap;
+static physics_rect_t collision_rects[PHYSICS_MAX_COLLISION_RECTS];
+static int collision_rect_count = 0;
+
+// Centreline with cumulative arc length; arc[i] is the distance to point i
+static vec2_t centreline_points[PHYSICS_MAX_CENTRELINE_POINTS];
+static vec2_t centreline_dirs[PHYSICS_MAX_CENTRELINE_POINTS];
+static int64_t centreline_arc[PHYSICS_MAX_CENTRELINE_POINTS + 1];  // 16.16, can pass 32767 px
+static int centreline_count = 0;
+
+// Surface table indexed directly by tile id; small enough to stay in cache
+static physics_surface_t surface_lut[PHYSICS_MAX_SURFACES];
+static uint32_t solid_mask = 0;
+static uint8_t tile_shift = 0;  // log2(tile_size) when a power of two, else 0
+static const physics_surface_t default_surface = {
+    .friction = PHYSICS_SURFACE_ONE,
+    .speed_cap = PHYSICS_SURFACE_ONE,
+    .flags = 0
+};
 static bool physics_initialized = false;
 
+// Origin of a tile ray, shared by every ray of a batch
+typedef struct {
+    int32_t cell_x, cell_y;   // Tile containing the origin
+    fixed16_t frac_x, frac_y; // Origin offset inside that tile
+} tile_ray_origin_t;
+
+// Rectangle faces a centre inside it may be pushed out through; tiles
+// close the faces they share with solid neighbours
+#define RECT_FACE_MIN_X (1 << 0)
+#define RECT_FACE_MAX_X (1 << 1)
+#define RECT_FACE_MIN_Y (1 << 2)
+#define RECT_FACE_MAX_Y (1 << 3)
+#define RECT_FACES_ALL  0x0F
+
+// Output array filled by physics_find_car_pairs
+typedef struct {
+    physics_car_pair_t *pairs;
+    int count;
+    int capacity;
+} car_pair_list_t;
+
 // Internal helper functions
 static void integrate_motion(car_physics_t *car, float delta_time);
-static void apply_friction(car_physics_t *car, float delta_time);
+static void apply_friction(car_physics_t *car, const physics_surface_t *surface, float delta_time);
+static void apply_surface(car_physics_t *car, const physics_surface_t *surface, float delta_time);
+static const physics_surface_t *surface_at(vec2_t position);
 static void resolve_collisions(physics_world_t *world);
-static void update_checkpoint_progress(physics_world_t *world, uint8_t car_index);
+static bool resolve_car_pair(uint8_t i, uint8_t j, void *context);
+static bool collect_car_pair(uint8_t a, uint8_t b, void *context);
+static void update_checkpoint_progress(physics_world_t *world, uint8_t car_index, vec2_t previous,
+                                       uint32_t step_ns);
+static void complete_gate(physics_world_t *world, uint8_t car_index, uint8_t gate, uint32_t time);
+static int64_t gate_side(const checkpoint_t *checkpoint, vec2_t point);
+static fixed16_t centreline_project(vec2_t point, int segment, int64_t *distance_squared);
+static int centreline_nearest(vec2_t point);
+static void update_track_position(physics_world_t *world, uint8_t car_index);
+static void update_race_positions(physics_world_t *world);
+static void sweep_motion(car_physics_t *car, vec2_t motion);
+static void reflect_velocity(car_physics_t *car, vec2_t normal);
+static bool sweep_rect(vec2_t start, vec2_t delta, fixed16_t radius, const physics_rect_t *rect,
+                       uint8_t open_faces, physics_sweep_hit_t *hit);
+static bool rect_penetration(vec2_t centre, fixed16_t radius, const physics_rect_t *rect,
+                             uint8_t open_faces, vec2_t *normal, fixed16_t *depth);
+static bool sweep_box(const int64_t p[2], const int64_t d[2], const int64_t lo[2], const int64_t hi[2],
+                      int64_t *toi, int *axis_out);
+static vec2_t axis_normal(int axis, vec2_t delta);
+static bool sweep_corner(vec2_t start, vec2_t delta, int64_t length, int64_t corner_x, int64_t corner_y,
+                         fixed16_t radius, int64_t *toi);
+static void depenetrate(car_physics_t *car);
+static bool tile_is_blocking(int32_t x, int32_t y, uint8_t *tile);
+static int32_t tile_cell(int64_t coord, int32_t lo, int32_t hi);
+static physics_rect_t tile_rect(int32_t x, int32_t y);
+static uint8_t tile_open_faces(int32_t x, int32_t y);
+static void tile_ray_setup(vec2_t origin, tile_ray_origin_t *ray_origin);
+static bool tile_ray_march(vec2_t origin, const tile_ray_origin_t *ray_origin, vec2_t direction,
+                           fixed16_t max_distance, physics_ray_hit_t *hit);
 
 esp_err_t physics_init(void) {
     if (physics_initialized) {
@@ -29,6 +99,9 @@ esp_err_t physics_init(void) {
         physics_world.cars[i].friction = PHYSICS_FRICTION_COEFFICIENT;
     }
 
+    // Neutral surfaces until a track provides its own
+    physics_set_surfaces(NULL, 0);
+
     physics_initialized = true;
     ESP_LOGI(TAG, "Physics system initialized");
     return ESP_OK;
@@ -55,22 +128,34 @@ void physics_update(physics_world_t *world, float delta_time) {
         }
 
         car_physics_t *car = &world->cars[i];
+        const physics_surface_t *surface = surface_at(car->position);
+        vec2_t previous = car->position;
+        uint32_t step_ns = (uint32_t)(delta_time * 1e9 + 0.5);
         
         // Integrate motion
         integrate_motion(car, delta_time);
         
         // Apply friction and drag
-        apply_friction(car, delta_time);
+        apply_friction(car, surface, delta_time);
+        
+        // Apply speed cap and surface hazards
+        apply_surface(car, surface, delta_time);
         
         // Update checkpoint progress
-        update_checkpoint_progress(world, i);
+        update_track_position(world, i);
+        update_checkpoint_progress(world, i, previous, step_ns);
         
-        // Update race time
-        world->race_time[i] += (uint32_t)(delta_time * 1000);
+        // Update race time, carrying the sub-millisecond remainder so steps
+        // like 16.667 ms do not lose time
+        uint32_t elapsed_ns = world->race_time_ns[i] + step_ns;
+        world->race_time[i] += elapsed_ns / 1000000;
+        world->race_time_ns[i] = elapsed_ns % 1000000;
     }
 
     // Resolve collisions between cars and track
     resolve_collisions(world);
+
+    update_race_positions(world);
 }
 
 void physics_reset_car(car_physics_t *car, vec2_t position, fixed16_t heading) {
@@ -148,13 +233,32 @@ void physics_handle_input(car_physics_t *car, float throttle, float brake, float
     physics_apply_torque(car, steering_angle);
 }
 
+physics_input_t physics_quantise_input(float throttle, float brake, float steering, uint8_t buttons) {
+    throttle = (throttle < 0.0f) ? 0.0f : (throttle > 1.0f) ? 1.0f : throttle;
+    brake = (brake < 0.0f) ? 0.0f : (brake > 1.0f) ? 1.0f : brake;
+    steering = (steering < -1.0f) ? -1.0f : (steering > 1.0f) ? 1.0f : steering;
+
+    physics_input_t input = {
+        .throttle = (uint8_t)(throttle * 100.0f + 0.5f),
+        .brake = (uint8_t)(brake * 100.0f + 0.5f),
+        .steering = (int8_t)(steering * 100.0f + (steering < 0.0f ? -0.5f : 0.5f)),
+        .buttons = buttons,
+    };
+    return input;
+}
+
+void physics_apply_input(car_physics_t *car, const physics_input_t *input, float delta_time) {
+    physics_handle_input(car, input->throttle / 100.0f, input->brake / 100.0f, input->steering / 100.0f,
+                         delta_time);
+}
+
 bool physics_check_track_collision(vec2_t position, vec2_t *normal, fixed16_t *penetration) {
     // Simple circular track collision detection
     fixed16_t distance_from_center = vec2_length(position);
     
     if (distance_from_center > PHYSICS_WALL_DISTANCE) {
         if (normal && distance_from_center != 0) {
-            *normal = vec2_scale(position, fixed_div(FIXED16_ONE, distance_from_center));
+            *normal = vec2_normalize(position);
         }
         if (penetration) {
             *penetration = distance_from_center - PHYSICS_WALL_DISTANCE;
@@ -164,7 +268,7 @@ bool physics_check_track_collision(vec2_t position, vec2_t *normal, fixed16_t *p
     
     if (distance_from_center < -PHYSICS_WALL_DISTANCE) {
         if (normal && distance_from_center != 0) {
-            *normal = vec2_scale(position, -fixed_div(FIXED16_ONE, distance_from_center));
+            *normal = vec2_scale(vec2_normalize(position), -FIXED16_ONE);
         }
         if (penetration) {
             *penetration = -PHYSICS_WALL_DISTANCE - distance_from_center;
@@ -178,23 +282,159 @@ bool physics_check_track_collision(vec2_t position, vec2_t *normal, fixed16_t *p
 bool physics_check_car_collision(car_physics_t *car1, car_physics_t *car2) {
     if (!car1 || !car2) return false;
 
-    // Simple bounding circle collision
-    vec2_t delta = vec2_sub(car1->position, car2->position);
-    fixed16_t distance_squared = vec2_dot(delta, delta);
-    fixed16_t min_distance = INT_TO_FIXED16(100);  // 1.0m radius per car
-    fixed16_t min_distance_squared = fixed_mul(min_distance, min_distance);
-    
-    return distance_squared < min_distance_squared;
+    // Bounding circle test in 64 bits; far-apart cars overflow a 16.16 dot,
+    // and the box reject keeps the squares in range at any separation
+    int64_t dx = (int64_t)car1->position.x - car2->position.x;
+    int64_t dy = (int64_t)car1->position.y - car2->position.y;
+    int64_t min_distance = PHYSICS_CAR_COLLISION_DISTANCE;
+    if (dx >= min_distance || dx <= -min_distance || dy >= min_distance || dy <= -min_distance) {
+        return false;
+    }
+
+    return dx * dx + dy * dy < min_distance * min_distance;
 }
 
-bool physics_check_checkpoint_collision(car_physics_t *car, checkpoint_t *checkpoint) {
-    if (!car || !checkpoint || checkpoint->passed) return false;
+int physics_sweep_car_pairs(physics_broadphase_t *broadphase, const car_physics_t *cars, int count,
+                            physics_pair_fn visit, void *context) {
+    if (!broadphase || !cars || !visit || count <= 1) return 0;
+    if (count > PHYSICS_MAX_CARS) count = PHYSICS_MAX_CARS;
 
-    vec2_t delta = vec2_sub(car->position, checkpoint->position);
-    fixed16_t distance_squared = vec2_dot(delta, delta);
-    fixed16_t radius_squared = fixed_mul(checkpoint->radius, checkpoint->radius);
-    
-    return distance_squared < radius_squared;
+    // Rebuild the order only when the car set changes
+    if (broadphase->count != count) {
+        for (int i = 0; i < count; i++) {
+            broadphase->order[i] = (uint8_t)i;
+        }
+        broadphase->count = (uint16_t)count;
+    }
+
+    // Insertion sort on x: cars move little per step, so this is close to O(n)
+    uint8_t *order = broadphase->order;
+    for (int i = 1; i < count; i++) {
+        uint8_t index = order[i];
+        fixed16_t x = cars[index].position.x;
+        int j = i - 1;
+        while (j >= 0 && cars[order[j]].position.x > x) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = index;
+    }
+
+    // Sweep: only cars whose x extents overlap are tested on y. Differences
+    // are taken in 64 bits so cars at opposite ends of the range can't wrap.
+    int pair_count = 0;
+    for (int i = 0; i < count; i++) {
+        const car_physics_t *car = &cars[order[i]];
+
+        for (int j = i + 1; j < count; j++) {
+            const car_physics_t *other = &cars[order[j]];
+            if ((int64_t)other->position.x - car->position.x >= PHYSICS_CAR_COLLISION_DISTANCE) {
+                break;
+            }
+
+            int64_t dy = (int64_t)other->position.y - car->position.y;
+            if (dy >= PHYSICS_CAR_COLLISION_DISTANCE || dy <= -PHYSICS_CAR_COLLISION_DISTANCE) {
+                continue;
+            }
+
+            uint8_t a = order[i] < order[j] ? order[i] : order[j];
+            uint8_t b = order[i] < order[j] ? order[j] : order[i];
+            pair_count++;
+            if (!visit(a, b, context)) return pair_count;
+        }
+    }
+
+    return pair_count;
+}
+
+int physics_find_car_pairs(physics_broadphase_t *broadphase, const car_physics_t *cars, int count,
+                           physics_car_pair_t *pairs, int max_pairs) {
+    if (!pairs || max_pairs <= 0) return 0;
+
+    car_pair_list_t list = { pairs, 0, max_pairs };
+    physics_sweep_car_pairs(broadphase, cars, count, collect_car_pair, &list);
+    return list.count;
+}
+
+int physics_check_gate_crossing(const checkpoint_t *checkpoint, vec2_t from, vec2_t to) {
+    if (!checkpoint) return 0;
+
+    // Segment-segment test with 64-bit cross products, no division. The
+    // gate side is positive behind the gate and non-positive past it, so
+    // a car stopping exactly on the line is counted once.
+    int64_t side_from = gate_side(checkpoint, from);
+    int64_t side_to = gate_side(checkpoint, to);
+
+    int direction;
+    if (side_from > 0 && side_to <= 0) {
+        direction = 1;
+    } else if (side_from <= 0 && side_to > 0) {
+        direction = -1;
+    } else {
+        return 0;
+    }
+
+    // Both gate ends must lie on opposite sides of the motion (or on it)
+    vec2_t motion = vec2_sub(to, from);
+    vec2_t a_rel = vec2_sub(checkpoint->gate_a, from);
+    vec2_t b_rel = vec2_sub(checkpoint->gate_b, from);
+    int64_t side_a = (int64_t)motion.x * a_rel.y - (int64_t)motion.y * a_rel.x;
+    int64_t side_b = (int64_t)motion.x * b_rel.y - (int64_t)motion.y * b_rel.x;
+    if ((side_a > 0 && side_b > 0) || (side_a < 0 && side_b < 0)) return 0;
+
+    return direction;
+}
+
+bool physics_sweep_circle(vec2_t start, vec2_t end, fixed16_t radius, physics_sweep_hit_t *hit) {
+    if (!hit) return false;
+
+    vec2_t delta = vec2_sub(end, start);
+    if (delta.x == 0 && delta.y == 0) return false;
+
+    bool found = false;
+    hit->toi = FIXED16_ONE + 1;
+
+    // Collision rectangles from the track file
+    for (int i = 0; i < collision_rect_count; i++) {
+        physics_sweep_hit_t rect_hit;
+        if (sweep_rect(start, delta, radius, &collision_rects[i], RECT_FACES_ALL, &rect_hit) &&
+            rect_hit.toi < hit->toi) {
+            *hit = rect_hit;
+            found = true;
+        }
+    }
+
+    // Solid tiles under the swept bounds. Off-map cells block, as they do
+    // for rays; one ring of them around the map is enough to wall it in.
+    fixed16_t tile_size = physics_tilemap.tile_size;
+    if (physics_tilemap.tiles && tile_size > 0) {
+        int64_t min_x = (int64_t)(start.x < end.x ? start.x : end.x) - radius;
+        int64_t max_x = (int64_t)(start.x > end.x ? start.x : end.x) + radius;
+        int64_t min_y = (int64_t)(start.y < end.y ? start.y : end.y) - radius;
+        int64_t max_y = (int64_t)(start.y > end.y ? start.y : end.y) + radius;
+
+        int32_t x0 = tile_cell(min_x, -1, physics_tilemap.width);
+        int32_t y0 = tile_cell(min_y, -1, physics_tilemap.height);
+        int32_t x1 = tile_cell(max_x, -1, physics_tilemap.width);
+        int32_t y1 = tile_cell(max_y, -1, physics_tilemap.height);
+
+        for (int32_t y = y0; y <= y1; y++) {
+            for (int32_t x = x0; x <= x1; x++) {
+                uint8_t tile;
+                if (!tile_is_blocking(x, y, &tile)) continue;
+
+                physics_rect_t rect = tile_rect(x, y);
+                physics_sweep_hit_t tile_hit;
+                if (sweep_rect(start, delta, radius, &rect, tile_open_faces(x, y), &tile_hit) &&
+                    tile_hit.toi < hit->toi) {
+                    *hit = tile_hit;
+                    found = true;
+                }
+            }
+        }
+    }
+
+    return found;
 }
 
 bool physics_ray_cast(vec2_t origin, vec2_t direction, fixed16_t max_distance, vec2_t *hit_point, fixed16_t *distance) {
@@ -228,6 +468,99 @@ bool physics_ray_cast(vec2_t origin, vec2_t direction, fixed16_t max_distance, v
     return true;
 }
 
+void physics_set_tilemap(const physics_tilemap_t *tilemap) {
+    if (!tilemap) {
+        memset(&physics_tilemap, 0, sizeof(physics_tilemap));
+        return;
+    }
+
+    physics_tilemap = *tilemap;
+
+    // Power-of-two tiles turn the per-car tile lookup into shifts
+    tile_shift = 0;
+    if (tilemap->tile_size > 0 && (tilemap->tile_size & (tilemap->tile_size - 1)) == 0) {
+        while ((1 << tile_shift) < tilemap->tile_size) {
+            tile_shift++;
+        }
+    }
+
+    ESP_LOGI(TAG, "Tilemap set: %dx%d tiles", tilemap->width, tilemap->height);
+}
+
+void physics_set_collision_rects(const physics_rect_t *rects, int count) {
+    if (!rects || count < 0) count = 0;
+    if (count > PHYSICS_MAX_COLLISION_RECTS) {
+        ESP_LOGW(TAG, "Too many collision rects (%d), keeping %d", count, PHYSICS_MAX_COLLISION_RECTS);
+        count = PHYSICS_MAX_COLLISION_RECTS;
+    }
+
+    if (count > 0) {
+        memcpy(collision_rects, rects, count * sizeof(physics_rect_t));
+    }
+    collision_rect_count = count;
+}
+
+void physics_set_centreline(const vec2_t *points, int count) {
+    if (!points || count < 2) count = 0;
+    if (count > PHYSICS_MAX_CENTRELINE_POINTS) {
+        ESP_LOGW(TAG, "Too many centreline points (%d), keeping %d", count, PHYSICS_MAX_CENTRELINE_POINTS);
+        count = PHYSICS_MAX_CENTRELINE_POINTS;
+    }
+
+    centreline_arc[0] = 0;
+    for (int i = 0; i < count; i++) {
+        vec2_t segment = vec2_sub(points[(i + 1) % count], points[i]);
+        centreline_points[i] = points[i];
+        centreline_dirs[i] = vec2_normalize(segment);
+        centreline_arc[i + 1] = centreline_arc[i] + vec2_length(segment);
+    }
+    centreline_count = count;
+}
+
+int64_t physics_get_centreline_length(void) {
+    return centreline_count > 0 ? centreline_arc[centreline_count] : 0;
+}
+
+void physics_set_surfaces(const physics_surface_t *surfaces, int count) {
+    if (!surfaces || count < 0) count = 0;
+    if (count > PHYSICS_MAX_SURFACES) count = PHYSICS_MAX_SURFACES;
+
+    solid_mask = 0;
+    for (int i = 0; i < PHYSICS_MAX_SURFACES; i++) {
+        surface_lut[i] = i < count ? surfaces[i] : default_surface;
+        if (surface_lut[i].flags & PHYSICS_SURFACE_SOLID) {
+            solid_mask |= 1u << i;
+        }
+    }
+}
+
+bool physics_ray_cast_tiles(vec2_t origin, vec2_t direction, fixed16_t max_distance, physics_ray_hit_t *hit) {
+    if (!hit || !physics_tilemap.tiles || physics_tilemap.tile_size <= 0) return false;
+
+    tile_ray_origin_t ray_origin;
+    tile_ray_setup(origin, &ray_origin);
+    return tile_ray_march(origin, &ray_origin, direction, max_distance, hit);
+}
+
+int physics_ray_cast_tiles_batch(vec2_t origin, const vec2_t *directions, int count,
+                                 fixed16_t max_distance, physics_ray_hit_t *hits) {
+    if (!directions || !hits || count <= 0) return 0;
+    if (!physics_tilemap.tiles || physics_tilemap.tile_size <= 0) return 0;
+
+    // The origin cell and offsets are the only divisions shared by all rays
+    tile_ray_origin_t ray_origin;
+    tile_ray_setup(origin, &ray_origin);
+
+    int hit_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (tile_ray_march(origin, &ray_origin, directions[i], max_distance, &hits[i])) {
+            hit_count++;
+        }
+    }
+
+    return hit_count;
+}
+
 fixed16_t physics_get_distance_to_wall(vec2_t position, fixed16_t heading) {
     vec2_t direction = (vec2_t){fixed_cos(heading), fixed_sin(heading)};
     vec2_t hit_point;
@@ -241,15 +574,22 @@ fixed16_t physics_get_distance_to_wall(vec2_t position, fixed16_t heading) {
 }
 
 vec2_t physics_get_closest_point_on_track(vec2_t position) {
+    if (centreline_count > 0) {
+        int segment = centreline_nearest(position);
+        int64_t distance_squared;
+        fixed16_t along = centreline_project(position, segment, &distance_squared);
+        return vec2_add(centreline_points[segment], vec2_scale(centreline_dirs[segment], along));
+    }
+
     // Clamp position to track boundaries
     fixed16_t distance = vec2_length(position);
     
     if (distance > PHYSICS_WALL_DISTANCE) {
-        return vec2_scale(vec2_scale(position, fixed_div(FIXED16_ONE, distance)), PHYSICS_WALL_DISTANCE);
+        return vec2_scale(vec2_normalize(position), PHYSICS_WALL_DISTANCE);
     }
     
     if (distance < -PHYSICS_WALL_DISTANCE) {
-        return vec2_scale(vec2_scale(position, fixed_div(FIXED16_ONE, distance)), -PHYSICS_WALL_DISTANCE);
+        return vec2_scale(vec2_normalize(position), -PHYSICS_WALL_DISTANCE);
     }
     
     return position;
@@ -265,12 +605,24 @@ void physics_start_race(physics_world_t *world) {
 
     for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
         world->race_time[i] = 0;
+        world->race_time_ns[i] = 0;
         world->race_finished[i] = false;
-        world->current_checkpoint[i] = 0;
+        memset(&world->progress[i], 0, sizeof(physics_car_progress_t));
+
+        // Seed the incremental centreline search with a full scan
+        if (centreline_count > 0) {
+            world->progress[i].segment = centreline_nearest(world->cars[i].position);
+        }
+    }
+
+    if (world->total_laps == 0) {
+        world->total_laps = PHYSICS_DEFAULT_LAPS;
     }
 
-    for (int i = 0; i < world->checkpoint_count; i++) {
-        world->checkpoints[i].passed = false;
+    physics_build_checkpoint_gates(world);
+
+    if (centreline_count > 0) {
+        world->track_length = centreline_arc[centreline_count];
     }
 
     ESP_LOGI(TAG, "Race started");
@@ -279,38 +631,43 @@ void physics_start_race(physics_world_t *world) {
 void physics_reset_race(physics_world_t *world) {
     if (!world) return;
 
-    physics_start_race(world);
-    
     // Reset car positions to starting positions
     for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
         vec2_t start_pos = {0, -i * 100};  // Staggered start
         physics_reset_car(&world->cars[i], start_pos, 0);
     }
+
+    // Progress is seeded from the positions above
+    physics_start_race(world);
 }
 
-bool physics_check_race_finished(physics_world_t *world, uint8_t car_index) {
-    if (!world || car_index >= PHYSICS_MAX_CARS) return false;
-    
-    if (world->race_finished[car_index]) {
-        return true;
-    }
-    
-    // Check if all checkpoints passed
-    bool all_checkpoints_passed = true;
-    for (int i = 0; i < world->checkpoint_count; i++) {
-        if (!world->checkpoints[i].passed) {
-            all_checkpoints_passed = false;
-            break;
+void physics_build_checkpoint_gates(physics_world_t *world) {
+    if (!world) return;
+
+    int count = world->checkpoint_count;
+    for (int i = 0; i < count; i++) {
+        checkpoint_t *checkpoint = &world->checkpoints[i];
+        vec2_t prev = world->checkpoints[(i + count - 1) % count].position;
+        vec2_t next = world->checkpoints[(i + 1) % count].position;
+
+        // Gates sit across the track tangent, estimated from the neighbours
+        vec2_t tangent = vec2_sub(next, prev);
+        if (tangent.x == 0 && tangent.y == 0) {
+            tangent = vec2_sub(next, checkpoint->position);
         }
+        checkpoint->forward = vec2_normalize(tangent);
+
+        vec2_t half_width = vec2_scale((vec2_t){-checkpoint->forward.y, checkpoint->forward.x},
+                                       checkpoint->radius);
+        checkpoint->gate_a = vec2_sub(checkpoint->position, half_width);
+        checkpoint->gate_b = vec2_add(checkpoint->position, half_width);
     }
-    
-    if (all_checkpoints_passed) {
-        world->race_finished[car_index] = true;
-        ESP_LOGI(TAG, "Car %d finished race in %d ms", car_index, world->race_time[car_index]);
-        return true;
-    }
-    
-    return false;
+}
+
+bool physics_check_race_finished(physics_world_t *world, uint8_t car_index) {
+    if (!world || car_index >= PHYSICS_MAX_CARS) return false;
+
+    return world->race_finished[car_index];
 }
 
 // Internal helper function implementations
@@ -321,9 +678,9 @@ static void integrate_motion(car_physics_t *car, float delta_time) {
     vec2_t velocity_change = vec2_scale(car->acceleration, dt);
     car->velocity = vec2_add(car->velocity, velocity_change);
     
-    // Integrate velocity to position
+    // Integrate velocity to position, stopping at walls along the way
     vec2_t position_change = vec2_scale(car->velocity, dt);
-    car->position = vec2_add(car->position, position_change);
+    sweep_motion(car, position_change);
     
     // Integrate angular velocity to heading
     car->heading += fixed_mul(car->angular_vel, dt);
@@ -335,26 +692,345 @@ static void integrate_motion(car_physics_t *car, float delta_time) {
     car->acceleration = (vec2_t){0, 0};
 }
 
-static void apply_friction(car_physics_t *car, float delta_time) {
+// Move a car along motion, resolving wall contacts at their time of impact
+// so fast cars cannot step over thin walls between two end positions.
+static void sweep_motion(car_physics_t *car, vec2_t motion) {
+    for (int i = 0; i < PHYSICS_CCD_MAX_ITERATIONS; i++) {
+        vec2_t target = vec2_add(car->position, motion);
+        physics_sweep_hit_t hit;
+
+        if (!physics_sweep_circle(car->position, target, PHYSICS_CAR_RADIUS, &hit)) {
+            car->position = target;
+            return;
+        }
+
+        // Stop just short of the wall, then spend the rest of the step
+        // moving along the reflected velocity
+        car->position = vec2_add(hit.point, vec2_scale(hit.normal, PHYSICS_CCD_SKIN));
+        reflect_velocity(car, hit.normal);
+
+        fixed16_t remaining = FIXED16_ONE - hit.toi;
+        fixed16_t length = vec2_length(motion);
+        fixed16_t speed = vec2_length(car->velocity);
+        if (remaining <= 0 || length == 0 || speed == 0) {
+            return;
+        }
+
+        motion = vec2_scale(car->velocity, fixed_div(fixed_mul(length, remaining), speed));
+    }
+}
+
+static void reflect_velocity(car_physics_t *car, vec2_t normal) {
+    fixed16_t normal_vel = vec2_dot(car->velocity, normal);
+    if (normal_vel < 0) {
+        vec2_t reflected = vec2_sub(car->velocity, 
+                                  vec2_scale(normal, fixed_mul(FIXED16_ONE * 2, normal_vel)));
+        car->velocity = vec2_scale(reflected, PHYSICS_COLLISION_ELASTICITY);
+    }
+}
+
+// Overlap of a circle with a rectangle. The normal points from the
+// rectangle towards the centre; a centre inside the rectangle is pushed
+// out through the nearest open face.
+static bool rect_penetration(vec2_t centre, fixed16_t radius, const physics_rect_t *rect,
+                             uint8_t open_faces, vec2_t *normal, fixed16_t *depth) {
+    int64_t px = centre.x, py = centre.y;
+    int64_t cx = px < rect->min_x ? rect->min_x : (px > rect->max_x ? rect->max_x : px);
+    int64_t cy = py < rect->min_y ? rect->min_y : (py > rect->max_y ? rect->max_y : py);
+    int64_t dx = px - cx, dy = py - cy;
+    if ((open_faces & RECT_FACES_ALL) == 0) open_faces = RECT_FACES_ALL;
+
+    // Outside a closed face the centre is over the neighbour, which owns
+    // that contact; dropping the component turns the false corners of a
+    // tiled wall into the flat face they belong to
+    if ((dx < 0 && !(open_faces & RECT_FACE_MIN_X)) || (dx > 0 && !(open_faces & RECT_FACE_MAX_X))) dx = 0;
+    if ((dy < 0 && !(open_faces & RECT_FACE_MIN_Y)) || (dy > 0 && !(open_faces & RECT_FACE_MAX_Y))) dy = 0;
+    if (dx == 0 && dy == 0 && (px != cx || py != cy)) return false;
+
+    if (dx >= radius || dx <= -radius || dy >= radius || dy <= -radius) return false;
+    int64_t distance_squared = dx * dx + dy * dy;
+    if (distance_squared >= (int64_t)radius * radius) return false;
+
+    if (distance_squared > 0) {
+        *normal = vec2_normalize((vec2_t){ (fixed16_t)dx, (fixed16_t)dy });
+        *depth = radius - (fixed16_t)isqrt64((uint64_t)distance_squared);
+        return true;
+    }
+
+    const int64_t face_distance[4] = {
+        px - rect->min_x, rect->max_x - px, py - rect->min_y, rect->max_y - py
+    };
+    const vec2_t face_normal[4] = {
+        { -FIXED16_ONE, 0 }, { FIXED16_ONE, 0 }, { 0, -FIXED16_ONE }, { 0, FIXED16_ONE }
+    };
+
+    int nearest = -1;
+    for (int face = 0; face < 4; face++) {
+        if ((open_faces & (1 << face)) &&
+            (nearest < 0 || face_distance[face] < face_distance[nearest])) {
+            nearest = face;
+        }
+    }
+    *normal = face_normal[nearest];
+    *depth = (fixed16_t)(face_distance[nearest] + radius);
+    return true;
+}
+
+// Ray against an axis-aligned box (slab test), for sweeps starting outside it.
+// Returns the entry time in 16.16 fractions of delta and the entry axis.
+static bool sweep_box(const int64_t p[2], const int64_t d[2], const int64_t lo[2], const int64_t hi[2],
+                      int64_t *toi, int *axis_out) {
+    int64_t t_enter = INT64_MIN, t_exit = INT64_MAX;
+    int enter_axis = 0;
+
+    for (int axis = 0; axis < 2; axis++) {
+        if (d[axis] == 0) {
+            if (p[axis] <= lo[axis] || p[axis] >= hi[axis]) return false;
+            continue;
+        }
+
+        int64_t t0 = ((lo[axis] - p[axis]) << 16) / d[axis];
+        int64_t t1 = ((hi[axis] - p[axis]) << 16) / d[axis];
+        if (t0 > t1) {
+            int64_t swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+
+        if (t0 > t_enter) {
+            t_enter = t0;
+            enter_axis = axis;
+        }
+        if (t1 < t_exit) t_exit = t1;
+    }
+
+    if (t_enter < 0 || t_enter > FIXED16_ONE || t_enter >= t_exit) return false;
+    *toi = t_enter;
+    *axis_out = enter_axis;
+    return true;
+}
+
+// Face normal opposing the motion along axis
+static vec2_t axis_normal(int axis, vec2_t delta) {
+    if (axis == 0) return (vec2_t){ delta.x > 0 ? -FIXED16_ONE : FIXED16_ONE, 0 };
+    return (vec2_t){ 0, delta.y > 0 ? -FIXED16_ONE : FIXED16_ONE };
+}
+
+// Ray against a circle of the given radius around corner, for sweeps
+// starting outside it. Works along the unit direction so every product
+// stays within 64 bits.
+static bool sweep_corner(vec2_t start, vec2_t delta, int64_t length, int64_t corner_x, int64_t corner_y,
+                         fixed16_t radius, int64_t *toi) {
+    int64_t mx = start.x - corner_x, my = start.y - corner_y;
+    int64_t along = (mx * delta.x + my * delta.y) / length;  // Start offset along the motion, 16.16
+    if (along >= 0) return false;  // Moving away from the corner
+
+    int64_t h = along * along - (mx * mx + my * my - (int64_t)radius * radius);
+    if (h < 0) return false;
+
+    int64_t distance = -along - (int64_t)isqrt64((uint64_t)h);
+    if (distance < 0) distance = 0;
+    if (distance > length) return false;
+
+    *toi = (distance << 16) / length;
+    return true;
+}
+
+// Swept circle against a rectangle: the exact rounded rectangle (the box
+// grown along each axis plus a circle at each corner). A circle that
+// already overlaps the rectangle and moves further in is a contact at
+// TOI 0, so sweeps that start inside a wall can't step through it.
+static bool sweep_rect(vec2_t start, vec2_t delta, fixed16_t radius, const physics_rect_t *rect,
+                       uint8_t open_faces, physics_sweep_hit_t *hit) {
+    // Reject rectangles outside the swept bounds; this also keeps the
+    // corner offsets small enough for the 64-bit products below
+    int64_t min_x = (int64_t)start.x + (delta.x < 0 ? delta.x : 0) - radius;
+    int64_t max_x = (int64_t)start.x + (delta.x > 0 ? delta.x : 0) + radius;
+    int64_t min_y = (int64_t)start.y + (delta.y < 0 ? delta.y : 0) - radius;
+    int64_t max_y = (int64_t)start.y + (delta.y > 0 ? delta.y : 0) + radius;
+    if (max_x <= rect->min_x || min_x >= rect->max_x || max_y <= rect->min_y || min_y >= rect->max_y) {
+        return false;
+    }
+
+    vec2_t normal;
+    fixed16_t depth;
+    if (rect_penetration(start, radius, rect, open_faces, &normal, &depth)) {
+        if ((int64_t)delta.x * normal.x + (int64_t)delta.y * normal.y >= 0) return false;
+
+        hit->toi = 0;
+        hit->point = start;
+        hit->normal = normal;
+        return true;
+    }
+
+    int64_t p[2] = { start.x, start.y };
+    int64_t d[2] = { delta.x, delta.y };
+    int64_t best = INT64_MAX;
+    int64_t toi;
+    int axis;
+
+    // Box grown along x, then along y: hits on the flat faces
+    int64_t lo_x[2] = { (int64_t)rect->min_x - radius, rect->min_y };
+    int64_t hi_x[2] = { (int64_t)rect->max_x + radius, rect->max_y };
+    int64_t lo_y[2] = { rect->min_x, (int64_t)rect->min_y - radius };
+    int64_t hi_y[2] = { rect->max_x, (int64_t)rect->max_y + radius };
+    if (sweep_box(p, d, lo_x, hi_x, &toi, &axis) && toi < best) {
+        best = toi;
+        hit->normal = axis_normal(axis, delta);
+    }
+    if (sweep_box(p, d, lo_y, hi_y, &toi, &axis) && toi < best) {
+        best = toi;
+        hit->normal = axis_normal(axis, delta);
+    }
+
+    // Corner circles, for convex corners the sweep can reach; normals point
+    // from the corner to the centre at impact
+    int64_t length = isqrt64((uint64_t)((int64_t)delta.x * delta.x + (int64_t)delta.y * delta.y));
+    const int64_t corners[4][2] = {
+        { rect->min_x, rect->min_y }, { rect->max_x, rect->min_y },
+        { rect->min_x, rect->max_y }, { rect->max_x, rect->max_y }
+    };
+    const uint8_t corner_faces[4] = {
+        RECT_FACE_MIN_X | RECT_FACE_MIN_Y, RECT_FACE_MAX_X | RECT_FACE_MIN_Y,
+        RECT_FACE_MIN_X | RECT_FACE_MAX_Y, RECT_FACE_MAX_X | RECT_FACE_MAX_Y
+    };
+    if ((open_faces & RECT_FACES_ALL) == 0) open_faces = RECT_FACES_ALL;
+    for (int i = 0; i < 4 && length > 0; i++) {
+        int64_t corner_x = corners[i][0], corner_y = corners[i][1];
+        if ((open_faces & corner_faces[i]) != corner_faces[i]) continue;
+        if (corner_x < min_x || corner_x > max_x || corner_y < min_y || corner_y > max_y) continue;
+
+        if (sweep_corner(start, delta, length, corner_x, corner_y, radius, &toi) && toi < best) {
+            vec2_t point = vec2_add(start, vec2_scale(delta, (fixed16_t)toi));
+            best = toi;
+            hit->normal = vec2_normalize((vec2_t){ (fixed16_t)(point.x - corner_x),
+                                                   (fixed16_t)(point.y - corner_y) });
+        }
+    }
+
+    if (best > FIXED16_ONE) return false;
+
+    hit->toi = (fixed16_t)best;
+    hit->point = vec2_add(start, vec2_scale(delta, hit->toi));
+    return true;
+}
+
+// Push a car out of any rectangle or solid tile it overlaps, deepest
+// overlap first. Sweeps only guard motion; this catches cars moved
+// without one.
+static void depenetrate(car_physics_t *car) {
+    fixed16_t radius = PHYSICS_CAR_RADIUS;
+
+    for (int iteration = 0; iteration < PHYSICS_CCD_MAX_ITERATIONS; iteration++) {
+        vec2_t normal, deepest_normal = {0, 0};
+        fixed16_t depth, deepest = 0;
+
+        for (int i = 0; i < collision_rect_count; i++) {
+            if (rect_penetration(car->position, radius, &collision_rects[i], RECT_FACES_ALL, &normal, &depth) &&
+                depth > deepest) {
+                deepest = depth;
+                deepest_normal = normal;
+            }
+        }
+
+        fixed16_t tile_size = physics_tilemap.tile_size;
+        if (physics_tilemap.tiles && tile_size > 0) {
+            int32_t x0 = tile_cell((int64_t)car->position.x - radius, -1, physics_tilemap.width);
+            int32_t y0 = tile_cell((int64_t)car->position.y - radius, -1, physics_tilemap.height);
+            int32_t x1 = tile_cell((int64_t)car->position.x + radius, -1, physics_tilemap.width);
+            int32_t y1 = tile_cell((int64_t)car->position.y + radius, -1, physics_tilemap.height);
+
+            for (int32_t y = y0; y <= y1; y++) {
+                for (int32_t x = x0; x <= x1; x++) {
+                    uint8_t tile;
+                    if (!tile_is_blocking(x, y, &tile)) continue;
+
+                    physics_rect_t rect = tile_rect(x, y);
+                    if (rect_penetration(car->position, radius, &rect, tile_open_faces(x, y), &normal, &depth) &&
+                        depth > deepest) {
+                        deepest = depth;
+                        deepest_normal = normal;
+                    }
+                }
+            }
+        }
+
+        if (deepest == 0) return;
+
+        car->position = vec2_add(car->position, vec2_scale(deepest_normal, deepest + PHYSICS_CCD_SKIN));
+        reflect_velocity(car, deepest_normal);
+    }
+}
+
+static void apply_friction(car_physics_t *car, const physics_surface_t *surface, float delta_time) {
     fixed16_t dt = FLOAT_TO_FIXED16(delta_time);
     
     // Apply drag force: F = -v * drag_coefficient
     vec2_t drag_force = vec2_scale(car->velocity, -car->drag);
     physics_apply_force(car, drag_force);
     
-    // Apply friction force: F = -v * friction_coefficient * mass
-    vec2_t friction_force = vec2_scale(car->velocity, -fixed_mul(car->friction, car->mass));
+    // Apply friction force: F = -v * friction_coefficient * surface_grip * mass
+    fixed16_t friction = (car->friction * (int32_t)surface->friction) >> 8;
+    vec2_t friction_force = vec2_scale(car->velocity, -fixed_mul(friction, car->mass));
     physics_apply_force(car, friction_force);
     
     // Apply angular friction
     car->angular_vel = fixed_mul(car->angular_vel, FIXED16_ONE - fixed_mul(FIXED16_ONE / 10, dt));
 }
 
+static void apply_surface(car_physics_t *car, const physics_surface_t *surface, float delta_time) {
+    fixed16_t dt = FLOAT_TO_FIXED16(delta_time);
+
+    // Clamp to the surface's top speed (solid tiles are left to collisions)
+    if (!(surface->flags & PHYSICS_SURFACE_SOLID)) {
+        fixed16_t cap = (PHYSICS_MAX_SPEED >> 8) * surface->speed_cap;
+        if (car->speed > cap && car->speed > 0) {
+            car->velocity = vec2_scale(car->velocity, fixed_div(cap, car->speed));
+            car->speed = cap;
+        }
+    }
+
+    if (surface->flags & PHYSICS_SURFACE_BOOST) {
+        vec2_t forward = (vec2_t){fixed_cos(car->heading), fixed_sin(car->heading)};
+        car->acceleration = vec2_add(car->acceleration, vec2_scale(forward, PHYSICS_BOOST_ACCELERATION));
+    }
+
+    if (surface->flags & PHYSICS_SURFACE_SPIN) {
+        fixed16_t kick = fixed_mul(PHYSICS_SPIN_ACCELERATION, dt);
+        car->angular_vel += car->angular_vel < 0 ? -kick : kick;
+    }
+}
+
+// Surface under a position: one tile byte load plus a cached table entry
+static const physics_surface_t *surface_at(vec2_t position) {
+    if (!physics_tilemap.tiles || position.x < 0 || position.y < 0) {
+        return &default_surface;
+    }
+
+    uint32_t x, y;
+    if (tile_shift) {
+        x = (uint32_t)position.x >> tile_shift;
+        y = (uint32_t)position.y >> tile_shift;
+    } else {
+        x = position.x / physics_tilemap.tile_size;
+        y = position.y / physics_tilemap.tile_size;
+    }
+
+    if (x >= physics_tilemap.width || y >= physics_tilemap.height) {
+        return &default_surface;
+    }
+
+    uint8_t tile = physics_tilemap.tiles[y * physics_tilemap.width + x];
+    return tile < PHYSICS_MAX_SURFACES ? &surface_lut[tile] : &default_surface;
+}
+
 static void resolve_collisions(physics_world_t *world) {
     if (!world) return;
 
-    // Resolve car-track collisions
-    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+    // Resolve car-track collisions against the legacy circular track, only
+    // used when the track provides no tiles or rectangles of its own
+    bool has_walls = collision_rect_count > 0 || (physics_tilemap.tiles && physics_tilemap.tile_size > 0);
+    for (int i = 0; i < PHYSICS_MAX_CARS && !has_walls; i++) {
         car_physics_t *car = &world->cars[i];
         
         vec2_t normal;
@@ -366,61 +1042,362 @@ static void resolve_collisions(physics_world_t *world) {
             car->position = vec2_add(car->position, correction);
             
             // Reflect velocity with elasticity
-            fixed16_t normal_vel = vec2_dot(car->velocity, normal);
-            if (normal_vel < 0) {
-                vec2_t reflected = vec2_sub(car->velocity, 
-                                          vec2_scale(normal, fixed_mul(FIXED16_ONE * 2, normal_vel)));
-                car->velocity = vec2_scale(reflected, PHYSICS_COLLISION_ELASTICITY);
-            }
+            reflect_velocity(car, normal);
         }
     }
 
-    // Resolve car-car collisions
+    // Resolve car-car collisions as the broadphase reports them, so the
+    // stack cost stays constant however many cars there are
+    physics_sweep_car_pairs(&world->broadphase, world->cars, PHYSICS_MAX_CARS,
+                            resolve_car_pair, world);
+
+    // Separation above moves cars without a sweep; push them back out of walls
     for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
-        for (int j = i + 1; j < PHYSICS_MAX_CARS; j++) {
-            if (physics_check_car_collision(&world->cars[i], &world->cars[j])) {
-                // Simple collision response - swap velocities
-                vec2_t temp = world->cars[i].velocity;
-                world->cars[i].velocity = world->cars[j].velocity;
-                world->cars[j].velocity = temp;
-                
-                // Separate cars
-                vec2_t delta = vec2_sub(world->cars[i].position, world->cars[j].position);
-                vec2_t direction = vec2_scale(delta, fixed_div(FIXED16_ONE, vec2_length(delta)));
-                
-                world->cars[i].position = vec2_add(world->cars[i].position, 
-                                                  vec2_scale(direction, INT_TO_FIXED16(50)));
-                world->cars[j].position = vec2_sub(world->cars[j].position, 
-                                                  vec2_scale(direction, INT_TO_FIXED16(50)));
-            }
-        }
+        depenetrate(&world->cars[i]);
+    }
+}
+
+static bool resolve_car_pair(uint8_t i, uint8_t j, void *context) {
+    physics_world_t *world = (physics_world_t *)context;
+
+    if (physics_check_car_collision(&world->cars[i], &world->cars[j])) {
+        // Simple collision response - swap velocities
+        vec2_t temp = world->cars[i].velocity;
+        world->cars[i].velocity = world->cars[j].velocity;
+        world->cars[j].velocity = temp;
+
+        // Separate cars, swept so the push can't carry a car through a wall
+        vec2_t delta = vec2_sub(world->cars[i].position, world->cars[j].position);
+        vec2_t push = vec2_scale(vec2_normalize(delta), INT_TO_FIXED16(50));
+
+        sweep_motion(&world->cars[i], push);
+        sweep_motion(&world->cars[j], vec2_sub((vec2_t){0, 0}, push));
     }
+
+    return true;
+}
+
+static bool collect_car_pair(uint8_t a, uint8_t b, void *context) {
+    car_pair_list_t *list = (car_pair_list_t *)context;
+    if (list->count >= list->capacity) return false;
+
+    list->pairs[list->count].a = a;
+    list->pairs[list->count].b = b;
+    list->count++;
+    return list->count < list->capacity;
 }
 
-static void update_checkpoint_progress(physics_world_t *world, uint8_t car_index) {
-    if (!world || car_index >= PHYSICS_MAX_CARS) return;
+static void update_checkpoint_progress(physics_world_t *world, uint8_t car_index, vec2_t previous,
+                                       uint32_t step_ns) {
+    if (!world || car_index >= PHYSICS_MAX_CARS || world->checkpoint_count == 0) return;
 
     car_physics_t *car = &world->cars[car_index];
-    uint8_t current = world->current_checkpoint[car_index];
-    
-    if (current >= world->checkpoint_count) {
+    physics_car_progress_t *progress = &world->progress[car_index];
+    uint8_t count = world->checkpoint_count;
+    uint8_t next = progress->next_checkpoint;
+    uint8_t last = (next + count - 1) % count;
+
+    // Only the next gate counts forwards, and only the last one passed can
+    // be undone, so skipping gates or reversing over a line gains nothing
+    if (physics_check_gate_crossing(&world->checkpoints[next], previous, car->position) > 0) {
+        if (progress->rewind_depth > 0) {
+            progress->rewind_depth--;
+            progress->next_checkpoint = (next + 1) % count;
+            if (next == 0) progress->lap++;
+        } else {
+            // Interpolate the crossing time inside the step from the sides
+            int64_t side_from = gate_side(&world->checkpoints[next], previous);
+            int64_t side_to = gate_side(&world->checkpoints[next], car->position);
+            float fraction = (float)side_from / (float)(side_from - side_to);
+            uint32_t offset_ns = world->race_time_ns[car_index] + (uint32_t)(fraction * step_ns);
+            complete_gate(world, car_index, next, world->race_time[car_index] + offset_ns / 1000000);
+        }
+    } else if (progress->lap > 0 &&
+               physics_check_gate_crossing(&world->checkpoints[last], previous, car->position) < 0) {
+        progress->rewind_depth++;
+        progress->next_checkpoint = last;
+        if (last == 0) progress->lap--;
+    }
+
+    // Wrong way: moving against the track direction, or behind a reversed gate
+    vec2_t forward = centreline_count > 0 ? centreline_dirs[progress->segment]
+                                          : world->checkpoints[progress->next_checkpoint].forward;
+    fixed16_t along_track = vec2_dot(car->velocity, forward);
+    progress->wrong_way = progress->rewind_depth > 0 ||
+                          (car->speed > PHYSICS_WRONG_WAY_MIN_SPEED && along_track < -(car->speed >> 1));
+}
+
+static int64_t gate_side(const checkpoint_t *checkpoint, vec2_t point) {
+    vec2_t gate = vec2_sub(checkpoint->gate_b, checkpoint->gate_a);
+    vec2_t rel = vec2_sub(point, checkpoint->gate_a);
+    return (int64_t)gate.x * rel.y - (int64_t)gate.y * rel.x;
+}
+
+static void complete_gate(physics_world_t *world, uint8_t car_index, uint8_t gate, uint32_t time) {
+    physics_car_progress_t *progress = &world->progress[car_index];
+    uint8_t count = world->checkpoint_count;
+
+    progress->next_checkpoint = (gate + 1) % count;
+
+    if (gate != 0) {
+        progress->sector_times[gate - 1] = time - progress->sector_start_time;
+        progress->sector_start_time = time;
+        ESP_LOGD(TAG, "Car %d passed checkpoint %d", car_index, gate);
         return;
     }
-    
-    checkpoint_t *checkpoint = &world->checkpoints[current];
-    
-    if (physics_check_checkpoint_collision(car, checkpoint)) {
-        checkpoint->passed = true;
-        world->current_checkpoint[car_index]++;
-        
-        ESP_LOGI(TAG, "Car %d passed checkpoint %d", car_index, current);
-        
-        // Reset checkpoint for next lap
-        if (world->current_checkpoint[car_index] >= world->checkpoint_count) {
-            world->current_checkpoint[car_index] = 0;
-            for (int i = 0; i < world->checkpoint_count; i++) {
-                world->checkpoints[i].passed = false;
+
+    // Start/finish line: close the lap that is running, if any
+    if (progress->lap > 0) {
+        uint32_t lap_time = time - progress->lap_start_time;
+        progress->sector_times[count - 1] = time - progress->sector_start_time;
+        progress->last_lap_time = lap_time;
+        if (progress->best_lap_time == 0 || lap_time < progress->best_lap_time) {
+            progress->best_lap_time = lap_time;
+        }
+        ESP_LOGI(TAG, "Car %d completed lap %d in %lu ms", car_index, progress->lap, (unsigned long)lap_time);
+    }
+
+    progress->lap_start_time = time;
+    progress->sector_start_time = time;
+
+    if (progress->lap >= world->total_laps) {
+        world->race_finished[car_index] = true;
+        ESP_LOGI(TAG, "Car %d finished race in %lu ms", car_index, (unsigned long)time);
+        return;
+    }
+    progress->lap++;
+}
+
+// Distance along the segment to the point's projection, clamped to the
+// segment, plus the squared distance to it
+static fixed16_t centreline_project(vec2_t point, int segment, int64_t *distance_squared) {
+    vec2_t rel = vec2_sub(point, centreline_points[segment]);
+    fixed16_t length = (fixed16_t)(centreline_arc[segment + 1] - centreline_arc[segment]);
+    fixed16_t along = vec2_dot(rel, centreline_dirs[segment]);
+    if (along < 0) along = 0;
+    if (along > length) along = length;
+
+    vec2_t offset = vec2_sub(rel, vec2_scale(centreline_dirs[segment], along));
+    *distance_squared = (int64_t)offset.x * offset.x + (int64_t)offset.y * offset.y;
+    return along;
+}
+
+static int centreline_nearest(vec2_t point) {
+    int best = 0;
+    int64_t best_distance = INT64_MAX;
+    for (int i = 0; i < centreline_count; i++) {
+        int64_t distance;
+        centreline_project(point, i, &distance);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void update_track_position(physics_world_t *world, uint8_t car_index) {
+    if (centreline_count == 0) return;
+
+    physics_car_progress_t *progress = &world->progress[car_index];
+    vec2_t position = world->cars[car_index].position;
+    int segment = progress->segment < centreline_count ? progress->segment : 0;
+
+    // Walk from last frame's segment towards the closer neighbour; cars
+    // move a fraction of a segment per step so this rarely takes a move
+    int64_t best;
+    fixed16_t along = centreline_project(position, segment, &best);
+    for (int step = 0; step < PHYSICS_CENTRELINE_MAX_STEPS; step++) {
+        int ahead = (segment + 1) % centreline_count;
+        int behind = (segment + centreline_count - 1) % centreline_count;
+        int64_t ahead_distance, behind_distance;
+        fixed16_t ahead_along = centreline_project(position, ahead, &ahead_distance);
+        fixed16_t behind_along = centreline_project(position, behind, &behind_distance);
+
+        if (ahead_distance < best && ahead_distance <= behind_distance) {
+            segment = ahead;
+            best = ahead_distance;
+            along = ahead_along;
+        } else if (behind_distance < best) {
+            segment = behind;
+            best = behind_distance;
+            along = behind_along;
+        } else {
+            break;
+        }
+    }
+
+    progress->segment = segment;
+    progress->lap_distance = centreline_arc[segment] + along;
+}
+
+static void update_race_positions(physics_world_t *world) {
+    int64_t leader = INT64_MIN;
+
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        physics_car_progress_t *progress = &world->progress[i];
+        int64_t length, lap_distance;
+
+        if (centreline_count > 0) {
+            length = centreline_arc[centreline_count];
+            lap_distance = progress->lap_distance;
+
+            // Gate and centreline can disagree for a step around the start line
+            if (progress->next_checkpoint == 1 && lap_distance > length / 2) {
+                lap_distance -= length;
+            } else if (progress->next_checkpoint == 0 && lap_distance < length / 2) {
+                lap_distance += length;
+            }
+        } else if (world->checkpoint_count > 0) {
+            // Without a centreline, rank on gates passed
+            length = INT_TO_FIXED16(world->checkpoint_count);
+            lap_distance = INT_TO_FIXED16((progress->next_checkpoint + world->checkpoint_count - 1) %
+                                          world->checkpoint_count);
+        } else {
+            length = 0;
+            lap_distance = 0;
+        }
+
+        progress->race_distance = (progress->lap - 1) * length + lap_distance;
+        if (progress->race_distance > leader) {
+            leader = progress->race_distance;
+        }
+    }
+
+    // Finished cars lead in finishing order, the rest by distance raced
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        physics_car_progress_t *progress = &world->progress[i];
+        uint8_t position = 1;
+
+        for (int j = 0; j < PHYSICS_MAX_CARS; j++) {
+            if (j == i) continue;
+
+            bool ahead;
+            if (world->race_finished[j] != world->race_finished[i]) {
+                ahead = world->race_finished[j];
+            } else if (world->race_finished[i]) {
+                ahead = world->race_time[j] < world->race_time[i] ||
+                        (world->race_time[j] == world->race_time[i] && j < i);
+            } else {
+                ahead = world->progress[j].race_distance > progress->race_distance ||
+                        (world->progress[j].race_distance == progress->race_distance && j < i);
             }
+            if (ahead) position++;
+        }
+
+        int64_t gap = world->race_finished[i] ? 0 : leader - progress->race_distance;
+        progress->position = position;
+        progress->gap_to_leader = gap > INT32_MAX ? INT32_MAX : (fixed16_t)gap;
+    }
+}
+
+static bool tile_is_blocking(int32_t x, int32_t y, uint8_t *tile) {
+    if (x < 0 || y < 0 || x >= physics_tilemap.width || y >= physics_tilemap.height) {
+        *tile = PHYSICS_TILE_NONE;
+        return true;
+    }
+
+    *tile = physics_tilemap.tiles[y * physics_tilemap.width + x];
+    return *tile < PHYSICS_MAX_SURFACES && (solid_mask & (1u << *tile));
+}
+
+// Floor of coord / tile_size, clamped to [lo, hi]
+static int32_t tile_cell(int64_t coord, int32_t lo, int32_t hi) {
+    int64_t tile_size = physics_tilemap.tile_size;
+    int64_t cell = coord / tile_size;
+    if (coord < 0 && cell * tile_size != coord) cell--;
+    if (cell < lo) return lo;
+    if (cell > hi) return hi;
+    return (int32_t)cell;
+}
+
+static physics_rect_t tile_rect(int32_t x, int32_t y) {
+    fixed16_t tile_size = physics_tilemap.tile_size;
+    return (physics_rect_t){
+        .min_x = x * tile_size, .min_y = y * tile_size,
+        .max_x = (x + 1) * tile_size, .max_y = (y + 1) * tile_size
+    };
+}
+
+// Faces of a blocking tile that border a free tile
+static uint8_t tile_open_faces(int32_t x, int32_t y) {
+    uint8_t tile;
+    uint8_t faces = 0;
+    if (!tile_is_blocking(x - 1, y, &tile)) faces |= RECT_FACE_MIN_X;
+    if (!tile_is_blocking(x + 1, y, &tile)) faces |= RECT_FACE_MAX_X;
+    if (!tile_is_blocking(x, y - 1, &tile)) faces |= RECT_FACE_MIN_Y;
+    if (!tile_is_blocking(x, y + 1, &tile)) faces |= RECT_FACE_MAX_Y;
+    return faces;
+}
+
+static void tile_ray_setup(vec2_t origin, tile_ray_origin_t *ray_origin) {
+    fixed16_t tile_size = physics_tilemap.tile_size;
+
+    // Floor division so negative coordinates land in the correct cell
+    int32_t cell_x = origin.x / tile_size;
+    int32_t cell_y = origin.y / tile_size;
+    if (origin.x < 0 && cell_x * tile_size != origin.x) cell_x--;
+    if (origin.y < 0 && cell_y * tile_size != origin.y) cell_y--;
+
+    ray_origin->cell_x = cell_x;
+    ray_origin->cell_y = cell_y;
+    ray_origin->frac_x = origin.x - cell_x * tile_size;
+    ray_origin->frac_y = origin.y - cell_y * tile_size;
+}
+
+// Amanatides-Woo grid traversal: after the per-ray setup every tile step
+// is one compare and one add, with no multiplies or divides.
+static bool tile_ray_march(vec2_t origin, const tile_ray_origin_t *ray_origin, vec2_t direction,
+                           fixed16_t max_distance, physics_ray_hit_t *hit) {
+    fixed16_t tile_size = physics_tilemap.tile_size;
+    int32_t x = ray_origin->cell_x;
+    int32_t y = ray_origin->cell_y;
+    int32_t step_x = direction.x < 0 ? -1 : 1;
+    int32_t step_y = direction.y < 0 ? -1 : 1;
+    int64_t abs_dx = direction.x < 0 ? -(int64_t)direction.x : direction.x;
+    int64_t abs_dy = direction.y < 0 ? -(int64_t)direction.y : direction.y;
+
+    // Distance to the first vertical/horizontal tile edge and between edges
+    int64_t t_max_x = INT64_MAX, t_delta_x = INT64_MAX;
+    int64_t t_max_y = INT64_MAX, t_delta_y = INT64_MAX;
+    if (abs_dx != 0) {
+        fixed16_t edge_x = direction.x > 0 ? tile_size - ray_origin->frac_x : ray_origin->frac_x;
+        t_max_x = ((int64_t)edge_x << 16) / abs_dx;
+        t_delta_x = ((int64_t)tile_size << 16) / abs_dx;
+    }
+    if (abs_dy != 0) {
+        fixed16_t edge_y = direction.y > 0 ? tile_size - ray_origin->frac_y : ray_origin->frac_y;
+        t_max_y = ((int64_t)edge_y << 16) / abs_dy;
+        t_delta_y = ((int64_t)tile_size << 16) / abs_dy;
+    }
+
+    int64_t t = 0;
+    uint8_t tile;
+    bool blocked = tile_is_blocking(x, y, &tile);
+
+    while (!blocked && (abs_dx != 0 || abs_dy != 0)) {
+        if (t_max_x < t_max_y) {
+            t = t_max_x;
+            x += step_x;
+            t_max_x += t_delta_x;
+        } else {
+            t = t_max_y;
+            y += step_y;
+            t_max_y += t_delta_y;
         }
+
+        if (t > max_distance) break;
+        blocked = tile_is_blocking(x, y, &tile);
+    }
+
+    if (!blocked) {
+        t = max_distance;
+        tile = PHYSICS_TILE_NONE;
     }
-}
\ No newline at end of file
+
+    hit->distance = (fixed16_t)t;
+    hit->point = vec2_add(origin, vec2_scale(direction, hit->distance));
+    hit->tile = tile;
+    hit->hit = blocked;
+    return blocked;
+}
@@ -6,7 +6,10 @@
 #include "esp_err.h"
 
 // Physics constants
-#define PHYSICS_MAX_CARS 2
+#ifndef PHYSICS_MAX_CARS
+#define PHYSICS_MAX_CARS 2  // At most 256: the broadphase stores uint8_t indices
+#endif
+#define PHYSICS_RATE_HZ 60  // Fixed steps a second; frame numbers on the wire count these
 #define PHYSICS_GRAVITY FLOAT_TO_FIXED16(9.8f)  // 9.8 m/s^2 in fixed-point
 #define PHYSICS_FRICTION_COEFFICIENT FLOAT_TO_FIXED16(0.85f)  // 0.85 in fixed-point
 #define PHYSICS_DRAG_COEFFICIENT FLOAT_TO_FIXED16(0.15f)  // 0.15 in fixed-point
@@ -20,6 +23,33 @@
 #define PHYSICS_TRACK_WIDTH FLOAT_TO_FIXED16(8.0f)  // 8.0m track width
 #define PHYSICS_WALL_DISTANCE FLOAT_TO_FIXED16(4.0f)  // 4.0m from center to wall
 #define PHYSICS_CHECKPOINT_RADIUS FLOAT_TO_FIXED16(1.0f)  // 1.0m checkpoint radius
+#define PHYSICS_MAX_CHECKPOINTS 16
+#define PHYSICS_DEFAULT_LAPS 3
+#define PHYSICS_WRONG_WAY_MIN_SPEED FLOAT_TO_FIXED16(1.0f)  // Slower cars are never flagged
+
+// Centreline constants
+#define PHYSICS_MAX_CENTRELINE_POINTS 256
+#define PHYSICS_CENTRELINE_MAX_STEPS 8  // Segments the nearest search may move per car per step
+#define PHYSICS_CAR_COLLISION_DISTANCE INT_TO_FIXED16(100)  // Centre distance at which cars touch
+#define PHYSICS_MAX_CAR_PAIRS (PHYSICS_MAX_CARS * (PHYSICS_MAX_CARS - 1) / 2)
+
+// Tile ray casting constants
+#define PHYSICS_TILE_NONE 0xFF  // Reported tile id for rays leaving the map
+
+// Continuous collision constants
+#define PHYSICS_CAR_RADIUS FLOAT_TO_FIXED16(8.0f)  // Car footprint radius for wall sweeps
+#define PHYSICS_CCD_MAX_ITERATIONS 3  // Wall contacts resolved per car per step
+#define PHYSICS_CCD_SKIN (FIXED16_ONE / 64)  // Gap left between car and wall after a contact
+#define PHYSICS_MAX_COLLISION_RECTS 64
+
+// Surface constants
+#define PHYSICS_MAX_SURFACES 32  // Tile ids covered by the surface table
+#define PHYSICS_SURFACE_ONE 256  // 1.0 in the 8.8 surface multipliers
+#define PHYSICS_SURFACE_SOLID (1 << 0)  // Not drivable
+#define PHYSICS_SURFACE_BOOST (1 << 1)  // Pushes the car along its heading
+#define PHYSICS_SURFACE_SPIN  (1 << 2)  // Oil: spins the car out
+#define PHYSICS_BOOST_ACCELERATION FLOAT_TO_FIXED16(6.0f)  // Boost pad push
+#define PHYSICS_SPIN_ACCELERATION FLOAT_TO_FIXED16(4.0f)  // Oil slick yaw kick (rad/s^2)
 
 // Physics structures
 typedef struct {
@@ -36,21 +66,106 @@ typedef struct {
 
 typedef struct {
     vec2_t position;      // Checkpoint position
-    fixed16_t radius;        // Checkpoint radius
-    bool passed;          // Whether checkpoint has been passed
+    fixed16_t radius;        // Gate half-width
+    vec2_t gate_a;        // Gate line endpoints, built by physics_build_checkpoint_gates
+    vec2_t gate_b;
+    vec2_t forward;       // Unit direction of travel through the gate
     uint8_t index;        // Checkpoint index
 } checkpoint_t;
 
+// Per-car race progress. Checkpoint 0 is the start/finish line; lap 0 is
+// the run-up before the car first crosses it.
+typedef struct {
+    uint8_t next_checkpoint;   // Gate the car has to cross next
+    uint8_t lap;               // Current lap, 1-based once racing
+    uint8_t rewind_depth;      // Gates crossed backwards and not yet re-crossed
+    bool wrong_way;            // Driving against the track direction
+    uint32_t lap_start_time;   // race_time at the start of this lap (ms)
+    uint32_t sector_start_time;
+    uint32_t last_lap_time;    // 0 until a lap has been completed
+    uint32_t best_lap_time;
+    uint32_t sector_times[PHYSICS_MAX_CHECKPOINTS];  // Latest split ending at each gate (ms)
+    uint16_t segment;          // Centreline segment nearest to the car
+    int64_t lap_distance;      // 16.16 arc length from the start line along the centreline
+    int64_t race_distance;     // 16.16 distance raced over all laps, negative before the start
+    fixed16_t gap_to_leader;   // Race distance behind the leading car
+    uint8_t position;          // Race position, 1 = leading
+} physics_car_progress_t;
+
+// Sweep-and-prune broadphase state, kept sorted by x between frames
+typedef struct {
+    uint8_t order[PHYSICS_MAX_CARS];  // Car indices sorted by x position
+    uint16_t count;                   // Number of valid entries in order
+} physics_broadphase_t;
+
+// Pair of car indices whose bounds overlap
+typedef struct {
+    uint8_t a;
+    uint8_t b;
+} physics_car_pair_t;
+
+// Broadphase pair visitor
+typedef bool (*physics_pair_fn)(uint8_t a, uint8_t b, void *context);
+
 typedef struct {
     car_physics_t cars[PHYSICS_MAX_CARS];
-    checkpoint_t checkpoints[16];  // Up to 16 checkpoints
+    checkpoint_t checkpoints[PHYSICS_MAX_CHECKPOINTS];
     uint8_t checkpoint_count;
-    uint8_t current_checkpoint[PHYSICS_MAX_CARS];
+    uint8_t total_laps;  // PHYSICS_DEFAULT_LAPS when left at 0
+    physics_car_progress_t progress[PHYSICS_MAX_CARS];
     uint32_t race_time[PHYSICS_MAX_CARS];
+    uint32_t race_time_ns[PHYSICS_MAX_CARS];  // Sub-millisecond remainder of race_time
     bool race_finished[PHYSICS_MAX_CARS];
-    fixed16_t track_length;
+    int64_t track_length;  // 16.16 centreline length
+    physics_broadphase_t broadphase;
 } physics_world_t;
 
+// Quantised driver input for one frame, as carried by input packets and
+// replays. Every peer applies the same values, so simulation stays in step.
+typedef struct {
+    uint8_t throttle;        // 0..100
+    uint8_t brake;           // 0..100
+    int8_t steering;         // -100 (left)..100 (right)
+    uint8_t buttons;         // BUTTON_* flags
+} physics_input_t;
+
+// Tilemap view used by tile-based queries (borrowed, not copied)
+typedef struct {
+    const uint8_t *tiles;    // Row-major tile ids, width * height bytes
+    uint16_t width;          // Map width in tiles
+    uint16_t height;         // Map height in tiles
+    fixed16_t tile_size;     // Tile edge length in world units
+} physics_tilemap_t;
+
+// Per-tile-id surface response, 8.8 fixed-point multipliers
+typedef struct {
+    uint16_t friction;       // Scales the car's friction (grip)
+    uint16_t speed_cap;      // Scales PHYSICS_MAX_SPEED on this surface
+    uint8_t flags;           // PHYSICS_SURFACE_* bits
+    uint8_t reserved;
+} physics_surface_t;
+
+// Axis-aligned blocking rectangle in world units
+typedef struct {
+    fixed16_t min_x, min_y;
+    fixed16_t max_x, max_y;
+} physics_rect_t;
+
+// Result of a swept circle test
+typedef struct {
+    fixed16_t toi;           // Time of impact as a fraction of the sweep (0..1)
+    vec2_t point;            // Circle centre at the time of impact
+    vec2_t normal;           // Surface normal at the contact
+} physics_sweep_hit_t;
+
+// Result of a tile ray cast
+typedef struct {
+    vec2_t point;            // Point where the ray enters the blocking tile
+    fixed16_t distance;      // Distance along the ray to the hit point
+    uint8_t tile;            // Blocking tile id, or PHYSICS_TILE_NONE at the map edge
+    bool hit;                // False when the ray reached max_distance unobstructed
+} physics_ray_hit_t;
+
 // Physics functions
 esp_err_t physics_init(void);
 void physics_deinit(void);
@@ -61,15 +176,38 @@ void physics_reset_car(car_physics_t *car, vec2_t position, fixed16_t heading);
 void physics_apply_force(car_physics_t *car, vec2_t force);
 void physics_apply_torque(car_physics_t *car, fixed16_t torque);
 void physics_handle_input(car_physics_t *car, float throttle, float brake, float steering, float delta_time);
+physics_input_t physics_quantise_input(float throttle, float brake, float steering, uint8_t buttons);
+void physics_apply_input(car_physics_t *car, const physics_input_t *input, float delta_time);
 
 // Collision detection
 bool physics_check_track_collision(vec2_t position, vec2_t *normal, fixed16_t *penetration);
 bool physics_check_car_collision(car_physics_t *car1, car_physics_t *car2);
-bool physics_check_checkpoint_collision(car_physics_t *car, checkpoint_t *checkpoint);
+// Visits every broadphase pair (a < b) in sweep order; return false to stop.
+// Positions are read as the sweep goes, so a visitor may move the cars.
+int physics_sweep_car_pairs(physics_broadphase_t *broadphase, const car_physics_t *cars, int count,
+                            physics_pair_fn visit, void *context);
+int physics_find_car_pairs(physics_broadphase_t *broadphase, const car_physics_t *cars, int count,
+                           physics_car_pair_t *pairs, int max_pairs);
+// 1 if the motion from..to crosses the gate forwards, -1 backwards, 0 if not
+int physics_check_gate_crossing(const checkpoint_t *checkpoint, vec2_t from, vec2_t to);
+// Earliest contact of a circle moving start..end with the collision rects and
+// solid tiles; a circle already overlapping a wall and moving in hits at TOI 0
+bool physics_sweep_circle(vec2_t start, vec2_t end, fixed16_t radius, physics_sweep_hit_t *hit);
 
 // Ray casting for AI and collision detection
 bool physics_ray_cast(vec2_t origin, vec2_t direction, fixed16_t max_distance, vec2_t *hit_point, fixed16_t *distance);
 
+// Tilemap ray casting (direction must be normalised)
+void physics_set_tilemap(const physics_tilemap_t *tilemap);
+void physics_set_collision_rects(const physics_rect_t *rects, int count);
+void physics_set_surfaces(const physics_surface_t *surfaces, int count);
+// Closed centreline loop starting at checkpoint 0; copied
+void physics_set_centreline(const vec2_t *points, int count);
+int64_t physics_get_centreline_length(void);  // 16.16
+bool physics_ray_cast_tiles(vec2_t origin, vec2_t direction, fixed16_t max_distance, physics_ray_hit_t *hit);
+int physics_ray_cast_tiles_batch(vec2_t origin, const vec2_t *directions, int count,
+                                 fixed16_t max_distance, physics_ray_hit_t *hits);
+
 // Utility functions
 fixed16_t physics_get_distance_to_wall(vec2_t position, fixed16_t heading);
 vec2_t physics_get_closest_point_on_track(vec2_t position);
@@ -78,6 +216,7 @@ bool physics_is_position_valid(vec2_t position);
 // Race management
 void physics_start_race(physics_world_t *world);
 void physics_reset_race(physics_world_t *world);
+void physics_build_checkpoint_gates(physics_world_t *world);
 bool physics_check_race_finished(physics_world_t *world, uint8_t car_index);
 
 #endif // _PHYSICS_H_
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "render_snapshot.h"
+#include <string.h>
+
+void render_snapshot_init(render_snapshot_buffer_t *buffer)
+{
+    memset(buffer, 0, sizeof(render_snapshot_buffer_t));
+    buffer->write_index = 0;
+    buffer->read_index = 1;
+    atomic_init(&buffer->spare, 2);
+}
+
+render_snapshot_t* render_snapshot_begin(render_snapshot_buffer_t *buffer)
+{
+    return &buffer->slots[buffer->write_index];
+}
+
+void render_snapshot_publish(render_snapshot_buffer_t *buffer)
+{
+    // Release orders the slot contents before the index becomes visible
+    uint_fast8_t previous = atomic_exchange_explicit(&buffer->spare,
+                                                     buffer->write_index | RENDER_SNAPSHOT_FRESH,
+                                                     memory_order_acq_rel);
+    if (previous & RENDER_SNAPSHOT_FRESH) {
+        buffer->dropped++;
+    }
+
+    buffer->write_index = previous & (RENDER_SNAPSHOT_FRESH - 1);
+    buffer->published++;
+}
+
+void render_snapshot_capture(render_snapshot_t *snapshot, const physics_world_t *world,
+                             uint32_t sequence, int64_t sim_time_us, int64_t input_time_us)
+{
+    snapshot->sequence = sequence;
+    snapshot->sim_time_us = sim_time_us;
+    snapshot->input_time_us = input_time_us;
+    snapshot->car_count = PHYSICS_MAX_CARS;
+
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        const car_physics_t *car = &world->cars[i];
+        const physics_car_progress_t *progress = &world->progress[i];
+        render_car_t *out = &snapshot->cars[i];
+
+        out->position = car->position;
+        out->heading = car->heading;
+        out->speed = car->speed;
+        out->lap = progress->lap;
+        out->position_in_race = progress->position;
+        out->wrong_way = progress->wrong_way;
+        out->finished = world->race_finished[i];
+    }
+}
+
+const render_snapshot_t* render_snapshot_acquire(render_snapshot_buffer_t *buffer, bool *fresh)
+{
+    bool updated = false;
+
+    // Only swap when the producer has published since the last acquire,
+    // otherwise keep showing the slot we already own
+    if (atomic_load_explicit(&buffer->spare, memory_order_relaxed) & RENDER_SNAPSHOT_FRESH) {
+        uint_fast8_t previous = atomic_exchange_explicit(&buffer->spare, buffer->read_index,
+                                                         memory_order_acq_rel);
+        buffer->read_index = previous & (RENDER_SNAPSHOT_FRESH - 1);
+        buffer->consumed++;
+        updated = true;
+    }
+
+    if (fresh) {
+        *fresh = updated;
+    }
+    return &buffer->slots[buffer->read_index];
+}
@@ -0,0 +1,63 @@
+#ifndef _RENDER_SNAPSHOT_H_
+#define _RENDER_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "include/math.h"
+#include "physics.h"
+
+// Slots in the triple buffer: one being written, one being read, one spare
+#define RENDER_SNAPSHOT_SLOTS 3
+
+// Set in the shared index when the spare slot holds an unread snapshot
+#define RENDER_SNAPSHOT_FRESH 0x4
+
+// Per-car state the renderer needs; nothing here points back into the world
+typedef struct {
+    vec2_t position;
+    fixed16_t heading;
+    fixed16_t speed;
+    uint8_t lap;
+    uint8_t position_in_race;  // 1 = leading
+    bool wrong_way;
+    bool finished;
+} render_car_t;
+
+// Immutable view of one physics step
+typedef struct {
+    uint32_t sequence;         // Physics step that produced the snapshot
+    int64_t sim_time_us;       // When the step finished
+    int64_t input_time_us;     // When the input applied in the step was sampled
+    uint8_t car_count;
+    render_car_t cars[PHYSICS_MAX_CARS];
+} render_snapshot_t;
+
+// Single-producer, single-consumer triple buffer. The producer always has a
+// slot to write and the consumer always has a slot to read, so neither side
+// ever waits; publishing swaps the written slot with the spare.
+typedef struct {
+    render_snapshot_t slots[RENDER_SNAPSHOT_SLOTS];
+    atomic_uint_fast8_t spare;   // Spare slot index, plus RENDER_SNAPSHOT_FRESH
+    uint8_t write_index;         // Owned by the producer
+    uint8_t read_index;          // Owned by the consumer
+    uint32_t published;
+    uint32_t consumed;
+    uint32_t dropped;            // Snapshots overwritten before being read
+} render_snapshot_buffer_t;
+
+void render_snapshot_init(render_snapshot_buffer_t *buffer);
+
+// Producer side: fill the slot returned by begin, then publish it
+render_snapshot_t* render_snapshot_begin(render_snapshot_buffer_t *buffer);
+void render_snapshot_publish(render_snapshot_buffer_t *buffer);
+
+// Copy the render-relevant part of the world into a snapshot
+void render_snapshot_capture(render_snapshot_t *snapshot, const physics_world_t *world,
+                             uint32_t sequence, int64_t sim_time_us, int64_t input_time_us);
+
+// Consumer side: returns the newest published snapshot, which stays valid
+// until the next call. fresh is set when it differs from the previous call.
+const render_snapshot_t* render_snapshot_acquire(render_snapshot_buffer_t *buffer, bool *fresh);
+
+#endif // _RENDER_SNAPSHOT_H_
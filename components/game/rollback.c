@@ -0,0 +1,205 @@
+#include "rollback.h"
+#include <string.h>
+
+static rollback_input_slot_t *input_slot(rollback_t *rollback, uint8_t player, uint32_t frame);
+static physics_input_t predict_input(const rollback_t *rollback, uint8_t player, uint32_t frame);
+static void simulate_frame(rollback_t *rollback, uint32_t frame);
+static void update_confirmed_frame(rollback_t *rollback);
+
+void rollback_init(rollback_t *rollback, physics_world_t *world, uint8_t local_player, float delta_time)
+{
+    memset(rollback, 0, sizeof(rollback_t));
+    rollback->world = world;
+    rollback->delta_time = delta_time;
+    rollback->local_player = local_player;
+    rollback->rollback_from = ROLLBACK_NO_FRAME;
+
+    for (int p = 0; p < ROLLBACK_PLAYERS; p++) {
+        for (int i = 0; i < ROLLBACK_INPUT_FRAMES; i++) {
+            rollback->inputs[p][i].frame = ROLLBACK_NO_FRAME;
+        }
+    }
+    for (int i = 0; i < ROLLBACK_MAX_FRAMES; i++) {
+        rollback->snapshots[i].frame = ROLLBACK_NO_FRAME;
+    }
+}
+
+void rollback_add_local_input(rollback_t *rollback, const physics_input_t *input)
+{
+    rollback_input_slot_t *slot = input_slot(rollback, rollback->local_player, rollback->frame);
+    slot->frame = rollback->frame;
+    slot->input = *input;
+    slot->confirmed = true;
+    update_confirmed_frame(rollback);
+}
+
+void rollback_add_remote_input(rollback_t *rollback, uint8_t player, uint32_t frame, const physics_input_t *input)
+{
+    if (player >= ROLLBACK_PLAYERS || player == rollback->local_player) return;
+
+    // Too far behind to be in the history, or too far ahead to store
+    if (frame + ROLLBACK_INPUT_FRAMES <= rollback->frame) {
+        rollback->late_inputs++;
+        return;
+    }
+    if (frame >= rollback->frame + ROLLBACK_INPUT_FRAMES - ROLLBACK_MAX_FRAMES) {
+        rollback->early_inputs++;
+        return;
+    }
+
+    rollback_input_slot_t *slot = input_slot(rollback, player, frame);
+    if (slot->frame == frame && slot->confirmed) {
+        return;  // Duplicate
+    }
+
+    if (frame < rollback->frame) {
+        // Already simulated on a prediction; rewind if it was wrong
+        physics_input_t used = slot->frame == frame ? slot->input : predict_input(rollback, player, frame);
+        if (memcmp(&used, input, sizeof(physics_input_t)) != 0) {
+            rollback->mispredictions++;
+            if (frame + ROLLBACK_MAX_FRAMES < rollback->frame) {
+                // Its snapshot is gone; only the stall rule prevents this
+                rollback->late_inputs++;
+            } else if (frame < rollback->rollback_from) {
+                rollback->rollback_from = frame;
+            }
+        }
+    }
+
+    slot->frame = frame;
+    slot->input = *input;
+    slot->confirmed = true;
+    update_confirmed_frame(rollback);
+}
+
+bool rollback_advance(rollback_t *rollback)
+{
+    // Rewind to the earliest mispredicted frame and replay up to now with
+    // the inputs as they are known now
+    if (rollback->rollback_from != ROLLBACK_NO_FRAME) {
+        uint32_t from = rollback->rollback_from;
+        uint32_t depth = rollback->frame - from;
+
+        rollback_restore(&rollback->snapshots[from % ROLLBACK_MAX_FRAMES], rollback->world);
+        for (uint32_t frame = from; frame < rollback->frame; frame++) {
+            simulate_frame(rollback, frame);
+        }
+
+        rollback->rollback_from = ROLLBACK_NO_FRAME;
+        rollback->rollbacks++;
+        rollback->resimulated_frames += depth;
+        rollback->last_rollback_depth = depth;
+        if (depth > rollback->max_rollback_depth) {
+            rollback->max_rollback_depth = depth;
+        }
+    }
+
+    // Saving this frame's snapshot overwrites the one ROLLBACK_MAX_FRAMES
+    // back, which must not be needed any more
+    if (rollback->frame - rollback->confirmed_frame >= ROLLBACK_MAX_FRAMES) {
+        rollback->stalls++;
+        return false;
+    }
+
+    simulate_frame(rollback, rollback->frame);
+    rollback->frame++;
+    update_confirmed_frame(rollback);
+    return true;
+}
+
+physics_input_t rollback_get_input(const rollback_t *rollback, uint8_t player, uint32_t frame)
+{
+    const rollback_input_slot_t *slot = &rollback->inputs[player][frame % ROLLBACK_INPUT_FRAMES];
+    if (slot->frame == frame) {
+        return slot->input;
+    }
+    return predict_input(rollback, player, frame);
+}
+
+bool rollback_confirmed_hash(const rollback_t *rollback, uint32_t *frame, uint64_t *hash)
+{
+    if (rollback->rollback_from != ROLLBACK_NO_FRAME) return false;
+
+    uint32_t confirmed = rollback->confirmed_frame;
+    if (confirmed == rollback->frame) {
+        *hash = world_state_hash_world(rollback->world, confirmed);
+    } else {
+        const rollback_snapshot_t *snapshot = &rollback->snapshots[confirmed % ROLLBACK_MAX_FRAMES];
+        if (snapshot->frame != confirmed) return false;
+        *hash = rollback_snapshot_hash(snapshot);
+    }
+
+    *frame = confirmed;
+    return true;
+}
+
+void rollback_capture(rollback_snapshot_t *snapshot, const physics_world_t *world, uint32_t frame)
+{
+    snapshot->frame = frame;
+    snapshot->length = (uint16_t)world_state_save(world, frame, WORLD_STATE_DYNAMIC, snapshot->data,
+                                                  sizeof(snapshot->data));
+}
+
+// The checkpoint count cannot change mid-race, so the load cannot fail
+void rollback_restore(const rollback_snapshot_t *snapshot, physics_world_t *world)
+{
+    world_state_load(snapshot->data, snapshot->length, world, NULL);
+}
+
+uint64_t rollback_snapshot_hash(const rollback_snapshot_t *snapshot)
+{
+    return world_state_hash(snapshot->data, snapshot->length);
+}
+
+static rollback_input_slot_t *input_slot(rollback_t *rollback, uint8_t player, uint32_t frame)
+{
+    return &rollback->inputs[player][frame % ROLLBACK_INPUT_FRAMES];
+}
+
+// Repeat the newest confirmed input at or before the frame; neutral before any
+static physics_input_t predict_input(const rollback_t *rollback, uint8_t player, uint32_t frame)
+{
+    physics_input_t neutral = {0};
+
+    for (uint32_t back = 0; back < ROLLBACK_INPUT_FRAMES && back <= frame; back++) {
+        const rollback_input_slot_t *slot = &rollback->inputs[player][(frame - back) % ROLLBACK_INPUT_FRAMES];
+        if (slot->frame == frame - back && slot->confirmed) {
+            return slot->input;
+        }
+    }
+    return neutral;
+}
+
+static void simulate_frame(rollback_t *rollback, uint32_t frame)
+{
+    physics_world_t *world = rollback->world;
+
+    rollback_capture(&rollback->snapshots[frame % ROLLBACK_MAX_FRAMES], world, frame);
+
+    for (int player = 0; player < ROLLBACK_PLAYERS; player++) {
+        rollback_input_slot_t *slot = input_slot(rollback, player, frame);
+        if (slot->frame != frame || !slot->confirmed) {
+            // Record the prediction so a later confirmation can be compared
+            slot->frame = frame;
+            slot->input = predict_input(rollback, player, frame);
+            slot->confirmed = false;
+        }
+        physics_apply_input(&world->cars[player], &slot->input, rollback->delta_time);
+    }
+
+    physics_update(world, rollback->delta_time);
+}
+
+static void update_confirmed_frame(rollback_t *rollback)
+{
+    while (rollback->confirmed_frame < rollback->frame) {
+        uint32_t frame = rollback->confirmed_frame;
+        bool confirmed = true;
+        for (int player = 0; player < ROLLBACK_PLAYERS && confirmed; player++) {
+            const rollback_input_slot_t *slot = input_slot(rollback, player, frame);
+            confirmed = slot->frame == frame && slot->confirmed;
+        }
+        if (!confirmed) break;
+        rollback->confirmed_frame++;
+    }
+}
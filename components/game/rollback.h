@@ -0,0 +1,82 @@
+#ifndef _ROLLBACK_H_
+#define _ROLLBACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "physics.h"
+#include "world_state.h"
+
+// Frames a late remote input can rewind. The simulation stalls rather than
+// predict further ahead than this.
+#define ROLLBACK_MAX_FRAMES 8
+// Input history per player; a power of two larger than ROLLBACK_MAX_FRAMES
+#define ROLLBACK_INPUT_FRAMES 32
+// One player per car, player i drives car i
+#define ROLLBACK_PLAYERS PHYSICS_MAX_CARS
+
+#define ROLLBACK_NO_FRAME UINT32_MAX
+
+// Simulation state that changes from frame to frame, as world_state's
+// dynamic section. The track, checkpoints and lap count are fixed for the
+// race and are not saved.
+typedef struct {
+    uint32_t frame;  // Frame about to be simulated from this state
+    uint16_t length;
+    uint8_t data[WORLD_STATE_DYNAMIC_MAX_SIZE];
+} rollback_snapshot_t;
+
+typedef struct {
+    physics_input_t input;
+    uint32_t frame;          // Frame this slot holds, ROLLBACK_NO_FRAME when empty
+    bool confirmed;          // Received from the owner rather than predicted
+} rollback_input_slot_t;
+
+typedef struct {
+    physics_world_t *world;
+    float delta_time;
+    uint8_t local_player;
+    uint32_t frame;              // Next frame to simulate
+    uint32_t confirmed_frame;    // Every input is known for all frames below this, <= frame
+    uint32_t rollback_from;      // Earliest mispredicted frame, or ROLLBACK_NO_FRAME
+    rollback_input_slot_t inputs[ROLLBACK_PLAYERS][ROLLBACK_INPUT_FRAMES];
+    rollback_snapshot_t snapshots[ROLLBACK_MAX_FRAMES];  // State before frame f at f % ROLLBACK_MAX_FRAMES
+
+    // Statistics
+    uint32_t rollbacks;
+    uint32_t resimulated_frames;
+    uint32_t max_rollback_depth;
+    uint32_t last_rollback_depth;
+    uint32_t mispredictions;     // Remote inputs that differed from the prediction
+    uint32_t late_inputs;        // Arrived too late to be corrected
+    uint32_t early_inputs;       // Arrived too far ahead to be stored
+    uint32_t stalls;             // Advances refused because prediction ran too far ahead
+} rollback_t;
+
+// world must already be set up for the race; frame 0 starts from its state
+void rollback_init(rollback_t *rollback, physics_world_t *world, uint8_t local_player, float delta_time);
+
+// Local input for the next frame to be simulated (rollback->frame)
+void rollback_add_local_input(rollback_t *rollback, const physics_input_t *input);
+
+// Input received from the peer. Inputs for frames already simulated with a
+// different prediction schedule a rollback on the next advance.
+void rollback_add_remote_input(rollback_t *rollback, uint8_t player, uint32_t frame, const physics_input_t *input);
+
+// Applies any pending rollback, then simulates one frame. Returns false
+// without simulating when the frame would run more than ROLLBACK_MAX_FRAMES
+// ahead of the last confirmed remote input.
+bool rollback_advance(rollback_t *rollback);
+
+// Input used (or predicted) for a player at a frame
+physics_input_t rollback_get_input(const rollback_t *rollback, uint8_t player, uint32_t frame);
+
+// Hash of the state at rollback->confirmed_frame, once no rollback is
+// pending. Peers that agree on inputs agree on this hash.
+bool rollback_confirmed_hash(const rollback_t *rollback, uint32_t *frame, uint64_t *hash);
+
+// Snapshot helpers, also used for desync checks
+void rollback_capture(rollback_snapshot_t *snapshot, const physics_world_t *world, uint32_t frame);
+void rollback_restore(const rollback_snapshot_t *snapshot, physics_world_t *world);
+uint64_t rollback_snapshot_hash(const rollback_snapshot_t *snapshot);
+
+#endif // _ROLLBACK_H_
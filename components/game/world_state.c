@@ -0,0 +1,343 @@
+#include "world_state.h"
+#include <string.h>
+
+// Multipliers from xxHash64; the mixing follows its short-input path
+#define PRIME1 0x9e3779b185ebca87ULL
+#define PRIME2 0xc2b2ae3d27d4eb4fULL
+#define PRIME3 0x165667b19e3779f9ULL
+#define PRIME4 0x85ebca77c2b2ae63ULL
+
+#define RACE_HEADER_SIZE 9          // Lap count and track length
+
+static uint8_t *put_u8(uint8_t *p, uint8_t value);
+static uint8_t *put_u16(uint8_t *p, uint16_t value);
+static uint8_t *put_u32(uint8_t *p, uint32_t value);
+static uint8_t *put_u64(uint8_t *p, uint64_t value);
+static uint8_t *put_vec2(uint8_t *p, vec2_t value);
+static uint16_t get_u16(const uint8_t *p);
+static uint32_t get_u32(const uint8_t *p);
+static uint64_t get_u64(const uint8_t *p);
+static vec2_t get_vec2(const uint8_t *p);
+static uint8_t *save_dynamic(const physics_world_t *world, uint8_t checkpoints, uint8_t *p);
+static const uint8_t *load_dynamic(const uint8_t *p, uint8_t checkpoints, physics_world_t *world);
+static uint64_t hash_mix(uint64_t hash, uint64_t word);
+static uint64_t load_word(const uint8_t *p);
+
+size_t world_state_save(const physics_world_t *world, uint32_t frame, uint8_t sections, uint8_t *buffer,
+                        size_t size)
+{
+    uint8_t checkpoints = world->checkpoint_count;
+    if (checkpoints > PHYSICS_MAX_CHECKPOINTS) {
+        return 0;
+    }
+
+    size_t length = WORLD_STATE_HEADER_SIZE;
+    if (sections & WORLD_STATE_DYNAMIC) {
+        length += PHYSICS_MAX_CARS * WORLD_STATE_CAR_SIZE(checkpoints) + 2 + world->broadphase.count;
+    }
+    if (sections & WORLD_STATE_RACE) {
+        length += RACE_HEADER_SIZE + checkpoints * WORLD_STATE_CHECKPOINT_SIZE;
+    }
+    if (length > size || world->broadphase.count > PHYSICS_MAX_CARS) {
+        return 0;
+    }
+
+    uint8_t *p = buffer;
+    p = put_u8(p, WORLD_STATE_MAGIC);
+    p = put_u8(p, WORLD_STATE_VERSION);
+    p = put_u8(p, sections & WORLD_STATE_ALL);
+    p = put_u8(p, checkpoints);
+    p = put_u16(p, PHYSICS_MAX_CARS);
+    p = put_u32(p, frame);
+
+    if (sections & WORLD_STATE_DYNAMIC) {
+        p = save_dynamic(world, checkpoints, p);
+    }
+    if (sections & WORLD_STATE_RACE) {
+        p = put_u8(p, world->total_laps);
+        p = put_u64(p, (uint64_t)world->track_length);
+        for (int i = 0; i < checkpoints; i++) {
+            const checkpoint_t *checkpoint = &world->checkpoints[i];
+            p = put_vec2(p, checkpoint->position);
+            p = put_u32(p, (uint32_t)checkpoint->radius);
+            p = put_vec2(p, checkpoint->gate_a);
+            p = put_vec2(p, checkpoint->gate_b);
+            p = put_vec2(p, checkpoint->forward);
+            p = put_u8(p, checkpoint->index);
+        }
+    }
+    return (size_t)(p - buffer);
+}
+
+bool world_state_load(const uint8_t *data, size_t length, physics_world_t *world, uint32_t *frame)
+{
+    uint8_t sections;
+    uint32_t state_frame;
+    if (!world_state_info(data, length, &sections, &state_frame)) {
+        return false;
+    }
+
+    // Check every length before touching the world
+    uint8_t checkpoints = data[3];
+    size_t expected = WORLD_STATE_HEADER_SIZE;
+    uint16_t broadphase_count = 0;
+    if (sections & WORLD_STATE_DYNAMIC) {
+        if (!(sections & WORLD_STATE_RACE) && checkpoints != world->checkpoint_count) {
+            return false;
+        }
+        expected += PHYSICS_MAX_CARS * WORLD_STATE_CAR_SIZE(checkpoints) + 2;
+        if (length < expected) {
+            return false;
+        }
+        broadphase_count = get_u16(data + expected - 2);
+        if (broadphase_count > PHYSICS_MAX_CARS) {
+            return false;
+        }
+        expected += broadphase_count;
+    }
+    if (sections & WORLD_STATE_RACE) {
+        expected += RACE_HEADER_SIZE + checkpoints * WORLD_STATE_CHECKPOINT_SIZE;
+    }
+    if (length != expected) {
+        return false;
+    }
+
+    const uint8_t *p = data + WORLD_STATE_HEADER_SIZE;
+    if (sections & WORLD_STATE_DYNAMIC) {
+        p = load_dynamic(p, checkpoints, world);
+    }
+    if (sections & WORLD_STATE_RACE) {
+        world->total_laps = p[0];
+        world->track_length = (int64_t)get_u64(p + 1);
+        p += RACE_HEADER_SIZE;
+        memset(world->checkpoints, 0, sizeof(world->checkpoints));
+        world->checkpoint_count = checkpoints;
+        for (int i = 0; i < checkpoints; i++, p += WORLD_STATE_CHECKPOINT_SIZE) {
+            checkpoint_t *checkpoint = &world->checkpoints[i];
+            checkpoint->position = get_vec2(p);
+            checkpoint->radius = (fixed16_t)get_u32(p + 8);
+            checkpoint->gate_a = get_vec2(p + 12);
+            checkpoint->gate_b = get_vec2(p + 20);
+            checkpoint->forward = get_vec2(p + 28);
+            checkpoint->index = p[36];
+        }
+    }
+    if (frame) {
+        *frame = state_frame;
+    }
+    return true;
+}
+
+bool world_state_info(const uint8_t *data, size_t length, uint8_t *sections, uint32_t *frame)
+{
+    if (length < WORLD_STATE_HEADER_SIZE || data[0] != WORLD_STATE_MAGIC || data[1] != WORLD_STATE_VERSION ||
+        (data[2] & ~WORLD_STATE_ALL) != 0 || data[3] > PHYSICS_MAX_CHECKPOINTS ||
+        get_u16(data + 4) != PHYSICS_MAX_CARS) {
+        return false;
+    }
+    if (sections) {
+        *sections = data[2];
+    }
+    if (frame) {
+        *frame = get_u32(data + 6);
+    }
+    return true;
+}
+
+uint64_t world_state_hash(const uint8_t *data, size_t length)
+{
+    uint64_t hash = PRIME3 ^ ((uint64_t)length * PRIME1);
+
+    for (; length >= 8; data += 8, length -= 8) {
+        hash = hash_mix(hash, load_word(data));
+    }
+    if (length > 0) {
+        uint64_t tail = 0;
+        for (size_t i = 0; i < length; i++) {
+            tail |= (uint64_t)data[i] << (8 * i);
+        }
+        hash = hash_mix(hash, tail);
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t world_state_hash_world(const physics_world_t *world, uint32_t frame)
+{
+    uint8_t buffer[WORLD_STATE_DYNAMIC_MAX_SIZE];
+    size_t length = world_state_save(world, frame, WORLD_STATE_DYNAMIC, buffer, sizeof(buffer));
+    return world_state_hash(buffer, length);
+}
+
+static uint8_t *save_dynamic(const physics_world_t *world, uint8_t checkpoints, uint8_t *p)
+{
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        const car_physics_t *car = &world->cars[i];
+        const physics_car_progress_t *progress = &world->progress[i];
+
+        p = put_vec2(p, car->position);
+        p = put_vec2(p, car->velocity);
+        p = put_vec2(p, car->acceleration);
+        p = put_u32(p, (uint32_t)car->heading);
+        p = put_u32(p, (uint32_t)car->angular_vel);
+        p = put_u32(p, (uint32_t)car->speed);
+        p = put_u32(p, (uint32_t)car->mass);
+        p = put_u32(p, (uint32_t)car->drag);
+        p = put_u32(p, (uint32_t)car->friction);
+
+        p = put_u8(p, progress->next_checkpoint);
+        p = put_u8(p, progress->lap);
+        p = put_u8(p, progress->rewind_depth);
+        p = put_u8(p, progress->wrong_way);
+        p = put_u32(p, progress->lap_start_time);
+        p = put_u32(p, progress->sector_start_time);
+        p = put_u32(p, progress->last_lap_time);
+        p = put_u32(p, progress->best_lap_time);
+        for (int gate = 0; gate < checkpoints; gate++) {
+            p = put_u32(p, progress->sector_times[gate]);
+        }
+        p = put_u16(p, progress->segment);
+        p = put_u64(p, (uint64_t)progress->lap_distance);
+        p = put_u64(p, (uint64_t)progress->race_distance);
+        p = put_u32(p, (uint32_t)progress->gap_to_leader);
+        p = put_u8(p, progress->position);
+
+        p = put_u32(p, world->race_time[i]);
+        p = put_u32(p, world->race_time_ns[i]);
+        p = put_u8(p, world->race_finished[i]);
+    }
+
+    p = put_u16(p, world->broadphase.count);
+    memcpy(p, world->broadphase.order, world->broadphase.count);
+    return p + world->broadphase.count;
+}
+
+// Lengths are already checked
+static const uint8_t *load_dynamic(const uint8_t *p, uint8_t checkpoints, physics_world_t *world)
+{
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        car_physics_t *car = &world->cars[i];
+        physics_car_progress_t *progress = &world->progress[i];
+
+        car->position = get_vec2(p);
+        car->velocity = get_vec2(p + 8);
+        car->acceleration = get_vec2(p + 16);
+        car->heading = (fixed16_t)get_u32(p + 24);
+        car->angular_vel = (fixed16_t)get_u32(p + 28);
+        car->speed = (fixed16_t)get_u32(p + 32);
+        car->mass = (fixed16_t)get_u32(p + 36);
+        car->drag = (fixed16_t)get_u32(p + 40);
+        car->friction = (fixed16_t)get_u32(p + 44);
+        p += 48;
+
+        progress->next_checkpoint = p[0];
+        progress->lap = p[1];
+        progress->rewind_depth = p[2];
+        progress->wrong_way = p[3] != 0;
+        progress->lap_start_time = get_u32(p + 4);
+        progress->sector_start_time = get_u32(p + 8);
+        progress->last_lap_time = get_u32(p + 12);
+        progress->best_lap_time = get_u32(p + 16);
+        p += 20;
+        memset(progress->sector_times, 0, sizeof(progress->sector_times));
+        for (int gate = 0; gate < checkpoints; gate++, p += 4) {
+            progress->sector_times[gate] = get_u32(p);
+        }
+        progress->segment = get_u16(p);
+        progress->lap_distance = (int64_t)get_u64(p + 2);
+        progress->race_distance = (int64_t)get_u64(p + 10);
+        progress->gap_to_leader = (fixed16_t)get_u32(p + 18);
+        progress->position = p[22];
+        p += 23;
+
+        world->race_time[i] = get_u32(p);
+        world->race_time_ns[i] = get_u32(p + 4);
+        world->race_finished[i] = p[8] != 0;
+        p += 9;
+    }
+
+    world->broadphase.count = get_u16(p);
+    memcpy(world->broadphase.order, p + 2, world->broadphase.count);
+    return p + 2 + world->broadphase.count;
+}
+
+static uint8_t *put_u8(uint8_t *p, uint8_t value)
+{
+    *p = value;
+    return p + 1;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t value)
+{
+    put_u32(p, (uint32_t)value);
+    return put_u32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint8_t *put_vec2(uint8_t *p, vec2_t value)
+{
+    put_u32(p, (uint32_t)value.x);
+    return put_u32(p + 4, (uint32_t)value.y);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static vec2_t get_vec2(const uint8_t *p)
+{
+    return (vec2_t){ (fixed16_t)get_u32(p), (fixed16_t)get_u32(p + 4) };
+}
+
+static uint64_t hash_mix(uint64_t hash, uint64_t word)
+{
+    word *= PRIME2;
+    word = (word << 31) | (word >> 33);
+    word *= PRIME1;
+    hash ^= word;
+    hash = (hash << 27) | (hash >> 37);
+    return hash * PRIME1 + PRIME4;
+}
+
+// Little-endian whatever the host, so every device hashes alike
+static uint64_t load_word(const uint8_t *p)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+#else
+    return get_u64(p);
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef _WORLD_STATE_H_
+#define _WORLD_STATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "physics.h"
+
+// Binary form of physics_world_t for save states, rollback snapshots,
+// replays and desync checks. Fields are written one by one, little-endian
+// and unpadded, so the bytes (and their hash) are the same on every build
+// and device that simulates the same state.
+#define WORLD_STATE_MAGIC   0x57   // 'W'
+#define WORLD_STATE_VERSION 1      // Bump with any layout change; older versions are refused
+
+// Sections, as flags
+#define WORLD_STATE_DYNAMIC (1 << 0)  // What changes from frame to frame: cars, progress, race times, broadphase
+#define WORLD_STATE_RACE    (1 << 1)  // What is fixed for the race: checkpoints, lap count, track length
+#define WORLD_STATE_ALL     (WORLD_STATE_DYNAMIC | WORLD_STATE_RACE)
+
+// Magic, version, sections, checkpoint count, car count (16 bits), frame
+#define WORLD_STATE_HEADER_SIZE 10
+// One car: physics 48, progress 43 plus the sector times, race time 9
+#define WORLD_STATE_CAR_SIZE(checkpoints) (100 + 4 * (checkpoints))
+#define WORLD_STATE_CHECKPOINT_SIZE 37
+#define WORLD_STATE_DYNAMIC_MAX_SIZE \
+    (WORLD_STATE_HEADER_SIZE + PHYSICS_MAX_CARS * WORLD_STATE_CAR_SIZE(PHYSICS_MAX_CHECKPOINTS) + 2 + PHYSICS_MAX_CARS)
+#define WORLD_STATE_MAX_SIZE \
+    (WORLD_STATE_DYNAMIC_MAX_SIZE + 9 + PHYSICS_MAX_CHECKPOINTS * WORLD_STATE_CHECKPOINT_SIZE)
+
+// Writes the sections of the world as they stand before frame. Returns the
+// length, 0 if size is too small.
+size_t world_state_save(const physics_world_t *world, uint32_t frame, uint8_t sections, uint8_t *buffer,
+                        size_t size);
+
+// Reads back whatever sections the data holds; the rest of the world is
+// left alone. A dynamic section must match the world's checkpoint count
+// unless the race section comes with it. Returns false, with the world
+// untouched, on a wrong magic, version, car count or length.
+bool world_state_load(const uint8_t *data, size_t length, physics_world_t *world, uint32_t *frame);
+
+// Peeks at the header without loading anything
+bool world_state_info(const uint8_t *data, size_t length, uint8_t *sections, uint32_t *frame);
+
+// 64-bit hash of any bytes, eight at a time. Not cryptographic: it tells
+// peers apart that simulated differently, every frame if need be.
+uint64_t world_state_hash(const uint8_t *data, size_t length);
+
+// Hash of the world's dynamic section before frame, without keeping the
+// bytes; equal to hashing what world_state_save writes
+uint64_t world_state_hash_world(const physics_world_t *world, uint32_t frame);
+
+#endif // _WORLD_STATE_H_
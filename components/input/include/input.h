@@ -36,8 +36,13 @@ typedef struct {
     float throttle;    // 0.0 to 1.0
     float brake;       // 0.0 to 1.0
     float steering;    // -1.0 (left) to 1.0 (right)
+
+    int64_t timestamp_us;  // esp_timer time at which input_update sampled the keys
 } input_state_t;
 
+// Flag for a key in the mask returned by input_take_key_presses
+#define INPUT_KEY_BIT(key) (1u << (key))
+
 // Input configuration
 typedef struct {
     bool use_imu_steering;
@@ -49,12 +54,22 @@ typedef struct {
 esp_err_t input_init(const input_config_t *config);
 void input_deinit(void);
 
-// Update input state (call every frame)
+// Update input state. input_update, input_update_imu and the state and key
+// queries below must all run on one task; other tasks use
+// input_take_key_presses.
 void input_update(void);
 
+// Sample the IMU into the input state (call at the IMU rate, faster than frames)
+void input_update_imu(void);
+
 // Get current input state
 const input_state_t* input_get_state(void);
 
+// Keys pressed since the previous call, as INPUT_KEY_BIT flags. Presses
+// are latched by input_update, so a slower consumer on another core still
+// sees every one.
+uint32_t input_take_key_presses(void);
+
 // Key state queries
 bool input_key_pressed(key_code_t key);
 bool input_key_just_pressed(key_code_t key);
@@ -6,6 +6,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <math.h>
+#include <stdatomic.h>
 
 static const char *TAG = "input";
 
@@ -13,6 +14,7 @@ static input_state_t input_state;
 static input_config_t input_config;
 static bool input_initialized = false;
 static input_state_t prev_state;
+static atomic_uint key_press_latch;  // INPUT_KEY_BIT flags not yet taken
 
 
 esp_err_t input_init(const input_config_t *config) {
@@ -42,6 +44,7 @@ esp_err_t input_init(const input_config_t *config) {
     // Clear input state
     memset(&input_state, 0, sizeof(input_state_t));
     memset(&prev_state, 0, sizeof(input_state_t));
+    atomic_store(&key_press_latch, 0);
 
     input_initialized = true;
     ESP_LOGI(TAG, "Input system initialized");
@@ -68,18 +71,21 @@ void input_update(void) {
 
     // Update keyboard state
     keyboard_update();
-    
-    // Update IMU state
-    if (input_config.use_imu_steering) {
-        imu_update();
-        imu_get_data(&input_state.accel_x, &input_state.accel_y, &input_state.accel_z,
-                    &input_state.gyro_x, &input_state.gyro_y, &input_state.gyro_z);
-    }
+    input_state.timestamp_us = esp_timer_get_time();
 
     // Read keyboard keys
+    uint32_t pressed = 0;
     for (int i = 0; i < KEY_COUNT; i++) {
         input_state.keys[i] = keyboard_is_key_pressed(i);
         input_state.keys_changed[i] = (input_state.keys[i] != prev_state.keys[i]);
+        if (input_state.keys[i] && input_state.keys_changed[i]) {
+            pressed |= INPUT_KEY_BIT(i);
+        }
+    }
+
+    // Latch presses for consumers on other tasks
+    if (pressed) {
+        atomic_fetch_or(&key_press_latch, pressed);
     }
 
     // Calculate analog inputs
@@ -118,10 +124,24 @@ void input_update(void) {
     }
 }
 
+void input_update_imu(void) {
+    if (!input_initialized || !input_config.use_imu_steering) {
+        return;
+    }
+
+    imu_update();
+    imu_get_data(&input_state.accel_x, &input_state.accel_y, &input_state.accel_z,
+                &input_state.gyro_x, &input_state.gyro_y, &input_state.gyro_z);
+}
+
 const input_state_t* input_get_state(void) {
     return &input_state;
 }
 
+uint32_t input_take_key_presses(void) {
+    return atomic_exchange(&key_press_latch, 0);
+}
+
 bool input_key_pressed(key_code_t key) {
     if (!input_initialized || key >= KEY_COUNT) {
         return false;
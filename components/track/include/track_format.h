@@ -7,12 +7,13 @@
 #define TRACK_MAGIC 0x4D375452  // "M7TR" in little-endian
 
 // Track file format constants
-#define TRACK_VERSION 1
+#define TRACK_VERSION 2
 #define TRACK_MAX_NAME_LEN 32
 #define TRACK_MAX_CHECKPOINTS 16
 #define TRACK_MAX_LAPS 99
 #define TRACK_TILE_SIZE 32
 #define TRACK_HEIGHTMAP_SIZE 256
+#define TRACK_MAX_CENTRELINE_POINTS 256
 
 // Tile types for Mode-7 rendering
 typedef enum {
@@ -34,6 +35,7 @@ typedef enum {
     TILE_JUMP_PAD,
     TILE_WATER,
     TILE_OFFROAD,
+    TILE_OIL_SLICK,
     TILE_COUNT
 } track_tile_type_t;
 
@@ -58,9 +60,36 @@ typedef struct __attribute__((packed)) {
     uint32_t checkpoint_size;
     uint32_t collision_offset;
     uint32_t collision_size;
+    uint32_t centreline_offset;
+    uint32_t centreline_size;
     uint32_t checksum;
 } track_header_t;
 
+// Version 1 header: same layout up to collision_size, with no centreline
+// section. Loaders convert it to track_header_t and derive the centreline.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t version;
+    char name[TRACK_MAX_NAME_LEN];
+    uint16_t width;
+    uint16_t height;
+    uint16_t tile_size;
+    uint16_t checkpoint_count;
+    uint16_t lap_count;
+    uint32_t track_length;
+    uint32_t thumbnail_offset;
+    uint32_t thumbnail_size;
+    uint32_t heightmap_offset;
+    uint32_t heightmap_size;
+    uint32_t tilemap_offset;
+    uint32_t tilemap_size;
+    uint32_t checkpoint_offset;
+    uint32_t checkpoint_size;
+    uint32_t collision_offset;
+    uint32_t collision_size;
+    uint32_t checksum;
+} track_header_v1_t;
+
 // Checkpoint structure
 typedef struct __attribute__((packed)) {
     int16_t x;
@@ -71,6 +100,13 @@ typedef struct __attribute__((packed)) {
     uint16_t order;
 } track_checkpoint_t;
 
+// Centreline point in track pixels. The centreline is a closed loop that
+// starts at checkpoint 0 (start/finish).
+typedef struct __attribute__((packed)) {
+    int16_t x;
+    int16_t y;
+} track_centreline_point_t;
+
 // Collision data structure
 typedef struct __attribute__((packed)) {
     uint16_t x;
@@ -103,6 +139,10 @@ typedef struct {
     
     // Checkpoint data
     track_checkpoint_t checkpoints[TRACK_MAX_CHECKPOINTS];
+
+    // Centreline data
+    track_centreline_point_t *centreline;
+    uint16_t centreline_count;
     
     // Collision data
     track_collision_t *collision_data;
@@ -7,18 +7,6 @@
 #include "esp_err.h"
 #include "track_format.h"
 
-// Track information structure (lightweight)
-typedef struct {
-    char name[TRACK_MAX_NAME_LEN];
-    uint16_t width;
-    uint16_t height;
-    uint16_t lap_count;
-    uint16_t checkpoint_count;
-    uint32_t track_length;
-    uint32_t file_size;
-    bool valid;
-} track_info_t;
-
 // Initialize track loader system
 esp_err_t track_loader_init(const track_loader_config_t *config);
 
@@ -44,9 +32,14 @@ bool track_validate(const track_data_t *track);
 uint8_t track_get_tile(const track_data_t *track, int x, int y);
 int8_t track_get_height(const track_data_t *track, int x, int y);
 bool track_check_collision(const track_data_t *track, int x, int y);
+void track_get_tile_properties(uint8_t tile_type, track_tile_properties_t *props);
+
+// Share the track's tilemap with the physics system
+void track_bind_physics(const track_data_t *track);
 
 // Track creation utilities
 esp_err_t track_create_default(const char *filename);
+int track_build_centreline(const track_data_t *track, track_centreline_point_t *points, int max_points);
 
 // Memory management
 uint32_t track_get_memory_usage(const track_data_t *track);
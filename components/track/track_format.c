@@ -1,4 +1,6 @@
 #include "track_format.h"
+#include "track_loader.h"
+#include "physics.h"
 #include "esp_log.h"
 #include "esp_crc.h"
 #include "utils.h"
@@ -8,6 +10,8 @@
 
 static const char *TAG = "track_format";
 
+static int corridor_extent(const track_data_t *track, vec2_t point, vec2_t direction, int limit);
+
 // Default tracks data
 static const uint8_t default_track_tilemap[] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -92,6 +96,8 @@ esp_err_t track_create_default(const char *filename)
     header.collision_size = 0;  // No collision data for default track
     current_offset += header.collision_size;
 
+    header.centreline_offset = current_offset;
+
     header.thumbnail_offset = current_offset;
     header.thumbnail_size = 0;  // No thumbnail for default track
 
@@ -103,6 +109,29 @@ esp_err_t track_create_default(const char *filename)
         { .x = 128, .y = 384, .radius = 48, .index = 3, .type = 0, .order = 3 }
     };
 
+    // Bake the centreline so loading does not have to derive it
+    static track_data_t source;
+    static track_centreline_point_t centreline[TRACK_MAX_CENTRELINE_POINTS];
+    memset(&source, 0, sizeof(source));
+    source.width = header.width;
+    source.height = header.height;
+    source.tile_size = header.tile_size;
+    source.checkpoint_count = header.checkpoint_count;
+    source.tilemap = (uint8_t *)default_track_tilemap;
+    memcpy(source.checkpoints, checkpoints, sizeof(checkpoints));
+
+    int centreline_count = track_build_centreline(&source, centreline, TRACK_MAX_CENTRELINE_POINTS);
+    header.centreline_size = centreline_count * sizeof(track_centreline_point_t);
+
+    // Track length is the centreline loop length in pixels
+    header.track_length = 0;
+    for (int i = 0; i < centreline_count; i++) {
+        const track_centreline_point_t *a = &centreline[i];
+        const track_centreline_point_t *b = &centreline[(i + 1) % centreline_count];
+        vec2_t segment = { INT_TO_FIXED16(b->x - a->x), INT_TO_FIXED16(b->y - a->y) };
+        header.track_length += FIXED16_TO_INT(vec2_length(segment));
+    }
+
     // Calculate checksum
     header.checksum = crc32((uint8_t *)&header, sizeof(header) - sizeof(uint32_t));
 
@@ -118,6 +147,9 @@ esp_err_t track_create_default(const char *filename)
     // Write checkpoints
     fwrite(checkpoints, 1, sizeof(checkpoints), file);
 
+    // Write centreline
+    fwrite(centreline, 1, header.centreline_size, file);
+
     fclose(file);
 
     ESP_LOGI(TAG, "Default track created: %s", filename);
@@ -137,7 +169,7 @@ bool track_format_validate(const track_header_t *header)
 {
     if (!header) return false;
     if (header->magic != TRACK_MAGIC_HEADER) return false;
-    if (header->version != TRACK_VERSION) return false;
+    if (header->version < 1 || header->version > TRACK_VERSION) return false;
     if (header->width == 0 || header->width > 1024) return false;
     if (header->height == 0 || header->height > 1024) return false;
     if (header->tile_size == 0 || header->tile_size > 256) return false;
@@ -168,7 +200,8 @@ void track_get_tile_properties(uint8_t tile_type, track_tile_properties_t *props
         [TILE_BOOST_PAD] = { .speed_multiplier = 1.5f, .friction = 0.95f, .is_drivable = true },
         [TILE_JUMP_PAD] = { .speed_multiplier = 1.2f, .friction = 0.95f, .is_drivable = true },
         [TILE_WATER] = { .speed_multiplier = 0.2f, .friction = 0.5f, .is_drivable = false },
-        [TILE_OFFROAD] = { .speed_multiplier = 0.5f, .friction = 0.7f, .is_drivable = true }
+        [TILE_OFFROAD] = { .speed_multiplier = 0.5f, .friction = 0.7f, .is_drivable = true },
+        [TILE_OIL_SLICK] = { .speed_multiplier = 0.9f, .friction = 0.2f, .is_drivable = true }
     };
     
     if (tile_type < TILE_COUNT) {
@@ -176,4 +209,64 @@ void track_get_tile_properties(uint8_t tile_type, track_tile_properties_t *props
     } else {
         *props = tile_properties[TILE_OFFROAD];
     }
-}
\ No newline at end of file
+}
+
+// Build a closed centreline through the checkpoints, starting at the
+// start/finish line. Samples are placed about one tile apart along each
+// leg and pulled sideways to the middle of the drivable corridor.
+int track_build_centreline(const track_data_t *track, track_centreline_point_t *points, int max_points)
+{
+    if (!track || !track->tilemap || !points || track->checkpoint_count < 2) return 0;
+
+    int count = 0;
+    for (int i = 0; i < track->checkpoint_count && count < max_points; i++) {
+        const track_checkpoint_t *from = &track->checkpoints[i];
+        const track_checkpoint_t *to = &track->checkpoints[(i + 1) % track->checkpoint_count];
+
+        // Checkpoints stay fixed so the gates remain on the line
+        points[count++] = (track_centreline_point_t){ from->x, from->y };
+
+        vec2_t leg = { INT_TO_FIXED16(to->x - from->x), INT_TO_FIXED16(to->y - from->y) };
+        int samples = FIXED16_TO_INT(vec2_length(leg)) / track->tile_size;
+        vec2_t along = vec2_normalize(leg);
+        vec2_t left = { -along.y, along.x };
+        int limit = from->radius + to->radius;
+
+        for (int s = 1; s < samples && count < max_points; s++) {
+            vec2_t point = {
+                INT_TO_FIXED16(from->x) + (fixed16_t)((int64_t)leg.x * s / samples),
+                INT_TO_FIXED16(from->y) + (fixed16_t)((int64_t)leg.y * s / samples)
+            };
+
+            // Shift by half the difference between the free space either side
+            int left_extent = corridor_extent(track, point, left, limit);
+            int right_extent = corridor_extent(track, point, (vec2_t){ -left.x, -left.y }, limit);
+            point = vec2_add(point, vec2_scale(left, INT_TO_FIXED16(left_extent - right_extent) / 2));
+
+            points[count++] = (track_centreline_point_t){
+                (int16_t)FIXED16_TO_INT(point.x), (int16_t)FIXED16_TO_INT(point.y)
+            };
+        }
+    }
+
+    ESP_LOGI(TAG, "Built centreline with %d points", count);
+    return count;
+}
+
+// Free distance from point along direction before the track edge, in
+// quarter-tile steps up to limit pixels
+static int corridor_extent(const track_data_t *track, vec2_t point, vec2_t direction, int limit)
+{
+    int step = track->tile_size >= 4 ? track->tile_size / 4 : 1;
+    int distance = 0;
+
+    while (distance + step <= limit) {
+        vec2_t probe = vec2_add(point, vec2_scale(direction, INT_TO_FIXED16(distance + step)));
+        if (track_check_collision(track, FIXED16_TO_INT(probe.x), FIXED16_TO_INT(probe.y))) {
+            break;
+        }
+        distance += step;
+    }
+
+    return distance;
+}
@@ -5,8 +5,10 @@
 #include "esp_spiffs.h"
 #include "esp_heap_caps.h"
 #include "utils.h"
+#include "physics.h"
 #include "math.h"
 #include <string.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -22,6 +24,58 @@ static track_loader_config_t loader_config = {
     .max_tracks_cached = 4
 };
 
+// Read and validate a track header of any supported version. Version 1
+// files have no centreline section; they are widened to the current layout
+// with an empty centreline so the loader derives it from the checkpoints.
+// The file is left positioned just past the header.
+static bool read_track_header(FILE *file, track_header_t *header, bool verify_checksum)
+{
+    track_header_v1_t v1;
+    if (fread(&v1, 1, sizeof(v1), file) != sizeof(v1)) {
+        ESP_LOGE(TAG, "Failed to read track header");
+        return false;
+    }
+
+    if (v1.magic != TRACK_MAGIC_HEADER) {
+        ESP_LOGE(TAG, "Invalid track file format");
+        return false;
+    }
+
+    if (v1.version == 1) {
+        if (verify_checksum &&
+            v1.checksum != crc32((uint8_t *)&v1, sizeof(v1) - sizeof(uint32_t))) {
+            ESP_LOGE(TAG, "Track checksum mismatch");
+            return false;
+        }
+
+        memset(header, 0, sizeof(*header));
+        memcpy(header, &v1, offsetof(track_header_v1_t, checksum));
+        header->checksum = v1.checksum;
+        return true;
+    }
+
+    if (v1.version != TRACK_VERSION) {
+        ESP_LOGE(TAG, "Track version mismatch: %d != %d", (int)v1.version, TRACK_VERSION);
+        return false;
+    }
+
+    // The v1-sized prefix is also the start of the current layout; read the rest
+    memcpy(header, &v1, sizeof(v1));
+    size_t remaining = sizeof(*header) - sizeof(v1);
+    if (fread((uint8_t *)header + sizeof(v1), 1, remaining, file) != remaining) {
+        ESP_LOGE(TAG, "Failed to read track header");
+        return false;
+    }
+
+    if (verify_checksum &&
+        header->checksum != crc32((uint8_t *)header, sizeof(*header) - sizeof(uint32_t))) {
+        ESP_LOGE(TAG, "Track checksum mismatch");
+        return false;
+    }
+
+    return true;
+}
+
 // Initialize track loader
 esp_err_t track_loader_init(const track_loader_config_t *config)
 {
@@ -88,33 +142,11 @@ track_data_t* track_loader_load(const char *filename)
     }
 
     track_header_t header;
-    size_t read = fread(&header, 1, sizeof(header), file);
-    if (read != sizeof(header)) {
-        ESP_LOGE(TAG, "Failed to read track header");
-        fclose(file);
-        return NULL;
-    }
-
-    // Validate header
-    if (header.magic != TRACK_MAGIC_HEADER) {
-        ESP_LOGE(TAG, "Invalid track file format");
-        fclose(file);
-        return NULL;
-    }
-
-    if (header.version != TRACK_VERSION) {
-        ESP_LOGE(TAG, "Track version mismatch: %d != %d", header.version, TRACK_VERSION);
-        fclose(file);
-        return NULL;
-    }
-
-    // Calculate and verify checksum
-    uint32_t calculated_crc = crc32((uint8_t *)&header, sizeof(header) - sizeof(uint32_t));
-    if (header.checksum != calculated_crc) {
-        ESP_LOGE(TAG, "Track checksum mismatch");
+    if (!read_track_header(file, &header, true)) {
         fclose(file);
         return NULL;
     }
+    size_t read;
 
     // Allocate track data structure
     track_data_t *track = (track_data_t *)heap_caps_malloc(sizeof(track_data_t), MALLOC_CAP_SPIRAM);
@@ -206,6 +238,34 @@ track_data_t* track_loader_load(const char *filename)
         }
     }
 
+    // Load the baked centreline, or derive one for tracks without it
+    uint32_t centreline_size = header.centreline_size;
+    if (centreline_size > TRACK_MAX_CENTRELINE_POINTS * sizeof(track_centreline_point_t)) {
+        centreline_size = 0;
+    }
+    track->centreline = (track_centreline_point_t *)heap_caps_malloc(
+        TRACK_MAX_CENTRELINE_POINTS * sizeof(track_centreline_point_t), MALLOC_CAP_SPIRAM);
+    if (!track->centreline) {
+        ESP_LOGE(TAG, "Failed to allocate centreline");
+        track_unload(track);
+        fclose(file);
+        return NULL;
+    }
+
+    if (centreline_size > 0) {
+        fseek(file, header.centreline_offset, SEEK_SET);
+        read = fread(track->centreline, 1, centreline_size, file);
+        if (read != centreline_size) {
+            ESP_LOGE(TAG, "Failed to read centreline");
+            track_unload(track);
+            fclose(file);
+            return NULL;
+        }
+        track->centreline_count = centreline_size / sizeof(track_centreline_point_t);
+    } else {
+        track->centreline_count = track_build_centreline(track, track->centreline, TRACK_MAX_CENTRELINE_POINTS);
+    }
+
     // Load thumbnail if available
     if (header.thumbnail_size > 0) {
         track->thumbnail = (uint8_t *)heap_caps_malloc(header.thumbnail_size, MALLOC_CAP_SPIRAM);
@@ -226,7 +286,8 @@ track_data_t* track_loader_load(const char *filename)
                          header.tilemap_size + 
                          header.heightmap_size + 
                          header.collision_size + 
-                         header.thumbnail_size;
+                         header.thumbnail_size +
+                         TRACK_MAX_CENTRELINE_POINTS * sizeof(track_centreline_point_t);
 
     ESP_LOGI(TAG, "Track loaded: %s (%dx%d, %d checkpoints, %dKB)", 
              filename, track->width, track->height, track->checkpoint_count, 
@@ -267,6 +328,9 @@ void track_unload(track_data_t *track)
     if (track->collision_data) {
         heap_caps_free(track->collision_data);
     }
+    if (track->centreline) {
+        heap_caps_free(track->centreline);
+    }
     if (track->thumbnail) {
         heap_caps_free(track->thumbnail);
     }
@@ -295,10 +359,10 @@ track_info_t track_loader_get_info(const char *filename)
     }
 
     track_header_t header;
-    size_t read = fread(&header, 1, sizeof(header), file);
+    bool ok = read_track_header(file, &header, false);
     fclose(file);
 
-    if (read != sizeof(header) || header.magic != TRACK_MAGIC_HEADER) {
+    if (!ok) {
         return info;
     }
 
@@ -308,8 +372,9 @@ track_info_t track_loader_get_info(const char *filename)
     info.lap_count = header.lap_count;
     info.checkpoint_count = header.checkpoint_count;
     info.track_length = header.track_length;
-    info.file_size = sizeof(header) + header.tilemap_size + header.heightmap_size + 
-                    header.checkpoint_size + header.collision_size + header.thumbnail_size;
+    info.file_size = (header.version == 1 ? sizeof(track_header_v1_t) : sizeof(header)) + header.tilemap_size + header.heightmap_size + 
+                    header.checkpoint_size + header.collision_size + header.thumbnail_size +
+                    header.centreline_size;
     info.valid = true;
 
     return info;
@@ -412,4 +477,64 @@ bool track_check_collision(const track_data_t *track, int x, int y)
     return tile == TILE_WALL_CONCRETE || tile == TILE_WALL_BARRIER || 
            tile == TILE_WALL_FENCE || tile == TILE_WALL_TREES ||
            tile == TILE_WATER || tile == TILE_OFFROAD;
-}
\ No newline at end of file
+}
+
+// Share the track's tilemap with the physics system
+void track_bind_physics(const track_data_t *track)
+{
+    if (!track || !track->tilemap) {
+        physics_set_tilemap(NULL);
+        physics_set_collision_rects(NULL, 0);
+        physics_set_centreline(NULL, 0);
+        return;
+    }
+
+    physics_tilemap_t tilemap = {
+        .tiles = track->tilemap,
+        .width = track->width,
+        .height = track->height,
+        .tile_size = INT_TO_FIXED16(track->tile_size)
+    };
+
+    // Convert the float tile properties into physics' fixed-point table once
+    physics_surface_t surfaces[TILE_COUNT];
+    for (uint8_t tile = 0; tile < TILE_COUNT; tile++) {
+        track_tile_properties_t props;
+        track_get_tile_properties(tile, &props);
+
+        surfaces[tile].friction = (uint16_t)(props.friction * PHYSICS_SURFACE_ONE);
+        surfaces[tile].speed_cap = (uint16_t)(props.speed_multiplier * PHYSICS_SURFACE_ONE);
+        surfaces[tile].flags = props.is_drivable ? 0 : PHYSICS_SURFACE_SOLID;
+        surfaces[tile].reserved = 0;
+    }
+    surfaces[TILE_BOOST_PAD].flags |= PHYSICS_SURFACE_BOOST;
+    surfaces[TILE_OIL_SLICK].flags |= PHYSICS_SURFACE_SPIN;
+
+    physics_set_surfaces(surfaces, TILE_COUNT);
+    physics_set_tilemap(&tilemap);
+
+    // Collision rectangles are swept against alongside the solid tiles
+    physics_rect_t rects[PHYSICS_MAX_COLLISION_RECTS];
+    int rect_count = 0;
+    for (int i = 0; i < track->collision_count && rect_count < PHYSICS_MAX_COLLISION_RECTS; i++) {
+        const track_collision_t *collision = &track->collision_data[i];
+        rects[rect_count].min_x = INT_TO_FIXED16(collision->x);
+        rects[rect_count].min_y = INT_TO_FIXED16(collision->y);
+        rects[rect_count].max_x = INT_TO_FIXED16(collision->x + collision->width);
+        rects[rect_count].max_y = INT_TO_FIXED16(collision->y + collision->height);
+        rect_count++;
+    }
+    physics_set_collision_rects(rects, rect_count);
+
+    // Centreline for race position and wrong-way checks
+    static vec2_t centreline[TRACK_MAX_CENTRELINE_POINTS];
+    int point_count = track->centreline_count;
+    if (point_count > PHYSICS_MAX_CENTRELINE_POINTS) {
+        point_count = PHYSICS_MAX_CENTRELINE_POINTS;
+    }
+    for (int i = 0; i < point_count; i++) {
+        centreline[i].x = INT_TO_FIXED16(track->centreline[i].x);
+        centreline[i].y = INT_TO_FIXED16(track->centreline[i].y);
+    }
+    physics_set_centreline(centreline, point_count);
+}
@@ -0,0 +1,75 @@
+#include "bitstream.h"
+#include <string.h>
+
+void bit_writer_init(bit_writer_t *writer, uint8_t *data, size_t size)
+{
+    writer->data = data;
+    writer->size = size;
+    writer->bit = 0;
+    writer->overflow = false;
+    memset(data, 0, size);
+}
+
+void bit_write(bit_writer_t *writer, uint32_t value, unsigned bits)
+{
+    if (bits == 0) return;
+    if (writer->bit + bits > writer->size * 8) {
+        writer->overflow = true;
+        return;
+    }
+    if (bits < 32) {
+        value &= (1u << bits) - 1;
+    }
+
+    // Fill the current byte, then whole bytes, most significant bits first
+    while (bits > 0) {
+        unsigned used = writer->bit & 7;
+        unsigned take = 8 - used < bits ? 8 - used : bits;
+        uint32_t chunk = (value >> (bits - take)) & ((1u << take) - 1);
+        writer->data[writer->bit >> 3] |= (uint8_t)(chunk << (8 - used - take));
+        writer->bit += take;
+        bits -= take;
+    }
+}
+
+size_t bit_writer_bytes(const bit_writer_t *writer)
+{
+    return (writer->bit + 7) >> 3;
+}
+
+void bit_reader_init(bit_reader_t *reader, const uint8_t *data, size_t size)
+{
+    reader->data = data;
+    reader->size = size;
+    reader->bit = 0;
+    reader->overflow = false;
+}
+
+uint32_t bit_read(bit_reader_t *reader, unsigned bits)
+{
+    if (bits == 0) return 0;
+    if (reader->bit + bits > reader->size * 8) {
+        reader->overflow = true;
+        reader->bit = reader->size * 8;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    while (bits > 0) {
+        unsigned used = reader->bit & 7;
+        unsigned take = 8 - used < bits ? 8 - used : bits;
+        uint32_t chunk = (reader->data[reader->bit >> 3] >> (8 - used - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        reader->bit += take;
+        bits -= take;
+    }
+    return value;
+}
+
+int32_t bit_read_signed(bit_reader_t *reader, unsigned bits)
+{
+    uint32_t value = bit_read(reader, bits);
+    if (bits == 0 || bits >= 32) return (int32_t)value;
+    uint32_t sign = 1u << (bits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
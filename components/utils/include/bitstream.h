@@ -0,0 +1,51 @@
+#ifndef _BITSTREAM_H_
+#define _BITSTREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// MSB-first bit packing for network packets. Writes past the end of the
+// buffer and reads past the end of the data set overflow instead of
+// touching memory; check it once after the whole packet.
+typedef struct {
+    uint8_t *data;
+    size_t size;               // Buffer size in bytes
+    size_t bit;                // Bits written so far
+    bool overflow;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;               // Data length in bytes
+    size_t bit;                // Bits read so far
+    bool overflow;
+} bit_reader_t;
+
+void bit_writer_init(bit_writer_t *writer, uint8_t *data, size_t size);
+// Low `bits` bits of value, 0..32
+void bit_write(bit_writer_t *writer, uint32_t value, unsigned bits);
+// Bytes used, the last one zero-padded
+size_t bit_writer_bytes(const bit_writer_t *writer);
+
+void bit_reader_init(bit_reader_t *reader, const uint8_t *data, size_t size);
+// 0..32 bits; returns 0 for bits past the end
+uint32_t bit_read(bit_reader_t *reader, unsigned bits);
+// Sign-extends a `bits`-wide two's complement field
+int32_t bit_read_signed(bit_reader_t *reader, unsigned bits);
+
+// Small magnitudes of either sign map to small codes: 0, -1, 1, -2, ...
+static inline uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t code) {
+    return (int32_t)(code >> 1) ^ -(int32_t)(code & 1);
+}
+
+// Bits needed for an unsigned value, 0 for 0
+static inline unsigned bit_width(uint32_t value) {
+    return value ? 32 - (unsigned)__builtin_clz(value) : 0;
+}
+
+#endif // _BITSTREAM_H_
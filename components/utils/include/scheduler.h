@@ -0,0 +1,65 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+// Task body; period_us is the nominal time between ticks
+typedef void (*scheduler_task_fn)(void *arg, uint32_t period_us);
+
+// Monotonic time source in microseconds (e.g. esp_timer_get_time)
+typedef int64_t (*scheduler_clock_fn)(void);
+
+// Task registration
+typedef struct {
+    const char *name;
+    uint32_t rate_hz;
+    uint8_t priority;        // Lower values run first when several tasks are due
+    uint8_t max_catch_up;    // Ticks run back to back when late; older ticks are dropped
+    scheduler_task_fn fn;
+    void *arg;
+} scheduler_task_config_t;
+
+// Per-task state and deadline accounting
+typedef struct {
+    scheduler_task_config_t config;
+    bool enabled;
+    int64_t epoch_us;        // Time of tick 0; deadlines are epoch + tick / rate
+    uint32_t tick;           // Index of the next tick to run
+    uint32_t runs;
+    uint32_t overruns;       // Runs that finished after the next tick was due
+    uint32_t skipped;        // Ticks dropped beyond max_catch_up
+    uint32_t last_duration_us;
+    uint32_t max_duration_us;
+    uint32_t max_lateness_us;  // Worst start delay past a deadline
+    int64_t total_duration_us;
+} scheduler_task_t;
+
+typedef struct {
+    scheduler_task_t tasks[SCHEDULER_MAX_TASKS];
+    uint8_t order[SCHEDULER_MAX_TASKS];  // Task ids sorted by priority
+    uint8_t task_count;
+    scheduler_clock_fn clock;            // NULL selects the simulated clock
+    int64_t sim_time_us;
+} scheduler_t;
+
+// Pass NULL as clock to run on a simulated clock driven by scheduler_advance
+void scheduler_init(scheduler_t *sched, scheduler_clock_fn clock);
+
+// Returns the task id, or -1 if the table is full or the config is invalid
+int scheduler_add_task(scheduler_t *sched, const scheduler_task_config_t *config);
+void scheduler_set_rate(scheduler_t *sched, int task_id, uint32_t rate_hz);
+void scheduler_set_enabled(scheduler_t *sched, int task_id, bool enabled);
+const scheduler_task_t *scheduler_get_task(const scheduler_t *sched, int task_id);
+
+// Run every due task in priority order. Returns microseconds until the
+// next deadline (0 if something is already due again).
+int64_t scheduler_run_due(scheduler_t *sched);
+
+// Clock access; scheduler_advance only affects the simulated clock
+int64_t scheduler_now(const scheduler_t *sched);
+void scheduler_advance(scheduler_t *sched, int64_t delta_us);
+
+#endif // _SCHEDULER_H_
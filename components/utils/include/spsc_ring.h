@@ -0,0 +1,45 @@
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Head and tail live on separate cache lines so the producer and consumer
+// cores do not invalidate each other's line on every push and pop
+#define SPSC_RING_CACHE_LINE 64
+
+// Single-producer, single-consumer ring of fixed-size slots. Exactly one
+// task may push and exactly one task may pop; neither side ever blocks.
+typedef struct {
+    // Producer line
+    _Alignas(SPSC_RING_CACHE_LINE) _Atomic uint32_t head;  // Next slot to write
+    uint32_t cached_tail;      // Producer's last view of tail
+    uint32_t dropped;          // Pushes rejected because the ring was full
+
+    // Consumer line
+    _Alignas(SPSC_RING_CACHE_LINE) _Atomic uint32_t tail;  // Next slot to read
+    uint32_t cached_head;      // Consumer's last view of head
+
+    // Read-only after init
+    _Alignas(SPSC_RING_CACHE_LINE) uint8_t *storage;
+    size_t slot_size;
+    uint32_t mask;             // Capacity - 1; capacity is a power of two
+} spsc_ring_t;
+
+// storage must hold capacity * slot_size bytes; capacity must be a power of two
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, uint32_t capacity);
+void spsc_ring_reset(spsc_ring_t *ring);
+
+// Producer side. Copies slot_size bytes in; returns false when full.
+bool spsc_ring_push(spsc_ring_t *ring, const void *item);
+
+// Consumer side. Copies the oldest item out; returns false when empty.
+bool spsc_ring_pop(spsc_ring_t *ring, void *item);
+
+// Approximate from either side; exact from the consumer when the producer is idle
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+uint32_t spsc_ring_capacity(const spsc_ring_t *ring);
+
+#endif // _SPSC_RING_H_
@@ -0,0 +1,150 @@
+#include "scheduler.h"
+#include <string.h>
+
+static int64_t task_deadline(const scheduler_task_t *task)
+{
+    return task->epoch_us + (int64_t)task->tick * 1000000 / task->config.rate_hz;
+}
+
+static void restart_task(scheduler_t *sched, scheduler_task_t *task)
+{
+    task->epoch_us = scheduler_now(sched);
+    task->tick = 0;
+}
+
+void scheduler_init(scheduler_t *sched, scheduler_clock_fn clock)
+{
+    memset(sched, 0, sizeof(scheduler_t));
+    sched->clock = clock;
+}
+
+int scheduler_add_task(scheduler_t *sched, const scheduler_task_config_t *config)
+{
+    if (!sched || !config || !config->fn || config->rate_hz == 0) return -1;
+    if (sched->task_count >= SCHEDULER_MAX_TASKS) return -1;
+
+    int id = sched->task_count++;
+    scheduler_task_t *task = &sched->tasks[id];
+    memset(task, 0, sizeof(scheduler_task_t));
+    task->config = *config;
+    if (task->config.max_catch_up == 0) {
+        task->config.max_catch_up = 1;
+    }
+    task->enabled = true;
+    restart_task(sched, task);
+
+    // Insert into the priority order; equal priorities keep registration order
+    int pos = id;
+    while (pos > 0 && sched->tasks[sched->order[pos - 1]].config.priority > config->priority) {
+        sched->order[pos] = sched->order[pos - 1];
+        pos--;
+    }
+    sched->order[pos] = id;
+
+    return id;
+}
+
+void scheduler_set_rate(scheduler_t *sched, int task_id, uint32_t rate_hz)
+{
+    if (!sched || task_id < 0 || task_id >= sched->task_count || rate_hz == 0) return;
+
+    scheduler_task_t *task = &sched->tasks[task_id];
+    if (task->config.rate_hz == rate_hz) return;
+
+    // Keep the pending deadline, continue at the new rate from there
+    task->epoch_us = task_deadline(task);
+    task->tick = 0;
+    task->config.rate_hz = rate_hz;
+}
+
+void scheduler_set_enabled(scheduler_t *sched, int task_id, bool enabled)
+{
+    if (!sched || task_id < 0 || task_id >= sched->task_count) return;
+
+    scheduler_task_t *task = &sched->tasks[task_id];
+    if (enabled && !task->enabled) {
+        restart_task(sched, task);
+    }
+    task->enabled = enabled;
+}
+
+const scheduler_task_t *scheduler_get_task(const scheduler_t *sched, int task_id)
+{
+    if (!sched || task_id < 0 || task_id >= sched->task_count) return NULL;
+    return &sched->tasks[task_id];
+}
+
+int64_t scheduler_run_due(scheduler_t *sched)
+{
+    if (!sched) return 0;
+
+    int64_t now = scheduler_now(sched);
+
+    for (int i = 0; i < sched->task_count; i++) {
+        scheduler_task_t *task = &sched->tasks[sched->order[i]];
+        if (!task->enabled) continue;
+
+        int64_t deadline = task_deadline(task);
+        if (now < deadline) continue;
+
+        // Drop ticks that are too old to be worth running
+        uint32_t due = (uint32_t)((now - deadline) * task->config.rate_hz / 1000000) + 1;
+        if (due > task->config.max_catch_up) {
+            uint32_t dropped = due - task->config.max_catch_up;
+            task->skipped += dropped;
+            task->tick += dropped;
+            deadline = task_deadline(task);
+        }
+
+        uint32_t period_us = 1000000 / task->config.rate_hz;
+        for (uint32_t run = 0; run < task->config.max_catch_up && now >= deadline; run++) {
+            uint32_t lateness = (uint32_t)(now - deadline);
+            if (lateness > task->max_lateness_us) {
+                task->max_lateness_us = lateness;
+            }
+
+            task->config.fn(task->config.arg, period_us);
+
+            int64_t end = scheduler_now(sched);
+            uint32_t duration = (uint32_t)(end - now);
+            task->tick++;
+            task->runs++;
+            task->last_duration_us = duration;
+            task->total_duration_us += duration;
+            if (duration > task->max_duration_us) {
+                task->max_duration_us = duration;
+            }
+
+            deadline = task_deadline(task);
+            if (end > deadline) {
+                task->overruns++;
+            }
+            now = end;
+        }
+    }
+
+    // Time until the earliest pending deadline
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < sched->task_count; i++) {
+        const scheduler_task_t *task = &sched->tasks[i];
+        if (!task->enabled) continue;
+
+        int64_t deadline = task_deadline(task);
+        if (deadline < next) next = deadline;
+    }
+
+    if (next == INT64_MAX) return 0;
+    return next > now ? next - now : 0;
+}
+
+int64_t scheduler_now(const scheduler_t *sched)
+{
+    return sched->clock ? sched->clock() : sched->sim_time_us;
+}
+
+void scheduler_advance(scheduler_t *sched, int64_t delta_us)
+{
+    if (sched && !sched->clock && delta_us > 0) {
+        sched->sim_time_us += delta_us;
+    }
+}
@@ -0,0 +1,77 @@
+#include "spsc_ring.h"
+#include <string.h>
+
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, uint32_t capacity)
+{
+    if (!ring || !storage || slot_size == 0 || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    memset(ring, 0, sizeof(spsc_ring_t));
+    ring->storage = storage;
+    ring->slot_size = slot_size;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+void spsc_ring_reset(spsc_ring_t *ring)
+{
+    // Only safe while neither side is running
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+    ring->dropped = 0;
+}
+
+bool spsc_ring_push(spsc_ring_t *ring, const void *item)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    // Only re-read the consumer's index when the cached one says full
+    if (head - ring->cached_tail > ring->mask) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail > ring->mask) {
+            ring->dropped++;
+            return false;
+        }
+    }
+
+    memcpy(ring->storage + (head & ring->mask) * ring->slot_size, item, ring->slot_size);
+
+    // Release publishes the slot contents together with the new head
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_ring_pop(spsc_ring_t *ring, void *item)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail == ring->cached_head) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == ring->cached_head) {
+            return false;
+        }
+    }
+
+    memcpy(item, ring->storage + (tail & ring->mask) * ring->slot_size, ring->slot_size);
+
+    // Release hands the slot back to the producer only after the copy
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t spsc_ring_capacity(const spsc_ring_t *ring)
+{
+    return ring->mask + 1;
+}
@@ -0,0 +1,68 @@
+// Broadphase cost per step at 2, 32 and 256 cars: sweep-and-prune against
+// the all-pairs loop it replaced, plus a full physics_update at 256 cars
+#include "host_test.h"
+#include "physics.h"
+
+_Static_assert(PHYSICS_MAX_CARS == 256, "built with -DPHYSICS_MAX_CARS=256");
+
+#define STEPS 2000
+
+static physics_world_t world;
+
+static bool count_pair(uint8_t a, uint8_t b, void *context) {
+    (*(int64_t *)context)++;
+    return true;
+}
+
+static void drift(uint32_t *rng, int count) {
+    for (int i = 0; i < count; i++) {
+        world.cars[i].position.x += (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(8)) - INT_TO_FIXED16(4);
+        world.cars[i].position.y += (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(8)) - INT_TO_FIXED16(4);
+    }
+}
+
+int main(void) {
+    static const int counts[] = { 2, 32, 256 };
+    physics_init();
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        uint32_t rng = 11;
+        for (int i = 0; i < count; i++) {
+            world.cars[i].mass = INT_TO_FIXED16(1000);
+            world.cars[i].drag = PHYSICS_DRAG_COEFFICIENT;
+            world.cars[i].friction = PHYSICS_FRICTION_COEFFICIENT;
+            world.cars[i].position.x = (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(3000));
+            world.cars[i].position.y = (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(3000));
+        }
+        world.broadphase.count = 0;
+
+        int64_t pairs = 0, sweep_ns = 0, brute_ns = 0;
+        for (int step = 0; step < STEPS; step++) {
+            drift(&rng, count);
+
+            int64_t start = host_time_ns();
+            physics_sweep_car_pairs(&world.broadphase, world.cars, count, count_pair, &pairs);
+            sweep_ns += host_time_ns() - start;
+
+            start = host_time_ns();
+            for (int i = 0; i < count; i++) {
+                for (int j = i + 1; j < count; j++) {
+                    pairs += physics_check_car_collision(&world.cars[i], &world.cars[j]);
+                }
+            }
+            brute_ns += host_time_ns() - start;
+        }
+
+        printf("%3d cars: sweep %8.2f us/step  all-pairs %8.2f us/step\n",
+               count, sweep_ns / 1e3 / STEPS, brute_ns / 1e3 / STEPS);
+        host_bench_sink = pairs;
+    }
+
+    int64_t start = host_time_ns();
+    for (int step = 0; step < STEPS; step++) {
+        physics_update(&world, 1.0f / 60.0f);
+    }
+    printf("256 cars: physics_update %8.2f us/step\n", (host_time_ns() - start) / 1e3 / STEPS);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Notifications and air bytes for a minute of racing traffic: input
+// history every 60 Hz frame, state at the 30 Hz network rate and clock
+// pings with their pongs, sent one notification per message as before or
+// batched per frame at the default and the preferred MTU. Then the cost of
+// batching and decoding per message.
+//
+//   bench_frame_batch [seconds]
+#include "host_test.h"
+#include "frame_batch.h"
+#include <stdlib.h>
+
+#define FRAME_RATE 60
+#define STATE_EVERY 2                // 30 Hz
+#define PING_EVERY 15                // 250 ms, each answered by a pong
+// Per notification on air besides its value: LL header 2, MIC 4, L2CAP 4, ATT 3
+#define NOTIFY_OVERHEAD (2 + 4 + 4 + FRAME_BATCH_ATT_HEADER)
+
+typedef struct {
+    uint64_t notifications;
+    uint64_t value_bytes;
+} traffic_t;
+
+static void discard(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length) {
+    host_bench_sink += length;
+}
+
+// Queues one frame's messages, sizes as the codecs produce mid race
+static int queue_frame(frame_batch_t *batch, uint32_t frame, uint32_t *rng, traffic_t *unbatched) {
+    static const uint8_t payload[FRAME_BATCH_MAX_MESSAGE];
+    int messages = 0;
+    size_t lengths[4];
+    frame_batch_kind_t kinds[4];
+
+    kinds[messages] = FRAME_BATCH_INPUT;
+    lengths[messages++] = 7 + host_rand(rng) % 6;
+    if (frame % STATE_EVERY == 0) {
+        kinds[messages] = FRAME_BATCH_STATE;
+        lengths[messages++] = 7 + host_rand(rng) % 5;
+    }
+    if (frame % PING_EVERY == 0) {
+        kinds[messages] = FRAME_BATCH_EVENT;
+        lengths[messages++] = 12;
+    }
+    if (frame % PING_EVERY == 3) {
+        kinds[messages] = FRAME_BATCH_EVENT;
+        lengths[messages++] = 12;
+    }
+    for (int i = 0; i < messages; i++) {
+        frame_batch_add(batch, kinds[i], payload, lengths[i]);
+        if (unbatched) {
+            unbatched->notifications++;
+            unbatched->value_bytes += lengths[i];
+        }
+    }
+    return messages;
+}
+
+static traffic_t run(uint16_t mtu, uint32_t frames, traffic_t *unbatched) {
+    frame_batch_t batch;
+    uint8_t frame[FRAME_BATCH_MAX_SIZE];
+    uint32_t rng = 0xba7c4;
+    traffic_t traffic = {0};
+
+    frame_batch_init(&batch, mtu - FRAME_BATCH_ATT_HEADER);
+    for (uint32_t f = 0; f < frames; f++) {
+        queue_frame(&batch, f, &rng, unbatched);
+        size_t length;
+        while ((length = frame_batch_next(&batch, frame)) > 0) {
+            traffic.notifications++;
+            traffic.value_bytes += length;
+        }
+    }
+    return traffic;
+}
+
+static void report(const char *name, const traffic_t *traffic, uint32_t seconds, const traffic_t *baseline) {
+    uint64_t air = traffic->value_bytes + traffic->notifications * NOTIFY_OVERHEAD;
+    uint64_t baseline_air = baseline->value_bytes + baseline->notifications * NOTIFY_OVERHEAD;
+    printf("%-26s %6.1f notifications/s %7.0f air bytes/s (%3.0f%% of unbatched)\n", name,
+           (double)traffic->notifications / seconds, (double)air / seconds, 100.0 * air / baseline_air);
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 60;
+    uint32_t frames = seconds * FRAME_RATE;
+    traffic_t unbatched = {0};
+
+    traffic_t default_mtu = run(23, frames, &unbatched);
+    traffic_t preferred_mtu = run(256, frames, NULL);
+    report("one per message", &unbatched, seconds, &unbatched);
+    report("batched per frame, MTU 23", &default_mtu, seconds, &unbatched);
+    report("batched per frame, MTU 256", &preferred_mtu, seconds, &unbatched);
+
+    // Queue, pack and decode cost
+    frame_batch_t sender, receiver;
+    uint8_t frame[FRAME_BATCH_MAX_SIZE];
+    uint32_t rng = 1;
+    uint64_t messages = 0;
+    frame_batch_init(&sender, FRAME_BATCH_MAX_SIZE);
+    frame_batch_init(&receiver, FRAME_BATCH_MAX_SIZE);
+    int64_t start = host_time_ns();
+    for (uint32_t f = 0; f < frames * 100; f++) {
+        messages += queue_frame(&sender, f, &rng, NULL);
+        size_t length;
+        while ((length = frame_batch_next(&sender, frame)) > 0) {
+            frame_batch_decode(&receiver, frame, length, discard, NULL);
+        }
+    }
+    int64_t ns = host_time_ns() - start;
+    printf("%-26s %6.1f ns/message (queue, pack, decode)\n", "codec", (double)ns / messages);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Simulation throughput from a recorded race: a replay of scripted inputs
+// for both cars is played back as fast as the host allows, as the same
+// deterministic load every run. Also the cost of recording and of reading
+// the stream alone.
+//
+//   bench_input_replay [seconds of race] [runs]
+#include "host_test.h"
+#include "input_replay.h"
+#include "net_peer.h"
+#include "world_state.h"
+#include <stdlib.h>
+
+#define DT (1.0f / NET_PEER_RATE_HZ)
+
+static uint8_t replay[1 << 20];
+
+int main(int argc, char **argv) {
+    uint32_t frames = (argc > 1 ? (uint32_t)atoi(argv[1]) : 180) * NET_PEER_RATE_HZ;
+    int runs = argc > 2 ? atoi(argv[2]) : 10;
+    static physics_world_t world;
+    input_replay_recorder_t recorder;
+    input_replay_reader_t reader;
+    physics_input_t inputs[PHYSICS_MAX_CARS];
+
+    int64_t start = host_time_ns();
+    input_replay_record_init(&recorder, replay, sizeof(replay), PHYSICS_MAX_CARS, NET_PEER_TRACK_ID,
+                             NET_PEER_RACE_SEED);
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        for (int player = 0; player < PHYSICS_MAX_CARS; player++) {
+            inputs[player] = race_fixture_input(player, frame);
+        }
+        input_replay_record_frame(&recorder, inputs);
+    }
+    size_t length = input_replay_record_finish(&recorder, false, 0);
+    double record_ns = (double)(host_time_ns() - start) / frames;
+    printf("%u frames (%u s) of %d cars: %zu bytes, %u runs, %.2f bytes a frame, record %.1f ns a frame\n",
+           frames, frames / NET_PEER_RATE_HZ, PHYSICS_MAX_CARS, length, recorder.runs, (double)length / frames,
+           record_ns);
+
+    start = host_time_ns();
+    for (int run = 0; run < runs; run++) {
+        input_replay_open(&reader, replay, length);
+        while (input_replay_next(&reader, inputs)) host_bench_sink += inputs[0].steering;
+    }
+    printf("  read only   %8.1f ns a frame\n", (double)(host_time_ns() - start) / ((double)frames * runs));
+
+    uint64_t first_hash = 0;
+    bool deterministic = true;
+    start = host_time_ns();
+    for (int run = 0; run < runs; run++) {
+        race_fixture_setup_world(&world);
+        input_replay_open(&reader, replay, length);
+        input_replay_play(&reader, &world, DT);
+        uint64_t hash = world_state_hash_world(&world, frames);
+        if (run == 0) first_hash = hash;
+        deterministic &= hash == first_hash;
+    }
+    double frame_ns = (double)(host_time_ns() - start) / ((double)frames * runs);
+    printf("  replay      %8.1f ns a frame, %.0f frames/s, %.0fx real time\n", frame_ns, 1e9 / frame_ns,
+           1e9 / frame_ns / NET_PEER_RATE_HZ);
+    printf("  final hash %016llx, %s over %d runs\n", (unsigned long long)first_hash,
+           deterministic ? "the same" : "DIFFERENT", runs);
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+// Fixed-point math microbenchmarks, ns per call over a shared input set
+#include "host_test.h"
+#include "include/math.h"
+#include <math.h>
+
+#define N 4096
+#define ROUNDS 1000
+
+static fixed16_t inputs[N];
+
+// The 16-iteration Newton square root this module used to ship
+static fixed16_t newton_sqrt(fixed16_t x) {
+    if (x <= 0) return 0;
+    fixed16_t result = x;
+    for (int i = 0; i < 16; i++) {
+        result = (result + fixed_div(x, result)) >> 1;
+    }
+    return result;
+}
+
+#define BENCH(name, expr) do { \
+    int64_t sum = 0; \
+    int64_t start = host_time_ns(); \
+    for (int r = 0; r < ROUNDS; r++) { \
+        for (int i = 0; i < N; i++) { \
+            fixed16_t x = inputs[i]; \
+            sum += (expr); \
+        } \
+    } \
+    int64_t elapsed = host_time_ns() - start; \
+    host_bench_sink += sum; \
+    printf("%-28s %7.2f ns\n", name, (double)elapsed / ((double)N * ROUNDS)); \
+} while (0)
+
+// affine2_t against the 3x3 matrices it replaced, ns per call
+static void bench_transforms(void) {
+    affine2_t a, b, ab;
+    mat3_t ma, mb, mab;
+    affine2_from_pose(&a, (vec2_t){ INT_TO_FIXED16(10), INT_TO_FIXED16(-4) }, FLOAT_TO_FIXED16(0.4f));
+    affine2_from_pose(&b, (vec2_t){ INT_TO_FIXED16(-3), INT_TO_FIXED16(8) }, FLOAT_TO_FIXED16(-1.1f));
+    mat3_rotation(&ma, FLOAT_TO_FIXED16(0.4f));
+    mat3_rotation(&mb, FLOAT_TO_FIXED16(-1.1f));
+
+    int64_t sum = 0;
+    int64_t start = host_time_ns();
+    for (int i = 0; i < N * ROUNDS / 4; i++) {
+        a.m[0][2] = inputs[i & (N - 1)];
+        affine2_compose(&ab, &a, &b);
+        sum += ab.m[0][2];
+    }
+    printf("%-28s %7.2f ns\n", "affine2_compose", (double)(host_time_ns() - start) / (N * ROUNDS / 4));
+
+    start = host_time_ns();
+    for (int i = 0; i < N * ROUNDS / 4; i++) {
+        ma.m[0][2] = inputs[i & (N - 1)];
+        mat3_multiply(&mab, &ma, &mb);
+        sum += mab.m[0][2];
+    }
+    printf("%-28s %7.2f ns\n", "mat3_multiply", (double)(host_time_ns() - start) / (N * ROUNDS / 4));
+
+    host_bench_sink += sum;
+    BENCH("affine2_transform", affine2_transform(&ab, (vec2_t){ x, x >> 1 }).x);
+    BENCH("mat3_transform", mat3_transform(&mab, (vec2_t){ x, x >> 1 }).x);
+}
+
+int main(void) {
+    uint32_t rng = 1;
+    for (int i = 0; i < N; i++) {
+        inputs[i] = (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(4096)) + 1;
+    }
+
+    BENCH("fixed_sqrt", fixed_sqrt(x));
+    BENCH("newton_sqrt (old)", newton_sqrt(x));
+    BENCH("sqrtf + convert", (fixed16_t)(sqrtf(x / 65536.0f) * 65536.0f));
+    BENCH("isqrt64", (int64_t)isqrt64((uint64_t)x << 16));
+    BENCH("fixed_rsqrt", fixed_rsqrt(x));
+    BENCH("fixed_div(1, fixed_sqrt)", fixed_div(FIXED16_ONE, fixed_sqrt(x)));
+    BENCH("vec2_normalize", vec2_normalize((vec2_t){ x, inputs[(i + 1) & (N - 1)] }).x);
+    BENCH("vec2_length", vec2_length((vec2_t){ x, inputs[(i + 1) & (N - 1)] }));
+    BENCH("angle16_sin", angle16_sin((angle16_t)x));
+    BENCH("angle16_sin_lerp", angle16_sin_lerp((angle16_t)x));
+    BENCH("fixed_sin (radians)", fixed_sin(x));
+    BENCH("sinf + convert", (fixed16_t)(sinf(x / 65536.0f) * 65536.0f));
+    bench_transforms();
+    return 0;
+}
@@ -0,0 +1,39 @@
+// Batched kernels against per-vector loops, ns per vector. This file is
+// built without auto-vectorisation so the loops show what single-vector
+// call sites cost; the kernels themselves come from the library.
+#include "host_test.h"
+#include "include/math.h"
+
+#define N 1024
+#define ROUNDS 20000
+
+static vec2_t a[N], b[N], out[N];
+static fixed16_t dots[N];
+
+#define BENCH(name, body) do { \
+    int64_t start = host_time_ns(); \
+    for (int r = 0; r < ROUNDS; r++) { \
+        body; \
+        host_bench_sink += out[r & (N - 1)].x + dots[r & (N - 1)]; \
+    } \
+    printf("%-30s %6.3f ns/vector\n", name, (double)(host_time_ns() - start) / ((double)N * ROUNDS)); \
+} while (0)
+
+int main(void) {
+    uint32_t rng = 3;
+    for (int i = 0; i < N; i++) {
+        a[i] = (vec2_t){ (fixed16_t)host_rand(&rng) >> 8, (fixed16_t)host_rand(&rng) >> 8 };
+        b[i] = (vec2_t){ (fixed16_t)host_rand(&rng) >> 8, (fixed16_t)host_rand(&rng) >> 8 };
+    }
+    affine2_t m;
+    affine2_from_pose(&m, (vec2_t){ INT_TO_FIXED16(3), INT_TO_FIXED16(4) }, FLOAT_TO_FIXED16(0.3f));
+    printf("backend: %s\n", math_batch_backend());
+
+    BENCH("vec2_scale_batch", vec2_scale_batch(out, a, FIXED16_HALF + r, N));
+    BENCH("vec2_scale loop", for (int i = 0; i < N; i++) out[i] = vec2_scale(a[i], FIXED16_HALF + r));
+    BENCH("vec2_dot_batch", vec2_dot_batch(dots, a, b, N));
+    BENCH("vec2_dot loop", for (int i = 0; i < N; i++) dots[i] = vec2_dot(a[i], b[i]));
+    BENCH("affine2_transform_batch", affine2_transform_batch(&m, out, a, N));
+    BENCH("affine2_transform loop", for (int i = 0; i < N; i++) out[i] = affine2_transform(&m, a[i]));
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Netcode cost and real-time races between processes.
+//
+//   bench_net_race
+//       Races two peers over loopback links as fast as the host allows and
+//       reports the netcode cost per simulated frame.
+//
+//   bench_net_race peer <player> <port> <peer port> [latency ms] [jitter ms] [loss %] [reorder %]
+//       One peer of a real-time race over UDP on localhost. Start player 0
+//       and player 1 in two shells with the ports swapped; each prints its
+//       final hash, which must match:
+//
+//       bench_net_race peer 0 7000 7001 20 15 2 1
+//       bench_net_race peer 1 7001 7000 20 15 2 1
+//
+//       The telemetry line is printed every second on the way.
+#include "host_test.h"
+#include "net_peer.h"
+#include "transport_loopback.h"
+#include "transport_udp.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RACE_FRAMES 3600
+#define RACES 5
+#define PEER_RACE_FRAMES 1200               // 20 s in real time
+#define PEER_TIMEOUT_US 120000000
+
+static int64_t sim_now_us;
+
+static int64_t sim_clock(void) {
+    return sim_now_us;
+}
+
+static int64_t real_clock(void) {
+    return host_time_ns() / 1000;
+}
+
+static void bench_loopback(const char *name, const link_sim_config_t *config) {
+    static transport_loopback_t loopback;
+    static net_peer_t peers[2];
+    transport_t ends[2];
+    uint32_t frames = 0, ticks = 0;
+    bool matched = true;
+
+    int64_t start = host_time_ns();
+    for (int race = 0; race < RACES; race++) {
+        link_sim_config_t link = *config;
+        link.seed += (uint32_t)race;
+        transport_loopback_init(&loopback, &link, sim_clock, 0);
+        for (int i = 0; i < 2; i++) {
+            transport_loopback_endpoint(&loopback, i, &ends[i]);
+            net_peer_init(&peers[i], (uint8_t)i, &ends[i], RACE_FRAMES);
+        }
+        for (uint32_t tick = 0; tick < RACE_FRAMES * 3 && !(peers[0].finished && peers[1].finished); tick++) {
+            sim_now_us = (int64_t)tick * NET_PEER_STEP_US;
+            net_peer_step(&peers[0], sim_now_us);
+            net_peer_step(&peers[1], sim_now_us);
+            ticks++;
+        }
+        matched &= peers[0].finished && peers[1].finished && peers[0].final_hash == peers[1].final_hash;
+        frames += peers[0].rollback.frame + peers[1].rollback.frame + peers[0].rollback.resimulated_frames +
+                  peers[1].rollback.resimulated_frames;
+        host_bench_sink += (int64_t)peers[0].final_hash;
+    }
+    double seconds = (host_time_ns() - start) / 1e9;
+
+    printf("  %-8s %7.2f us per peer step, %7.2f us per simulated frame, %6.0fx real time  %s\n", name,
+           seconds * 1e6 / (2.0 * ticks), seconds * 1e6 / frames, ticks * (NET_PEER_STEP_US / 1e6) / seconds,
+           matched ? "" : "HASHES DIFFER");
+}
+
+static int run_peer(int argc, char **argv) {
+    static transport_udp_t udp;
+    static net_peer_t peer;
+    transport_t transport;
+
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s peer <player> <port> <peer port> [latency ms] [jitter ms] [loss %%] [reorder %%]\n",
+                argv[0]);
+        return 2;
+    }
+    uint8_t player = (uint8_t)atoi(argv[2]);
+    link_sim_config_t config = {
+        .latency_us = argc > 5 ? (uint32_t)atoi(argv[5]) * 1000 : 0,
+        .jitter_us = argc > 6 ? (uint32_t)atoi(argv[6]) * 1000 : 0,
+        .loss_percent = argc > 7 ? (uint32_t)atoi(argv[7]) : 0,
+        .reorder_percent = argc > 8 ? (uint32_t)atoi(argv[8]) : 0,
+        .seed = 0x1234u + player,
+    };
+    if (!transport_udp_open(&udp, (uint16_t)atoi(argv[3]), (uint16_t)atoi(argv[4]), &config, real_clock, 0)) {
+        fprintf(stderr, "cannot bind port %s\n", argv[3]);
+        return 1;
+    }
+    transport_udp_endpoint(&udp, &transport);
+    net_peer_init(&peer, player, &transport, PEER_RACE_FRAMES);
+
+    printf("player %u on port %u, waiting for port %u\n", player, udp.port, udp.peer_port);
+    int64_t start = real_clock();
+    int64_t next = start;
+    uint32_t lines = 0;
+    while (!peer.finished && real_clock() - start < PEER_TIMEOUT_US) {
+        int64_t now = real_clock();
+        if (now < next) {
+            struct timespec pause = { 0, (long)(next - now) * 1000 };
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        next += NET_PEER_STEP_US;
+        net_peer_step(&peer, now);
+        if (peer.protocol.telemetry_lines != lines) {
+            lines = peer.protocol.telemetry_lines;
+            printf("  %s\n", peer.protocol.telemetry_line);
+        }
+    }
+    // Keep answering a while so the other side can confirm the end too
+    for (int64_t end = real_clock() + 1000000; real_clock() < end;) {
+        struct timespec pause = { 0, NET_PEER_STEP_US * 1000L };
+        nanosleep(&pause, NULL);
+        net_peer_step(&peer, real_clock());
+    }
+
+    const rollback_t *rollback = &peer.rollback;
+    printf("frames %u, rollbacks %u, resimulated %u, max depth %u, stalls %u, skipped %u, added %u, RTT %u us\n",
+           rollback->frame, rollback->rollbacks, rollback->resimulated_frames, rollback->max_rollback_depth,
+           rollback->stalls, peer.protocol.clock_sync.frames_skipped, peer.protocol.clock_sync.frames_added, peer.protocol.clock_sync.rtt_us);
+    printf("datagrams %u sent, %u received; %u lost and %u reordered on the way out\n", udp.datagrams_sent,
+           udp.datagrams_received, udp.outbound.lost, udp.outbound.reordered);
+    if (!peer.finished) {
+        printf("unfinished\n");
+        transport_udp_close(&udp);
+        return 1;
+    }
+    printf("final hash %016llx\n", (unsigned long long)peer.final_hash);
+    transport_udp_close(&udp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "peer") == 0) {
+        return run_peer(argc, argv);
+    }
+
+    printf("%d races of %d frames over loopback\n", RACES, RACE_FRAMES);
+    bench_loopback("clean", &(link_sim_config_t){ .latency_us = 10000, .seed = 1 });
+    bench_loopback("typical", &(link_sim_config_t){ .latency_us = 20000, .jitter_us = 15000, .loss_percent = 2,
+                                                    .seed = 2 });
+    bench_loopback("awful", &(link_sim_config_t){ .latency_us = 50000, .jitter_us = 50000, .loss_percent = 20,
+                                                  .reorder_percent = 10, .seed = 3 });
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Cost of keeping telemetry on: a race second's worth of recording (input
+// and state packets both ways, clock pings, rollbacks) and the once-a-second
+// tick with its log line, per sample and per second of racing.
+//
+//   bench_net_telemetry [seconds]
+#include "host_test.h"
+#include "net_telemetry.h"
+#include <stdlib.h>
+
+#define FRAME_RATE 60
+#define STATE_EVERY 2                // 30 Hz
+#define PING_EVERY 15
+
+int main(int argc, char **argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 20000;
+    static net_telemetry_t telemetry;
+    char line[NET_TELEMETRY_LINE_SIZE];
+    uint32_t rng = 1;
+    uint64_t samples = 0;
+
+    net_telemetry_init(&telemetry, 0);
+    int64_t start = host_time_ns();
+    for (int second = 0; second < seconds; second++) {
+        for (uint32_t frame = 0; frame < FRAME_RATE; frame++) {
+            int64_t now = (int64_t)second * 1000000 + (int64_t)frame * 1000000 / FRAME_RATE;
+            uint32_t r = host_rand(&rng);
+
+            net_telemetry_count_sent(&telemetry, NET_TELEMETRY_INPUT, 7 + r % 6);
+            net_telemetry_count_received(&telemetry, NET_TELEMETRY_INPUT, 7 + (r >> 4) % 6);
+            net_telemetry_count_inputs(&telemetry, 1, (r >> 8) % 50 == 0, 0);
+            samples += 3;
+            if (frame % STATE_EVERY == 0) {
+                net_telemetry_count_sent(&telemetry, NET_TELEMETRY_STATE, 7 + (r >> 12) % 5);
+                net_telemetry_count_received(&telemetry, NET_TELEMETRY_STATE, 7 + (r >> 16) % 5);
+                net_telemetry_record_transit(&telemetry, now, now + 20000 + (r >> 20) % 15000);
+                net_telemetry_record(&telemetry, NET_TELEMETRY_ONE_WAY, 20000 + (r >> 18) % 15000);
+                samples += 4;
+            }
+            if (frame % PING_EVERY == 0) {
+                net_telemetry_count_sent(&telemetry, NET_TELEMETRY_CLOCK, 12);
+                net_telemetry_count_received(&telemetry, NET_TELEMETRY_CLOCK, 12);
+                net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 30000 + (r >> 14) % 40000);
+                samples += 3;
+            }
+            if ((r >> 24) % 4 == 0) {
+                net_telemetry_record_rollback(&telemetry, 1 + (r >> 26) % 6, 1 + (r >> 26) % 6);
+                samples++;
+            }
+            if (net_telemetry_tick(&telemetry, now, line, sizeof(line))) {
+                host_bench_sink += line[0];
+            }
+        }
+    }
+    double elapsed_ns = (double)(host_time_ns() - start);
+
+    net_telemetry_snapshot_t snapshot;
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    host_bench_sink += snapshot.histograms[NET_TELEMETRY_RTT].samples;
+    printf("%d race seconds, %llu samples\n", seconds, (unsigned long long)samples);
+    printf("  %.1f ns per sample, %.2f us per race second with its log line\n", elapsed_ns / samples,
+           elapsed_ns / 1000.0 / seconds);
+    printf("  last line: %s\n", line);
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Physics query benchmarks: 1M tile rays single and batched, against the
+// legacy circle ray cast
+#include "host_test.h"
+#include "physics.h"
+
+#define MAP_W 64
+#define MAP_H 64
+#define RAYS 1000000
+#define BATCH 64
+
+static uint8_t tiles[MAP_W * MAP_H];
+static vec2_t dirs[BATCH];
+
+static void report(const char *name, int64_t ns, int rays) {
+    printf("%-28s %8.1f ns/ray %8.2f Mray/s\n", name, (double)ns / rays, rays * 1e3 / ns);
+}
+
+int main(void) {
+    static const physics_surface_t surfaces[2] = {
+        { .friction = PHYSICS_SURFACE_ONE, .speed_cap = PHYSICS_SURFACE_ONE, .flags = 0 },
+        { .friction = PHYSICS_SURFACE_ONE, .speed_cap = PHYSICS_SURFACE_ONE, .flags = PHYSICS_SURFACE_SOLID },
+    };
+    uint32_t rng = 7;
+    for (int i = 0; i < MAP_W * MAP_H; i++) {
+        tiles[i] = host_rand(&rng) % 100 < 10 ? 1 : 0;
+    }
+    physics_init();
+    physics_tilemap_t map = { tiles, MAP_W, MAP_H, INT_TO_FIXED16(16) };
+    physics_set_tilemap(&map);
+    physics_set_surfaces(surfaces, 2);
+
+    for (int i = 0; i < BATCH; i++) {
+        angle16_t angle = (angle16_t)(i * (65536 / BATCH) + 100);
+        dirs[i] = (vec2_t){ angle16_cos_lerp(angle), angle16_sin_lerp(angle) };
+    }
+    vec2_t origin = { INT_TO_FIXED16(MAP_W * 8) + 5, INT_TO_FIXED16(MAP_H * 8) + 9 };
+    fixed16_t max_distance = INT_TO_FIXED16(256);
+    int64_t sink = 0;
+
+    int64_t start = host_time_ns();
+    for (int i = 0; i < RAYS; i++) {
+        physics_ray_hit_t hit;
+        sink += physics_ray_cast_tiles(origin, dirs[i % BATCH], max_distance, &hit);
+        sink += hit.distance;
+    }
+    report("physics_ray_cast_tiles", host_time_ns() - start, RAYS);
+
+    start = host_time_ns();
+    for (int i = 0; i < RAYS; i += BATCH) {
+        physics_ray_hit_t hits[BATCH];
+        sink += physics_ray_cast_tiles_batch(origin, dirs, BATCH, max_distance, hits);
+        sink += hits[0].distance;
+    }
+    report("physics_ray_cast_tiles_batch", host_time_ns() - start, RAYS);
+
+    start = host_time_ns();
+    for (int i = 0; i < RAYS; i++) {
+        vec2_t point;
+        fixed16_t distance = 0;
+        sink += physics_ray_cast((vec2_t){ i & 0xFFFF, 0 }, dirs[i % BATCH], max_distance, &point, &distance);
+        sink += distance;
+    }
+    report("physics_ray_cast (circle)", host_time_ns() - start, RAYS);
+
+    host_bench_sink = sink;
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Serial against pipelined rendering, modelled with pthreads on the host.
+// Physics (60 Hz) and frame tasks run on the real scheduler with the host
+// clock; each task's work is a sleep so the result does not depend on how
+// many CPUs the host has.
+//
+//   bench_render_pipeline [seconds] [physics_ms] [render_ms] [target_fps]
+#include "host_test.h"
+#include "physics.h"
+#include "render_snapshot.h"
+#include "scheduler.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t physics_work_us = 6000;
+static uint32_t render_work_us = 14000;
+static uint32_t target_fps = 120;
+
+static physics_world_t world;
+static render_snapshot_buffer_t snapshots;
+static uint32_t physics_step;
+static atomic_bool running;
+
+// Frame-side statistics, owned by whichever thread runs the frame task
+static uint32_t frames;
+static uint32_t latency_samples;
+static int64_t latency_total_us;
+static int64_t latency_max_us;
+
+static int64_t host_clock_us(void) {
+    return host_time_ns() / 1000;
+}
+
+static void work(uint32_t us) {
+    struct timespec ts = { us / 1000000, (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static void task_physics(void *arg, uint32_t period_us) {
+    int64_t input_time = host_clock_us();
+    work(physics_work_us);
+    physics_update(&world, 1.0f / PHYSICS_RATE_HZ);
+    render_snapshot_capture(render_snapshot_begin(&snapshots), &world, ++physics_step, host_clock_us(), input_time);
+    render_snapshot_publish(&snapshots);
+}
+
+static void task_frame(void *arg, uint32_t period_us) {
+    bool fresh;
+    const render_snapshot_t *snapshot = render_snapshot_acquire(&snapshots, &fresh);
+    work(render_work_us);
+
+    // The frame is on screen once the flush returns
+    if (fresh && snapshot->input_time_us > 0) {
+        int64_t latency = host_clock_us() - snapshot->input_time_us;
+        latency_total_us += latency;
+        latency_samples++;
+        if (latency > latency_max_us) latency_max_us = latency;
+    }
+    frames++;
+}
+
+static void scheduler_loop(scheduler_t *sched) {
+    while (atomic_load(&running)) {
+        int64_t wait = scheduler_run_due(sched);
+        work(wait > 1000 ? (uint32_t)wait : 1000);
+    }
+}
+
+static void *render_thread(void *arg) {
+    scheduler_loop((scheduler_t *)arg);
+    return NULL;
+}
+
+static void *timer_thread(void *arg) {
+    work(*(uint32_t *)arg);
+    atomic_store(&running, false);
+    return NULL;
+}
+
+static void run(bool pipelined, uint32_t seconds) {
+    memset(&world, 0, sizeof(world));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+    }
+    physics_start_race(&world);
+    render_snapshot_init(&snapshots);
+    physics_step = 0;
+    frames = latency_samples = 0;
+    latency_total_us = latency_max_us = 0;
+    atomic_store(&running, true);
+
+    scheduler_t sim, render;
+    scheduler_init(&sim, host_clock_us);
+    scheduler_init(&render, host_clock_us);
+    int physics_id = scheduler_add_task(&sim, &(scheduler_task_config_t){
+        .name = "physics", .rate_hz = PHYSICS_RATE_HZ, .priority = 1, .max_catch_up = 4, .fn = task_physics
+    });
+    scheduler_t *frame_sched = pipelined ? &render : &sim;
+    scheduler_add_task(frame_sched, &(scheduler_task_config_t){
+        .name = "frame", .rate_hz = target_fps, .priority = 3, .max_catch_up = 1, .fn = task_frame
+    });
+
+    uint32_t duration_us = seconds * 1000000;
+    pthread_t timer, renderer;
+    pthread_create(&timer, NULL, timer_thread, &duration_us);
+    if (pipelined) {
+        pthread_create(&renderer, NULL, render_thread, &render);
+    }
+    scheduler_loop(&sim);
+    if (pipelined) {
+        pthread_join(renderer, NULL);
+    }
+    pthread_join(timer, NULL);
+
+    const scheduler_task_t *physics = scheduler_get_task(&sim, physics_id);
+    printf("%-10s %6.1f fps  input-to-photon avg %5.1f ms max %5.1f ms  "
+           "physics %u steps, %u skipped  %u snapshots dropped\n",
+           pipelined ? "pipelined" : "serial", (double)frames / seconds,
+           latency_samples ? latency_total_us / 1000.0 / latency_samples : 0.0, latency_max_us / 1000.0,
+           physics->runs, physics->skipped, snapshots.dropped);
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 3;
+    if (argc > 2) physics_work_us = (uint32_t)atoi(argv[2]) * 1000;
+    if (argc > 3) render_work_us = (uint32_t)atoi(argv[3]) * 1000;
+    if (argc > 4) target_fps = (uint32_t)atoi(argv[4]);
+
+    printf("physics %u ms at %d Hz, render %u ms, target %u fps, %u s per mode\n", physics_work_us / 1000,
+           PHYSICS_RATE_HZ, render_work_us / 1000, target_fps, seconds);
+    run(false, seconds);
+    run(true, seconds);
+    return 0;
+}
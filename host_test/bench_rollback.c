@@ -0,0 +1,85 @@
+// Rollback cost per physics step: a plain advance, and the worst case where a
+// late input rewinds the full prediction window and replays it.
+//
+//   bench_rollback [iterations]
+#include "host_test.h"
+#include "rollback.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DT (1.0f / 60.0f)
+
+static physics_world_t world;
+static rollback_t rollback;
+
+static void setup(void) {
+    memset(&world, 0, sizeof(world));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+        world.cars[i].position = (vec2_t){ INT_TO_FIXED16(40 * i), 0 };
+    }
+    physics_start_race(&world);
+    rollback_init(&rollback, &world, 0, DT);
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000;
+    physics_input_t local = { .throttle = 100, .steering = 20 };
+    rollback_snapshot_t snapshot;
+
+    // Snapshot primitives
+    setup();
+    int64_t start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        rollback_capture(&snapshot, &world, i);
+    }
+    int64_t capture_ns = host_time_ns() - start;
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        rollback_restore(&snapshot, &world);
+    }
+    int64_t restore_ns = host_time_ns() - start;
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        snapshot.frame = i;
+        host_bench_sink += (int64_t)rollback_snapshot_hash(&snapshot);
+    }
+    int64_t hash_ns = host_time_ns() - start;
+
+    // Remote input always on time and predicted right: one step per advance
+    setup();
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        physics_input_t remote = { .throttle = 100 };
+        rollback_add_local_input(&rollback, &local);
+        rollback_add_remote_input(&rollback, 1, rollback.frame, &remote);
+        rollback_advance(&rollback);
+    }
+    int64_t steady_ns = host_time_ns() - start;
+
+    // Remote input arrives a full window late and always differs from the
+    // prediction, so every advance replays ROLLBACK_MAX_FRAMES frames
+    setup();
+    uint32_t steps = 0;
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations + ROLLBACK_MAX_FRAMES; i++) {
+        rollback_add_local_input(&rollback, &local);
+        if (rollback.frame >= ROLLBACK_MAX_FRAMES) {
+            uint32_t late = rollback.frame - ROLLBACK_MAX_FRAMES;
+            physics_input_t remote = { .throttle = (uint8_t)(late % 2 ? 100 : 0), .steering = 1 };
+            rollback_add_remote_input(&rollback, 1, late, &remote);
+        }
+        if (rollback_advance(&rollback)) steps++;
+    }
+    int64_t worst_ns = host_time_ns() - start;
+
+    printf("%d cars, snapshot %zu bytes\n", PHYSICS_MAX_CARS, sizeof(rollback_snapshot_t));
+    printf("capture  %8.1f ns\n", (double)capture_ns / iterations);
+    printf("restore  %8.1f ns\n", (double)restore_ns / iterations);
+    printf("hash     %8.1f ns\n", (double)hash_ns / iterations);
+    printf("advance, no rollback        %8.2f us\n", steady_ns / 1e3 / iterations);
+    printf("advance, %d-frame rollback   %8.2f us  (%u rollbacks, max depth %u, %.2f%% of a 60 Hz step)\n",
+           ROLLBACK_MAX_FRAMES, worst_ns / 1e3 / steps, rollback.rollbacks, rollback.max_rollback_depth,
+           worst_ns / 1e3 / steps / 16667.0 * 100.0);
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Save, load and hash cost of the world's binary form: the dynamic section
+// as rollback snapshots and desync checks use it every frame, and the full
+// world as a save state.
+//
+//   bench_world_state [iterations]
+#include "host_test.h"
+#include "world_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DT (1.0f / 60.0f)
+
+static physics_world_t world;
+
+static void setup(void) {
+    memset(&world, 0, sizeof(world));
+    for (int i = 0; i < PHYSICS_MAX_CHECKPOINTS; i++) {
+        world.checkpoints[i].position = (vec2_t){ INT_TO_FIXED16(100 * i), INT_TO_FIXED16(300) };
+        world.checkpoints[i].radius = INT_TO_FIXED16(60);
+        world.checkpoints[i].index = (uint8_t)i;
+    }
+    world.checkpoint_count = PHYSICS_MAX_CHECKPOINTS;
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+        world.cars[i].position = (vec2_t){ INT_TO_FIXED16(40 * i), 0 };
+    }
+    physics_start_race(&world);
+    for (int i = 0; i < 60; i++) {
+        physics_input_t input = { .throttle = 100, .steering = 20 };
+        physics_apply_input(&world.cars[0], &input, DT);
+        physics_update(&world, DT);
+    }
+}
+
+static void bench(const char *name, uint8_t sections, uint32_t iterations) {
+    static uint8_t buffer[WORLD_STATE_MAX_SIZE];
+    size_t length = 0;
+
+    int64_t start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        length = world_state_save(&world, i, sections, buffer, sizeof(buffer));
+        host_bench_sink += buffer[length - 1];
+    }
+    double save_ns = (double)(host_time_ns() - start) / iterations;
+
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        buffer[6] = (uint8_t)i;
+        host_bench_sink += world_state_load(buffer, length, &world, NULL);
+    }
+    double load_ns = (double)(host_time_ns() - start) / iterations;
+
+    start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        buffer[6] = (uint8_t)i;
+        host_bench_sink += (int64_t)world_state_hash(buffer, length);
+    }
+    double hash_ns = (double)(host_time_ns() - start) / iterations;
+
+    printf("  %-8s %5zu bytes  save %7.1f ns  load %7.1f ns  hash %7.1f ns (%.2f GB/s)\n", name, length, save_ns,
+           load_ns, hash_ns, length / hash_ns);
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+
+    setup();
+    printf("%d cars, %d gates, world %zu bytes in memory\n", PHYSICS_MAX_CARS, PHYSICS_MAX_CHECKPOINTS,
+           sizeof(physics_world_t));
+    bench("dynamic", WORLD_STATE_DYNAMIC, iterations);
+    bench("all", WORLD_STATE_ALL, iterations);
+
+    int64_t start = host_time_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        host_bench_sink += (int64_t)world_state_hash_world(&world, i);
+    }
+    printf("  save and hash the dynamic section %7.1f ns\n", (double)(host_time_ns() - start) / iterations);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+// Minimal check and timing helpers shared by the host tests and benchmarks.
+// Each test is its own executable; main returns host_test_finish().
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int host_test_checks = 0;
+static int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+    host_test_checks++; \
+    if (!(cond)) { \
+        host_test_failures++; \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+// Like CHECK, with a printf-style explanation on failure
+#define CHECK_MSG(cond, ...) do { \
+    host_test_checks++; \
+    if (!(cond)) { \
+        host_test_failures++; \
+        printf("%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    int failures_before = host_test_failures; \
+    fn(); \
+    printf("%-44s %s\n", #fn, host_test_failures == failures_before ? "ok" : "FAILED"); \
+} while (0)
+
+static inline int host_test_finish(void)
+{
+    printf("%d checks, %d failed\n", host_test_checks, host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
+
+static inline int64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Small deterministic generator so runs are reproducible
+static inline uint32_t host_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Keeps the optimiser from discarding benchmark results
+static volatile int64_t host_bench_sink;
+
+#endif // _HOST_TEST_H_
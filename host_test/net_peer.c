@@ -0,0 +1,136 @@
+#include "net_peer.h"
+#include <string.h>
+#include "esp_timer.h"
+
+// The peer whose step is running, for the BLE callback
+static net_peer_t *stepping;
+
+static void start_race(net_peer_t *peer);
+static void step_race(net_peer_t *peer);
+static void handle_ble_event(uint8_t event_type, const uint8_t *data, uint16_t length);
+
+void net_peer_init(net_peer_t *peer, uint8_t player, const transport_t *transport, uint32_t race_frames)
+{
+    memset(peer, 0, sizeof(net_peer_t));
+    peer->player = player;
+    peer->race_frames = race_frames;
+    host_ble_init(&peer->ble, transport);
+}
+
+void net_peer_step(net_peer_t *peer, int64_t now_us)
+{
+    // The game's one protocol, BLE layer and clock become this peer's
+    protocol_select(&peer->protocol);
+    host_ble_select(&peer->ble);
+    host_timer_pin(now_us);
+    stepping = peer;
+    if (peer->steps++ == 0) {
+        // As game_loop_init, with the host decided up front
+        protocol_init(peer->player == 0);
+        ble_register_callback(handle_ble_event);
+    }
+
+    // As game_task_physics
+    ble_poll();
+    if (ble_is_connected()) {
+        protocol_clock_poll();
+        protocol_link_control(peer->racing, NET_PEER_STATE_RATE_HZ);
+        protocol_telemetry_poll();
+        if (peer->racing) {
+            step_race(peer);
+        }
+    }
+
+    // As game_task_network, every other step, then the flush after them
+    if (peer->racing && ble_is_connected() && peer->steps % (NET_PEER_RATE_HZ / NET_PEER_STATE_RATE_HZ) == 0) {
+        uint8_t packet[STATE_CODEC_MAX_PACKET];
+        size_t length = protocol_encode_game_state(&peer->world, peer->player, peer->rollback.frame, packet,
+                                                   sizeof(packet));
+        if (length > 0) {
+            ble_send_state_delta(packet, (uint16_t)length);
+        }
+    }
+    ble_flush();
+
+    host_timer_unpin();
+    stepping = NULL;
+    protocol_select(NULL);
+    host_ble_select(NULL);
+}
+
+// Both peers start frame 0 from the same world; player 0 is the host,
+// whose clock is the timeline
+static void start_race(net_peer_t *peer)
+{
+    race_fixture_setup_world(&peer->world);
+    rollback_init(&peer->rollback, &peer->world, peer->player, 1.0f / PHYSICS_RATE_HZ);
+    if (peer->player == 0) {
+        protocol_start_timeline();
+    }
+    protocol_set_rollback(&peer->rollback);
+    input_replay_record_init(&peer->recorder, peer->replay, sizeof(peer->replay), ROLLBACK_PLAYERS,
+                             NET_PEER_TRACK_ID, NET_PEER_RACE_SEED);
+    peer->racing = true;
+}
+
+// The rollback half of game_task_physics, stopping at race_frames
+static void step_race(net_peer_t *peer)
+{
+    rollback_t *rollback = &peer->rollback;
+
+    int frames = protocol_pace_frames(rollback->frame);
+    for (int advanced = 0; advanced < frames && rollback->frame < peer->race_frames; advanced++) {
+        if (rollback->frame == peer->next_input_frame) {
+            physics_input_t input = race_fixture_input(peer->player, rollback->frame);
+            rollback_add_local_input(rollback, &input);
+            protocol_store_frame_input(&input, rollback->frame);
+            peer->next_input_frame++;
+        }
+        if (!rollback_advance(rollback)) {
+            break;
+        }
+    }
+    // Past the line nothing is simulated, but late inputs still rewind
+    if (rollback->frame >= peer->race_frames && rollback->rollback_from != ROLLBACK_NO_FRAME) {
+        rollback_advance(rollback);
+    }
+    protocol_check_desync();
+
+    uint32_t frame;
+    uint64_t hash;
+    input_replay_record_rollback(&peer->recorder, rollback, peer->race_frames);
+    if (!peer->finished && rollback_confirmed_hash(rollback, &frame, &hash) && frame == peer->race_frames) {
+        peer->finished = true;
+        peer->final_hash = hash;
+        peer->replay_length = input_replay_record_finish(&peer->recorder, true, hash);
+    }
+
+    // A packet every step, stalled or finished, for acks and resends
+    uint8_t packet[INPUT_HISTORY_MAX_PACKET];
+    size_t length = protocol_encode_input_history(packet, sizeof(packet));
+    if (length) {
+        ble_send_input_history(packet, (uint16_t)length);
+    }
+}
+
+// As game_handle_ble_event; a connection starts the race before any of the
+// peer's frames is handled, and a reconnect mid-race carries on
+static void handle_ble_event(uint8_t event_type, const uint8_t *data, uint16_t length)
+{
+    net_peer_t *peer = stepping;
+
+    if (event_type == 0) {
+        if (!peer->racing) {
+            start_race(peer);
+        }
+    } else if (event_type == 1) {
+        peer->disconnects++;
+    } else if (event_type == 2 && data) {
+        state_codec_car_t state;
+        protocol_decode_game_state(data, length, &state);
+    } else if (event_type == 3 && data) {
+        protocol_decode_input_history(data, length);
+    } else if (event_type == 4 && data) {
+        protocol_handle_config(data, length);
+    }
+}
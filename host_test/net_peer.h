@@ -0,0 +1,56 @@
+#ifndef _NET_PEER_H_
+#define _NET_PEER_H_
+
+// One racer as game_task_physics and game_task_network run it: protocol.c
+// itself, over the host ble stand-in and any transport. The game loop is
+// bound to FreeRTOS and the display, so the race rigs drive this instead,
+// one per peer, each with its own protocol context and clock.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+#include "host_ble.h"
+#include "input_replay.h"
+#include "race_fixture.h"
+
+#define NET_PEER_RATE_HZ PHYSICS_RATE_HZ
+#define NET_PEER_STEP_US (1000000 / NET_PEER_RATE_HZ)
+#define NET_PEER_STATE_RATE_HZ 30          // The game's default net_update_rate
+#define NET_PEER_TRACK_ID 0
+#define NET_PEER_RACE_SEED 0x5eed
+#define NET_PEER_REPLAY_SIZE 8192
+
+typedef struct {
+    uint8_t player;
+    uint32_t race_frames;
+
+    // What the game keeps in statics: the protocol's context, the BLE
+    // layer's and the race
+    protocol_context_t protocol;
+    host_ble_t ble;
+    physics_world_t world;
+    rollback_t rollback;
+    uint32_t next_input_frame;
+    bool racing;
+
+    // Result: the confirmed state at race_frames, and the inputs that led
+    // there as a replay once finished
+    bool finished;
+    uint64_t final_hash;
+    input_replay_recorder_t recorder;
+    uint8_t replay[NET_PEER_REPLAY_SIZE];
+    size_t replay_length;
+
+    // Statistics
+    uint32_t steps;
+    uint32_t disconnects;
+} net_peer_t;
+
+void net_peer_init(net_peer_t *peer, uint8_t player, const transport_t *transport, uint32_t race_frames);
+
+// One physics step at now_us on the peer's clock: deliver what arrived,
+// start the race once connected, advance as the shared timeline says,
+// send a state packet at NET_PEER_STATE_RATE_HZ, and flush
+void net_peer_step(net_peer_t *peer, int64_t now_us);
+
+#endif // _NET_PEER_H_
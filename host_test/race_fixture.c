@@ -0,0 +1,106 @@
+#include "race_fixture.h"
+#include <string.h>
+
+#define MAP_SIZE 64
+#define HOLD_SHIFT 3                       // Script inputs change every 8 frames at most
+
+static uint8_t tiles[MAP_SIZE * MAP_SIZE];
+
+static void peer_tick(race_fixture_session_t *session, race_fixture_peer_t *peer, link_sim_t *out, int64_t now_us);
+
+void race_fixture_setup_world(physics_world_t *world)
+{
+    physics_tilemap_t map = { tiles, MAP_SIZE, MAP_SIZE, INT_TO_FIXED16(16) };
+    physics_set_tilemap(&map);
+    physics_set_centreline(NULL, 0);
+
+    memset(world, 0, sizeof(physics_world_t));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world->cars[i].mass = INT_TO_FIXED16(1000);
+        world->cars[i].position = (vec2_t){ INT_TO_FIXED16(480 + 40 * i), INT_TO_FIXED16(500) };
+    }
+    world->total_laps = 3;
+    physics_start_race(world);
+}
+
+physics_input_t race_fixture_input(uint8_t player, uint32_t frame)
+{
+    // Hash of the player and the hold period, so any frame can be asked for
+    uint32_t x = (frame >> HOLD_SHIFT) * 0x9e3779b9u ^ (uint32_t)(player + 1) * 0x85ebca6bu;
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return (physics_input_t){
+        .throttle = (uint8_t)(x % 101),
+        .brake = (uint8_t)((x >> 8) % 4 == 0 ? (x >> 10) % 101 : 0),
+        .steering = (int8_t)((int)((x >> 17) % 201) - 100),
+    };
+}
+
+void race_fixture_session_init(race_fixture_session_t *session, const race_fixture_protocol_t *protocol,
+                               const link_sim_config_t *config, uint32_t frames)
+{
+    memset(session, 0, sizeof(race_fixture_session_t));
+    session->protocol = protocol;
+    session->frames = frames;
+    for (int i = 0; i < 2; i++) {
+        race_fixture_peer_t *peer = &session->peers[i];
+        race_fixture_setup_world(&peer->world);
+        rollback_init(&peer->rollback, &peer->world, (uint8_t)i, RACE_FIXTURE_DT);
+
+        link_sim_config_t link = *config;
+        link.seed += (uint32_t)i;
+        link_sim_init(&session->links[i], &link);
+    }
+}
+
+void race_fixture_session_tick(race_fixture_session_t *session)
+{
+    int64_t now_us = (int64_t)session->tick * RACE_FIXTURE_TICK_US;
+    uint8_t packet[LINK_SIM_MAX_PACKET];
+    size_t length;
+
+    for (int i = 0; i < 2; i++) {
+        while ((length = link_sim_receive(&session->links[1 - i], now_us, packet)) > 0) {
+            session->protocol->receive(&session->peers[i], packet, length);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        peer_tick(session, &session->peers[i], &session->links[i], now_us);
+    }
+    session->tick++;
+}
+
+uint32_t race_fixture_session_confirmed(const race_fixture_session_t *session)
+{
+    uint32_t a = session->peers[0].rollback.confirmed_frame;
+    uint32_t b = session->peers[1].rollback.confirmed_frame;
+    return a < b ? a : b;
+}
+
+// One local input per frame, sent as soon as it is sampled; the protocol
+// may send on stalled ticks too
+static void peer_tick(race_fixture_session_t *session, race_fixture_peer_t *peer, link_sim_t *out, int64_t now_us)
+{
+    rollback_t *rollback = &peer->rollback;
+    physics_input_t input;
+    const physics_input_t *sampled = NULL;
+
+    if (rollback->frame == peer->next_input_frame && peer->next_input_frame < session->frames) {
+        input = race_fixture_input(rollback->local_player, rollback->frame);
+        rollback_add_local_input(rollback, &input);
+        sampled = &input;
+        peer->next_input_frame++;
+    }
+
+    uint8_t packet[LINK_SIM_MAX_PACKET];
+    size_t length = session->protocol->send(peer, sampled, packet);
+    if (length) {
+        link_sim_send(out, packet, length, now_us);
+    }
+    if (rollback->frame < session->frames) {
+        rollback_advance(rollback);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef _RACE_FIXTURE_H_
+#define _RACE_FIXTURE_H_
+
+// The world and scripted inputs every networked host test races with, and
+// a two-peer rollback session over link_sim for the rigs that exchange
+// inputs themselves rather than through net_peer and a transport.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "physics.h"
+#include "rollback.h"
+#include "link_sim.h"
+
+#define RACE_FIXTURE_DT (1.0f / PHYSICS_RATE_HZ)
+#define RACE_FIXTURE_TICK_US (1000000 / PHYSICS_RATE_HZ)
+
+// The world every race starts from, the host's one track
+void race_fixture_setup_world(physics_world_t *world);
+
+// Input a player holds at a frame; the same on every peer and process.
+// Held for up to 8 frames, so prediction by repetition is usually right
+// and sometimes wrong.
+physics_input_t race_fixture_input(uint8_t player, uint32_t frame);
+
+typedef struct {
+    physics_world_t world;
+    rollback_t rollback;
+    uint32_t next_input_frame;
+} race_fixture_peer_t;
+
+// How a session's peers talk. send fills packet (LINK_SIM_MAX_PACKET bytes)
+// with what the peer sends this tick and returns its length, 0 for
+// nothing; input is the local input sampled this tick, NULL if none was.
+// receive takes a packet from the other peer.
+typedef struct {
+    size_t (*send)(race_fixture_peer_t *peer, const physics_input_t *input, uint8_t *packet);
+    void (*receive)(race_fixture_peer_t *peer, const uint8_t *packet, size_t length);
+} race_fixture_protocol_t;
+
+typedef struct {
+    const race_fixture_protocol_t *protocol;
+    uint32_t frames;                       // Script frames each peer plays
+    race_fixture_peer_t peers[2];
+    link_sim_t links[2];                   // links[i] carries peer i's packets
+    uint32_t tick;
+} race_fixture_session_t;
+
+// Both peers at frame 0 of the fixture world; each link takes config, its
+// seed offset by the sending peer
+void race_fixture_session_init(race_fixture_session_t *session, const race_fixture_protocol_t *protocol,
+                               const link_sim_config_t *config, uint32_t frames);
+
+// One tick of RACE_FIXTURE_TICK_US: deliver what is due, then each peer
+// samples its next input, sends and advances a frame
+void race_fixture_session_tick(race_fixture_session_t *session);
+
+// Lowest frame both peers have confirmed up to
+uint32_t race_fixture_session_confirmed(const race_fixture_session_t *session);
+
+#endif // _RACE_FIXTURE_H_
@@ -0,0 +1,169 @@
+#include "host_ble.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "ble";
+
+static host_ble_t default_ble;
+static host_ble_t *ble = &default_ble;
+
+static bool ble_validate_connection(void);
+static void ble_deliver(void *context, transport_event_t event, const uint8_t *data, size_t length);
+static void ble_deliver_message(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length);
+static esp_err_t ble_send_message(frame_batch_kind_t kind, const void *data, uint16_t length);
+
+void host_ble_init(host_ble_t *context, const transport_t *transport)
+{
+    memset(context, 0, sizeof(host_ble_t));
+    context->transport = transport;
+    frame_batch_init(&context->tx, transport_frame_size(transport));
+    frame_batch_init(&context->rx, transport_frame_size(transport));
+}
+
+void host_ble_select(host_ble_t *context)
+{
+    ble = context ? context : &default_ble;
+}
+
+esp_err_t ble_send_state_delta(const uint8_t *data, uint16_t length)
+{
+    if (!data || length == 0 || length > BLE_PACKET_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ble_validate_connection()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ble_send_message(FRAME_BATCH_STATE, data, length);
+}
+
+esp_err_t ble_send_input_history(const uint8_t *data, uint16_t length)
+{
+    if (!data || length == 0 || length > BLE_PACKET_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ble_validate_connection()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ble_send_message(FRAME_BATCH_INPUT, data, length);
+}
+
+esp_err_t ble_send_config(const config_packet_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ble_validate_connection()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ble_send_message(FRAME_BATCH_EVENT, config, sizeof(config_packet_t));
+}
+
+void ble_flush(void)
+{
+    uint8_t frame[FRAME_BATCH_MAX_SIZE];
+    size_t length;
+
+    frame_batch_set_capacity(&ble->tx, transport_frame_size(ble->transport));
+    while ((length = frame_batch_next(&ble->tx, frame)) > 0) {
+        if (transport_send(ble->transport, frame, length)) {
+            ble->frames_sent++;
+            ble->bytes_sent += (uint32_t)length;
+        }
+    }
+}
+
+void ble_poll(void)
+{
+    transport_poll(ble->transport, ble_deliver, NULL);
+}
+
+void ble_set_transport(const transport_t *transport)
+{
+    ble->transport = transport;
+}
+
+bool ble_is_connected(void)
+{
+    return transport_connected(ble->transport);
+}
+
+void ble_register_callback(ble_event_callback_t callback)
+{
+    ble->callback = callback;
+}
+
+// The link is simulated whole by the transport
+void ble_update_connection_parameters(uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+}
+
+void ble_set_phy(uint8_t phy)
+{
+}
+
+static bool ble_validate_connection(void)
+{
+    if (!transport_connected(ble->transport)) {
+        ESP_LOGW(TAG, "%s transport not connected", ble->transport->ops->name);
+        return false;
+    }
+    return true;
+}
+
+static void ble_deliver(void *context, transport_event_t event, const uint8_t *data, size_t length)
+{
+    switch (event) {
+        case TRANSPORT_CONNECTED:
+            if (ble->callback) {
+                ble->callback(0, NULL, 0);
+            }
+            break;
+
+        case TRANSPORT_DISCONNECTED:
+            if (ble->callback) {
+                ble->callback(1, NULL, 0);
+            }
+            break;
+
+        case TRANSPORT_FRAME:
+            frame_batch_decode(&ble->rx, data, length, ble_deliver_message, NULL);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void ble_deliver_message(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length)
+{
+    if (!ble->callback) {
+        return;
+    }
+
+    switch (kind) {
+        case FRAME_BATCH_STATE:
+            ble->callback(2, data, (uint16_t)length);
+            break;
+
+        case FRAME_BATCH_INPUT:
+            ble->callback(3, data, (uint16_t)length);
+            break;
+
+        case FRAME_BATCH_EVENT:
+            if (length == sizeof(config_packet_t)) {
+                ble->callback(4, data, (uint16_t)length);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static esp_err_t ble_send_message(frame_batch_kind_t kind, const void *data, uint16_t length)
+{
+    if (!frame_batch_add(&ble->tx, kind, data, length)) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,27 @@
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <time.h>
+
+static bool pinned;
+static int64_t pinned_us;
+
+int64_t esp_timer_get_time(void)
+{
+    if (pinned) {
+        return pinned_us;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void host_timer_pin(int64_t now_us)
+{
+    pinned = true;
+    pinned_us = now_us;
+}
+
+void host_timer_unpin(void)
+{
+    pinned = false;
+}
@@ -0,0 +1,16 @@
+#ifndef _HOST_ESP_TIMER_H_
+#define _HOST_ESP_TIMER_H_
+
+// Host stand-in for esp_timer_get_time: CLOCK_MONOTONIC in microseconds,
+// or a simulated clock while one is pinned
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+// Until unpinned, esp_timer_get_time returns now_us; rigs stepping a
+// peer on its own simulated clock pin it for the step
+void host_timer_pin(int64_t now_us);
+void host_timer_unpin(void);
+
+#endif // _HOST_ESP_TIMER_H_
@@ -0,0 +1,30 @@
+#ifndef _HOST_BLE_H_
+#define _HOST_BLE_H_
+
+// Host stand-in for ble.c's transport half: ble_send_* queue messages into
+// frame_batch frames, ble_flush sends them over the transport set with
+// ble_set_transport, and ble_poll hands what arrived to the registered
+// callback as ble.c's events. There is no NimBLE backend, so a transport
+// must be set before any of it is used.
+//
+// Everything ble.c keeps in statics lives in a host_ble_t, so two peers
+// can share a process: select each one's before its step.
+
+#include "ble.h"
+
+typedef struct {
+    const transport_t *transport;
+    ble_event_callback_t callback;
+    frame_batch_t tx;
+    frame_batch_t rx;
+
+    // Statistics
+    uint32_t frames_sent;
+    uint32_t bytes_sent;
+} host_ble_t;
+
+// Zeroes context and sizes its batches for the transport
+void host_ble_init(host_ble_t *context, const transport_t *transport);
+void host_ble_select(host_ble_t *context);
+
+#endif // _HOST_BLE_H_
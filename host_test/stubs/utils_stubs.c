@@ -0,0 +1,22 @@
+#include "utils.h"
+
+// utils.c needs FreeRTOS and the heap allocator; the host build takes just
+// the checksum protocol.c packs its legacy packets with, the same CRC-16
+// (Modbus: 0xFFFF, reflected 0xA001)
+uint16_t crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x0001) {
+                crc = (crc >> 1) ^ 0xA001;
+            } else {
+                crc = crc >> 1;
+            }
+        }
+    }
+
+    return crc;
+}
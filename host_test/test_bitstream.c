@@ -0,0 +1,87 @@
+// Bit packing: random field widths round trip, sign extension, zigzag and
+// overflow on both ends
+#include "host_test.h"
+#include "bitstream.h"
+#include <string.h>
+
+#define FIELDS 2000
+
+static void test_random_round_trip(void) {
+    static uint8_t buffer[FIELDS * 4];
+    static uint32_t values[FIELDS];
+    static unsigned widths[FIELDS];
+    uint32_t rng = 12345;
+    bit_writer_t writer;
+    bit_reader_t reader;
+
+    bit_writer_init(&writer, buffer, sizeof(buffer));
+    size_t total = 0;
+    for (int i = 0; i < FIELDS; i++) {
+        widths[i] = host_rand(&rng) % 33;
+        values[i] = widths[i] == 32 ? host_rand(&rng) : host_rand(&rng) & ((1u << widths[i]) - 1);
+        bit_write(&writer, values[i], widths[i]);
+        total += widths[i];
+    }
+    CHECK(!writer.overflow);
+    CHECK(writer.bit == total);
+    CHECK(bit_writer_bytes(&writer) == (total + 7) / 8);
+
+    bit_reader_init(&reader, buffer, bit_writer_bytes(&writer));
+    int mismatches = 0;
+    for (int i = 0; i < FIELDS; i++) {
+        if (bit_read(&reader, widths[i]) != values[i]) mismatches++;
+    }
+    CHECK(mismatches == 0);
+    CHECK(!reader.overflow);
+}
+
+static void test_layout_and_signs(void) {
+    uint8_t buffer[4];
+    bit_writer_t writer;
+    bit_reader_t reader;
+
+    // MSB first, high bits of a value are dropped
+    bit_writer_init(&writer, buffer, sizeof(buffer));
+    bit_write(&writer, 1, 1);
+    bit_write(&writer, 0xff5, 4);
+    bit_write(&writer, (uint32_t)-3, 6);
+    CHECK(buffer[0] == 0xaf && buffer[1] == 0xa0);
+
+    bit_reader_init(&reader, buffer, 2);
+    CHECK(bit_read(&reader, 1) == 1);
+    CHECK(bit_read(&reader, 4) == 5);
+    CHECK(bit_read_signed(&reader, 6) == -3);
+
+    for (int32_t v = -70000; v <= 70000; v += 7) {
+        CHECK(zigzag_decode(zigzag_encode(v)) == v);
+    }
+    CHECK(zigzag_encode(0) == 0 && zigzag_encode(-1) == 1 && zigzag_encode(1) == 2);
+    CHECK(zigzag_decode(zigzag_encode(INT32_MIN)) == INT32_MIN);
+    CHECK(bit_width(0) == 0 && bit_width(1) == 1 && bit_width(255) == 8 && bit_width(UINT32_MAX) == 32);
+}
+
+static void test_overflow(void) {
+    uint8_t buffer[2];
+    bit_writer_t writer;
+    bit_reader_t reader;
+
+    bit_writer_init(&writer, buffer, sizeof(buffer));
+    bit_write(&writer, 0x1ff, 9);
+    CHECK(!writer.overflow);
+    bit_write(&writer, 0xff, 8);
+    CHECK(writer.overflow);
+    CHECK(writer.bit == 9);
+
+    bit_reader_init(&reader, buffer, sizeof(buffer));
+    CHECK(bit_read(&reader, 12) == 0xff8);
+    CHECK(!reader.overflow);
+    CHECK(bit_read(&reader, 5) == 0);
+    CHECK(reader.overflow);
+}
+
+int main(void) {
+    RUN_TEST(test_random_round_trip);
+    RUN_TEST(test_layout_and_signs);
+    RUN_TEST(test_overflow);
+    return host_test_finish();
+}
@@ -0,0 +1,113 @@
+// Sweep-and-prune broadphase against brute force, built with 256 cars
+#include "host_test.h"
+#include "physics.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(PHYSICS_MAX_CARS == 256, "built with -DPHYSICS_MAX_CARS=256");
+
+static car_physics_t cars[PHYSICS_MAX_CARS];
+static uint8_t sweep_hit[PHYSICS_MAX_CARS][PHYSICS_MAX_CARS];
+
+static bool brute_overlap(const car_physics_t *a, const car_physics_t *b) {
+    int64_t dx = (int64_t)a->position.x - b->position.x;
+    int64_t dy = (int64_t)a->position.y - b->position.y;
+    if (dx < 0) dx = -dx;
+    if (dy < 0) dy = -dy;
+    return dx < PHYSICS_CAR_COLLISION_DISTANCE && dy < PHYSICS_CAR_COLLISION_DISTANCE;
+}
+
+static bool mark_pair(uint8_t a, uint8_t b, void *context) {
+    int *duplicates = (int *)context;
+    if (a >= b || sweep_hit[a][b]) (*duplicates)++;
+    sweep_hit[a][b] = 1;
+    return true;
+}
+
+static void check_against_brute_force(physics_broadphase_t *broadphase, int count) {
+    memset(sweep_hit, 0, sizeof(sweep_hit));
+    int duplicates = 0;
+    int found = physics_sweep_car_pairs(broadphase, cars, count, mark_pair, &duplicates);
+    CHECK(duplicates == 0);
+
+    int expected = 0, missing = 0, extra = 0;
+    for (int a = 0; a < count; a++) {
+        for (int b = a + 1; b < count; b++) {
+            bool overlap = brute_overlap(&cars[a], &cars[b]);
+            expected += overlap;
+            missing += overlap && !sweep_hit[a][b];
+            extra += !overlap && sweep_hit[a][b];
+        }
+    }
+    CHECK_MSG(found == expected && missing == 0 && extra == 0,
+              "%d cars: found %d expected %d (missing %d, extra %d)", count, found, expected, missing, extra);
+}
+
+static void scatter(uint32_t *rng, int count, int32_t spread) {
+    for (int i = 0; i < count; i++) {
+        cars[i].position.x = (fixed16_t)(host_rand(rng) % (uint32_t)spread) - spread / 2;
+        cars[i].position.y = (fixed16_t)(host_rand(rng) % (uint32_t)spread) - spread / 2;
+    }
+}
+
+static void test_matches_brute_force(void) {
+    static const int counts[] = { 2, 3, 32, 100, 256 };
+    uint32_t rng = 5;
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        physics_broadphase_t broadphase = { 0 };
+        int count = counts[c];
+        scatter(&rng, count, INT_TO_FIXED16(2000));
+
+        // Jitter the cars between steps so the incremental sort is exercised
+        for (int step = 0; step < 50; step++) {
+            check_against_brute_force(&broadphase, count);
+            for (int i = 0; i < count; i++) {
+                cars[i].position.x += (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(40)) - INT_TO_FIXED16(20);
+                cars[i].position.y += (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(40)) - INT_TO_FIXED16(20);
+            }
+        }
+    }
+}
+
+static void test_extreme_positions_do_not_wrap(void) {
+    physics_broadphase_t broadphase = { 0 };
+
+    // 32-bit differences between these wrap around to small values
+    cars[0].position = (vec2_t){ INT32_MIN + 10, 0 };
+    cars[1].position = (vec2_t){ INT32_MAX - 10, 0 };
+    cars[2].position = (vec2_t){ 0, INT32_MIN + 10 };
+    cars[3].position = (vec2_t){ 0, INT32_MAX - 10 };
+    check_against_brute_force(&broadphase, 4);
+    CHECK(!physics_check_car_collision(&cars[0], &cars[1]));
+    CHECK(!physics_check_car_collision(&cars[2], &cars[3]));
+
+    cars[1].position = (vec2_t){ INT32_MIN + 20, 0 };
+    check_against_brute_force(&broadphase, 4);
+    CHECK(physics_check_car_collision(&cars[0], &cars[1]));
+}
+
+static void test_find_pairs_respects_capacity(void) {
+    physics_broadphase_t broadphase = { 0 };
+    for (int i = 0; i < 8; i++) {
+        cars[i].position = (vec2_t){ INT_TO_FIXED16(i), 0 };
+    }
+
+    physics_car_pair_t pairs[5];
+    CHECK(physics_find_car_pairs(&broadphase, cars, 8, pairs, 5) == 5);
+    physics_car_pair_t all[28];
+    CHECK(physics_find_car_pairs(&broadphase, cars, 8, all, 28) == 28);
+    for (int i = 0; i < 28; i++) {
+        CHECK(all[i].a < all[i].b);
+    }
+}
+
+int main(void) {
+    physics_init();
+
+    RUN_TEST(test_matches_brute_force);
+    RUN_TEST(test_extreme_positions_do_not_wrap);
+    RUN_TEST(test_find_pairs_respects_capacity);
+
+    return host_test_finish();
+}
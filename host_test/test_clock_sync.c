@@ -0,0 +1,223 @@
+// Clock sync: two devices with unrelated, drifting clocks ping each other
+// over a jittery, lossy link. The non-reference side must track the
+// reference clock to well under a frame, and pacing must keep both
+// simulations on the shared frame timeline.
+#include "host_test.h"
+#include "clock_sync.h"
+#include "link_sim.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_RATE 60
+#define STEP_US 500                 // True-time resolution of the simulation
+
+// A device clock: local = base + true * (1 + ppm / 1e6)
+typedef struct {
+    int64_t base_us;
+    double ppm;
+} device_clock_t;
+
+static int64_t device_time(const device_clock_t *clock, int64_t true_us) {
+    return clock->base_us + true_us + (int64_t)((double)true_us * clock->ppm / 1e6);
+}
+
+static void send_message(link_sim_t *link, int64_t true_us, const clock_sync_message_t *message) {
+    uint8_t data[CLOCK_SYNC_PACKET_SIZE];
+    clock_sync_encode(message, data);
+    link_sim_send(link, data, sizeof(data), true_us);
+}
+
+typedef struct {
+    device_clock_t clock;
+    clock_sync_t sync;
+    link_sim_t *out;
+    // Simulation paced to the shared timeline
+    bool racing;
+    bool paced;
+    uint32_t frame;
+    int64_t next_tick_local_us;
+} device_t;
+
+// Link times are true time
+static void deliver(link_sim_t *link, int64_t true_us, device_t *to) {
+    uint8_t data[LINK_SIM_MAX_PACKET];
+    size_t length;
+    while ((length = link_sim_receive(link, true_us, data)) > 0) {
+        clock_sync_message_t message, reply;
+        CHECK(clock_sync_decode(data, length, &message));
+        if (clock_sync_handle(&to->sync, &message, device_time(&to->clock, true_us), &reply)) {
+            send_message(to->out, true_us, &reply);
+        }
+    }
+}
+
+static void device_step(device_t *device, int64_t true_us) {
+    int64_t now = device_time(&device->clock, true_us);
+    clock_sync_message_t ping;
+    if (clock_sync_poll(&device->sync, now, &ping)) {
+        send_message(device->out, true_us, &ping);
+    }
+    // 60 Hz ticks on the device's own clock
+    if (device->racing && now >= device->next_tick_local_us) {
+        device->next_tick_local_us += 1000000 / FRAME_RATE;
+        device->frame += device->paced ? (uint32_t)clock_sync_pace(&device->sync, device->frame, now) : 1;
+    }
+}
+
+static device_t host, client;
+static link_sim_t to_client, to_host;
+
+static void setup(double host_ppm, double client_ppm, uint32_t jitter_us, uint32_t loss_percent, bool paced) {
+    memset(&host, 0, sizeof(host));
+    memset(&client, 0, sizeof(client));
+
+    // Unrelated clocks: boot times 17 minutes apart
+    host.clock = (device_clock_t){ 1000000000ll, host_ppm };
+    client.clock = (device_clock_t){ 23456789ll, client_ppm };
+    clock_sync_init(&host.sync, true, FRAME_RATE);
+    clock_sync_init(&client.sync, false, FRAME_RATE);
+    host.out = &to_client;
+    client.out = &to_host;
+    host.paced = client.paced = paced;
+
+    // 4 ms each way plus queueing
+    link_sim_config_t link = { .latency_us = 4000, .jitter_us = jitter_us, .loss_percent = loss_percent };
+    link.seed = 0x2468aceu;
+    link_sim_init(&to_client, &link);
+    link.seed = 0x1357bdfu;
+    link_sim_init(&to_host, &link);
+}
+
+static void run_until(int64_t *true_us, int64_t end_us) {
+    for (; *true_us < end_us; *true_us += STEP_US) {
+        deliver(&to_client, *true_us, &client);
+        deliver(&to_host, *true_us, &host);
+        device_step(&host, *true_us);
+        device_step(&client, *true_us);
+    }
+}
+
+static int64_t offset_error(int64_t true_us) {
+    int64_t truth = device_time(&host.clock, true_us);
+    return clock_sync_reference_time(&client.sync, device_time(&client.clock, true_us)) - truth;
+}
+
+static void test_message_round_trip(void) {
+    clock_sync_message_t message = { CLOCK_SYNC_PONG, 200, 0xdeadbeef, (1ll << 47) + 12345 }, decoded;
+    uint8_t buffer[CLOCK_SYNC_PACKET_SIZE];
+
+    clock_sync_encode(&message, buffer);
+    CHECK(clock_sync_decode(buffer, sizeof(buffer), &decoded));
+    CHECK(decoded.type == message.type && decoded.sequence == message.sequence);
+    CHECK(decoded.origin_us == message.origin_us && decoded.time_us == message.time_us);
+
+    // Game configuration and short packets are not clock messages
+    buffer[0] = 1;
+    CHECK(!clock_sync_decode(buffer, sizeof(buffer), &decoded));
+    buffer[0] = CLOCK_SYNC_PING;
+    CHECK(!clock_sync_decode(buffer, sizeof(buffer) - 1, &decoded));
+}
+
+static void test_exchange_without_jitter(void) {
+    // Fixed 4 ms each way: one round trip gives the exact offset
+    setup(0, 0, 0, 0, false);
+    int64_t true_us = 0;
+    CHECK(!client.sync.synced);
+    CHECK(clock_sync_reference_time(&client.sync, 777) == 777);
+    run_until(&true_us, 100000);
+    CHECK(client.sync.synced && host.sync.synced);
+    CHECK(client.sync.rtt_us == 8000);
+    CHECK(llabs(offset_error(true_us)) <= STEP_US);
+    CHECK(client.sync.offset_us == -host.sync.offset_us);
+}
+
+static void test_skewed_drifting_clocks(void) {
+    // 250 ppm apart, 0..6 ms queueing each way, 5% loss
+    setup(100, -150, 6000, 5, false);
+    int64_t true_us = 0;
+
+    // First estimate within a second
+    run_until(&true_us, 1000000);
+    CHECK(client.sync.synced);
+    int64_t first_error = llabs(offset_error(true_us));
+    CHECK_MSG(first_error < 3000, "error %lld us after 1 s", (long long)first_error);
+
+    // Settled: tracked to an eighth of a frame for ten minutes, though the
+    // clocks drift 150 ms apart over that time
+    run_until(&true_us, 30000000);
+    int64_t max_error = 0, total_error = 0;
+    int samples = 0;
+    while (true_us < 630000000) {
+        run_until(&true_us, true_us + 100000);
+        int64_t error = llabs(offset_error(true_us));
+        if (error > max_error) max_error = error;
+        total_error += error;
+        samples++;
+    }
+    printf("  250 ppm, 4+0..6 ms, 5%% loss: offset error mean %lld us, max %lld us; skew %.0f ppm; rtt %u us\n",
+           (long long)(total_error / samples), (long long)max_error, client.sync.skew_ppm, client.sync.rtt_us);
+    CHECK_MSG(max_error < 2000, "max error %lld us", (long long)max_error);
+    CHECK(total_error / samples < 600);
+    // Client clock runs slow against the host: the offset grows
+    CHECK(client.sync.skew_valid);
+    CHECK_MSG(fabsf(client.sync.skew_ppm - 250.0f) < 50.0f, "skew %.1f ppm", client.sync.skew_ppm);
+    // The window's quickest round trip: 8 ms plus a little queueing
+    CHECK(client.sync.rtt_us >= 8000 && client.sync.rtt_us < 14000);
+    CHECK(client.sync.samples_rejected == 0);
+}
+
+// Frames the client simulation is ahead of the host's
+static int32_t frame_gap(void) {
+    return (int32_t)(client.frame - host.frame);
+}
+
+static int32_t run_race(bool paced, int32_t *max_gap_after_settling) {
+    setup(100, -400, 8000, 5, paced);
+    int64_t true_us = 0;
+    run_until(&true_us, 2000000);
+
+    // The host starts the race; the client starts 300 ms (18 frames) late
+    host.racing = true;
+    host.next_tick_local_us = device_time(&host.clock, true_us);
+    clock_sync_start_timeline(&host.sync, host.next_tick_local_us);
+    run_until(&true_us, 2300000);
+    client.racing = true;
+    client.next_tick_local_us = device_time(&client.clock, true_us);
+
+    int32_t max_gap = 0;
+    run_until(&true_us, 20000000);
+    while (true_us < 602000000) {
+        run_until(&true_us, true_us + 50000);
+        int32_t gap = abs(frame_gap());
+        if (gap > max_gap) max_gap = gap;
+    }
+    *max_gap_after_settling = max_gap;
+    return frame_gap();
+}
+
+static void test_pacing_on_shared_timeline(void) {
+    int32_t free_gap, paced_gap, free_max, paced_max;
+
+    free_gap = run_race(false, &free_max);
+    paced_gap = run_race(true, &paced_max);
+    printf("  500 ppm apart, client 18 frames late: unpaced gap %d frames after 10 min, paced gap %d (max %d)\n",
+           free_gap, paced_gap, paced_max);
+    printf("  client paced %u frames added, %u skipped; host %u added, %u skipped\n", client.sync.frames_added,
+           client.sync.frames_skipped, host.sync.frames_added, host.sync.frames_skipped);
+
+    // Unpaced, the late start stays and drift adds half a minute's worth
+    CHECK(free_gap < -30);
+    // Paced, both stay within the pacing threshold of each other
+    CHECK_MSG(paced_max <= CLOCK_SYNC_PACE_START + 1, "max gap %d", paced_max);
+    CHECK(client.sync.frames_added > 18);
+    CHECK(client.sync.epoch_valid && client.sync.epoch_us == host.sync.epoch_us);
+}
+
+int main(void) {
+    RUN_TEST(test_message_round_trip);
+    RUN_TEST(test_exchange_without_jitter);
+    RUN_TEST(test_skewed_drifting_clocks);
+    RUN_TEST(test_pacing_on_shared_timeline);
+    return host_test_finish();
+}
@@ -0,0 +1,214 @@
+// Connection parameter controller against a scripted link: the RTT grows
+// with the connection interval, congestion adds queueing, interference
+// costs more on 2M PHY than on 1M. Menus must get the power-saving
+// profile, races the loosest interval that keeps RTT in its band, and the
+// controller must settle rather than oscillate.
+#include "host_test.h"
+#include "conn_control.h"
+#include "link_sim.h"
+#include <string.h>
+
+#define TICK_US 100000
+#define APPLY_DELAY_US 300000       // Peer takes this long to accept an update
+#define FRAME_RATE 60
+
+// The link as the script makes it
+typedef struct {
+    bool racing;
+    uint32_t base_us;               // RTT besides the interval
+    uint32_t jitter_us;             // Plus up to this much per sample
+    uint32_t loss_2m_percent;
+    uint32_t loss_1m_percent;
+    uint16_t update_rate_hz;
+} phase_t;
+
+typedef struct {
+    conn_control_t control;
+    conn_control_params_t applied;
+    conn_control_params_t pending;
+    int64_t pending_at_us;
+    bool has_pending;
+    int64_t now_us;
+    link_sim_t frames;              // Input frames; the latency is in the RTT
+    uint32_t delivered;
+    uint32_t rng;
+    double radio_events;            // Connection events the peripheral attends
+} link_t;
+
+// RTT of the interval as applied: about two and a half intervals (waiting
+// for the next event each way, then the reply) plus the script's base
+static uint32_t link_rtt(link_t *link, const phase_t *phase) {
+    return link->applied.interval * 1250 * 5 / 2 + phase->base_us + host_rand(&link->rng) % (phase->jitter_us + 1);
+}
+
+static void run_phase(link_t *link, const phase_t *phase, uint32_t seconds) {
+    int64_t end_us = link->now_us + (int64_t)seconds * 1000000;
+    for (; link->now_us < end_us; link->now_us += TICK_US) {
+        if (link->has_pending && link->now_us >= link->pending_at_us) {
+            link->applied = link->pending;
+            link->has_pending = false;
+        }
+
+        // A tick's worth of input frames, each lost first time at the
+        // PHY's rate and recovered by the next packet
+        link->frames.config.loss_percent =
+            link->applied.phy == CONN_CONTROL_PHY_2M ? phase->loss_2m_percent : phase->loss_1m_percent;
+        for (int i = 0; i < FRAME_RATE * TICK_US / 1000000; i++) {
+            uint8_t frame[LINK_SIM_MAX_PACKET] = {0};
+            link_sim_send(&link->frames, frame, 1, link->now_us);
+            link_sim_receive(&link->frames, link->now_us, frame);
+            link->delivered++;
+        }
+        if (link->applied.interval) {
+            link->radio_events += (double)TICK_US / (link->applied.interval * 1250.0 * (1 + link->applied.latency));
+        }
+
+        conn_control_input_t input = {
+            .racing = phase->racing,
+            .rtt_us = link->applied.interval ? link_rtt(link, phase) : 0,
+            .frames_delivered = link->delivered,
+            .frames_recovered = link->frames.lost,
+            .update_rate_hz = phase->update_rate_hz,
+        };
+        conn_control_params_t params;
+        if (conn_control_update(&link->control, &input, link->now_us, &params)) {
+            link->pending = params;
+            link->pending_at_us = link->now_us + APPLY_DELAY_US;
+            link->has_pending = true;
+        }
+    }
+}
+
+static void setup(link_t *link) {
+    memset(link, 0, sizeof(link_t));
+    link->rng = 0xc0ffee;
+    link_sim_init(&link->frames, &(link_sim_config_t){ .seed = 0xbadcafe });
+    conn_control_init(&link->control);
+}
+
+static void test_menu_and_race_profiles(void) {
+    link_t link;
+    setup(&link);
+
+    phase_t menu = { .racing = false, .base_us = 8000, .jitter_us = 2000, .update_rate_hz = 30 };
+    run_phase(&link, &menu, 10);
+    CHECK(link.applied.interval == CONN_CONTROL_IDLE_INTERVAL);
+    CHECK(link.applied.latency == CONN_CONTROL_IDLE_LATENCY);
+    CHECK(link.applied.timeout == CONN_CONTROL_TIMEOUT);
+    CHECK(link.control.requests == 1);
+
+    // Racing starts tight and on 2M straight away
+    phase_t race = { .racing = true, .base_us = 8000, .jitter_us = 2000, .update_rate_hz = 30 };
+    run_phase(&link, &race, 1);
+    CHECK(link.applied.interval == conn_control_race_interval(0));
+    CHECK(link.applied.latency == 0 && link.applied.phy == CONN_CONTROL_PHY_2M);
+
+    // And back at once when it ends
+    run_phase(&link, &menu, 1);
+    CHECK(link.applied.interval == CONN_CONTROL_IDLE_INTERVAL);
+    CHECK(link.control.requests == 3);
+}
+
+static void test_update_rate_ceiling(void) {
+    link_t link;
+    setup(&link);
+
+    // A quick link relaxes until the RTT is in its band
+    phase_t quick = { .racing = true, .base_us = 0, .jitter_us = 2000, .update_rate_hz = 10 };
+    run_phase(&link, &quick, 120);
+    CHECK_MSG(link.control.level == 2, "level %u", link.control.level);  // 15 ms: 37.5 ms RTT is in the band
+
+    // Even faster: nothing but the interval in the RTT
+    conn_control_t control;
+    conn_control_params_t params;
+    conn_control_init(&control);
+    conn_control_input_t input = { .racing = true, .rtt_us = 10000, .update_rate_hz = 10 };
+    int64_t now = 0;
+    for (; now < 200000000; now += TICK_US) {
+        input.frames_delivered += 6;
+        conn_control_update(&control, &input, now, &params);
+    }
+    CHECK(control.level == CONN_CONTROL_RACE_LEVELS - 1);
+    CHECK(params.interval == 24);
+
+    // 60 Hz updates cannot wait 30 ms: down to 15 ms at the next period,
+    // without waiting out the hold
+    input.update_rate_hz = 60;
+    bool requested = false;
+    for (int64_t end = now + CONN_CONTROL_PERIOD_US + TICK_US; now < end; now += TICK_US) {
+        input.frames_delivered += 6;
+        requested |= conn_control_update(&control, &input, now, &params);
+    }
+    CHECK(requested && params.interval == 12);
+}
+
+static void test_scripted_race(void) {
+    link_t link;
+    setup(&link);
+    const phase_t phases[] = {
+        { false, 8000, 2000, 0, 0, 30 },      // Menus
+        { true, 8000, 2000, 0, 0, 30 },       // Clean race: relaxes one step
+        { true, 40000, 2000, 0, 0, 30 },      // Congestion: back to the tightest
+        { true, 8000, 2000, 0, 0, 30 },       // Clear again
+        { true, 8000, 2000, 15, 4, 30 },      // Interference: 1M PHY
+        { true, 8000, 2000, 0, 0, 30 },       // Clean: 2M again
+        { false, 8000, 2000, 0, 0, 30 },      // Results and menus
+    };
+    const uint32_t seconds[] = { 10, 60, 40, 60, 40, 60, 10 };
+    conn_control_params_t ends[7];
+    uint32_t requests[7];
+    double events[7];
+
+    for (int i = 0; i < 7; i++) {
+        double events_before = link.radio_events;
+        run_phase(&link, &phases[i], seconds[i]);
+        ends[i] = link.applied;
+        requests[i] = link.control.requests;
+        events[i] = (link.radio_events - events_before) / seconds[i];
+        printf("  phase %d: interval %5.2f ms, latency %u, %s PHY, loss %2u%%, %3u requests, %5.1f events/s\n", i,
+               ends[i].interval * 1.25, ends[i].latency, ends[i].phy == CONN_CONTROL_PHY_2M ? "2M" : "1M",
+               link.control.loss_percent, requests[i], events[i]);
+    }
+
+    CHECK(ends[0].interval == CONN_CONTROL_IDLE_INTERVAL && ends[0].latency == CONN_CONTROL_IDLE_LATENCY);
+    // 7.5 ms gives 27 ms RTT, under the band; 10 ms gives 33, inside it
+    CHECK(ends[1].interval == conn_control_race_interval(1) && ends[1].phy == CONN_CONTROL_PHY_2M);
+    CHECK(ends[2].interval == conn_control_race_interval(0));
+    CHECK(ends[3].interval == conn_control_race_interval(1));
+    CHECK(ends[4].phy == CONN_CONTROL_PHY_1M);
+    CHECK(ends[5].phy == CONN_CONTROL_PHY_2M && ends[5].interval == conn_control_race_interval(1));
+    CHECK(ends[6].interval == CONN_CONTROL_IDLE_INTERVAL);
+
+    // One step per disturbance, and nothing once settled
+    CHECK(requests[1] - requests[0] == 2);      // Race start, then one step looser
+    CHECK(requests[2] - requests[1] == 1);
+    CHECK(requests[3] - requests[2] == 1);
+    CHECK(requests[4] - requests[3] == 1);
+    CHECK(requests[5] - requests[4] == 1);
+    CHECK(requests[6] - requests[5] == 1);
+
+    // The menus attend a fraction of the events a race does
+    CHECK(events[0] * 10 < events[1]);
+}
+
+static void test_no_oscillation_on_noisy_link(void) {
+    link_t link;
+    setup(&link);
+
+    // RTT samples anywhere from 19 to 59 ms at 7.5 ms, crossing both band
+    // edges all the time; loss around both of its thresholds too
+    phase_t noisy = { .racing = true, .base_us = 0, .jitter_us = 40000, .loss_2m_percent = 6,
+                      .loss_1m_percent = 6, .update_rate_hz = 30 };
+    run_phase(&link, &noisy, 600);
+    printf("  noisy link for 10 min: %u requests, %u tighter, %u looser, %u PHY changes\n",
+           link.control.requests, link.control.tightened, link.control.loosened, link.control.phy_changes);
+    CHECK(link.control.requests <= 5);
+}
+
+int main(void) {
+    RUN_TEST(test_menu_and_race_profiles);
+    RUN_TEST(test_update_rate_ceiling);
+    RUN_TEST(test_scripted_race);
+    RUN_TEST(test_no_oscillation_on_noisy_link);
+    return host_test_finish();
+}
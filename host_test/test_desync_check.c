@@ -0,0 +1,106 @@
+// Desync checks: two peers simulating the same race agree on every frame
+// they both confirm, whichever lags; one fixed-point step of drift in one
+// world is caught at the first shared frame after it, and repeats are not
+// recounted.
+#include "host_test.h"
+#include "desync_check.h"
+#include "world_state.h"
+#include <string.h>
+
+#define DT (1.0f / 60.0f)
+#define FRAMES 600
+
+static physics_world_t worlds[2];
+
+static void setup_world(physics_world_t *world) {
+    memset(world, 0, sizeof(physics_world_t));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world->cars[i].mass = INT_TO_FIXED16(1000);
+        world->cars[i].position = (vec2_t){ INT_TO_FIXED16(40 * i), 0 };
+    }
+    physics_start_race(world);
+}
+
+// Both peers step the same world; each confirms in jumps of 1-4 frames and
+// sends its confirmed hash every third frame. Peer 1's world is nudged at
+// drift_frame, if below FRAMES.
+static void run_race(desync_check_t checks[2], uint32_t drift_frame) {
+    uint32_t rng = 11;
+    uint32_t confirmed[2] = { 0, 0 };
+    uint32_t hashes[2][FRAMES + 1];
+
+    for (int p = 0; p < 2; p++) {
+        setup_world(&worlds[p]);
+        desync_check_init(&checks[p]);
+    }
+    for (uint32_t frame = 0; frame <= FRAMES; frame++) {
+        for (int p = 0; p < 2; p++) {
+            if (frame == drift_frame && p == 1) worlds[p].cars[0].position.x += 1;
+            hashes[p][frame] = (uint32_t)world_state_hash_world(&worlds[p], frame);
+            physics_input_t input = { .throttle = 80, .steering = (int8_t)(frame / 60) };
+            physics_apply_input(&worlds[p].cars[0], &input, DT);
+            physics_update(&worlds[p], DT);
+        }
+        for (int p = 0; p < 2; p++) {
+            uint32_t next = confirmed[p] + 1 + host_rand(&rng) % 4;
+            if (next > frame) continue;
+            confirmed[p] = next;
+            desync_check_add_local(&checks[p], next, hashes[p][next]);
+            if (frame % 3 == 0) {
+                desync_check_add_remote(&checks[1 - p], next, hashes[p][next]);
+            }
+        }
+    }
+}
+
+static void test_in_sync(void) {
+    static desync_check_t checks[2];
+    run_race(checks, UINT32_MAX);
+    printf("  %u and %u frames compared\n", checks[0].checks, checks[1].checks);
+    for (int p = 0; p < 2; p++) {
+        CHECK(checks[p].checks > 30);
+        CHECK(checks[p].mismatches == 0 && !checks[p].desynced);
+    }
+}
+
+static void test_drift(void) {
+    static desync_check_t checks[2];
+    run_race(checks, 300);
+    for (int p = 0; p < 2; p++) {
+        CHECK(checks[p].desynced);
+        CHECK(checks[p].first_desync_frame >= 300);
+        CHECK_MSG(checks[p].first_desync_frame < 330, "first desync at %u", checks[p].first_desync_frame);
+        CHECK(checks[p].mismatches > 10);
+    }
+}
+
+static void test_order_and_repeats(void) {
+    desync_check_t check;
+    desync_check_init(&check);
+
+    // Either side first; a frame is compared once however often it comes
+    CHECK(!desync_check_add_remote(&check, 10, 0xabc));
+    CHECK(!desync_check_add_remote(&check, 10, 0xabc));
+    CHECK(check.checks == 0);
+    CHECK(!desync_check_add_local(&check, 10, 0xabc));
+    CHECK(!desync_check_add_remote(&check, 10, 0xabc));
+    CHECK(check.checks == 1);
+
+    CHECK(!desync_check_add_local(&check, 11, 1));
+    CHECK(!desync_check_add_local(&check, 11, 1) && check.checks == 1);
+    CHECK(desync_check_add_remote(&check, 11, 2));
+    CHECK(check.checks == 2 && check.mismatches == 1 && check.first_desync_frame == 11);
+
+    // A frame a whole history later replaces the slot and is not confused with it
+    CHECK(!desync_check_add_remote(&check, 11 + DESYNC_CHECK_HISTORY, 3));
+    CHECK(check.checks == 2);
+    CHECK(desync_check_add_local(&check, 11 + DESYNC_CHECK_HISTORY, 4));
+    CHECK(check.mismatches == 2 && check.first_desync_frame == 11);
+}
+
+int main(void) {
+    RUN_TEST(test_in_sync);
+    RUN_TEST(test_drift);
+    RUN_TEST(test_order_and_repeats);
+    return host_test_finish();
+}
@@ -0,0 +1,239 @@
+// Frame batching: typed messages packed into notifications in priority
+// order, split across frames only at message boundaries, and rejected
+// whole when a frame is malformed.
+#include "host_test.h"
+#include "frame_batch.h"
+#include <string.h>
+
+#define MAX_RECEIVED 64
+
+typedef struct {
+    frame_batch_kind_t kind;
+    uint8_t length;
+    uint8_t data[FRAME_BATCH_MAX_MESSAGE];
+} received_t;
+
+static received_t received[MAX_RECEIVED];
+static int received_count;
+
+static void collect(void *context, frame_batch_kind_t kind, const uint8_t *data, size_t length) {
+    if (received_count == MAX_RECEIVED) return;
+    received_t *message = &received[received_count++];
+    message->kind = kind;
+    message->length = (uint8_t)length;
+    memcpy(message->data, data, length);
+}
+
+static void fill(uint8_t *data, size_t length, uint8_t seed) {
+    for (size_t i = 0; i < length; i++) data[i] = (uint8_t)(seed + i * 7);
+}
+
+// Flushes everything, decoding each frame; returns the frame count
+static int flush_all(frame_batch_t *sender, frame_batch_t *receiver, size_t *largest) {
+    uint8_t frame[FRAME_BATCH_MAX_SIZE];
+    int frames = 0;
+    size_t length;
+    *largest = 0;
+    while ((length = frame_batch_next(sender, frame)) > 0) {
+        CHECK(length <= sender->capacity);
+        if (length > *largest) *largest = length;
+        CHECK(frame_batch_decode(receiver, frame, length, collect, NULL));
+        frames++;
+    }
+    return frames;
+}
+
+static void test_round_trip_in_priority_order(void) {
+    frame_batch_t sender, receiver;
+    uint8_t event[12], input_a[9], state[11], input_b[14];
+    size_t largest;
+
+    frame_batch_init(&sender, FRAME_BATCH_MAX_SIZE);
+    frame_batch_init(&receiver, FRAME_BATCH_MAX_SIZE);
+    fill(event, sizeof(event), 1);
+    fill(input_a, sizeof(input_a), 2);
+    fill(state, sizeof(state), 3);
+    fill(input_b, sizeof(input_b), 4);
+
+    // Queued in any order; inputs go first, then state, then events
+    CHECK(!frame_batch_pending(&sender));
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_EVENT, event, sizeof(event)));
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_INPUT, input_a, sizeof(input_a)));
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_STATE, state, sizeof(state)));
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_INPUT, input_b, sizeof(input_b)));
+    CHECK(frame_batch_pending(&sender));
+
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 1);
+    CHECK(largest == 4 * FRAME_BATCH_HEADER_SIZE + sizeof(event) + sizeof(input_a) + sizeof(state) + sizeof(input_b));
+    CHECK(!frame_batch_pending(&sender));
+    CHECK(received_count == 4);
+    CHECK(received[0].kind == FRAME_BATCH_INPUT && received[0].length == sizeof(input_a) &&
+          memcmp(received[0].data, input_a, sizeof(input_a)) == 0);
+    CHECK(received[1].kind == FRAME_BATCH_INPUT && received[1].length == sizeof(input_b) &&
+          memcmp(received[1].data, input_b, sizeof(input_b)) == 0);
+    CHECK(received[2].kind == FRAME_BATCH_STATE && memcmp(received[2].data, state, sizeof(state)) == 0);
+    CHECK(received[3].kind == FRAME_BATCH_EVENT && memcmp(received[3].data, event, sizeof(event)) == 0);
+    CHECK(sender.frames_sent == 1 && receiver.messages_received == 4);
+
+    // The queues start over once flushed
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_STATE, state, 1));
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 1 && largest == 2);
+    CHECK(received_count == 1 && received[0].length == 1);
+
+    // Largest message
+    uint8_t big[FRAME_BATCH_MAX_MESSAGE];
+    fill(big, sizeof(big), 5);
+    CHECK(frame_batch_add(&sender, FRAME_BATCH_EVENT, big, sizeof(big)));
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 1);
+    CHECK(received_count == 1 && received[0].length == sizeof(big) && memcmp(received[0].data, big, sizeof(big)) == 0);
+}
+
+static void test_split_at_small_mtu(void) {
+    frame_batch_t sender, receiver;
+    uint8_t data[FRAME_BATCH_MAX_MESSAGE];
+    size_t largest;
+
+    // Default MTU: 20 bytes a notification
+    frame_batch_init(&sender, 23 - FRAME_BATCH_ATT_HEADER);
+    frame_batch_init(&receiver, 0);
+    CHECK(sender.capacity == FRAME_BATCH_MIN_SIZE && receiver.capacity == FRAME_BATCH_MIN_SIZE);
+    fill(data, sizeof(data), 9);
+
+    // 12 + 12 do not share a frame; the 6 byte event fills the first gap
+    frame_batch_add(&sender, FRAME_BATCH_INPUT, data, 11);
+    frame_batch_add(&sender, FRAME_BATCH_STATE, data, 11);
+    frame_batch_add(&sender, FRAME_BATCH_EVENT, data, 5);
+    frame_batch_add(&sender, FRAME_BATCH_STATE, data, 3);
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 2);
+    CHECK(largest <= FRAME_BATCH_MIN_SIZE);
+    CHECK(received_count == 4);
+    CHECK(received[0].kind == FRAME_BATCH_INPUT && received[0].length == 11);
+    CHECK(received[1].kind == FRAME_BATCH_EVENT && received[1].length == 5);
+    CHECK(received[2].kind == FRAME_BATCH_STATE && received[2].length == 11);
+    CHECK(received[3].kind == FRAME_BATCH_STATE && received[3].length == 3);
+
+    // Too big for any frame at this MTU: dropped, the rest still sent
+    frame_batch_add(&sender, FRAME_BATCH_STATE, data, 30);
+    frame_batch_add(&sender, FRAME_BATCH_EVENT, data, 4);
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 1);
+    CHECK(received_count == 1 && received[0].kind == FRAME_BATCH_EVENT);
+    CHECK(sender.messages_dropped == 1);
+
+    // A larger MTU later takes it
+    frame_batch_set_capacity(&sender, 1000);
+    CHECK(sender.capacity == FRAME_BATCH_MAX_SIZE);
+    frame_batch_add(&sender, FRAME_BATCH_STATE, data, 30);
+    received_count = 0;
+    CHECK(flush_all(&sender, &receiver, &largest) == 1 && received_count == 1);
+}
+
+static void test_rejects(void) {
+    frame_batch_t batch;
+    uint8_t data[FRAME_BATCH_MAX_MESSAGE + 1] = {0};
+
+    frame_batch_init(&batch, FRAME_BATCH_MAX_SIZE);
+    CHECK(!frame_batch_add(&batch, FRAME_BATCH_INPUT, data, 0));
+    CHECK(!frame_batch_add(&batch, FRAME_BATCH_INPUT, data, FRAME_BATCH_MAX_MESSAGE + 1));
+    CHECK(!frame_batch_add(&batch, FRAME_BATCH_KINDS, data, 4));
+
+    // A full queue refuses more, other kinds still take theirs
+    int added = 0;
+    while (frame_batch_add(&batch, FRAME_BATCH_STATE, data, 20)) added++;
+    CHECK(added == FRAME_BATCH_QUEUE_BYTES / 21);
+    CHECK(frame_batch_add(&batch, FRAME_BATCH_EVENT, data, 20));
+
+    // Malformed frames are refused whole
+    uint8_t frame[8];
+    received_count = 0;
+    CHECK(!frame_batch_decode(&batch, frame, 0, collect, NULL));
+    frame[0] = 3 << 6;                      // Reserved kind
+    frame[1] = 0;
+    CHECK(!frame_batch_decode(&batch, frame, 2, collect, NULL));
+    frame[0] = FRAME_BATCH_STATE << 6 | 1;  // Two bytes, then a truncated message
+    frame[1] = frame[2] = 7;
+    frame[3] = FRAME_BATCH_INPUT << 6 | 5;
+    frame[4] = 1;
+    CHECK(!frame_batch_decode(&batch, frame, 5, collect, NULL));
+    CHECK(received_count == 0);
+    CHECK(batch.malformed == 3);
+    CHECK(frame_batch_decode(&batch, frame, 3, collect, NULL));
+    CHECK(received_count == 1 && received[0].kind == FRAME_BATCH_STATE && received[0].length == 2);
+}
+
+static void test_wrap_single(void) {
+    frame_batch_t receiver;
+    uint8_t config[12], frame[FRAME_BATCH_HEADER_SIZE + FRAME_BATCH_MAX_MESSAGE];
+
+    // A bare message from a legacy characteristic decodes like a batch of one
+    frame_batch_init(&receiver, FRAME_BATCH_MIN_SIZE);
+    fill(config, sizeof(config), 5);
+    received_count = 0;
+    size_t length = frame_batch_wrap(FRAME_BATCH_EVENT, config, sizeof(config), frame);
+    CHECK(length == FRAME_BATCH_HEADER_SIZE + sizeof(config));
+    CHECK(frame_batch_decode(&receiver, frame, length, collect, NULL));
+    CHECK(received_count == 1 && received[0].kind == FRAME_BATCH_EVENT && received[0].length == sizeof(config));
+    CHECK(memcmp(received[0].data, config, sizeof(config)) == 0);
+
+    CHECK(frame_batch_wrap(FRAME_BATCH_INPUT, config, 0, frame) == 0);
+    CHECK(frame_batch_wrap(FRAME_BATCH_KINDS, config, sizeof(config), frame) == 0);
+}
+
+static void test_random_round_trips(void) {
+    frame_batch_t sender, receiver;
+    uint32_t rng = 0x5eed;
+
+    frame_batch_init(&receiver, FRAME_BATCH_MAX_SIZE);
+    for (int round = 0; round < 2000; round++) {
+        frame_batch_init(&sender, (uint16_t)(FRAME_BATCH_MIN_SIZE + host_rand(&rng) % 240));
+
+        // Up to 12 messages that each fit a frame, kept per kind in order
+        int counts[FRAME_BATCH_KINDS] = {0};
+        received_t queued[FRAME_BATCH_KINDS][12];
+        int messages = 1 + host_rand(&rng) % 12;
+        for (int i = 0; i < messages; i++) {
+            frame_batch_kind_t kind = (frame_batch_kind_t)(host_rand(&rng) % FRAME_BATCH_KINDS);
+            uint8_t length = (uint8_t)(1 + host_rand(&rng) % (sender.capacity - FRAME_BATCH_HEADER_SIZE < 40
+                                                                  ? sender.capacity - FRAME_BATCH_HEADER_SIZE
+                                                                  : 40));
+            received_t *message = &queued[kind][counts[kind]++];
+            message->kind = kind;
+            message->length = length;
+            for (int b = 0; b < length; b++) message->data[b] = (uint8_t)host_rand(&rng);
+            CHECK(frame_batch_add(&sender, kind, message->data, length));
+        }
+
+        size_t largest;
+        received_count = 0;
+        int frames = flush_all(&sender, &receiver, &largest);
+        CHECK(received_count == messages);
+        CHECK(largest <= sender.capacity);
+
+        // Per kind the order holds, and the first input leads the first frame
+        int seen[FRAME_BATCH_KINDS] = {0};
+        size_t total = 0;
+        for (int i = 0; i < received_count; i++) {
+            received_t *got = &received[i];
+            received_t *want = &queued[got->kind][seen[got->kind]++];
+            CHECK(got->length == want->length && memcmp(got->data, want->data, got->length) == 0);
+            total += FRAME_BATCH_HEADER_SIZE + got->length;
+        }
+        if (counts[FRAME_BATCH_INPUT] > 0) CHECK(received[0].kind == FRAME_BATCH_INPUT);
+
+        // Everything that fits one frame goes in one
+        if (total <= sender.capacity) CHECK(frames == 1);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_round_trip_in_priority_order);
+    RUN_TEST(test_split_at_small_mtu);
+    RUN_TEST(test_rejects);
+    RUN_TEST(test_wrap_single);
+    RUN_TEST(test_random_round_trips);
+    return host_test_finish();
+}
@@ -0,0 +1,376 @@
+// Input history packets: run-length round trips, acks trimming the resend
+// window, recovery after dropped packets, then two rollback peers over a
+// lossy link, sweeping the loss rate with and without the history.
+#include "host_test.h"
+#include "input_history.h"
+#include "race_fixture.h"
+#include <string.h>
+
+#define RACE_FRAMES 1200
+#define SCRIPT_FRAMES (RACE_FRAMES + 64)
+
+// Collects delivered frames for the codec tests
+typedef struct {
+    uint32_t frames[64];
+    physics_input_t inputs[64];
+    uint8_t player;
+    int count;
+} delivery_t;
+
+static void collect(void *context, uint8_t player, uint32_t frame, const physics_input_t *input) {
+    delivery_t *delivery = context;
+    if (delivery->count < 64) {
+        delivery->frames[delivery->count] = frame;
+        delivery->inputs[delivery->count] = *input;
+        delivery->count++;
+    }
+    delivery->player = player;
+}
+
+static physics_input_t varied_input(uint32_t frame) {
+    return (physics_input_t){
+        .throttle = (uint8_t)(frame * 7 % 101),
+        .brake = (uint8_t)(frame % 3 == 0 ? 40 : 0),
+        .steering = (int8_t)((int)(frame * 13 % 201) - 100),
+        .buttons = (uint8_t)(frame & 1),
+    };
+}
+
+// An otherwise empty packet from `from`, carrying its ack to `to`
+static void send_ack(input_history_t *from, input_history_t *to, uint32_t frame) {
+    uint8_t packet[INPUT_HISTORY_MAX_PACKET];
+    physics_input_t idle = {0};
+
+    input_history_push(from, frame, &idle);
+    size_t length = input_history_encode(from, packet, sizeof(packet));
+    CHECK(input_history_decode(to, packet, length, NULL, NULL));
+}
+
+static void test_round_trip(void) {
+    input_history_t sender, receiver;
+    delivery_t delivery = {0};
+    uint8_t packet[64];
+
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+    CHECK(input_history_encode(&sender, packet, sizeof(packet)) == 0);
+
+    for (uint32_t frame = 0; frame < 6; frame++) {
+        physics_input_t input = varied_input(frame);
+        input_history_push(&sender, frame, &input);
+    }
+    size_t length = input_history_encode(&sender, packet, sizeof(packet));
+    CHECK(length > 0 && length <= sizeof(packet));
+    CHECK(input_history_decode(&receiver, packet, length, collect, &delivery));
+    CHECK(delivery.count == 6 && delivery.player == 1);
+    for (int i = 0; i < delivery.count; i++) {
+        physics_input_t expected = varied_input((uint32_t)i);
+        CHECK(delivery.frames[i] == (uint32_t)i);
+        CHECK(memcmp(&delivery.inputs[i], &expected, sizeof(expected)) == 0);
+    }
+    CHECK(receiver.received_until == 6);
+
+    // Extremes survive
+    physics_input_t extreme = { .throttle = 100, .brake = 100, .steering = -100, .buttons = 0xff };
+    input_history_push(&sender, 6, &extreme);
+    length = input_history_encode(&sender, packet, sizeof(packet));
+    delivery.count = 0;
+    CHECK(input_history_decode(&receiver, packet, length, collect, &delivery));
+    // Frames 0..5 were not acked, so they repeat, but only frame 6 is new
+    CHECK(delivery.count == 1 && delivery.frames[0] == 6);
+    CHECK(memcmp(&delivery.inputs[0], &extreme, sizeof(extreme)) == 0);
+}
+
+static void test_run_length_and_ack(void) {
+    input_history_t a, b;
+    delivery_t delivery = {0};
+    uint8_t packet[64];
+    physics_input_t held = { .throttle = 80, .steering = 12 };
+
+    input_history_init(&a, 0);
+    input_history_init(&b, 1);
+
+    // A held input packs to one run however many frames it covers
+    for (uint32_t frame = 0; frame < INPUT_HISTORY_FRAMES; frame++) {
+        input_history_push(&a, frame, &held);
+    }
+    size_t length = input_history_encode(&a, packet, sizeof(packet));
+    printf("  %d held frames: %zu bytes\n", INPUT_HISTORY_FRAMES, length);
+    CHECK(length <= 10);
+    CHECK(input_history_decode(&b, packet, length, collect, &delivery));
+    CHECK(delivery.count == INPUT_HISTORY_FRAMES);
+
+    // b's packet carries the ack; a then sends only newer frames
+    input_history_push(&b, 0, &held);
+    length = input_history_encode(&b, packet, sizeof(packet));
+    CHECK(input_history_decode(&a, packet, length, NULL, NULL));
+    CHECK(a.peer_ack == INPUT_HISTORY_FRAMES);
+
+    physics_input_t turn = { .throttle = 80, .steering = -40 };
+    input_history_push(&a, INPUT_HISTORY_FRAMES, &turn);
+    uint32_t frames_before = a.frames_sent;
+    length = input_history_encode(&a, packet, sizeof(packet));
+    CHECK(a.frames_sent - frames_before == 1);
+
+    // With everything acked the newest frame still goes, to carry the ack
+    input_history_push(&b, 1, &held);
+    length = input_history_encode(&b, packet, sizeof(packet));
+    delivery.count = 0;
+    CHECK(input_history_decode(&a, packet, length, collect, &delivery));
+    CHECK(delivery.count == 1 && delivery.frames[0] == 1);
+    length = input_history_encode(&b, packet, sizeof(packet));
+    delivery.count = 0;
+    CHECK(input_history_decode(&a, packet, length, collect, &delivery));
+    CHECK(delivery.count == 0);
+}
+
+static void test_recovery_after_loss(void) {
+    input_history_t sender, receiver;
+    delivery_t delivery = {0};
+    uint8_t packet[INPUT_HISTORY_MAX_PACKET];
+
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+
+    // Packets for frames 0..3 are lost; frame 4's packet brings them all
+    size_t length = 0;
+    for (uint32_t frame = 0; frame < 5; frame++) {
+        physics_input_t input = race_fixture_input(1, frame);
+        input_history_push(&sender, frame, &input);
+        length = input_history_encode(&sender, packet, sizeof(packet));
+    }
+    CHECK(input_history_decode(&receiver, packet, length, collect, &delivery));
+    CHECK(delivery.count == 5);
+    CHECK(receiver.frames_recovered == 4 && receiver.frames_lost == 0);
+
+    // Inputs changing every frame: the packet fills up with the oldest
+    // unacked frames, and the rest follow in the next one
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+    for (uint32_t frame = 0; frame < 24; frame++) {
+        physics_input_t input = varied_input(frame);
+        input_history_push(&sender, frame, &input);
+    }
+    delivery.count = 0;
+    length = input_history_encode(&sender, packet, sizeof(packet));
+    CHECK(length <= INPUT_HISTORY_MAX_PACKET);
+    CHECK(input_history_decode(&receiver, packet, length, collect, &delivery));
+    CHECK(delivery.count > 0 && delivery.count < 24);
+
+    // Each packet back acks what has arrived, moving the window on
+    uint32_t reply_frame = 0;
+    while (receiver.received_until < 24) {
+        send_ack(&receiver, &sender, reply_frame++);
+        CHECK(sender.peer_ack == receiver.received_until);
+        int before = delivery.count;
+        length = input_history_encode(&sender, packet, sizeof(packet));
+        CHECK(input_history_decode(&receiver, packet, length, collect, &delivery));
+        CHECK(delivery.count > before);
+        if (delivery.count == before) break;
+    }
+    CHECK(reply_frame > 1);
+    CHECK(delivery.count == 24 && receiver.frames_lost == 0);
+    for (int i = 0; i < delivery.count; i++) {
+        CHECK(delivery.frames[i] == (uint32_t)i);
+    }
+
+    // Sending only the newest frame, as the single-input packet did, loses
+    // whatever a dropped packet carried
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+    sender.frames_per_packet = 1;
+    for (uint32_t frame = 0; frame < 5; frame++) {
+        physics_input_t input = race_fixture_input(1, frame);
+        input_history_push(&sender, frame, &input);
+        length = input_history_encode(&sender, packet, sizeof(packet));
+        if (frame != 2) {
+            CHECK(input_history_decode(&receiver, packet, length, NULL, NULL));
+        }
+    }
+    CHECK(receiver.frames_delivered == 4 && receiver.received_until == 2);
+
+    // It is only given up on once a frame a whole history ahead arrives
+    physics_input_t idle = {0};
+    input_history_push(&sender, 2 + INPUT_HISTORY_FRAMES, &idle);
+    length = input_history_encode(&sender, packet, sizeof(packet));
+    CHECK(input_history_decode(&receiver, packet, length, NULL, NULL));
+    CHECK(receiver.frames_lost == 1);
+    CHECK(receiver.received_until == 5);
+}
+
+static void test_reordering(void) {
+    input_history_t sender, receiver;
+    delivery_t delivery = {0};
+    uint8_t packets[4][INPUT_HISTORY_MAX_PACKET];
+    size_t lengths[4];
+
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+    sender.frames_per_packet = 1;
+    for (uint32_t frame = 0; frame < 4; frame++) {
+        physics_input_t input = varied_input(frame);
+        input_history_push(&sender, frame, &input);
+        lengths[frame] = input_history_encode(&sender, packets[frame], sizeof(packets[frame]));
+    }
+
+    // Out of order arrivals are delivered once each and close the gap
+    static const int order[] = { 2, 0, 3, 2, 1, 0 };
+    for (int i = 0; i < 6; i++) {
+        CHECK(input_history_decode(&receiver, packets[order[i]], lengths[order[i]], collect, &delivery));
+    }
+    CHECK(delivery.count == 4);
+    CHECK(delivery.frames[0] == 2 && delivery.frames[1] == 0 && delivery.frames[2] == 3 && delivery.frames[3] == 1);
+    CHECK(receiver.received_until == 4 && receiver.received_mask == 0);
+    CHECK(receiver.frames_lost == 0);
+}
+
+static void test_malformed(void) {
+    input_history_t sender, receiver;
+    uint8_t packet[64];
+
+    input_history_init(&sender, 1);
+    input_history_init(&receiver, 0);
+    for (uint32_t frame = 0; frame < 8; frame++) {
+        physics_input_t input = varied_input(frame);
+        input_history_push(&sender, frame, &input);
+    }
+    size_t length = input_history_encode(&sender, packet, sizeof(packet));
+    for (size_t cut = 0; cut < length; cut++) {
+        CHECK(!input_history_decode(&receiver, packet, cut, NULL, NULL));
+    }
+    CHECK(receiver.malformed == length && receiver.received_until == 0);
+
+    // Throttle out of range: first run's throttle is the 7 bits after the
+    // 38-bit header and 5-bit run length
+    packet[5] |= 0x1f;
+    packet[6] |= 0xc0;
+    CHECK(!input_history_decode(&receiver, packet, length, NULL, NULL));
+
+    // Too small for even one frame
+    CHECK(input_history_encode(&sender, packet, 8) == 0);
+}
+
+static input_history_t histories[2];
+
+static void deliver_to_rollback(void *context, uint8_t player, uint32_t frame, const physics_input_t *input) {
+    rollback_add_remote_input(context, player, frame, input);
+}
+
+// A packet every tick, stalled or not, so acks and resends keep flowing
+static size_t send_history(race_fixture_peer_t *peer, const physics_input_t *input, uint8_t *packet) {
+    input_history_t *history = &histories[peer->rollback.local_player];
+    if (input) {
+        input_history_push(history, peer->rollback.frame, input);
+    }
+    return input_history_encode(history, packet, INPUT_HISTORY_MAX_PACKET);
+}
+
+static void receive_history(race_fixture_peer_t *peer, const uint8_t *packet, size_t length) {
+    CHECK(input_history_decode(&histories[peer->rollback.local_player], packet, length, deliver_to_rollback,
+                               &peer->rollback));
+}
+
+static const race_fixture_protocol_t history_protocol = { send_history, receive_history };
+
+typedef struct {
+    bool completed;
+    uint32_t confirmed;
+    uint32_t rollbacks;
+    uint32_t max_depth;
+    uint32_t stalls;
+    uint32_t resimulated;
+    uint32_t frames_lost;
+    uint32_t frames_recovered;
+    float bytes_per_packet;
+} session_result_t;
+
+// Latency 3 plus up to 2 frames each way
+static session_result_t run_session(uint32_t loss_percent, uint8_t frames_per_packet) {
+    static race_fixture_session_t session;
+    static uint64_t hashes[2][SCRIPT_FRAMES + 1];
+    link_sim_config_t link = {
+        .latency_us = 3 * RACE_FIXTURE_TICK_US,
+        .jitter_us = 2 * RACE_FIXTURE_TICK_US,
+        .loss_percent = loss_percent,
+        .seed = 0x1234567u + loss_percent * 0x10001u,
+    };
+    session_result_t result = {0};
+
+    race_fixture_session_init(&session, &history_protocol, &link, SCRIPT_FRAMES);
+    for (int i = 0; i < 2; i++) {
+        input_history_init(&histories[i], (uint8_t)i);
+        histories[i].frames_per_packet = frames_per_packet;
+        for (uint32_t f = 0; f <= SCRIPT_FRAMES; f++) hashes[i][f] = 0;
+    }
+
+    while (session.tick < RACE_FRAMES * 3 && race_fixture_session_confirmed(&session) < RACE_FRAMES) {
+        race_fixture_session_tick(&session);
+        for (int i = 0; i < 2; i++) {
+            uint32_t frame;
+            uint64_t hash;
+            if (rollback_confirmed_hash(&session.peers[i].rollback, &frame, &hash)) hashes[i][frame] = hash;
+        }
+    }
+
+    // Both peers agree on every frame both confirmed
+    uint32_t mismatches = 0;
+    for (uint32_t f = 0; f <= SCRIPT_FRAMES; f++) {
+        if (hashes[0][f] && hashes[1][f] && hashes[0][f] != hashes[1][f]) mismatches++;
+    }
+    CHECK_MSG(mismatches == 0, "%u confirmed frames differ at %u%% loss", mismatches, loss_percent);
+
+    result.confirmed = race_fixture_session_confirmed(&session);
+    result.completed = result.confirmed >= RACE_FRAMES;
+    uint32_t packets = 0, bytes = 0;
+    for (int i = 0; i < 2; i++) {
+        const rollback_t *rollback = &session.peers[i].rollback;
+        result.rollbacks += rollback->rollbacks;
+        result.stalls += rollback->stalls;
+        result.resimulated += rollback->resimulated_frames;
+        if (rollback->max_rollback_depth > result.max_depth) result.max_depth = rollback->max_rollback_depth;
+        result.frames_lost += histories[i].frames_lost;
+        result.frames_recovered += histories[i].frames_recovered;
+        packets += histories[i].packets_sent;
+        bytes += histories[i].bytes_sent;
+    }
+    result.bytes_per_packet = packets ? (float)bytes / packets : 0.0f;
+    return result;
+}
+
+static void test_lossy_link_sweep(void) {
+    static const uint32_t loss_rates[] = { 0, 5, 10, 20, 30, 40 };
+
+    printf("  latency 3+2 ticks each way; per 100 frames per peer\n");
+    printf("  loss | history: rollbacks  resim  depth  stalls  recovered  B/pkt | newest only: confirmed\n");
+    for (size_t i = 0; i < sizeof(loss_rates) / sizeof(loss_rates[0]); i++) {
+        uint32_t loss = loss_rates[i];
+        session_result_t history = run_session(loss, INPUT_HISTORY_FRAMES);
+        session_result_t single = run_session(loss, 1);
+        printf("  %3u%% | %18.1f  %5.1f  %5u  %6u  %9u  %5.1f | %22u\n", loss,
+               history.rollbacks * 100.0f / (2.0f * RACE_FRAMES), history.resimulated * 100.0f / (2.0f * RACE_FRAMES),
+               history.max_depth, history.stalls, history.frames_recovered, history.bytes_per_packet,
+               single.confirmed);
+
+        // The history never loses a frame, so the race always completes
+        CHECK_MSG(history.completed, "%u%% loss: confirmed only %u", loss, history.confirmed);
+        CHECK(history.frames_lost == 0);
+        CHECK(history.max_depth <= ROLLBACK_MAX_FRAMES);
+        CHECK(history.bytes_per_packet <= INPUT_HISTORY_MAX_PACKET);
+        if (loss == 0) {
+            CHECK(single.completed);
+        } else {
+            // One lost input leaves the peer predicting that frame forever
+            CHECK(!single.completed);
+        }
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_run_length_and_ack);
+    RUN_TEST(test_recovery_after_loss);
+    RUN_TEST(test_reordering);
+    RUN_TEST(test_malformed);
+    RUN_TEST(test_lossy_link_sweep);
+    return host_test_finish();
+}
@@ -0,0 +1,214 @@
+// Input replays: runs read back frame for frame, held inputs cost nothing,
+// a full buffer truncates cleanly, malformed replays are refused, and a
+// race recorded by both peers over a lossy link replays, from a file, to
+// the exact final hash the peers confirmed.
+#include "host_test.h"
+#include "input_replay.h"
+#include "net_peer.h"
+#include "transport_loopback.h"
+#include "world_state.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RACE_FRAMES 1800
+#define DT (1.0f / NET_PEER_RATE_HZ)
+
+static int64_t sim_now_us;
+
+static int64_t sim_clock(void) {
+    return sim_now_us;
+}
+
+static bool same_input(const physics_input_t *a, const physics_input_t *b) {
+    return a->throttle == b->throttle && a->brake == b->brake && a->steering == b->steering &&
+           a->buttons == b->buttons;
+}
+
+// Player 1 holds each input for up to 16 frames, player 0 for up to 64
+static void script_inputs(uint32_t *rng, uint32_t frame, physics_input_t *inputs) {
+    static physics_input_t held[2];
+    static uint32_t until[2];
+    for (int p = 0; p < 2; p++) {
+        if (frame == 0 || frame >= until[p]) {
+            held[p] = (physics_input_t){ .throttle = (uint8_t)(host_rand(rng) % 101),
+                                         .brake = (uint8_t)(host_rand(rng) % 3 == 0 ? host_rand(rng) % 101 : 0),
+                                         .steering = (int8_t)((int)(host_rand(rng) % 201) - 100),
+                                         .buttons = (uint8_t)(host_rand(rng) % 4) };
+            until[p] = frame + 1 + host_rand(rng) % (p ? 16 : 64);
+        }
+        inputs[p] = held[p];
+    }
+}
+
+static void test_stream(void) {
+    static uint8_t buffer[16384];
+    static physics_input_t script[RACE_FRAMES][2];
+    input_replay_recorder_t recorder;
+    input_replay_reader_t reader;
+    uint32_t rng = 5;
+
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 2, 7, 0xdecafbad);
+    for (uint32_t frame = 0; frame < RACE_FRAMES; frame++) {
+        script_inputs(&rng, frame, script[frame]);
+        CHECK(input_replay_record_frame(&recorder, script[frame]));
+    }
+    size_t length = input_replay_record_finish(&recorder, true, 0x0123456789abcdefULL);
+    printf("  %u frames in %zu bytes, %u runs, %.2f bytes a frame\n", RACE_FRAMES, length, recorder.runs,
+           (double)length / RACE_FRAMES);
+    CHECK(length < RACE_FRAMES);
+
+    CHECK(input_replay_open(&reader, buffer, length));
+    CHECK(reader.players == 2 && reader.track_id == 7 && reader.race_seed == 0xdecafbad);
+    CHECK(reader.frames == RACE_FRAMES && (reader.flags & INPUT_REPLAY_FINAL_HASH));
+    CHECK(reader.final_hash == 0x0123456789abcdefULL);
+    physics_input_t inputs[2];
+    uint32_t frames = 0, wrong = 0;
+    while (input_replay_next(&reader, inputs)) {
+        wrong += !same_input(&inputs[0], &script[frames][0]) || !same_input(&inputs[1], &script[frames][1]);
+        frames++;
+    }
+    CHECK(frames == RACE_FRAMES && wrong == 0);
+    CHECK(reader.position == length);
+
+    // A minute of the same input is one run: length, flags and two inputs
+    physics_input_t held[2] = { { .throttle = 100 }, { .throttle = 100, .steering = -20 } };
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 2, 0, 0);
+    for (int i = 0; i < 3600; i++) input_replay_record_frame(&recorder, held);
+    CHECK(input_replay_record_finish(&recorder, false, 0) == INPUT_REPLAY_HEADER_SIZE + 2 + 1 + 8);
+
+    // Neutral input from the start costs no input bytes at all
+    physics_input_t neutral[2] = {0};
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 2, 0, 0);
+    input_replay_record_frame(&recorder, neutral);
+    CHECK(input_replay_record_finish(&recorder, false, 0) == INPUT_REPLAY_HEADER_SIZE + 2);
+    CHECK(input_replay_open(&reader, buffer, INPUT_REPLAY_HEADER_SIZE + 2));
+    CHECK(input_replay_next(&reader, inputs) && same_input(&inputs[1], &neutral[1]));
+    CHECK(!input_replay_next(&reader, inputs));
+}
+
+static void test_truncated_and_refused(void) {
+    static uint8_t buffer[256];
+    static physics_input_t script[RACE_FRAMES][2];
+    input_replay_recorder_t recorder;
+    input_replay_reader_t reader;
+    uint32_t rng = 6;
+
+    // Runs stop at the first that does not fit; what was written plays back
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 2, 0, 0);
+    uint32_t recorded = 0;
+    for (uint32_t frame = 0; frame < RACE_FRAMES; frame++) {
+        script_inputs(&rng, frame, script[frame]);
+        recorded += input_replay_record_frame(&recorder, script[frame]);
+    }
+    size_t length = input_replay_record_finish(&recorder, true, 1);
+    CHECK(length <= sizeof(buffer) && recorder.frames > 0 && recorder.frames < recorded);
+    CHECK(input_replay_open(&reader, buffer, length));
+    CHECK((reader.flags & INPUT_REPLAY_TRUNCATED) && !(reader.flags & INPUT_REPLAY_FINAL_HASH));
+    physics_input_t inputs[2];
+    uint32_t frames = 0;
+    while (input_replay_next(&reader, inputs)) {
+        CHECK(same_input(&inputs[0], &script[frames][0]) && same_input(&inputs[1], &script[frames][1]));
+        frames++;
+    }
+    CHECK(frames == recorder.frames);
+
+    // Cut short, the stream ends where the data does
+    CHECK(input_replay_open(&reader, buffer, length - 3));
+    frames = 0;
+    while (input_replay_next(&reader, inputs)) frames++;
+    CHECK(frames < recorder.frames);
+
+    // Each header field wrong in turn
+    uint8_t bad[sizeof(buffer)];
+    for (int field = 0; field < 5; field++) {
+        memcpy(bad, buffer, length);
+        switch (field) {
+            case 0: bad[0] ^= 1; break;
+            case 1: bad[1] = INPUT_REPLAY_VERSION + 1; break;
+            case 2: bad[2] = 0; break;
+            case 3: bad[2] = PHYSICS_MAX_CARS + 1; break;
+            case 4: bad[12] |= 0x80; break;
+        }
+        CHECK_MSG(!input_replay_open(&reader, bad, length), "header field %d", field);
+    }
+    CHECK(!input_replay_open(&reader, buffer, INPUT_REPLAY_HEADER_SIZE - 1));
+
+    // A run flagging a player the replay does not have
+    memcpy(bad, buffer, length);
+    bad[2] = 1;
+    CHECK(input_replay_open(&reader, bad, length));
+    CHECK(!input_replay_next(&reader, inputs));
+
+    // Too small for even the header
+    input_replay_record_init(&recorder, buffer, INPUT_REPLAY_HEADER_SIZE - 1, 2, 0, 0);
+    CHECK(!input_replay_record_frame(&recorder, script[0]));
+    CHECK(input_replay_record_finish(&recorder, true, 1) == 0);
+}
+
+// Two peers race over a lossy loopback link, each recording the confirmed
+// inputs; both replays must be the same bytes and play back to the hash
+static void test_race_replay(void) {
+    static transport_loopback_t loopback;
+    static net_peer_t peers[2];
+    static physics_world_t world;
+    static uint8_t loaded[NET_PEER_REPLAY_SIZE];
+    link_sim_config_t poor = { .latency_us = 35000, .jitter_us = 30000, .loss_percent = 8, .reorder_percent = 3,
+                               .seed = 41 };
+    transport_t ends[2];
+
+    sim_now_us = 0;
+    transport_loopback_init(&loopback, &poor, sim_clock, 0);
+    for (int i = 0; i < 2; i++) {
+        transport_loopback_endpoint(&loopback, i, &ends[i]);
+        net_peer_init(&peers[i], (uint8_t)i, &ends[i], RACE_FRAMES);
+    }
+    for (uint32_t tick = 0; tick < RACE_FRAMES * 3 && !(peers[0].finished && peers[1].finished); tick++) {
+        sim_now_us = (int64_t)tick * NET_PEER_STEP_US;
+        net_peer_step(&peers[0], sim_now_us);
+        net_peer_step(&peers[1], sim_now_us);
+    }
+    CHECK(peers[0].finished && peers[1].finished);
+    CHECK(peers[0].final_hash == peers[1].final_hash);
+    CHECK(peers[0].rollback.rollbacks > 0);
+    printf("  %u frames, %u rollbacks; replay %zu bytes\n", RACE_FRAMES,
+           peers[0].rollback.rollbacks + peers[1].rollback.rollbacks, peers[0].replay_length);
+    CHECK(peers[0].replay_length > INPUT_REPLAY_HEADER_SIZE);
+    CHECK(peers[0].replay_length == peers[1].replay_length);
+    CHECK(memcmp(peers[0].replay, peers[1].replay, peers[0].replay_length) == 0);
+
+    // Through a file, as the device keeps them on SPIFFS
+    const char *path = "test_input_replay.rpl";
+    CHECK(input_replay_save(path, peers[0].replay, peers[0].replay_length));
+    size_t length = input_replay_load(path, loaded, sizeof(loaded));
+    CHECK(length == peers[0].replay_length);
+    CHECK(input_replay_load(path, loaded, length - 1) == 0);
+    remove(path);
+    CHECK(input_replay_load(path, loaded, sizeof(loaded)) == 0);
+
+    input_replay_reader_t reader;
+    CHECK(input_replay_open(&reader, loaded, length));
+    CHECK(reader.track_id == NET_PEER_TRACK_ID && reader.race_seed == NET_PEER_RACE_SEED);
+    race_fixture_setup_world(&world);
+    CHECK(input_replay_play(&reader, &world, DT) == RACE_FRAMES);
+    uint64_t hash = world_state_hash_world(&world, RACE_FRAMES);
+    CHECK(hash == reader.final_hash);
+    CHECK(hash == peers[0].final_hash);
+
+    // One frame's steering a step off ends elsewhere
+    input_replay_open(&reader, loaded, length);
+    physics_input_t inputs[PHYSICS_MAX_CARS];
+    race_fixture_setup_world(&world);
+    for (uint32_t frame = 0; input_replay_next(&reader, inputs); frame++) {
+        if (frame == RACE_FRAMES / 2) inputs[1].steering += inputs[1].steering < 100 ? 1 : -1;
+        for (int p = 0; p < PHYSICS_MAX_CARS; p++) physics_apply_input(&world.cars[p], &inputs[p], DT);
+        physics_update(&world, DT);
+    }
+    CHECK(world_state_hash_world(&world, RACE_FRAMES) != reader.final_hash);
+}
+
+int main(void) {
+    RUN_TEST(test_stream);
+    RUN_TEST(test_truncated_and_refused);
+    RUN_TEST(test_race_replay);
+    return host_test_finish();
+}
@@ -0,0 +1,86 @@
+// Input replays of more than eight players, built with 256 cars: the
+// changed-player mask spans several bytes, a 256-car world records its
+// first 255, and unused mask bits are refused
+#include "host_test.h"
+#include "input_replay.h"
+#include <string.h>
+
+_Static_assert(PHYSICS_MAX_CARS == 256, "built with -DPHYSICS_MAX_CARS=256");
+
+#define FRAMES 600
+
+static bool same_input(const physics_input_t *a, const physics_input_t *b) {
+    return a->throttle == b->throttle && a->brake == b->brake && a->steering == b->steering &&
+           a->buttons == b->buttons;
+}
+
+static void test_all_players(void) {
+    static uint8_t buffer[1 << 18];
+    static physics_input_t script[FRAMES][PHYSICS_MAX_CARS];
+    static physics_input_t inputs[PHYSICS_MAX_CARS];
+    input_replay_recorder_t recorder;
+    input_replay_reader_t reader;
+    uint32_t rng = 11;
+
+    // Each player holds an input for up to 32 frames
+    for (int p = 0; p < PHYSICS_MAX_CARS; p++) {
+        for (int frame = 0; frame < FRAMES;) {
+            physics_input_t input = { .throttle = (uint8_t)(host_rand(&rng) % 101),
+                                      .steering = (int8_t)((int)(host_rand(&rng) % 201) - 100) };
+            for (uint32_t hold = 1 + host_rand(&rng) % 32; hold > 0 && frame < FRAMES; hold--) {
+                script[frame++][p] = input;
+            }
+        }
+    }
+
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 255, 3, 42);
+    CHECK(recorder.players == INPUT_REPLAY_MAX_PLAYERS);
+    for (int frame = 0; frame < FRAMES; frame++) {
+        CHECK(input_replay_record_frame(&recorder, script[frame]));
+    }
+    size_t length = input_replay_record_finish(&recorder, false, 0);
+
+    CHECK(input_replay_open(&reader, buffer, length));
+    CHECK(reader.players == 255 && reader.frames == FRAMES);
+    int frames = 0, wrong = 0;
+    while (input_replay_next(&reader, inputs)) {
+        for (int p = 0; p < reader.players; p++) wrong += !same_input(&inputs[p], &script[frames][p]);
+        frames++;
+    }
+    CHECK(frames == FRAMES && wrong == 0);
+    CHECK(reader.position == length);
+}
+
+static void test_mask_bytes(void) {
+    static uint8_t buffer[256];
+    static physics_input_t inputs[PHYSICS_MAX_CARS];
+    input_replay_recorder_t recorder;
+    input_replay_reader_t reader;
+
+    // One player changing costs the whole mask and its own input
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 200, 0, 0);
+    inputs[199].throttle = 100;
+    input_replay_record_frame(&recorder, inputs);
+    CHECK(input_replay_record_finish(&recorder, false, 0) == INPUT_REPLAY_HEADER_SIZE + 1 + 25 + 4);
+    CHECK(input_replay_open(&reader, buffer, INPUT_REPLAY_HEADER_SIZE + 1 + 25 + 4));
+    memset(inputs, 0, sizeof(inputs));
+    CHECK(input_replay_next(&reader, inputs) && inputs[199].throttle == 100 && inputs[198].throttle == 0);
+
+    // Twelve players take two mask bytes; a bit past player 11 is refused
+    memset(inputs, 0, sizeof(inputs));
+    input_replay_record_init(&recorder, buffer, sizeof(buffer), 12, 0, 0);
+    input_replay_record_frame(&recorder, inputs);
+    size_t length = input_replay_record_finish(&recorder, false, 0);
+    CHECK(length == INPUT_REPLAY_HEADER_SIZE + 1 + 2);
+    CHECK(input_replay_open(&reader, buffer, length));
+    CHECK(input_replay_next(&reader, inputs));
+    buffer[INPUT_REPLAY_HEADER_SIZE + 2] |= 0x10;
+    CHECK(input_replay_open(&reader, buffer, length));
+    CHECK(!input_replay_next(&reader, inputs));
+}
+
+int main(void) {
+    RUN_TEST(test_all_players);
+    RUN_TEST(test_mask_bytes);
+    return host_test_finish();
+}
@@ -0,0 +1,227 @@
+// Jitter buffer: a remote car circling at constant speed, sent at 30 Hz
+// over a link whose jitter rises and falls. Rendered at 60 Hz the car must
+// move evenly, close to where it really was at the shown time, with the
+// delay following the jitter. Showing each packet as it lands, as before,
+// is the baseline.
+#include "host_test.h"
+#include "jitter_buffer.h"
+#include "link_sim.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_RATE 60
+#define FRAME_US (1000000 / FRAME_RATE)
+#define SEND_EVERY 2                // Frames between packets: 30 Hz
+#define RADIUS 200.0
+#define SPEED 60.0                  // Units per second
+#define RECEIVE_STEP_US 1000       // Packets are taken as they land, to the millisecond
+#define CLOCK_OFFSET_US 987654321ll  // Receiver clock minus sender time
+#define SETTLE_FRAMES FRAME_RATE    // Steps not judged while playout starts
+
+static state_codec_car_t truth(uint32_t frame) {
+    double t = (double)frame / FRAME_RATE;
+    double angle = SPEED / RADIUS * t;
+    double vx = -SPEED * sin(angle), vy = SPEED * cos(angle);
+    double heading = atan2(vy, vx) / (2 * M_PI);
+    if (heading < 0) heading += 1.0;
+    return (state_codec_car_t){
+        .frame = frame,
+        .position_x = (int32_t)lround((1000.0 + RADIUS * cos(angle)) * 16),
+        .position_y = (int32_t)lround((1000.0 + RADIUS * sin(angle)) * 16),
+        .velocity_x = (int32_t)lround(vx * 32),
+        .velocity_y = (int32_t)lround(vy * 32),
+        .heading = (uint16_t)lround(heading * 4096) & 4095,
+    };
+}
+
+typedef struct {
+    uint32_t steps;
+    double max_step_error;          // Worst |step - expected| / expected
+    uint32_t uneven_steps;          // Steps off by more than a quarter
+    double max_position_error;      // Units from the truth at the shown time
+    uint32_t max_delay_us;
+    uint32_t end_delay_us;
+    uint32_t end_jitter_us;
+} phase_result_t;
+
+static jitter_buffer_t buffer;
+static link_sim_t link;
+static int64_t received_until_us;
+static uint32_t next_frame;
+static int64_t now_us;
+static bool have_last;
+static state_codec_car_t last_shown;
+// Baseline: the newest packet, frozen between arrivals
+static state_codec_car_t newest, last_direct;
+static bool have_newest, have_last_direct;
+
+// Relative error of one rendered step against the car's true speed
+static double step_error(const state_codec_car_t *from, const state_codec_car_t *to) {
+    const double expected = SPEED * FRAME_US / 1e6;
+    double dx = (to->position_x - from->position_x) / 16.0;
+    double dy = (to->position_y - from->position_y) / 16.0;
+    return fabs(sqrt(dx * dx + dy * dy) - expected) / expected;
+}
+
+static void count_step(phase_result_t *result, double error) {
+    if (error > result->max_step_error) result->max_step_error = error;
+    if (error > 0.25) result->uneven_steps++;
+    result->steps++;
+}
+
+// Runs one phase; direct counts the same metrics for showing the newest
+// packet straight away
+static phase_result_t run_phase(uint32_t seconds, uint32_t jitter_us, uint32_t loss_percent,
+                                phase_result_t *direct) {
+    phase_result_t result = {0};
+    uint32_t end_frame = next_frame + seconds * FRAME_RATE;
+
+    memset(direct, 0, sizeof(*direct));
+    link.config.jitter_us = jitter_us;
+    link.config.loss_percent = loss_percent;
+    for (; next_frame < end_frame; next_frame++) {
+        now_us = CLOCK_OFFSET_US + (int64_t)next_frame * FRAME_US;
+
+        // The sender's packet for this frame, 15 ms plus jitter away
+        if (next_frame % SEND_EVERY == 0) {
+            state_codec_car_t state = truth(next_frame);
+            link_sim_send(&link, (const uint8_t *)&state, sizeof(state), now_us);
+        }
+        for (; received_until_us <= now_us; received_until_us += RECEIVE_STEP_US) {
+            uint8_t data[LINK_SIM_MAX_PACKET];
+            while (link_sim_receive(&link, received_until_us, data) == sizeof(state_codec_car_t)) {
+                state_codec_car_t state;
+                memcpy(&state, data, sizeof(state));
+                jitter_buffer_push(&buffer, &state, received_until_us);
+                if (!have_newest || state.frame > newest.frame) {
+                    newest = state;
+                    have_newest = true;
+                }
+            }
+        }
+
+        state_codec_car_t shown;
+        if (!jitter_buffer_sample(&buffer, now_us, &shown)) continue;
+
+        bool judged = next_frame >= SETTLE_FRAMES;
+        if (have_last && judged) {
+            count_step(&result, step_error(&last_shown, &shown));
+
+            // Where the car really was at the time shown
+            double shown_time_frames = (double)(now_us - buffer.playout_offset_us) * FRAME_RATE / 1e6;
+            double angle = SPEED / RADIUS * shown_time_frames / FRAME_RATE;
+            double ex = shown.position_x / 16.0 - (1000.0 + RADIUS * cos(angle));
+            double ey = shown.position_y / 16.0 - (1000.0 + RADIUS * sin(angle));
+            double position_error = sqrt(ex * ex + ey * ey);
+            if (position_error > result.max_position_error) result.max_position_error = position_error;
+
+            uint32_t delay = jitter_buffer_delay(&buffer);
+            if (delay > result.max_delay_us) result.max_delay_us = delay;
+        }
+        last_shown = shown;
+        have_last = true;
+
+        if (have_last_direct && judged) {
+            count_step(direct, step_error(&last_direct, &newest));
+        }
+        last_direct = newest;
+        have_last_direct = have_newest;
+    }
+    result.end_delay_us = jitter_buffer_delay(&buffer);
+    result.end_jitter_us = buffer.jitter_us;
+    return result;
+}
+
+static void print_phase(const char *name, const phase_result_t *result, const phase_result_t *direct) {
+    printf("  %-16s delay %3u ms (max %3u), jitter %2u ms; uneven steps %3u of %u (direct %3u), "
+           "worst step %3.0f%% (direct %3.0f%%), position error %.2f\n",
+           name, result->end_delay_us / 1000, result->max_delay_us / 1000, result->end_jitter_us / 1000,
+           result->uneven_steps, result->steps, direct->uneven_steps, result->max_step_error * 100,
+           direct->max_step_error * 100, result->max_position_error);
+}
+
+static void test_interpolation_and_extrapolation(void) {
+    jitter_buffer_t jb;
+    state_codec_car_t a = truth(0), b = truth(6), shown;
+
+    jitter_buffer_init(&jb, FRAME_RATE);
+    CHECK(!jitter_buffer_sample(&jb, 0, &shown));
+
+    // Heading wraps the short way between 4090 and 6
+    a.heading = 4090;
+    b.heading = 6;
+    jitter_buffer_push(&jb, &a, 1000);
+    jitter_buffer_push(&jb, &b, 101000);
+    jitter_buffer_push(&jb, &b, 101000);
+    CHECK(jb.duplicates == 1 && jb.count == 2);
+
+    // Halfway between the two snapshots
+    jb.playing = true;
+    jb.playout_offset_us = jb.target_delay_us + jb.transit_us;
+    jb.last_sample_us = 50000 + jb.playout_offset_us;
+    jb.last_render_time_us = 0;
+    jb.target_delay_us = (uint32_t)(jb.playout_offset_us - jb.transit_us);
+    CHECK(jitter_buffer_sample(&jb, 50000 + jb.playout_offset_us, &shown));
+    CHECK(shown.position_x == (a.position_x + b.position_x) / 2 ||
+          shown.position_x == (a.position_x + b.position_x + 1) / 2);
+    CHECK(shown.heading == 4094 || shown.heading == 4095 || shown.heading == 0);
+    CHECK(jb.interpolated == 1);
+
+    // Past the newest: carried on along its velocity, then held
+    jitter_buffer_t single;
+    jitter_buffer_init(&single, FRAME_RATE);
+    state_codec_car_t moving = { .frame = 0, .position_x = 0, .velocity_x = 32 * 10 };  // 10 units/s
+    jitter_buffer_push(&single, &moving, 0);
+    CHECK(jitter_buffer_sample(&single, (int64_t)single.target_delay_us + 50000, &shown));
+    CHECK(abs(shown.position_x - 8) <= 1);  // 50 ms worth, half a unit
+    CHECK(single.extrapolated == 1);
+    CHECK(jitter_buffer_sample(&single, (int64_t)single.target_delay_us + 2000000, &shown));
+    CHECK(abs(shown.position_x - 16) <= 1);  // 100 ms worth, 1 unit
+    CHECK(single.held == 1);
+
+    // Snapshots older than what was shown are dropped
+    state_codec_car_t stale = moving;
+    jitter_buffer_push(&single, &stale, 0);
+    CHECK(single.late == 1);
+}
+
+static void test_smooth_under_jitter(void) {
+    phase_result_t calm, stormy, recovered, direct_calm, direct_stormy, direct_recovered;
+
+    jitter_buffer_init(&buffer, FRAME_RATE);
+    link_sim_init(&link, &(link_sim_config_t){ .latency_us = 15000, .seed = 0xc0ffee });
+    received_until_us = CLOCK_OFFSET_US;
+    calm = run_phase(20, 4000, 0, &direct_calm);
+    stormy = run_phase(20, 60000, 5, &direct_stormy);
+    recovered = run_phase(40, 4000, 0, &direct_recovered);
+    print_phase("0-4 ms:", &calm, &direct_calm);
+    print_phase("0-60 ms, 5% loss:", &stormy, &direct_stormy);
+    print_phase("0-4 ms again:", &recovered, &direct_recovered);
+
+    // Even motion: the playout runs at most 5% off speed while the delay
+    // moves, plus rounding to 1/16 unit
+    CHECK_MSG(calm.max_step_error < 0.15, "calm worst step %.2f", calm.max_step_error);
+    CHECK_MSG(stormy.uneven_steps * 100 < stormy.steps, "%u uneven steps", stormy.uneven_steps);
+    CHECK(recovered.max_step_error < 0.15);
+    // Showing packets as they land stutters in every phase
+    CHECK(direct_calm.uneven_steps > direct_calm.steps / 3);
+    CHECK(direct_stormy.uneven_steps > stormy.uneven_steps * 10);
+
+    // Close to the truth at the time shown (quantisation and chords only)
+    CHECK(calm.max_position_error < 0.2 && recovered.max_position_error < 0.2);
+    CHECK(stormy.max_position_error < 0.5);
+
+    // The delay follows the jitter up and back down
+    CHECK(calm.end_delay_us < 50000);
+    CHECK(stormy.end_delay_us > calm.end_delay_us * 2);
+    CHECK(recovered.end_delay_us < stormy.end_delay_us / 2);
+    CHECK(stormy.end_jitter_us > calm.end_jitter_us * 4);
+    CHECK(buffer.extrapolated * 100 < buffer.interpolated);
+}
+
+int main(void) {
+    RUN_TEST(test_interpolation_and_extrapolation);
+    RUN_TEST(test_smooth_under_jitter);
+    return host_test_finish();
+}
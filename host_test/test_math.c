@@ -0,0 +1,282 @@
+// Accuracy tests for the fixed-point math in components/game/include/math.h,
+// measured in 16.16 ulps against long double libm
+#include "host_test.h"
+#include "include/math.h"
+#include <math.h>
+#include <string.h>
+
+// Worst |result - exact| in ulps over every checked input
+typedef struct {
+    double max_ulp;
+    long double worst_input;
+} ulp_error_t;
+
+static void track_error(ulp_error_t *error, long double input, long double result, long double exact) {
+    double ulp = (double)fabsl(result - exact);
+    if (ulp > error->max_ulp) {
+        error->max_ulp = ulp;
+        error->worst_input = input;
+    }
+}
+
+static void test_isqrt64_is_floor(void) {
+    uint32_t rng = 3;
+    int bad = 0;
+    for (int i = 0; i < 2000000; i++) {
+        uint64_t n = ((uint64_t)host_rand(&rng) << 32 | host_rand(&rng)) >> (host_rand(&rng) % 64);
+        uint64_t r = isqrt64(n);
+        bad += !(r * r <= n && (r + 1) * (r + 1) > n);
+    }
+    uint64_t top = UINT64_MAX;
+    CHECK(isqrt64(top) == UINT32_MAX);
+    CHECK(isqrt64(0) == 0 && isqrt64(1) == 1 && isqrt64(3) == 1 && isqrt64(4) == 2);
+    CHECK_MSG(bad == 0, "%d wrong roots", bad);
+}
+
+static void check_sqrt(ulp_error_t *error, fixed16_t x) {
+    long double exact = sqrtl((long double)x * 65536.0L);
+    track_error(error, x, fixed_sqrt(x), exact);
+}
+
+static void test_fixed_sqrt_accuracy(void) {
+    ulp_error_t error = { 0, 0 };
+
+    // Every input below 64.0, then a sample of the rest of the range
+    for (fixed16_t x = 1; x < (1 << 22); x++) {
+        check_sqrt(&error, x);
+    }
+    uint32_t rng = 17;
+    for (int i = 0; i < 4000000; i++) {
+        check_sqrt(&error, (fixed16_t)(host_rand(&rng) & 0x7FFFFFFF));
+    }
+    for (fixed16_t x = INT32_MAX; x > INT32_MAX - 100000; x--) {
+        check_sqrt(&error, x);
+    }
+
+    CHECK(fixed_sqrt(0) == 0 && fixed_sqrt(-5) == 0);
+    CHECK(fixed_sqrt(INT_TO_FIXED16(4)) == INT_TO_FIXED16(2));
+    CHECK_MSG(error.max_ulp <= 0.501, "max error %.4f ulp at %.0Lf", error.max_ulp, error.worst_input);
+    printf("  fixed_sqrt max error %.4f ulp\n", error.max_ulp);
+}
+
+static void check_rsqrt(ulp_error_t *error, fixed16_t x) {
+    long double exact = 65536.0L / sqrtl((long double)x / 65536.0L);
+    track_error(error, x, fixed_rsqrt(x), exact);
+}
+
+static void test_fixed_rsqrt_accuracy(void) {
+    ulp_error_t error = { 0, 0 };
+
+    // Small inputs have results far above one ulp of resolution, so sweep
+    // them all, then sample the rest of the positive range
+    for (fixed16_t x = 1; x < (1 << 22); x++) {
+        check_rsqrt(&error, x);
+    }
+    uint32_t rng = 23;
+    for (int i = 0; i < 4000000; i++) {
+        fixed16_t x = (fixed16_t)(host_rand(&rng) & 0x7FFFFFFF);
+        if (x > 0) check_rsqrt(&error, x);
+    }
+    check_rsqrt(&error, INT32_MAX);
+
+    CHECK(fixed_rsqrt(0) == 0 && fixed_rsqrt(-1) == 0);
+    CHECK(fixed_rsqrt(FIXED16_ONE) == FIXED16_ONE);
+    CHECK(fixed_rsqrt(INT_TO_FIXED16(4)) == FIXED16_HALF);
+    CHECK_MSG(error.max_ulp <= 0.5, "max error %.4f ulp at %.0Lf", error.max_ulp, error.worst_input);
+    printf("  fixed_rsqrt max error %.4f ulp\n", error.max_ulp);
+}
+
+static void test_vec2_normalize(void) {
+    uint32_t rng = 29;
+    double worst_length = 0, worst_angle = 0;
+
+    for (int i = 0; i < 2000000; i++) {
+        // Magnitudes from a few ulps up to the full 32-bit range
+        int shift = host_rand(&rng) % 31;
+        vec2_t v = { (fixed16_t)((int32_t)host_rand(&rng) >> shift), (fixed16_t)((int32_t)host_rand(&rng) >> shift) };
+        if (v.x == 0 && v.y == 0) continue;
+
+        vec2_t n = vec2_normalize(v);
+        double length = hypot(n.x, n.y) / 65536.0;
+        double angle = fabs(atan2(n.y, n.x) - atan2(v.y, v.x));
+        if (angle > M_PI) angle = 2 * M_PI - angle;
+        if (fabs(length - 1.0) > worst_length) worst_length = fabs(length - 1.0);
+        if (angle > worst_angle) worst_angle = angle;
+    }
+
+    vec2_t zero = vec2_normalize((vec2_t){ 0, 0 });
+    CHECK(zero.x == 0 && zero.y == 0);
+    vec2_t axis = vec2_normalize((vec2_t){ INT_TO_FIXED16(-300), 0 });
+    CHECK(axis.x >= -FIXED16_ONE - 1 && axis.x <= -FIXED16_ONE + 1 && axis.y == 0);
+
+    // Truncating each component loses under 2 ulps of length
+    CHECK_MSG(worst_length * 65536.0 < 2.0, "length off by %.3f ulp", worst_length * 65536.0);
+    CHECK_MSG(worst_angle < 4.0 / 65536.0, "direction off by %.3g rad", worst_angle);
+    printf("  vec2_normalize max length error %.3f ulp, direction %.3g rad\n",
+           worst_length * 65536.0, worst_angle);
+}
+
+static void test_sin_tables(void) {
+    ulp_error_t nearest = { 0, 0 }, lerp = { 0, 0 };
+    int cos_mismatch = 0, odd_mismatch = 0;
+
+    for (int a = 0; a < 65536; a++) {
+        angle16_t angle = (angle16_t)a;
+        long double exact = sinl(a * (2.0L * M_PI / 65536.0L)) * 65536.0L;
+        track_error(&nearest, a, angle16_sin(angle), exact);
+        track_error(&lerp, a, angle16_sin_lerp(angle), exact);
+
+        cos_mismatch += angle16_cos_lerp(angle) != angle16_sin_lerp((angle16_t)(angle + ANGLE16_QUARTER));
+        odd_mismatch += angle16_sin_lerp((angle16_t)-a) != -angle16_sin_lerp(angle);
+    }
+
+    CHECK(angle16_sin(0) == 0 && angle16_sin(ANGLE16_QUARTER) == FIXED16_ONE);
+    CHECK(angle16_sin_lerp(ANGLE16_HALF) == 0 && angle16_sin_lerp(3 * ANGLE16_QUARTER) == -FIXED16_ONE);
+    CHECK(cos_mismatch == 0);
+    CHECK_MSG(odd_mismatch == 0, "%d angles where sin(-a) != -sin(a)", odd_mismatch);
+    CHECK_MSG(lerp.max_ulp <= 1.18, "lerp max error %.3f ulp at angle %.0Lf", lerp.max_ulp, lerp.worst_input);
+    CHECK_MSG(nearest.max_ulp <= 202, "nearest max error %.3f ulp at angle %.0Lf",
+              nearest.max_ulp, nearest.worst_input);
+    printf("  angle16_sin max error %.2f ulp, angle16_sin_lerp %.3f ulp\n", nearest.max_ulp, lerp.max_ulp);
+}
+
+static void test_radian_sin_wraps(void) {
+    ulp_error_t error = { 0, 0 };
+    uint32_t rng = 31;
+
+    // The whole int32 range of radians; the error is dominated by rounding
+    // the angle to 1/65536 of a turn, about 3.1 ulp at the steepest point
+    for (int i = 0; i < 2000000; i++) {
+        fixed16_t radians = (fixed16_t)host_rand(&rng);
+        long double exact = sinl((long double)radians / 65536.0L) * 65536.0L;
+        track_error(&error, radians, fixed_sin(radians), exact);
+    }
+
+    CHECK_MSG(error.max_ulp <= 5.5, "max error %.3f ulp at %.0Lf", error.max_ulp, error.worst_input);
+    printf("  fixed_sin max error %.3f ulp\n", error.max_ulp);
+}
+
+static void random_affine(uint32_t *rng, affine2_t *m) {
+    // Rotation, a scale of 1/4..4 on each axis, translation within +-4096
+    affine2_t rotation, scaling;
+    affine2_rotation(&rotation, (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(7)) - INT_TO_FIXED16(3));
+    affine2_scaling(&scaling, FIXED16_QUARTER + (fixed16_t)(host_rand(rng) % (INT_TO_FIXED16(4) - FIXED16_QUARTER)),
+                    FIXED16_QUARTER + (fixed16_t)(host_rand(rng) % (INT_TO_FIXED16(4) - FIXED16_QUARTER)));
+    affine2_compose(m, &rotation, &scaling);
+    m->m[0][2] = (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(8192)) - INT_TO_FIXED16(4096);
+    m->m[1][2] = (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(8192)) - INT_TO_FIXED16(4096);
+}
+
+static void test_affine_compose_matches_mat3(void) {
+    uint32_t rng = 43;
+    int mismatches = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        affine2_t a, b, ab;
+        random_affine(&rng, &a);
+        random_affine(&rng, &b);
+        affine2_compose(&ab, &a, &b);
+
+        mat3_t ma, mb, mab;
+        for (int r = 0; r < 2; r++) {
+            for (int c = 0; c < 3; c++) {
+                ma.m[r][c] = a.m[r][c];
+                mb.m[r][c] = b.m[r][c];
+            }
+        }
+        ma.m[2][0] = mb.m[2][0] = 0;
+        ma.m[2][1] = mb.m[2][1] = 0;
+        ma.m[2][2] = mb.m[2][2] = FIXED16_ONE;
+        mat3_multiply(&mab, &ma, &mb);
+
+        for (int r = 0; r < 2; r++) {
+            for (int c = 0; c < 3; c++) {
+                mismatches += ab.m[r][c] != mab.m[r][c];
+            }
+        }
+
+        // Composing into an operand gives the same result
+        affine2_t aliased = a;
+        affine2_compose(&aliased, &aliased, &b);
+        mismatches += memcmp(&aliased, &ab, sizeof(ab)) != 0;
+    }
+    CHECK_MSG(mismatches == 0, "%d entries differ from mat3_multiply", mismatches);
+}
+
+static void test_affine_invert_round_trip(void) {
+    uint32_t rng = 47;
+    int64_t worst_identity = 0, worst_point = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        affine2_t m, inverse, product;
+        random_affine(&rng, &m);
+        CHECK(affine2_invert(&inverse, &m));
+        affine2_compose(&product, &m, &inverse);
+
+        // m * m^-1 is the identity to within a few ulps of 16.16 rounding,
+        // amplified by up to 4x scales
+        for (int r = 0; r < 2; r++) {
+            for (int c = 0; c < 2; c++) {
+                int64_t error = product.m[r][c] - (r == c ? FIXED16_ONE : 0);
+                if (error < 0) error = -error;
+                if (error > worst_identity) worst_identity = error;
+            }
+        }
+
+        // A point taken through m and back lands where it started, to the
+        // precision 16.16 keeps for offsets of a few thousand units
+        vec2_t point = { (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(2048)) - INT_TO_FIXED16(1024),
+                         (fixed16_t)(host_rand(&rng) % INT_TO_FIXED16(2048)) - INT_TO_FIXED16(1024) };
+        vec2_t back = affine2_transform(&inverse, affine2_transform(&m, point));
+        int64_t dx = (int64_t)back.x - point.x, dy = (int64_t)back.y - point.y;
+        if (dx < 0) dx = -dx;
+        if (dy < 0) dy = -dy;
+        if (dx > worst_point) worst_point = dx;
+        if (dy > worst_point) worst_point = dy;
+    }
+
+    CHECK_MSG(worst_identity <= 8, "m * m^-1 off identity by %lld ulp", (long long)worst_identity);
+    CHECK_MSG(worst_point <= FIXED16_ONE / 4, "round trip off by %.4f", worst_point / 65536.0);
+    printf("  identity within %lld ulp, points within %.4f units\n", (long long)worst_identity, worst_point / 65536.0);
+}
+
+static void test_affine_invert_exact_cases(void) {
+    affine2_t m, inverse;
+
+    // Negative entries in every position (the shifts these used to take
+    // were undefined for negative values)
+    affine2_scaling(&m, INT_TO_FIXED16(-2), -FIXED16_HALF);
+    m.m[0][2] = INT_TO_FIXED16(-10);
+    m.m[1][2] = INT_TO_FIXED16(3);
+    CHECK(affine2_invert(&inverse, &m));
+    CHECK(inverse.m[0][0] == -FIXED16_HALF && inverse.m[1][1] == INT_TO_FIXED16(-2));
+    CHECK(inverse.m[0][1] == 0 && inverse.m[1][0] == 0);
+    CHECK(inverse.m[0][2] == INT_TO_FIXED16(-5) && inverse.m[1][2] == INT_TO_FIXED16(6));
+
+    affine2_rotation(&m, 0);
+    m.m[0][1] = -FIXED16_ONE;
+    m.m[1][0] = FIXED16_ONE;
+    m.m[0][0] = m.m[1][1] = 0;
+    CHECK(affine2_invert(&inverse, &m));
+    CHECK(inverse.m[0][1] == FIXED16_ONE && inverse.m[1][0] == -FIXED16_ONE);
+
+    // Singular matrices leave the result untouched
+    affine2_t untouched = inverse;
+    affine2_scaling(&m, FIXED16_ONE, 0);
+    CHECK(!affine2_invert(&inverse, &m));
+    CHECK(memcmp(&inverse, &untouched, sizeof(inverse)) == 0);
+}
+
+int main(void) {
+    RUN_TEST(test_isqrt64_is_floor);
+    RUN_TEST(test_fixed_sqrt_accuracy);
+    RUN_TEST(test_fixed_rsqrt_accuracy);
+    RUN_TEST(test_vec2_normalize);
+    RUN_TEST(test_sin_tables);
+    RUN_TEST(test_radian_sin_wraps);
+    RUN_TEST(test_affine_compose_matches_mat3);
+    RUN_TEST(test_affine_invert_round_trip);
+    RUN_TEST(test_affine_invert_exact_cases);
+
+    return host_test_finish();
+}
@@ -0,0 +1,103 @@
+// Batched vec2 kernels against the single-vector functions. Built once per
+// backend; every backend must match the scalar code bit for bit.
+#include "host_test.h"
+#include "include/math.h"
+#include <string.h>
+
+#define MAX_COUNT 67
+
+static vec2_t a[MAX_COUNT], b[MAX_COUNT], out[MAX_COUNT], expect[MAX_COUNT];
+static fixed16_t dots[MAX_COUNT], expect_dots[MAX_COUNT];
+
+// Mixes small values with the full int32 range, where fixed_mul wraps
+static fixed16_t random_fixed(uint32_t *rng) {
+    uint32_t r = host_rand(rng);
+    switch (r & 3) {
+        case 0: return (fixed16_t)host_rand(rng);
+        case 1: return (fixed16_t)(host_rand(rng) % INT_TO_FIXED16(64)) - INT_TO_FIXED16(32);
+        case 2: return (r & 4) ? INT32_MAX - (fixed16_t)(r >> 24) : INT32_MIN + (fixed16_t)(r >> 24);
+        default: return (fixed16_t)((int32_t)host_rand(rng) >> (r >> 27));
+    }
+}
+
+static void fill(uint32_t *rng, int count) {
+    for (int i = 0; i < count; i++) {
+        a[i] = (vec2_t){ random_fixed(rng), random_fixed(rng) };
+        b[i] = (vec2_t){ random_fixed(rng), random_fixed(rng) };
+    }
+}
+
+static bool same_vectors(const vec2_t *x, const vec2_t *y, int count) {
+    return memcmp(x, y, count * sizeof(vec2_t)) == 0;
+}
+
+static void test_kernels_match_scalar(void) {
+    uint32_t rng = 37;
+    int failures[4] = { 0 };
+
+    // Every length up to MAX_COUNT covers each vector width plus every tail
+    for (int round = 0; round < 200; round++) {
+        for (int count = 0; count <= MAX_COUNT; count++) {
+            fill(&rng, count);
+            fixed16_t s = random_fixed(&rng);
+            affine2_t m;
+            for (int r = 0; r < 2; r++) {
+                for (int c = 0; c < 3; c++) {
+                    m.m[r][c] = random_fixed(&rng);
+                }
+            }
+
+            for (int i = 0; i < count; i++) expect[i] = vec2_add(a[i], b[i]);
+            vec2_add_batch(out, a, b, count);
+            failures[0] += !same_vectors(out, expect, count);
+
+            for (int i = 0; i < count; i++) expect[i] = vec2_scale(a[i], s);
+            vec2_scale_batch(out, a, s, count);
+            failures[1] += !same_vectors(out, expect, count);
+
+            for (int i = 0; i < count; i++) expect_dots[i] = vec2_dot(a[i], b[i]);
+            vec2_dot_batch(dots, a, b, count);
+            failures[2] += memcmp(dots, expect_dots, count * sizeof(fixed16_t)) != 0;
+
+            for (int i = 0; i < count; i++) expect[i] = affine2_transform(&m, a[i]);
+            affine2_transform_batch(&m, out, a, count);
+            failures[3] += !same_vectors(out, expect, count);
+        }
+    }
+
+    CHECK_MSG(failures[0] == 0, "vec2_add_batch differs in %d runs", failures[0]);
+    CHECK_MSG(failures[1] == 0, "vec2_scale_batch differs in %d runs", failures[1]);
+    CHECK_MSG(failures[2] == 0, "vec2_dot_batch differs in %d runs", failures[2]);
+    CHECK_MSG(failures[3] == 0, "affine2_transform_batch differs in %d runs", failures[3]);
+}
+
+static void test_in_place(void) {
+    uint32_t rng = 41;
+    affine2_t m;
+    affine2_from_pose(&m, (vec2_t){ INT_TO_FIXED16(12), INT_TO_FIXED16(-7) }, FLOAT_TO_FIXED16(0.7f));
+    fill(&rng, MAX_COUNT);
+
+    for (int i = 0; i < MAX_COUNT; i++) expect[i] = vec2_add(a[i], b[i]);
+    vec2_add_batch(a, a, b, MAX_COUNT);
+    CHECK(same_vectors(a, expect, MAX_COUNT));
+
+    for (int i = 0; i < MAX_COUNT; i++) expect[i] = vec2_scale(b[i], FIXED16_HALF);
+    vec2_scale_batch(b, b, FIXED16_HALF, MAX_COUNT);
+    CHECK(same_vectors(b, expect, MAX_COUNT));
+
+    for (int i = 0; i < MAX_COUNT; i++) expect[i] = affine2_transform(&m, a[i]);
+    affine2_transform_batch(&m, a, a, MAX_COUNT);
+    CHECK(same_vectors(a, expect, MAX_COUNT));
+}
+
+int main(void) {
+    printf("backend: %s\n", math_batch_backend());
+#ifdef EXPECT_BACKEND
+    CHECK_MSG(strcmp(math_batch_backend(), EXPECT_BACKEND) == 0, "built %s", math_batch_backend());
+#endif
+
+    RUN_TEST(test_kernels_match_scalar);
+    RUN_TEST(test_in_place);
+
+    return host_test_finish();
+}
@@ -0,0 +1,193 @@
+// Two peers race each other through the transports: protocol.c as the
+// game loop runs it (rollback, input history, clock sync, framing) over loopback
+// links from clean to awful, over a link that drops out mid-race, and over
+// UDP on localhost. Both must finish on the same confirmed state.
+#include "host_test.h"
+#include "net_peer.h"
+#include "transport_loopback.h"
+#include "transport_udp.h"
+#include <string.h>
+
+#define RACE_FRAMES 1800
+#define MAX_TICKS (RACE_FRAMES * 3)
+#define LATE_START_TICKS 7          // Peer 1 comes up this much later
+#define CLOCK_OFFSET_US 123456789   // Peer 1's clock is unrelated to peer 0's
+#define CLOCK_SKEW_PPM 300          // And runs fast
+
+static int64_t sim_now_us;
+
+static int64_t sim_clock(void) {
+    return sim_now_us;
+}
+
+typedef struct {
+    bool finished;
+    bool hashes_match;
+    uint32_t ticks;
+    uint32_t rollbacks;
+    uint32_t resimulated;
+    uint32_t max_depth;
+    uint32_t stalls;
+    uint32_t recovered;
+    uint32_t paced;             // Frames skipped or added to hold the timeline
+    float bytes_per_second;
+    uint32_t rtt_p50_us;        // Telemetry of peer 1
+    uint32_t one_way_p50_us;
+    bool telemetry_matches;     // Depth histograms hold every rollback
+    uint32_t desync_checks;     // Confirmed hashes compared through state packets
+    uint32_t desyncs;
+
+} race_result_t;
+
+// Steps both peers a tick at a time; drop_from..drop_until takes a
+// loopback link down for a while
+static race_result_t run_race(const transport_t *transports[2], transport_loopback_t *loopback,
+                              uint32_t drop_from, uint32_t drop_until) {
+    static net_peer_t peers[2];
+    race_result_t result = {0};
+
+    sim_now_us = 0;
+    for (int i = 0; i < 2; i++) {
+        net_peer_init(&peers[i], (uint8_t)i, transports[i], RACE_FRAMES);
+    }
+
+    uint32_t tick = 0;
+    for (; tick < MAX_TICKS && !(peers[0].finished && peers[1].finished); tick++) {
+        sim_now_us = (int64_t)tick * NET_PEER_STEP_US;
+        if (loopback && tick == drop_from) transport_loopback_set_up(loopback, false);
+        if (loopback && tick == drop_until) transport_loopback_set_up(loopback, true);
+
+        net_peer_step(&peers[0], sim_now_us);
+        if (tick >= LATE_START_TICKS) {
+            int64_t local = CLOCK_OFFSET_US + sim_now_us + sim_now_us / 1000000 * CLOCK_SKEW_PPM;
+            net_peer_step(&peers[1], local);
+        }
+    }
+
+    result.finished = peers[0].finished && peers[1].finished;
+    result.hashes_match = result.finished && peers[0].final_hash == peers[1].final_hash;
+    result.ticks = tick;
+    uint32_t bytes = 0;
+    for (int i = 0; i < 2; i++) {
+        const rollback_t *rollback = &peers[i].rollback;
+        result.rollbacks += rollback->rollbacks;
+        result.resimulated += rollback->resimulated_frames;
+        result.stalls += rollback->stalls;
+        if (rollback->max_rollback_depth > result.max_depth) result.max_depth = rollback->max_rollback_depth;
+        result.recovered += peers[i].protocol.input_history.frames_recovered;
+        result.paced += peers[i].protocol.clock_sync.frames_skipped + peers[i].protocol.clock_sync.frames_added;
+        bytes += peers[i].ble.bytes_sent;
+        result.desync_checks += peers[i].protocol.desync_check.checks;
+        result.desyncs += peers[i].protocol.desync_check.mismatches;
+    }
+    result.bytes_per_second = bytes / 2.0f / (tick * (float)NET_PEER_STEP_US / 1e6f);
+
+    net_telemetry_snapshot_t snapshot;
+    result.telemetry_matches = true;
+    for (int i = 0; i < 2; i++) {
+        net_telemetry_snapshot(&peers[i].protocol.telemetry, &snapshot);
+        result.telemetry_matches &= snapshot.histograms[NET_TELEMETRY_ROLLBACK_DEPTH].samples ==
+                                    peers[i].rollback.rollbacks;
+        result.telemetry_matches &= snapshot.inputs_delivered == peers[i].protocol.input_history.frames_delivered;
+    }
+    result.rtt_p50_us = net_telemetry_percentile(&snapshot.histograms[NET_TELEMETRY_RTT], NET_TELEMETRY_RTT, 50);
+    result.one_way_p50_us = net_telemetry_percentile(&snapshot.histograms[NET_TELEMETRY_ONE_WAY],
+                                                     NET_TELEMETRY_ONE_WAY, 50);
+    return result;
+}
+
+static race_result_t run_loopback_race(const link_sim_config_t *config, uint32_t drop_from, uint32_t drop_until) {
+    static transport_loopback_t loopback;
+    transport_t ends[2];
+
+    transport_loopback_init(&loopback, config, sim_clock, 0);
+    transport_loopback_endpoint(&loopback, 0, &ends[0]);
+    transport_loopback_endpoint(&loopback, 1, &ends[1]);
+    const transport_t *transports[2] = { &ends[0], &ends[1] };
+    return run_race(transports, &loopback, drop_from, drop_until);
+}
+
+static void print_result(const char *name, const race_result_t *result) {
+    printf("  %-8s | %5.2f %6.1f %5u %6u %9u %5u | %5.0f | %3u %3u | %s\n", name,
+           result->rollbacks * 100.0f / (2.0f * RACE_FRAMES), result->resimulated * 100.0f / (2.0f * RACE_FRAMES),
+           result->max_depth, result->stalls, result->recovered, result->paced, result->bytes_per_second,
+           result->rtt_p50_us / 1000, result->one_way_p50_us / 1000,
+           result->hashes_match ? "match" : result->finished ? "DIFFER" : "unfinished");
+}
+
+static void test_loopback_sweep(void) {
+    static const struct {
+        const char *name;
+        link_sim_config_t config;
+    } links[] = {
+        { "clean", { .latency_us = 10000, .seed = 11 } },
+        { "typical", { .latency_us = 20000, .jitter_us = 15000, .loss_percent = 2, .seed = 12 } },
+        { "poor", { .latency_us = 35000, .jitter_us = 30000, .loss_percent = 8, .reorder_percent = 3, .seed = 13 } },
+        { "awful", { .latency_us = 50000, .jitter_us = 50000, .loss_percent = 20, .reorder_percent = 10,
+                     .seed = 14 } },
+    };
+
+    printf("  per 100 frames per peer   rollbacks resim depth stalls recovered paced |  B/s  | rtt owd |"
+           " final hash\n");
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        race_result_t result = run_loopback_race(&links[i].config, UINT32_MAX, UINT32_MAX);
+        print_result(links[i].name, &result);
+        CHECK_MSG(result.hashes_match, "%s link", links[i].name);
+        CHECK(result.max_depth <= ROLLBACK_MAX_FRAMES);
+        CHECK(result.telemetry_matches);
+        CHECK(result.desync_checks > 0 && result.desyncs == 0);
+        // Measured delays never read below the link's own
+        CHECK(result.rtt_p50_us >= 2 * links[i].config.latency_us);
+        CHECK(result.one_way_p50_us >= links[i].config.latency_us);
+        if (i == 0) {
+            // Inputs from a 10 ms link always land inside the window
+            CHECK(result.stalls == 0);
+        }
+    }
+}
+
+static void test_dropout(void) {
+    // Half a second of nothing in the middle of a typical race
+    link_sim_config_t typical = { .latency_us = 20000, .jitter_us = 15000, .loss_percent = 2, .seed = 21 };
+    race_result_t result = run_loopback_race(&typical, RACE_FRAMES / 2, RACE_FRAMES / 2 + 30);
+    print_result("dropout", &result);
+    CHECK(result.hashes_match);
+}
+
+static void test_udp_race(void) {
+    static transport_udp_t a, b;
+    transport_t ends[2];
+    link_sim_config_t poor = { .latency_us = 35000, .jitter_us = 30000, .loss_percent = 8, .reorder_percent = 3,
+                               .seed = 31 };
+
+    sim_now_us = 0;
+    if (!transport_udp_open(&a, 0, 0, &poor, sim_clock, 0)) {
+        printf("  no UDP sockets here, skipped\n");
+        return;
+    }
+    poor.seed = 32;
+    if (!transport_udp_open(&b, 0, a.port, &poor, sim_clock, 0)) {
+        transport_udp_close(&a);
+        printf("  no UDP sockets here, skipped\n");
+        return;
+    }
+    transport_udp_set_peer(&a, b.port);
+    transport_udp_endpoint(&a, &ends[0]);
+    transport_udp_endpoint(&b, &ends[1]);
+
+    const transport_t *transports[2] = { &ends[0], &ends[1] };
+    race_result_t result = run_race(transports, NULL, UINT32_MAX, UINT32_MAX);
+    print_result("udp", &result);
+    CHECK(result.hashes_match);
+    CHECK(a.outbound.lost > 0 && b.outbound.reordered > 0);
+
+    transport_udp_close(&a);
+    transport_udp_close(&b);
+}
+
+int main(void) {
+    RUN_TEST(test_loopback_sweep);
+    RUN_TEST(test_dropout);
+    RUN_TEST(test_udp_race);
+    return host_test_finish();
+}
@@ -0,0 +1,190 @@
+// Link telemetry: values land in the right fixed buckets, percentiles read
+// back bucket bounds, jitter follows the change in transit time whatever
+// the clock offset, rollbacks fill the depth histogram and resimulated
+// frames per second, and the once-a-second line covers only its second.
+#include "host_test.h"
+#include "net_telemetry.h"
+#include <string.h>
+
+static void test_buckets(void) {
+    net_telemetry_t telemetry;
+    net_telemetry_init(&telemetry, 0);
+
+    // Bounds are inclusive and ascending; the last bucket is open
+    for (int metric = 0; metric < NET_TELEMETRY_METRICS; metric++) {
+        for (int i = 1; i < NET_TELEMETRY_BUCKETS; i++) {
+            CHECK(net_telemetry_bucket_bound(metric, i) > net_telemetry_bucket_bound(metric, i - 1));
+        }
+        CHECK(net_telemetry_bucket_bound(metric, NET_TELEMETRY_BUCKETS - 1) == UINT32_MAX);
+    }
+
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 0);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 10000);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 10001);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 1000000);
+
+    net_telemetry_snapshot_t snapshot;
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    const net_telemetry_histogram_t *rtt = &snapshot.histograms[NET_TELEMETRY_RTT];
+    CHECK(rtt->counts[0] == 2);
+    CHECK(rtt->counts[1] == 1);
+    CHECK(rtt->counts[NET_TELEMETRY_BUCKETS - 1] == 1);
+    CHECK(rtt->samples == 4);
+    CHECK(rtt->max == 1000000);
+    CHECK(rtt->sum == 1020001);
+    CHECK(snapshot.histograms[NET_TELEMETRY_JITTER].samples == 0);
+}
+
+static void test_percentiles(void) {
+    net_telemetry_t telemetry;
+    net_telemetry_init(&telemetry, 0);
+    net_telemetry_snapshot_t snapshot;
+
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    CHECK(net_telemetry_percentile(&snapshot.histograms[NET_TELEMETRY_RTT], NET_TELEMETRY_RTT, 50) == 0);
+
+    // 90 at 28 ms, 9 at 45 ms, 1 far out
+    for (int i = 0; i < 90; i++) net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 28000);
+    for (int i = 0; i < 9; i++) net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 45000);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 900000);
+
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    const net_telemetry_histogram_t *rtt = &snapshot.histograms[NET_TELEMETRY_RTT];
+    CHECK(net_telemetry_percentile(rtt, NET_TELEMETRY_RTT, 50) == 30000);
+    CHECK(net_telemetry_percentile(rtt, NET_TELEMETRY_RTT, 90) == 30000);
+    CHECK(net_telemetry_percentile(rtt, NET_TELEMETRY_RTT, 95) == 50000);
+    CHECK(net_telemetry_percentile(rtt, NET_TELEMETRY_RTT, 99) == 50000);
+    CHECK(net_telemetry_percentile(rtt, NET_TELEMETRY_RTT, 100) == 900000);
+}
+
+static void test_jitter(void) {
+    net_telemetry_t telemetry;
+    net_telemetry_init(&telemetry, 0);
+    uint32_t rng = 7;
+
+    // A frame every 16.667 ms with 20 ms of delay, +-3 ms of noise and an
+    // arbitrary offset between the clocks
+    int64_t offset = 987654321;
+    int64_t previous = 0;
+    uint64_t expected = 0;
+    for (uint32_t frame = 0; frame < 600; frame++) {
+        int64_t send = (int64_t)frame * 1000000 / 60;
+        int64_t transit = 20000 + (int64_t)(host_rand(&rng) % 6001) - 3000;
+        net_telemetry_record_transit(&telemetry, send, send + offset + transit);
+        if (frame > 0) expected += (uint64_t)(transit > previous ? transit - previous : previous - transit);
+        previous = transit;
+    }
+
+    net_telemetry_snapshot_t snapshot;
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    const net_telemetry_histogram_t *jitter = &snapshot.histograms[NET_TELEMETRY_JITTER];
+    printf("  jitter p50 %u us, p95 %u us, max %u us\n",
+           net_telemetry_percentile(jitter, NET_TELEMETRY_JITTER, 50),
+           net_telemetry_percentile(jitter, NET_TELEMETRY_JITTER, 95), jitter->max);
+    CHECK(jitter->samples == 599);
+    CHECK(jitter->sum == expected);
+    CHECK(jitter->max <= 6000);
+    CHECK(net_telemetry_percentile(jitter, NET_TELEMETRY_JITTER, 95) <= 6000);
+
+    // Reset forgets the previous transit
+    net_telemetry_reset(&telemetry, 0);
+    net_telemetry_record_transit(&telemetry, 0, 5000000);
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    CHECK(snapshot.histograms[NET_TELEMETRY_JITTER].samples == 0);
+}
+
+static void test_rollbacks_and_counters(void) {
+    net_telemetry_t telemetry;
+    net_telemetry_init(&telemetry, 1000);
+
+    // 30 rollbacks of depth 3 in the first second, none in the second
+    for (int i = 0; i < 30; i++) net_telemetry_record_rollback(&telemetry, 3, 3);
+    CHECK(!net_telemetry_tick(&telemetry, 1000 + NET_TELEMETRY_PERIOD_US - 1, NULL, 0));
+    CHECK(net_telemetry_tick(&telemetry, 1000 + NET_TELEMETRY_PERIOD_US, NULL, 0));
+    CHECK(net_telemetry_tick(&telemetry, 1000 + 2 * NET_TELEMETRY_PERIOD_US, NULL, 0));
+
+    for (int i = 0; i < 60; i++) net_telemetry_count_sent(&telemetry, NET_TELEMETRY_INPUT, 9);
+    net_telemetry_count_received(&telemetry, NET_TELEMETRY_STATE, 11);
+    net_telemetry_count_received(&telemetry, NET_TELEMETRY_STATE, 7);
+    net_telemetry_count_inputs(&telemetry, 60, 2, 1);
+
+    net_telemetry_snapshot_t snapshot;
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    const net_telemetry_histogram_t *depth = &snapshot.histograms[NET_TELEMETRY_ROLLBACK_DEPTH];
+    const net_telemetry_histogram_t *resimulated = &snapshot.histograms[NET_TELEMETRY_RESIMULATED];
+    CHECK(depth->samples == 30);
+    CHECK(net_telemetry_percentile(depth, NET_TELEMETRY_ROLLBACK_DEPTH, 50) == 3);
+    CHECK(resimulated->samples == 2);
+    CHECK(resimulated->counts[0] == 1);
+    CHECK(resimulated->max == 90);
+    CHECK(snapshot.sent[NET_TELEMETRY_INPUT].packets == 60 && snapshot.sent[NET_TELEMETRY_INPUT].bytes == 540);
+    CHECK(snapshot.received[NET_TELEMETRY_STATE].packets == 2 && snapshot.received[NET_TELEMETRY_STATE].bytes == 18);
+    CHECK(snapshot.sent[NET_TELEMETRY_CLOCK].packets == 0);
+    CHECK(snapshot.inputs_delivered == 60 && snapshot.inputs_recovered == 2 && snapshot.inputs_lost == 1);
+    CHECK(snapshot.since_us == 1000);
+
+    net_telemetry_reset(&telemetry, 5000000);
+    net_telemetry_snapshot(&telemetry, &snapshot);
+    CHECK(snapshot.histograms[NET_TELEMETRY_ROLLBACK_DEPTH].samples == 0);
+    CHECK(snapshot.sent[NET_TELEMETRY_INPUT].packets == 0);
+    CHECK(snapshot.since_us == 5000000);
+}
+
+static void test_log_line(void) {
+    net_telemetry_t telemetry;
+    char line[NET_TELEMETRY_LINE_SIZE];
+    net_telemetry_init(&telemetry, 0);
+
+    // First second: a bad link
+    for (int i = 0; i < 4; i++) net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 140000);
+    net_telemetry_record_rollback(&telemetry, 7, 7);
+    for (int i = 0; i < 60; i++) net_telemetry_count_sent(&telemetry, NET_TELEMETRY_INPUT, 12);
+    CHECK(net_telemetry_tick(&telemetry, NET_TELEMETRY_PERIOD_US, line, sizeof(line)));
+    printf("  %s\n", line);
+    CHECK(strstr(line, "rtt 150/150 ") == line);
+    CHECK(strstr(line, " rb 1 d7/7 resim 7 ") != NULL);
+    CHECK(strstr(line, " in 60/720:0/0") != NULL);
+
+    // Second: a good one, which must not inherit the first
+    for (int i = 0; i < 4; i++) net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 22000);
+    for (int i = 0; i < 60; i++) net_telemetry_count_sent(&telemetry, NET_TELEMETRY_INPUT, 9);
+    for (int i = 0; i < 4; i++) net_telemetry_count_received(&telemetry, NET_TELEMETRY_CLOCK, 12);
+    CHECK(net_telemetry_tick(&telemetry, 2 * NET_TELEMETRY_PERIOD_US, line, sizeof(line)));
+    printf("  %s\n", line);
+    CHECK(strstr(line, "rtt 25/25 ") == line);
+    CHECK(strstr(line, " rb 0 d0/0 resim 0 ") != NULL);
+    CHECK(strstr(line, " in 60/540:0/0") != NULL);
+    CHECK(strstr(line, " ck 0/0:4/48") != NULL);
+
+    // A second far worse than any race still fits
+    for (int type = 0; type < NET_TELEMETRY_TYPES; type++) {
+        for (int i = 0; i < 999; i++) {
+            net_telemetry_count_sent(&telemetry, type, 244);
+            net_telemetry_count_received(&telemetry, type, 244);
+        }
+    }
+    net_telemetry_record(&telemetry, NET_TELEMETRY_RTT, 9999999);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_ONE_WAY, 9999999);
+    net_telemetry_record(&telemetry, NET_TELEMETRY_JITTER, 9999999);
+    net_telemetry_count_inputs(&telemetry, 9999, 9999, 9999);
+    for (int i = 0; i < 999; i++) net_telemetry_record_rollback(&telemetry, 99, 99);
+    CHECK(net_telemetry_tick(&telemetry, 3 * NET_TELEMETRY_PERIOD_US, line, sizeof(line)));
+    printf("  %s\n", line);
+    CHECK(strlen(line) < sizeof(line) - 1);
+    CHECK(strstr(line, " ck 999/243756:999/243756") != NULL);
+
+    // Past that it is cut short, never overrun
+    for (int i = 0; i < 1000; i++) net_telemetry_count_sent(&telemetry, NET_TELEMETRY_CLOCK, 4000000);
+    net_telemetry_count_inputs(&telemetry, UINT32_MAX / 2, UINT32_MAX / 2, UINT32_MAX / 2);
+    CHECK(net_telemetry_tick(&telemetry, 4 * NET_TELEMETRY_PERIOD_US, line, 64));
+    CHECK(strlen(line) == 63);
+}
+
+int main(void) {
+    RUN_TEST(test_buckets);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_jitter);
+    RUN_TEST(test_rollbacks_and_counters);
+    RUN_TEST(test_log_line);
+    return host_test_finish();
+}
@@ -0,0 +1,280 @@
+// Host tests for physics.c: tile rays, sweeps and the collision passes
+#include "host_test.h"
+#include "physics.h"
+#include <math.h>
+#include <string.h>
+
+#define MAP_W 32
+#define MAP_H 32
+#define TILE 16
+
+static uint8_t tiles[MAP_W * MAP_H];
+
+static void setup_map(uint32_t seed, int solid_percent) {
+    static const physics_surface_t surfaces[2] = {
+        { .friction = PHYSICS_SURFACE_ONE, .speed_cap = PHYSICS_SURFACE_ONE, .flags = 0 },
+        { .friction = PHYSICS_SURFACE_ONE, .speed_cap = PHYSICS_SURFACE_ONE, .flags = PHYSICS_SURFACE_SOLID },
+    };
+    for (int i = 0; i < MAP_W * MAP_H; i++) {
+        tiles[i] = (int)(host_rand(&seed) % 100) < solid_percent ? 1 : 0;
+    }
+    physics_tilemap_t map = { tiles, MAP_W, MAP_H, INT_TO_FIXED16(TILE) };
+    physics_set_tilemap(&map);
+    physics_set_surfaces(surfaces, 2);
+    physics_set_collision_rects(NULL, 0);
+}
+
+static bool ref_blocking(int x, int y) {
+    if (x < 0 || y < 0 || x >= MAP_W || y >= MAP_H) return true;
+    return tiles[y * MAP_W + x] == 1;
+}
+
+// Double-precision grid walk; returns the entry distance of the first
+// blocking cell, or -1 when nothing blocks within max_distance
+static double ref_ray(double ox, double oy, double dx, double dy, double max_distance) {
+    int x = (int)floor(ox / TILE), y = (int)floor(oy / TILE);
+    int step_x = dx < 0 ? -1 : 1, step_y = dy < 0 ? -1 : 1;
+    double t_max_x = dx != 0 ? ((dx > 0 ? (x + 1) * TILE : x * TILE) - ox) / dx : INFINITY;
+    double t_max_y = dy != 0 ? ((dy > 0 ? (y + 1) * TILE : y * TILE) - oy) / dy : INFINITY;
+    double t_delta_x = dx != 0 ? TILE / fabs(dx) : INFINITY;
+    double t_delta_y = dy != 0 ? TILE / fabs(dy) : INFINITY;
+    double t = 0;
+
+    while (!ref_blocking(x, y)) {
+        if (t_max_x < t_max_y) {
+            t = t_max_x;
+            x += step_x;
+            t_max_x += t_delta_x;
+        } else {
+            t = t_max_y;
+            y += step_y;
+            t_max_y += t_delta_y;
+        }
+        if (t > max_distance) return -1;
+    }
+    return t;
+}
+
+static void test_ray_matches_reference(void) {
+    setup_map(1234, 15);
+    uint32_t rng = 99;
+    int cases = 0, mismatches = 0;
+
+    for (int i = 0; i < 20000; i++) {
+        double ox = (host_rand(&rng) % (MAP_W * TILE * 64)) / 64.0;
+        double oy = (host_rand(&rng) % (MAP_H * TILE * 64)) / 64.0;
+        if (ref_blocking((int)(ox / TILE), (int)(oy / TILE))) continue;
+
+        angle16_t angle = (angle16_t)host_rand(&rng);
+        vec2_t dir = { angle16_cos_lerp(angle), angle16_sin_lerp(angle) };
+        double dx = dir.x / 65536.0, dy = dir.y / 65536.0;
+        double len = sqrt(dx * dx + dy * dy);
+        vec2_t origin = { (fixed16_t)(ox * 65536), (fixed16_t)(oy * 65536) };
+
+        physics_ray_hit_t hit;
+        bool got = physics_ray_cast_tiles(origin, dir, INT_TO_FIXED16(200), &hit);
+        double expect = ref_ray(ox, oy, dx / len, dy / len, 200.0);
+        cases++;
+
+        // Grazing a tile corner may legitimately pick the other neighbour
+        if (got != (expect >= 0) || (got && fabs(FIXED16_TO_FLOAT(hit.distance) - expect) > 0.05)) {
+            mismatches++;
+        }
+        if (got) {
+            CHECK(hit.hit);
+            CHECK(hit.tile == 1 || hit.tile == PHYSICS_TILE_NONE);
+        }
+    }
+    CHECK_MSG(cases > 10000, "%d cases", cases);
+    CHECK_MSG(mismatches * 1000 <= cases, "%d of %d rays disagree with the reference", mismatches, cases);
+}
+
+static void test_ray_batch_matches_single(void) {
+    setup_map(42, 20);
+    vec2_t origin = { INT_TO_FIXED16(MAP_W * TILE / 2) + 123, INT_TO_FIXED16(MAP_H * TILE / 2) + 77 };
+    tiles[(MAP_H / 2) * MAP_W + MAP_W / 2] = 0;
+
+    vec2_t dirs[256];
+    physics_ray_hit_t batch[256];
+    for (int i = 0; i < 256; i++) {
+        angle16_t angle = (angle16_t)(i << 8);
+        dirs[i] = (vec2_t){ angle16_cos_lerp(angle), angle16_sin_lerp(angle) };
+    }
+    int hits = physics_ray_cast_tiles_batch(origin, dirs, 256, INT_TO_FIXED16(1000), batch);
+
+    int single_hits = 0;
+    for (int i = 0; i < 256; i++) {
+        physics_ray_hit_t hit;
+        single_hits += physics_ray_cast_tiles(origin, dirs[i], INT_TO_FIXED16(1000), &hit);
+        CHECK(hit.hit == batch[i].hit);
+        CHECK(hit.distance == batch[i].distance);
+        CHECK(hit.tile == batch[i].tile);
+    }
+    CHECK(hits == single_hits);
+    CHECK(hits == 256);  // The map edge stops every ray
+}
+
+static void test_off_map_blocks_rays_and_sweeps(void) {
+    setup_map(1, 0);
+    fixed16_t edge = INT_TO_FIXED16(MAP_W * TILE);
+    vec2_t origin = { edge - INT_TO_FIXED16(40), INT_TO_FIXED16(100) };
+
+    physics_ray_hit_t ray;
+    CHECK(physics_ray_cast_tiles(origin, (vec2_t){ FIXED16_ONE, 0 }, INT_TO_FIXED16(100), &ray));
+    CHECK(ray.tile == PHYSICS_TILE_NONE);
+    CHECK(ray.distance == INT_TO_FIXED16(40));
+
+    // A sweep across the same edge stops a radius short of it
+    physics_sweep_hit_t hit;
+    vec2_t end = { edge + INT_TO_FIXED16(40), origin.y };
+    CHECK(physics_sweep_circle(origin, end, PHYSICS_CAR_RADIUS, &hit));
+    CHECK(hit.normal.x < 0);
+    CHECK(hit.point.x <= edge - PHYSICS_CAR_RADIUS);
+    CHECK(hit.point.x > edge - PHYSICS_CAR_RADIUS - FIXED16_ONE);
+
+    // And across the top-left corner of the map
+    vec2_t corner_start = { INT_TO_FIXED16(20), INT_TO_FIXED16(20) };
+    CHECK(physics_sweep_circle(corner_start, (vec2_t){ INT_TO_FIXED16(-30), INT_TO_FIXED16(-30) },
+                               PHYSICS_CAR_RADIUS, &hit));
+    CHECK(hit.point.x >= PHYSICS_CAR_RADIUS - FIXED16_ONE);
+
+    // Motion that stays on the map is free
+    CHECK(!physics_sweep_circle(origin, (vec2_t){ origin.x + INT_TO_FIXED16(20), origin.y },
+                                PHYSICS_CAR_RADIUS, &hit));
+}
+
+// Solid column of tiles at x = WALL_TILE, one tile (16 units) thick
+#define WALL_TILE 10
+#define WALL_FACE INT_TO_FIXED16(WALL_TILE * TILE)
+
+static void setup_wall(void) {
+    setup_map(1, 0);
+    for (int y = 0; y < MAP_H; y++) {
+        tiles[y * MAP_W + WALL_TILE] = 1;
+    }
+}
+
+static void place_car(physics_world_t *world, int index, vec2_t position, vec2_t velocity) {
+    car_physics_t *car = &world->cars[index];
+    memset(car, 0, sizeof(*car));
+    car->mass = INT_TO_FIXED16(1000);
+    car->drag = PHYSICS_DRAG_COEFFICIENT;
+    car->friction = PHYSICS_FRICTION_COEFFICIENT;
+    car->position = position;
+    car->velocity = velocity;
+}
+
+static void test_sweep_starting_in_contact(void) {
+    setup_wall();
+
+    // The review case: 6 units from the face (2 inside the radius), moving +40
+    vec2_t start = { WALL_FACE - INT_TO_FIXED16(6), INT_TO_FIXED16(100) };
+    physics_sweep_hit_t hit;
+    CHECK(physics_sweep_circle(start, (vec2_t){ start.x + INT_TO_FIXED16(40), start.y },
+                               PHYSICS_CAR_RADIUS, &hit));
+    CHECK(hit.toi == 0);
+    CHECK_MSG(hit.normal.x <= -FIXED16_ONE + 4 && hit.normal.y == 0, "normal %d %d", hit.normal.x, hit.normal.y);
+
+    // Moving back out of the overlap is not a contact
+    CHECK(!physics_sweep_circle(start, (vec2_t){ start.x - INT_TO_FIXED16(40), start.y },
+                                PHYSICS_CAR_RADIUS, &hit));
+}
+
+static void test_fast_cars_do_not_tunnel(void) {
+    static physics_world_t world;
+    setup_wall();
+    int cases = 0;
+
+    // Every start up to and overlapping the face, up to 200 units per step
+    for (int offset = 40; offset >= 0; offset--) {
+        for (int speed = 10; speed <= 200; speed += 5) {
+            memset(&world, 0, sizeof(world));
+            vec2_t start = { WALL_FACE - INT_TO_FIXED16(offset), INT_TO_FIXED16(100) + offset * 977 };
+            place_car(&world, 0, start, (vec2_t){ INT_TO_FIXED16(speed * 60), INT_TO_FIXED16(speed) });
+            place_car(&world, 1, (vec2_t){ INT_TO_FIXED16(40), INT_TO_FIXED16(400) }, (vec2_t){0, 0});
+
+            physics_update(&world, 1.0f / 60.0f);
+            cases++;
+            CHECK_MSG(world.cars[0].position.x <= WALL_FACE - PHYSICS_CAR_RADIUS,
+                      "start %d units out at %d units/step ended at x %.3f",
+                      offset, speed, FIXED16_TO_FLOAT(world.cars[0].position.x));
+        }
+    }
+    CHECK(cases > 1000);
+}
+
+static void test_rounded_corners(void) {
+    setup_map(1, 0);
+    tiles[WALL_TILE * MAP_W + WALL_TILE] = 1;  // One solid tile at (160, 160)..(176, 176)
+    fixed16_t corner = WALL_FACE;
+    physics_sweep_hit_t hit;
+
+    // A diagonal pass 10 units from the corner clears the radius, though it
+    // crosses the square inflated box
+    fixed16_t off = FLOAT_TO_FIXED16(10.0f / 1.41421356f);
+    vec2_t start = { corner - off - INT_TO_FIXED16(10), corner - off + INT_TO_FIXED16(10) };
+    vec2_t end = { corner - off + INT_TO_FIXED16(10), corner - off - INT_TO_FIXED16(10) };
+    CHECK(!physics_sweep_circle(start, end, PHYSICS_CAR_RADIUS, &hit));
+
+    // Heading straight at the corner hits it with a diagonal normal
+    start = (vec2_t){ corner - INT_TO_FIXED16(30), corner - INT_TO_FIXED16(30) };
+    CHECK(physics_sweep_circle(start, (vec2_t){ corner, corner }, PHYSICS_CAR_RADIUS, &hit));
+    CHECK(hit.normal.x < -FIXED16_HALF && hit.normal.y < -FIXED16_HALF);
+    int64_t dx = (int64_t)hit.point.x - corner, dy = (int64_t)hit.point.y - corner;
+    int64_t distance = isqrt64((uint64_t)(dx * dx + dy * dy));
+    CHECK_MSG(distance >= PHYSICS_CAR_RADIUS - FIXED16_ONE / 256 && distance <= PHYSICS_CAR_RADIUS + FIXED16_ONE / 256,
+              "stopped %.4f from the corner", FIXED16_TO_FLOAT(distance));
+}
+
+static void test_tiled_wall_has_no_seams(void) {
+    setup_wall();
+    physics_sweep_hit_t hit;
+
+    // Hitting the wall where two tiles meet (y = 96) sees one flat face
+    for (int y = 90; y <= 102; y++) {
+        vec2_t start = { WALL_FACE - INT_TO_FIXED16(30), INT_TO_FIXED16(y) };
+        vec2_t end = { WALL_FACE + INT_TO_FIXED16(10), INT_TO_FIXED16(y) - INT_TO_FIXED16(6) };
+        CHECK(physics_sweep_circle(start, end, PHYSICS_CAR_RADIUS, &hit));
+        CHECK_MSG(hit.normal.x == -FIXED16_ONE && hit.normal.y == 0, "y %d normal %d %d",
+                  y, hit.normal.x, hit.normal.y);
+    }
+}
+
+static void test_separation_and_overlap_push_out_of_walls(void) {
+    static physics_world_t world;
+    setup_wall();
+
+    // Car-car separation pushes car 0 towards the wall it sits beside
+    memset(&world, 0, sizeof(world));
+    place_car(&world, 0, (vec2_t){ WALL_FACE - INT_TO_FIXED16(10), INT_TO_FIXED16(100) }, (vec2_t){0, 0});
+    place_car(&world, 1, (vec2_t){ WALL_FACE - INT_TO_FIXED16(40), INT_TO_FIXED16(100) }, (vec2_t){0, 0});
+    physics_update(&world, 1.0f / 60.0f);
+    CHECK(world.cars[0].position.x <= WALL_FACE - PHYSICS_CAR_RADIUS);
+
+    // Cars already overlapping a wall, with the centre outside and inside it
+    static const int offsets[] = { -6, -1, 0, 2, 7 };
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        memset(&world, 0, sizeof(world));
+        place_car(&world, 0, (vec2_t){ WALL_FACE + INT_TO_FIXED16(offsets[i]), INT_TO_FIXED16(100) },
+                  (vec2_t){0, 0});
+        place_car(&world, 1, (vec2_t){ INT_TO_FIXED16(40), INT_TO_FIXED16(400) }, (vec2_t){0, 0});
+        physics_update(&world, 1.0f / 60.0f);
+        CHECK_MSG(world.cars[0].position.x <= WALL_FACE - PHYSICS_CAR_RADIUS,
+                  "offset %d ended at x %.3f", offsets[i], FIXED16_TO_FLOAT(world.cars[0].position.x));
+    }
+}
+
+int main(void) {
+    physics_init();
+
+    RUN_TEST(test_ray_matches_reference);
+    RUN_TEST(test_ray_batch_matches_single);
+    RUN_TEST(test_off_map_blocks_rays_and_sweeps);
+    RUN_TEST(test_sweep_starting_in_contact);
+    RUN_TEST(test_fast_cars_do_not_tunnel);
+    RUN_TEST(test_rounded_corners);
+    RUN_TEST(test_tiled_wall_has_no_seams);
+    RUN_TEST(test_separation_and_overlap_push_out_of_walls);
+
+    return host_test_finish();
+}
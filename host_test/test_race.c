@@ -0,0 +1,241 @@
+// Race progress: scripted trajectories through the checkpoint gates
+#include "host_test.h"
+#include "physics.h"
+#include <string.h>
+
+// 1024x1024 open map so the legacy circular track stays out of the way
+#define MAP_SIZE 64
+#define DT 0.02f
+#define STEP_MS 20
+
+static uint8_t tiles[MAP_SIZE * MAP_SIZE];
+static physics_world_t world;
+
+// Square circuit driven clockwise (x right, y down), one gate per edge
+static const vec2_t corners[4] = {
+    { INT_TO_FIXED16(800), INT_TO_FIXED16(200) }, { INT_TO_FIXED16(800), INT_TO_FIXED16(800) },
+    { INT_TO_FIXED16(200), INT_TO_FIXED16(800) }, { INT_TO_FIXED16(200), INT_TO_FIXED16(200) },
+};
+
+static void setup_race(uint8_t laps) {
+    physics_tilemap_t map = { tiles, MAP_SIZE, MAP_SIZE, INT_TO_FIXED16(16) };
+    physics_set_tilemap(&map);
+    physics_set_centreline(NULL, 0);
+
+    memset(&world, 0, sizeof(world));
+    static const int gates[4][2] = { { 500, 200 }, { 800, 500 }, { 500, 800 }, { 200, 500 } };
+    for (int i = 0; i < 4; i++) {
+        world.checkpoints[i].position = (vec2_t){ INT_TO_FIXED16(gates[i][0]), INT_TO_FIXED16(gates[i][1]) };
+        world.checkpoints[i].radius = INT_TO_FIXED16(60);
+        world.checkpoints[i].index = (uint8_t)i;
+    }
+    world.checkpoint_count = 4;
+    world.total_laps = laps;
+
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+        world.cars[i].position = (vec2_t){ INT_TO_FIXED16(100 + 40 * i), INT_TO_FIXED16(950) };
+    }
+    world.cars[0].position = (vec2_t){ INT_TO_FIXED16(300), INT_TO_FIXED16(200) };
+    physics_start_race(&world);
+}
+
+// Smallest velocity whose 16.16 step over dt moves exactly motion
+static fixed16_t velocity_for(fixed16_t motion, fixed16_t dt) {
+    int64_t scaled = (int64_t)motion * FIXED16_ONE;
+    int64_t velocity = scaled / dt;
+    if (velocity * dt < scaled) velocity++;
+    return (fixed16_t)velocity;
+}
+
+// Drives car 0 in a straight line to target at speed units per step,
+// landing on it exactly
+static void drive_to(vec2_t target, int speed) {
+    fixed16_t dt = FLOAT_TO_FIXED16(DT);
+    for (int guard = 0; guard < 10000 && !world.race_finished[0]; guard++) {
+        car_physics_t *car = &world.cars[0];
+        vec2_t to_target = vec2_sub(target, car->position);
+        fixed16_t distance = vec2_length(to_target);
+        if (distance == 0) return;
+
+        vec2_t motion = distance <= INT_TO_FIXED16(speed) ? to_target
+                                                          : vec2_scale(vec2_normalize(to_target), INT_TO_FIXED16(speed));
+        car->velocity = (vec2_t){ velocity_for(motion.x, dt), velocity_for(motion.y, dt) };
+        physics_update(&world, DT);
+    }
+}
+
+// From corner 0 round to corner 0 again
+static void drive_lap(int speed) {
+    for (int i = 1; i <= 4; i++) {
+        drive_to(corners[i % 4], speed);
+    }
+}
+
+static void test_clean_laps(void) {
+    setup_race(2);
+    const physics_car_progress_t *progress = &world.progress[0];
+
+    drive_to(corners[0], 10);
+    CHECK(progress->lap == 1);
+    CHECK(progress->next_checkpoint == 1);
+    uint32_t start = progress->lap_start_time;
+    CHECK(start > 0 && start <= world.race_time[0]);
+
+    // One lap of 2400 units at 10 units per step is 240 steps
+    drive_lap(10);
+    CHECK(progress->lap == 2);
+    CHECK_MSG(progress->last_lap_time >= 240 * STEP_MS - 2 * STEP_MS &&
+              progress->last_lap_time <= 240 * STEP_MS + 2 * STEP_MS,
+              "lap took %lu ms", (unsigned long)progress->last_lap_time);
+    CHECK(progress->best_lap_time == progress->last_lap_time);
+
+    uint32_t sectors = 0;
+    for (int i = 0; i < 4; i++) {
+        CHECK(progress->sector_times[i] > 0);
+        sectors += progress->sector_times[i];
+    }
+    CHECK(sectors == progress->last_lap_time);
+
+    // A faster second lap becomes the best and finishes the race
+    uint32_t first_lap = progress->last_lap_time;
+    drive_lap(20);
+    CHECK(world.race_finished[0]);
+    CHECK(physics_check_race_finished(&world, 0));
+    CHECK(progress->last_lap_time < first_lap);
+    CHECK(progress->best_lap_time == progress->last_lap_time);
+    CHECK(!world.race_finished[1]);
+}
+
+static void test_skipped_gate_does_not_count(void) {
+    setup_race(3);
+    const physics_car_progress_t *progress = &world.progress[0];
+
+    drive_to(corners[0], 10);
+    drive_to(corners[1], 10);  // Through gate 1
+    CHECK(progress->next_checkpoint == 2);
+
+    // Cut across the infield, missing gate 2 on the bottom edge
+    drive_to((vec2_t){ INT_TO_FIXED16(200), INT_TO_FIXED16(650) }, 10);
+    drive_to(corners[3], 10);  // Through gate 3, which is not next
+    CHECK(progress->next_checkpoint == 2);
+    drive_to((vec2_t){ INT_TO_FIXED16(700), INT_TO_FIXED16(200) }, 10);  // Over the start line
+    CHECK(progress->lap == 1);
+    CHECK(progress->last_lap_time == 0);
+}
+
+static void test_reversing_over_the_line(void) {
+    setup_race(3);
+    const physics_car_progress_t *progress = &world.progress[0];
+
+    drive_to(corners[0], 10);
+    drive_lap(10);
+    CHECK(progress->lap == 2);
+    uint32_t lap_time = progress->last_lap_time;
+    drive_to((vec2_t){ INT_TO_FIXED16(600), INT_TO_FIXED16(200) }, 10);
+
+    // Back over the start line: the lap is undone and the car is flagged
+    drive_to((vec2_t){ INT_TO_FIXED16(400), INT_TO_FIXED16(200) }, 10);
+    CHECK(progress->lap == 1);
+    CHECK(progress->next_checkpoint == 0);
+    CHECK(progress->rewind_depth == 1);
+    CHECK(progress->wrong_way);
+
+    // Forwards again restores it without closing another lap
+    drive_to((vec2_t){ INT_TO_FIXED16(600), INT_TO_FIXED16(200) }, 10);
+    CHECK(progress->lap == 2);
+    CHECK(progress->rewind_depth == 0);
+    CHECK(progress->next_checkpoint == 1);
+    CHECK(progress->last_lap_time == lap_time);
+    CHECK(!progress->wrong_way);
+}
+
+static void test_line_and_gate_edges(void) {
+    setup_race(3);
+    const physics_car_progress_t *progress = &world.progress[0];
+
+    // Stopping exactly on the line counts once, and rocking on it adds nothing
+    drive_to((vec2_t){ INT_TO_FIXED16(500), INT_TO_FIXED16(200) }, 10);
+    CHECK(progress->lap == 1);
+    for (int i = 0; i < 5; i++) {
+        drive_to((vec2_t){ INT_TO_FIXED16(500) + FIXED16_ONE / 2, INT_TO_FIXED16(200) }, 10);
+        drive_to((vec2_t){ INT_TO_FIXED16(500), INT_TO_FIXED16(200) }, 10);
+    }
+    CHECK(progress->lap == 1);
+    CHECK(progress->next_checkpoint == 1);
+
+    // Passing beside gate 1, outside its 60-unit half-width, does not count
+    drive_to((vec2_t){ INT_TO_FIXED16(700), INT_TO_FIXED16(400) }, 10);
+    drive_to((vec2_t){ INT_TO_FIXED16(700), INT_TO_FIXED16(600) }, 10);
+    CHECK(progress->next_checkpoint == 1);
+
+    // Through its end point exactly still counts
+    drive_to((vec2_t){ INT_TO_FIXED16(740), INT_TO_FIXED16(400) }, 10);
+    drive_to((vec2_t){ INT_TO_FIXED16(740), INT_TO_FIXED16(600) }, 10);
+    CHECK(progress->next_checkpoint == 2);
+}
+
+// Loop longer than 32767 px; segment 2 runs through the origin
+static const vec2_t long_loop[4] = {
+    { INT_TO_FIXED16(10000), INT_TO_FIXED16(-5000) }, { INT_TO_FIXED16(10000), INT_TO_FIXED16(5000) },
+    { 0, INT_TO_FIXED16(5000) }, { 0, INT_TO_FIXED16(-5000) },
+};
+
+static bool near_px(int64_t value, int64_t px) {
+    int64_t error = value - px * FIXED16_ONE;
+    return error >= -FIXED16_ONE && error <= FIXED16_ONE;
+}
+
+static void test_long_centreline(void) {
+    physics_set_tilemap(NULL);
+    physics_set_centreline(long_loop, 4);
+    CHECK(near_px(physics_get_centreline_length(), 40000));
+
+    memset(&world, 0, sizeof(world));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+    }
+    world.cars[0].position = (vec2_t){ INT_TO_FIXED16(8000), INT_TO_FIXED16(-5000) };
+    physics_start_race(&world);
+    CHECK(near_px(world.track_length, 40000));
+    CHECK(world.progress[0].segment == 3);
+
+    physics_update(&world, DT);
+    CHECK_MSG(near_px(world.progress[0].lap_distance, 38000), "lap_distance %lld",
+              (long long)(world.progress[0].lap_distance >> 16));
+
+    physics_set_centreline(NULL, 0);
+}
+
+static void test_reset_seeds_centreline_segment(void) {
+    physics_set_tilemap(NULL);
+    physics_set_centreline(long_loop, 4);
+
+    memset(&world, 0, sizeof(world));
+    physics_reset_race(&world);
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        CHECK(world.progress[i].segment == 2);
+    }
+
+    // From the seeded segment the first step lands on the right arc length
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world.cars[i].mass = INT_TO_FIXED16(1000);
+    }
+    physics_update(&world, DT);
+    CHECK(near_px(world.progress[0].lap_distance, 25000));
+
+    physics_set_centreline(NULL, 0);
+}
+
+int main(void) {
+    physics_init();
+
+    RUN_TEST(test_clean_laps);
+    RUN_TEST(test_skipped_gate_does_not_count);
+    RUN_TEST(test_reversing_over_the_line);
+    RUN_TEST(test_line_and_gate_edges);
+    RUN_TEST(test_long_centreline);
+    RUN_TEST(test_reset_seeds_centreline_segment);
+
+    return host_test_finish();
+}
@@ -0,0 +1,157 @@
+// Render snapshot triple buffer: single-threaded rules, then a producer and
+// consumer thread hammering it. Each published slot is filled from its
+// sequence number, so a torn or reused slot shows up as a mismatch.
+#include "host_test.h"
+#include "render_snapshot.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#ifndef STRESS_SNAPSHOTS
+#define STRESS_SNAPSHOTS 2000000
+#endif
+
+static render_snapshot_buffer_t buffer;
+
+static void fill(render_snapshot_t *snapshot, uint32_t sequence) {
+    snapshot->sequence = sequence;
+    snapshot->sim_time_us = (int64_t)sequence * 16667;
+    snapshot->input_time_us = (int64_t)sequence * 16667 - 1000;
+    snapshot->car_count = PHYSICS_MAX_CARS;
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        render_car_t *car = &snapshot->cars[i];
+        car->position = (vec2_t){ (fixed16_t)(sequence + i), (fixed16_t)~sequence };
+        car->heading = (fixed16_t)(sequence * 3);
+        car->speed = (fixed16_t)(sequence ^ 0x5a5a5a5a);
+        car->lap = (uint8_t)(sequence >> 8);
+        car->position_in_race = (uint8_t)(i + 1);
+        car->wrong_way = (sequence & 1) != 0;
+        car->finished = (sequence & 2) != 0;
+    }
+}
+
+static bool consistent(const render_snapshot_t *snapshot) {
+    render_snapshot_t expected;
+    memset(&expected, 0, sizeof(expected));
+    fill(&expected, snapshot->sequence);
+    if (snapshot->sim_time_us != expected.sim_time_us || snapshot->input_time_us != expected.input_time_us ||
+        snapshot->car_count != expected.car_count) {
+        return false;
+    }
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        const render_car_t *a = &snapshot->cars[i];
+        const render_car_t *b = &expected.cars[i];
+        if (a->position.x != b->position.x || a->position.y != b->position.y || a->heading != b->heading ||
+            a->speed != b->speed || a->lap != b->lap || a->position_in_race != b->position_in_race ||
+            a->wrong_way != b->wrong_way || a->finished != b->finished) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_single_thread(void) {
+    bool fresh;
+    render_snapshot_init(&buffer);
+
+    // Nothing published yet: the reader keeps its own slot
+    render_snapshot_acquire(&buffer, &fresh);
+    CHECK(!fresh);
+
+    fill(render_snapshot_begin(&buffer), 1);
+    render_snapshot_publish(&buffer);
+    const render_snapshot_t *snapshot = render_snapshot_acquire(&buffer, &fresh);
+    CHECK(fresh && snapshot->sequence == 1 && consistent(snapshot));
+
+    // Re-acquiring without a publish returns the same slot, not fresh
+    CHECK(render_snapshot_acquire(&buffer, &fresh) == snapshot);
+    CHECK(!fresh);
+
+    // Two publishes before a read: the older one is dropped
+    fill(render_snapshot_begin(&buffer), 2);
+    render_snapshot_publish(&buffer);
+    fill(render_snapshot_begin(&buffer), 3);
+    render_snapshot_publish(&buffer);
+    snapshot = render_snapshot_acquire(&buffer, &fresh);
+    CHECK(fresh && snapshot->sequence == 3 && consistent(snapshot));
+    CHECK(buffer.dropped == 1);
+
+    // The producer never writes into the slot the reader holds
+    for (uint32_t sequence = 4; sequence < 20; sequence++) {
+        CHECK(render_snapshot_begin(&buffer) != snapshot);
+        fill(render_snapshot_begin(&buffer), sequence);
+        render_snapshot_publish(&buffer);
+    }
+    CHECK(snapshot->sequence == 3 && consistent(snapshot));
+}
+
+static void *producer(void *arg) {
+    for (uint32_t sequence = 1; sequence <= STRESS_SNAPSHOTS; sequence++) {
+        fill(render_snapshot_begin(&buffer), sequence);
+        render_snapshot_publish(&buffer);
+        // One CPU in CI: let the reader in regularly
+        if ((sequence & 63) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    uint32_t reads;
+    uint32_t fresh_reads;
+    uint32_t torn;
+    uint32_t out_of_order;
+    uint32_t stale_fresh;
+} consumer_result_t;
+
+static void *consumer(void *arg) {
+    consumer_result_t *result = (consumer_result_t *)arg;
+    int64_t last = -1;  // The first acquire takes the pre-published snapshot 0
+
+    while (last < STRESS_SNAPSHOTS) {
+        bool fresh;
+        const render_snapshot_t *snapshot = render_snapshot_acquire(&buffer, &fresh);
+        result->reads++;
+        if (!consistent(snapshot)) result->torn++;
+        if (snapshot->sequence < last) result->out_of_order++;
+        if (fresh) {
+            result->fresh_reads++;
+            if (snapshot->sequence == last) result->stale_fresh++;
+        }
+        last = snapshot->sequence;
+        if ((result->reads & 15) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_two_threads(void) {
+    render_snapshot_init(&buffer);
+    fill(render_snapshot_begin(&buffer), 0);
+    render_snapshot_publish(&buffer);
+
+    consumer_result_t result = {0};
+    pthread_t producer_thread, consumer_thread;
+    CHECK(pthread_create(&consumer_thread, NULL, consumer, &result) == 0);
+    CHECK(pthread_create(&producer_thread, NULL, producer, NULL) == 0);
+    pthread_join(producer_thread, NULL);
+    pthread_join(consumer_thread, NULL);
+
+    printf("  %u published, %u consumed, %u dropped, %u reads\n", buffer.published, buffer.consumed,
+           buffer.dropped, result.reads);
+    CHECK(result.torn == 0);
+    CHECK(result.out_of_order == 0);
+    CHECK(result.stale_fresh == 0);
+    CHECK(buffer.published == STRESS_SNAPSHOTS + 1);
+    // Every publish is either read or overwritten before it was read
+    CHECK(buffer.consumed + buffer.dropped == buffer.published);
+    CHECK(buffer.consumed == result.fresh_reads);
+}
+
+int main(void) {
+    RUN_TEST(test_single_thread);
+    RUN_TEST(test_two_threads);
+    return host_test_finish();
+}
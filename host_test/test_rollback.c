@@ -0,0 +1,244 @@
+// Rollback engine: prediction and rewind rules, then two peers exchanging
+// scripted inputs over a delayed, jittered link. Every confirmed state hash
+// on either peer must match a reference run that knew all inputs up front.
+#include "host_test.h"
+#include "race_fixture.h"
+#include <string.h>
+
+#define DT RACE_FIXTURE_DT
+#define RACE_FRAMES 1200
+#define REFERENCE_FRAMES (RACE_FRAMES + 64)
+
+// Hash of the state before each frame with every input known
+static uint64_t reference[REFERENCE_FRAMES + 1];
+
+static void build_reference(void) {
+    static physics_world_t world;
+    rollback_snapshot_t snapshot;
+
+    race_fixture_setup_world(&world);
+    for (uint32_t frame = 0; frame <= REFERENCE_FRAMES; frame++) {
+        rollback_capture(&snapshot, &world, frame);
+        reference[frame] = rollback_snapshot_hash(&snapshot);
+        if (frame == REFERENCE_FRAMES) break;
+        for (uint8_t p = 0; p < PHYSICS_MAX_CARS; p++) {
+            physics_input_t input = race_fixture_input(p, frame);
+            physics_apply_input(&world.cars[p], &input, DT);
+        }
+        physics_update(&world, DT);
+    }
+}
+
+// A packet is the frame and the input sampled for it, sent before the
+// frame is advanced
+static size_t send_input(race_fixture_peer_t *peer, const physics_input_t *input, uint8_t *packet) {
+    if (!input) return 0;
+    uint32_t frame = peer->rollback.frame;
+    memcpy(packet, &frame, sizeof(frame));
+    memcpy(packet + sizeof(frame), input, sizeof(physics_input_t));
+    return sizeof(frame) + sizeof(physics_input_t);
+}
+
+static void receive_input(race_fixture_peer_t *peer, const uint8_t *packet, size_t length) {
+    uint32_t frame;
+    physics_input_t input;
+    CHECK(length == sizeof(frame) + sizeof(input));
+    memcpy(&frame, packet, sizeof(frame));
+    memcpy(&input, packet + sizeof(frame), sizeof(input));
+    rollback_add_remote_input(&peer->rollback, (uint8_t)(1 - peer->rollback.local_player), frame, &input);
+}
+
+static const race_fixture_protocol_t input_protocol = { send_input, receive_input };
+
+typedef struct {
+    uint32_t ticks;
+    uint32_t rollbacks;
+    uint32_t max_depth;
+    uint32_t stalls;
+} session_result_t;
+
+// Latency plus up to jitter frames each way; reorder_percent of the inputs
+// are held back a further latency plus jitter, behind the ones after them
+static session_result_t run_session(uint32_t latency, uint32_t jitter, uint32_t reorder_percent) {
+    static race_fixture_session_t session;
+    link_sim_config_t link = {
+        .latency_us = latency * RACE_FIXTURE_TICK_US,
+        .jitter_us = jitter * RACE_FIXTURE_TICK_US,
+        .reorder_percent = reorder_percent,
+        .seed = 0x1234567u,
+    };
+    uint32_t hashes_checked[2] = {0}, hash_mismatches[2] = {0};
+    uint32_t last_checked_frame[2] = { ROLLBACK_NO_FRAME, ROLLBACK_NO_FRAME };
+    session_result_t result = {0};
+
+    race_fixture_session_init(&session, &input_protocol, &link, REFERENCE_FRAMES);
+    while (session.tick < RACE_FRAMES * 4 && race_fixture_session_confirmed(&session) < RACE_FRAMES) {
+        race_fixture_session_tick(&session);
+        for (int i = 0; i < 2; i++) {
+            uint32_t frame;
+            uint64_t hash;
+            if (rollback_confirmed_hash(&session.peers[i].rollback, &frame, &hash) && frame != last_checked_frame[i]) {
+                hashes_checked[i]++;
+                if (hash != reference[frame]) hash_mismatches[i]++;
+                last_checked_frame[i] = frame;
+            }
+        }
+    }
+
+    result.ticks = session.tick;
+    for (int i = 0; i < 2; i++) {
+        const rollback_t *rollback = &session.peers[i].rollback;
+        CHECK_MSG(rollback->confirmed_frame >= RACE_FRAMES, "peer %d confirmed %u", i, rollback->confirmed_frame);
+        CHECK_MSG(hash_mismatches[i] == 0, "peer %d: %u of %u hashes differ", i, hash_mismatches[i],
+                  hashes_checked[i]);
+        CHECK(hashes_checked[i] > RACE_FRAMES / 8);
+        CHECK(rollback->max_rollback_depth <= ROLLBACK_MAX_FRAMES);
+        CHECK(rollback->late_inputs == 0 && rollback->early_inputs == 0);
+        result.rollbacks += rollback->rollbacks;
+        result.stalls += rollback->stalls;
+        if (rollback->max_rollback_depth > result.max_depth) result.max_depth = rollback->max_rollback_depth;
+    }
+    CHECK(session.links[0].overflowed == 0 && session.links[1].overflowed == 0);
+    printf("  latency %u+%u, %u%% reordered: %u ticks, %u rollbacks, max depth %u, %u stalls\n", latency, jitter,
+           reorder_percent, result.ticks, result.rollbacks, result.max_depth, result.stalls);
+    return result;
+}
+
+static void test_snapshot_round_trip(void) {
+    static physics_world_t world, copy;
+    rollback_snapshot_t before, after;
+
+    race_fixture_setup_world(&world);
+    for (uint32_t frame = 0; frame < 30; frame++) {
+        physics_input_t input = race_fixture_input(0, frame);
+        physics_apply_input(&world.cars[0], &input, DT);
+        physics_update(&world, DT);
+    }
+    rollback_capture(&before, &world, 30);
+    copy = world;
+
+    for (uint32_t frame = 30; frame < 60; frame++) {
+        physics_input_t input = race_fixture_input(0, frame);
+        physics_apply_input(&world.cars[0], &input, DT);
+        physics_update(&world, DT);
+    }
+    rollback_capture(&after, &world, 30);
+    CHECK(rollback_snapshot_hash(&before) != rollback_snapshot_hash(&after));
+
+    // Restoring reproduces the saved world exactly
+    rollback_restore(&before, &world);
+    rollback_capture(&after, &world, 30);
+    CHECK(rollback_snapshot_hash(&before) == rollback_snapshot_hash(&after));
+    CHECK(memcmp(world.cars, copy.cars, sizeof(world.cars)) == 0);
+}
+
+static void test_prediction_and_rewind(void) {
+    static physics_world_t world;
+    static rollback_t rollback;
+    physics_input_t steady = { .throttle = 80 };
+    physics_input_t turn = { .throttle = 80, .steering = 50 };
+
+    race_fixture_setup_world(&world);
+    rollback_init(&rollback, &world, 0, DT);
+
+    // Remote input for frame 0 arrives in time; frames 1..4 are predicted
+    rollback_add_remote_input(&rollback, 1, 0, &steady);
+    for (int i = 0; i < 5; i++) {
+        rollback_add_local_input(&rollback, &steady);
+        CHECK(rollback_advance(&rollback));
+    }
+    CHECK(rollback.frame == 5 && rollback.confirmed_frame == 1);
+    physics_input_t predicted = rollback_get_input(&rollback, 1, 3);
+    CHECK(memcmp(&predicted, &steady, sizeof(steady)) == 0);
+
+    // A late input matching the prediction costs nothing
+    rollback_add_remote_input(&rollback, 1, 1, &steady);
+    CHECK(rollback.rollback_from == ROLLBACK_NO_FRAME);
+    CHECK(rollback.confirmed_frame == 2);
+
+    // A differing one rewinds to its frame on the next advance
+    rollback_add_remote_input(&rollback, 1, 3, &turn);
+    rollback_add_remote_input(&rollback, 1, 2, &turn);
+    CHECK(rollback.rollback_from == 2);
+    CHECK(rollback.mispredictions == 2);
+    CHECK(rollback.confirmed_frame == 4);
+    rollback_add_local_input(&rollback, &steady);
+    CHECK(rollback_advance(&rollback));
+    CHECK(rollback.rollbacks == 1 && rollback.last_rollback_depth == 3);
+    CHECK(rollback.resimulated_frames == 3);
+
+    // Frame 4 onwards now predicts the newest confirmed input
+    predicted = rollback_get_input(&rollback, 1, 5);
+    CHECK(memcmp(&predicted, &turn, sizeof(turn)) == 0);
+
+    // Duplicates are ignored
+    rollback_add_remote_input(&rollback, 1, 2, &steady);
+    CHECK(rollback.rollback_from == ROLLBACK_NO_FRAME);
+}
+
+static void test_stall_at_prediction_limit(void) {
+    static physics_world_t world;
+    static rollback_t rollback;
+    physics_input_t input = { .throttle = 50 };
+
+    race_fixture_setup_world(&world);
+    rollback_init(&rollback, &world, 0, DT);
+
+    // No remote input at all: the engine predicts ROLLBACK_MAX_FRAMES frames
+    // and then refuses to run further ahead
+    int advanced = 0;
+    for (int i = 0; i < ROLLBACK_MAX_FRAMES + 4; i++) {
+        if (rollback.frame == (uint32_t)advanced) rollback_add_local_input(&rollback, &input);
+        if (rollback_advance(&rollback)) advanced++;
+    }
+    CHECK(advanced == ROLLBACK_MAX_FRAMES);
+    CHECK(rollback.stalls == 4);
+
+    // The oldest frame's input releases one more
+    rollback_add_remote_input(&rollback, 1, 0, &input);
+    CHECK(rollback.confirmed_frame == 1);
+    rollback_add_local_input(&rollback, &input);
+    // It differs from the neutral prediction, so all eight frames replay
+    CHECK(rollback.rollback_from == 0);
+    CHECK(rollback_advance(&rollback));
+    CHECK(rollback.rollbacks == 1 && rollback.last_rollback_depth == ROLLBACK_MAX_FRAMES);
+    CHECK(rollback.frame == ROLLBACK_MAX_FRAMES + 1);
+
+    // Inputs beyond the input history are rejected
+    rollback_add_remote_input(&rollback, 1, rollback.frame + ROLLBACK_INPUT_FRAMES, &input);
+    CHECK(rollback.early_inputs == 1 && rollback.late_inputs == 0);
+}
+
+static void test_two_peers_converge(void) {
+    build_reference();
+
+    // Same tick delivery: the second peer's input lands one frame late
+    session_result_t result = run_session(0, 0, 0);
+    CHECK(result.max_depth <= 1 && result.stalls == 0);
+
+    // Typical BLE link: 2..5 frames each way, in order
+    result = run_session(2, 3, 0);
+    CHECK(result.rollbacks > 0);
+    CHECK(result.stalls == 0);
+
+    // Reordered inputs arrive up to 10 frames late, past the prediction
+    // window: the peers stall on them but stay in sync
+    result = run_session(2, 3, 10);
+    CHECK(result.rollbacks > 0);
+    CHECK(result.stalls > 0);
+    CHECK(result.max_depth <= ROLLBACK_MAX_FRAMES);
+
+    // Latency beyond the prediction window
+    result = run_session(10, 4, 0);
+    CHECK(result.rollbacks > 0);
+    CHECK(result.stalls > 0);
+    CHECK(result.max_depth <= ROLLBACK_MAX_FRAMES);
+}
+
+int main(void) {
+    RUN_TEST(test_snapshot_round_trip);
+    RUN_TEST(test_prediction_and_rewind);
+    RUN_TEST(test_stall_at_prediction_limit);
+    RUN_TEST(test_two_peers_converge);
+    return host_test_finish();
+}
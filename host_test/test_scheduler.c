@@ -0,0 +1,237 @@
+// Multi-rate scheduler on the simulated clock
+#include "host_test.h"
+#include "scheduler.h"
+#include "physics.h"
+#include <string.h>
+
+typedef struct {
+    scheduler_t *sched;
+    int id;
+    uint32_t cost_us;  // Simulated time each run takes
+} sim_task_t;
+
+static int run_log[64];
+static int run_log_count;
+
+static void sim_task(void *arg, uint32_t period_us) {
+    sim_task_t *task = (sim_task_t *)arg;
+    if (run_log_count < 64) {
+        run_log[run_log_count++] = task->id;
+    }
+    scheduler_advance(task->sched, task->cost_us);
+}
+
+static int add_sim_task(scheduler_t *sched, sim_task_t *task, const char *name, uint32_t rate_hz,
+                        uint8_t priority, uint8_t max_catch_up) {
+    scheduler_task_config_t config = {
+        .name = name, .rate_hz = rate_hz, .priority = priority, .max_catch_up = max_catch_up,
+        .fn = sim_task, .arg = task,
+    };
+    task->sched = sched;
+    task->id = scheduler_add_task(sched, &config);
+    return task->id;
+}
+
+// Runs due tasks and sleeps as the game loop does, at least 1 ms per pass,
+// until the clock reaches end_us
+static void run_until(scheduler_t *sched, int64_t end_us) {
+    while (scheduler_now(sched) < end_us) {
+        int64_t wait = scheduler_run_due(sched);
+        if (wait < 1000) wait = 1000;
+        if (scheduler_now(sched) + wait > end_us) wait = end_us - scheduler_now(sched);
+        scheduler_advance(sched, wait);
+    }
+}
+
+static void test_rates_over_one_second(void) {
+    scheduler_t sched;
+    sim_task_t imu = {0}, physics = {0}, network = {0}, frame = {0};
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &imu, "imu", 200, 0, 2);
+    add_sim_task(&sched, &physics, "physics", 60, 1, 4);
+    add_sim_task(&sched, &network, "network", 20, 2, 1);
+    add_sim_task(&sched, &frame, "frame", 30, 3, 1);
+
+    // Poll every millisecond up to, not including, t = 1 s
+    for (int64_t t = 0; t < 1000000; t += 1000) {
+        scheduler_run_due(&sched);
+        scheduler_advance(&sched, 1000);
+    }
+
+    CHECK(scheduler_get_task(&sched, imu.id)->runs == 200);
+    CHECK(scheduler_get_task(&sched, physics.id)->runs == 60);
+    CHECK(scheduler_get_task(&sched, network.id)->runs == 20);
+    CHECK(scheduler_get_task(&sched, frame.id)->runs == 30);
+    for (int i = 0; i < 4; i++) {
+        const scheduler_task_t *task = scheduler_get_task(&sched, i);
+        CHECK_MSG(task->overruns == 0 && task->skipped == 0, "%s overruns %u skipped %u",
+                  task->config.name, task->overruns, task->skipped);
+    }
+}
+
+static void test_priority_order(void) {
+    scheduler_t sched;
+    sim_task_t tasks[4] = {{0}};
+    scheduler_init(&sched, NULL);
+
+    // Registered out of order; equal priorities keep registration order
+    add_sim_task(&sched, &tasks[0], "c", 10, 3, 1);
+    add_sim_task(&sched, &tasks[1], "a", 10, 0, 1);
+    add_sim_task(&sched, &tasks[2], "b1", 10, 1, 1);
+    add_sim_task(&sched, &tasks[3], "b2", 10, 1, 1);
+
+    run_log_count = 0;
+    scheduler_run_due(&sched);
+    CHECK(run_log_count == 4);
+    CHECK(run_log[0] == tasks[1].id);
+    CHECK(run_log[1] == tasks[2].id);
+    CHECK(run_log[2] == tasks[3].id);
+    CHECK(run_log[3] == tasks[0].id);
+}
+
+static void test_next_deadline(void) {
+    scheduler_t sched;
+    sim_task_t physics = {0};
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &physics, "physics", 60, 0, 1);
+
+    // Tick 1 is due at 1e6 / 60 = 16666.67 us, rounded down
+    CHECK(scheduler_run_due(&sched) == 16666);
+    scheduler_advance(&sched, 10000);
+    CHECK(scheduler_run_due(&sched) == 6666);
+    CHECK(scheduler_get_task(&sched, physics.id)->runs == 1);
+}
+
+static void test_deadlines_do_not_drift(void) {
+    scheduler_t sched;
+    sim_task_t physics = {0};
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &physics, "physics", 60, 0, 4);
+
+    // Poll on a period unrelated to the task's for 10 s
+    int64_t last = 0;
+    for (int64_t t = 0; t < 10000000; t += 7000) {
+        scheduler_run_due(&sched);
+        last = t;
+        scheduler_advance(&sched, 7000);
+    }
+
+    const scheduler_task_t *task = scheduler_get_task(&sched, physics.id);
+    uint32_t expected = (uint32_t)(last * 60 / 1000000) + 1;
+    CHECK_MSG(task->runs == expected, "runs %u, expected %u", task->runs, expected);
+    CHECK(task->skipped == 0);
+    CHECK(task->max_lateness_us < 7000);
+}
+
+static void test_catch_up_and_skips(void) {
+    scheduler_t sched;
+    sim_task_t imu = {0};
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &imu, "imu", 200, 0, 2);
+
+    scheduler_run_due(&sched);
+    // 100 ms stall: ticks 1..20 are due, two run and the rest are dropped
+    scheduler_advance(&sched, 100000);
+    scheduler_run_due(&sched);
+
+    const scheduler_task_t *task = scheduler_get_task(&sched, imu.id);
+    CHECK(task->runs == 3);
+    CHECK(task->skipped == 18);
+    CHECK(task->max_lateness_us == 5000);
+}
+
+static void test_overruns_under_load(void) {
+    scheduler_t sched;
+    sim_task_t physics = { .cost_us = 2000 };
+    sim_task_t frame = { .cost_us = 50000 };
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &physics, "physics", 60, 0, 4);
+    add_sim_task(&sched, &frame, "frame", 30, 1, 1);
+
+    run_until(&sched, 1000000);
+
+    // Physics catches up after each slow frame without dropping ticks
+    const scheduler_task_t *physics_task = scheduler_get_task(&sched, physics.id);
+    const scheduler_task_t *frame_task = scheduler_get_task(&sched, frame.id);
+    CHECK_MSG(physics_task->runs >= 58 && physics_task->runs <= 60, "physics runs %u", physics_task->runs);
+    CHECK(physics_task->skipped == 0);
+    CHECK(frame_task->overruns > 0);
+    CHECK(frame_task->max_duration_us >= 50000);
+}
+
+static void test_set_rate_and_enable(void) {
+    scheduler_t sched;
+    sim_task_t network = {0};
+    scheduler_init(&sched, NULL);
+    add_sim_task(&sched, &network, "network", 20, 0, 1);
+
+    run_until(&sched, 1000000);
+    uint32_t before = scheduler_get_task(&sched, network.id)->runs;
+    CHECK(before == 20);
+
+    scheduler_set_rate(&sched, network.id, 10);
+    run_until(&sched, 2000000);
+    uint32_t after = scheduler_get_task(&sched, network.id)->runs - before;
+    CHECK_MSG(after == 10 || after == 11, "runs at 10 Hz: %u", after);
+
+    // Disabled tasks do not run; enabling restarts the epoch at now
+    scheduler_set_enabled(&sched, network.id, false);
+    run_until(&sched, 3000000);
+    uint32_t disabled = scheduler_get_task(&sched, network.id)->runs;
+    CHECK(disabled == before + after);
+
+    scheduler_advance(&sched, 123);
+    scheduler_set_enabled(&sched, network.id, true);
+    run_log_count = 0;
+    scheduler_run_due(&sched);
+    CHECK(run_log_count == 1);
+    CHECK(scheduler_get_task(&sched, network.id)->epoch_us == 3000123);
+}
+
+// Physics stepped by the scheduler keeps race time in step with the clock
+typedef struct {
+    physics_world_t world;
+    uint32_t steps;
+} race_task_t;
+
+static void race_task(void *arg, uint32_t period_us) {
+    race_task_t *race = (race_task_t *)arg;
+    physics_update(&race->world, 1.0f / 60);
+    race->steps++;
+}
+
+static void test_physics_race_time(void) {
+    static race_task_t race;
+    memset(&race, 0, sizeof(race));
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        race.world.cars[i].mass = INT_TO_FIXED16(1000);
+    }
+    physics_set_tilemap(NULL);
+    physics_set_centreline(NULL, 0);
+    physics_start_race(&race.world);
+
+    scheduler_t sched;
+    scheduler_init(&sched, NULL);
+    scheduler_task_config_t config = {
+        .name = "physics", .rate_hz = 60, .priority = 0, .max_catch_up = 4, .fn = race_task, .arg = &race,
+    };
+    scheduler_add_task(&sched, &config);
+
+    // Ten simulated minutes; truncating each step to 16 ms lost 4%
+    run_until(&sched, 600 * 1000000LL);
+    CHECK(race.steps == 36000);
+    CHECK_MSG(race.world.race_time[0] == 600000,
+              "race_time %u ms after 600 s", race.world.race_time[0]);
+}
+
+int main(void) {
+    RUN_TEST(test_rates_over_one_second);
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_next_deadline);
+    RUN_TEST(test_deadlines_do_not_drift);
+    RUN_TEST(test_catch_up_and_skips);
+    RUN_TEST(test_overruns_under_load);
+    RUN_TEST(test_set_rate_and_enable);
+    RUN_TEST(test_physics_race_time);
+    return host_test_finish();
+}
@@ -0,0 +1,294 @@
+// Game state codec: quantisation error bounds, exact round trips over a
+// lossy two-way link, packet sizes, keyframe fallback, extreme values and
+// the world hash riding the packets that have room for it
+#include "host_test.h"
+#include "state_codec.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEND_EVERY 3            // 20 Hz state packets at 60 Hz physics
+#define TARGET_DELTA_BYTES 12
+
+static physics_world_t world;
+
+static bool same_state(const state_codec_car_t *a, const state_codec_car_t *b) {
+    return a->frame == b->frame && a->position_x == b->position_x && a->position_y == b->position_y &&
+           a->velocity_x == b->velocity_x && a->velocity_y == b->velocity_y && a->heading == b->heading &&
+           a->checkpoint == b->checkpoint && a->lap == b->lap && a->finished == b->finished;
+}
+
+// Car 0 follows a 1000-unit circle, accelerating from rest to top_speed
+// units/s, tangent heading; the lap counter ticks over every half turn
+static void drive_circle(uint32_t frame, float top_speed) {
+    float t = frame / 60.0f;
+    float speed = top_speed * (t < 10.0f ? t / 10.0f : 1.0f);
+    float distance = t < 10.0f ? 0.5f * speed * t : top_speed * (t - 5.0f);
+    float angle = distance / 1000.0f;
+    car_physics_t *car = &world.cars[0];
+    car->position = (vec2_t){ FLOAT_TO_FIXED16(1000.0f * cosf(angle)), FLOAT_TO_FIXED16(1000.0f * sinf(angle)) };
+    car->velocity = (vec2_t){ FLOAT_TO_FIXED16(-speed * sinf(angle)), FLOAT_TO_FIXED16(speed * cosf(angle)) };
+    car->heading = FLOAT_TO_FIXED16(angle + 1.5707963f);
+    world.progress[0].lap = (uint8_t)(angle / 3.14159265f);
+    world.progress[0].next_checkpoint = (uint8_t)((int)(angle / 0.7853982f) % 4);
+}
+
+static void test_quantisation_error(void) {
+    uint32_t rng = 99;
+    state_codec_car_t state;
+    int32_t worst_position = 0, worst_velocity = 0, worst_heading = 0;
+
+    memset(&world, 0, sizeof(world));
+    world.checkpoint_count = 4;
+    for (int i = 0; i < 20000; i++) {
+        car_physics_t original = {
+            .position = { (fixed16_t)(host_rand(&rng) % (60000u << 16)) - (30000 << 16),
+                          (fixed16_t)(host_rand(&rng) % (60000u << 16)) - (30000 << 16) },
+            .velocity = { (fixed16_t)(host_rand(&rng) % (1000u << 16)) - (500 << 16),
+                          (fixed16_t)(host_rand(&rng) % (1000u << 16)) - (500 << 16) },
+            .heading = (fixed16_t)host_rand(&rng),  // Any number of turns either way
+        };
+        world.cars[0] = original;
+        state_codec_quantise(&world, 0, 0, &state);
+        state_codec_apply(&state, &world, 0);
+        const car_physics_t *back = &world.cars[0];
+
+        int32_t dp = abs(back->position.x - original.position.x);
+        if (abs(back->position.y - original.position.y) > dp) dp = abs(back->position.y - original.position.y);
+        int32_t dv = abs(back->velocity.x - original.velocity.x);
+        if (abs(back->velocity.y - original.velocity.y) > dv) dv = abs(back->velocity.y - original.velocity.y);
+        int32_t dh = abs((int16_t)(fixed_to_angle16(back->heading) - fixed_to_angle16(original.heading)));
+        if (dp > worst_position) worst_position = dp;
+        if (dv > worst_velocity) worst_velocity = dv;
+        if (dh > worst_heading) worst_heading = dh;
+    }
+
+    printf("  worst error: position %.4f units, velocity %.4f units/s, heading %.3f degrees\n",
+           worst_position / 65536.0, worst_velocity / 65536.0, worst_heading * 360.0 / 65536.0);
+    // Half a quantisation step, plus a binary angle step for the radian round trip
+    CHECK(worst_position <= 1 << (STATE_CODEC_POSITION_SHIFT - 1));
+    CHECK(worst_velocity <= 1 << (STATE_CODEC_VELOCITY_SHIFT - 1));
+    CHECK(worst_heading <= (1 << (15 - STATE_CODEC_HEADING_BITS)) + 1);
+
+    // Out of range velocities saturate instead of wrapping
+    world.cars[0].velocity = (vec2_t){ INT_TO_FIXED16(2000), INT_TO_FIXED16(-2000) };
+    state_codec_quantise(&world, 0, 0, &state);
+    CHECK(state.velocity_x == (1 << (STATE_CODEC_VELOCITY_BITS - 1)) - 1);
+    CHECK(state.velocity_y == -(1 << (STATE_CODEC_VELOCITY_BITS - 1)));
+}
+
+typedef struct {
+    uint32_t packets;
+    uint32_t decoded;
+    uint32_t mismatches;
+    uint32_t delta_bytes;
+    uint32_t deltas;
+    size_t max_delta;
+    size_t max_keyframe;
+} link_result_t;
+
+// A sends car 0 to B; B answers with a packet of its own so A gets acks.
+// loss_percent drops packets in both directions; outage drops everything
+// for a stretch in the middle.
+static link_result_t run_link(float top_speed, uint32_t loss_percent, uint32_t outage_packets) {
+    static state_codec_t a, b;
+    link_result_t result = {0};
+    uint32_t rng = 4242;
+    uint8_t packet[STATE_CODEC_MAX_PACKET];
+    state_codec_car_t sent, received, reply;
+
+    memset(&world, 0, sizeof(world));
+    world.checkpoint_count = 4;
+    state_codec_init(&a, 0);
+    state_codec_init(&b, 1);
+
+    for (uint32_t frame = 0; frame < 60 * 60; frame += SEND_EVERY) {
+        drive_circle(frame, top_speed);
+        state_codec_quantise(&world, 0, frame, &sent);
+        uint32_t deltas_before = a.deltas_sent;
+        size_t length = state_codec_encode(&a, &sent, packet, sizeof(packet));
+        CHECK(length > 0);
+        result.packets++;
+        if (a.deltas_sent != deltas_before) {
+            result.deltas++;
+            result.delta_bytes += (uint32_t)length;
+            if (length > result.max_delta) result.max_delta = length;
+        } else if (length > result.max_keyframe) {
+            result.max_keyframe = length;
+        }
+
+        bool outage = result.packets > 200 && result.packets <= 200 + outage_packets;
+        if (!outage && host_rand(&rng) % 100 >= loss_percent) {
+            if (state_codec_decode(&b, packet, length, &received, NULL)) {
+                result.decoded++;
+                if (!same_state(&received, &sent)) result.mismatches++;
+            }
+        }
+
+        // B's reply carries its ack for A
+        state_codec_quantise(&world, 1, frame, &reply);
+        length = state_codec_encode(&b, &reply, packet, sizeof(packet));
+        if (!outage && host_rand(&rng) % 100 >= loss_percent) {
+            state_codec_decode(&a, packet, length, &received, NULL);
+        }
+    }
+
+    printf("  %3.0f units/s, %2u%% loss, %2u outage: %u/%u decoded, %u keyframes (max %zu B), "
+           "deltas avg %.1f B max %zu B, %u missing baselines\n",
+           top_speed, loss_percent, outage_packets, result.decoded, result.packets, a.keyframes_sent,
+           result.max_keyframe, result.deltas ? (double)result.delta_bytes / result.deltas : 0.0, result.max_delta,
+           b.missing_baselines);
+    return result;
+}
+
+static void test_round_trip_clean(void) {
+    // Physics top speed, then far past it
+    link_result_t result = run_link(20.0f, 0, 0);
+    CHECK(result.decoded == result.packets && result.mismatches == 0);
+    CHECK(result.deltas == result.packets - 1);
+    CHECK(result.max_delta < TARGET_DELTA_BYTES);
+
+    result = run_link(400.0f, 0, 0);
+    CHECK(result.decoded == result.packets && result.mismatches == 0);
+    CHECK(result.max_delta < TARGET_DELTA_BYTES);
+    CHECK(result.max_keyframe <= STATE_CODEC_MAX_PACKET);
+}
+
+static void test_loss_and_keyframe_fallback(void) {
+    static state_codec_t a, b;
+
+    // Every packet that decodes is exact whatever was lost before it
+    link_result_t result = run_link(100.0f, 20, 0);
+    CHECK(result.mismatches == 0);
+    CHECK(result.decoded > result.packets * 7 / 10);
+    CHECK(result.max_delta < TARGET_DELTA_BYTES);
+
+    // An outage longer than the history forces a keyframe once it ends
+    result = run_link(100.0f, 5, 3 * STATE_CODEC_HISTORY);
+    CHECK(result.mismatches == 0);
+    CHECK(result.packets - result.deltas >= 2);
+
+    // A delta whose baseline never arrived is refused and not acked
+    uint8_t packet[STATE_CODEC_MAX_PACKET];
+    state_codec_car_t state = { .frame = 10, .position_x = 100 }, out;
+    state_codec_init(&a, 0);
+    state_codec_init(&b, 1);
+    size_t length = state_codec_encode(&a, &state, packet, sizeof(packet));
+    CHECK(state_codec_decode(&b, packet, length, &out, NULL));
+    length = state_codec_encode(&b, &state, packet, sizeof(packet));
+    CHECK(state_codec_decode(&a, packet, length, &out, NULL));  // A now has B's ack
+    state.frame = 13;
+    length = state_codec_encode(&a, &state, packet, sizeof(packet));
+    CHECK(a.deltas_sent == 1);
+    state_codec_init(&b, 1);
+    CHECK(!state_codec_decode(&b, packet, length, &out, NULL));
+    CHECK(b.missing_baselines == 1 && !b.ack_valid);
+}
+
+static void test_extreme_values(void) {
+    static state_codec_t a, b;
+    uint8_t packet[STATE_CODEC_MAX_PACKET];
+    state_codec_car_t out, reply = {0};
+    int32_t position_max = (1 << (STATE_CODEC_POSITION_BITS - 1)) - 1;
+    int32_t velocity_max = (1 << (STATE_CODEC_VELOCITY_BITS - 1)) - 1;
+    const state_codec_car_t states[] = {
+        { 0, 0, 0, 0, 0, 0, 0, 0, false, false, 0, 0 },
+        { 1, position_max, -position_max - 1, velocity_max, -velocity_max - 1, 4095, 15, 255, true, false, 0, 0 },
+        { 2, -position_max - 1, position_max, -velocity_max - 1, velocity_max, 0, 0, 0, false, false, 0, 0 },  // Teleport
+        { 3, -position_max - 1 + 31, position_max - 31, -velocity_max, velocity_max - 1, 4095, 0, 0, false, false, 0, 0 },
+        { 3, 12, -12, 2047, -2048, 1, 1, 1, false, false, 0, 0 },     // Same frame again, medium deltas
+        { 1000, 12, -12, 2047, -2048, 1, 1, 1, false, false, 0, 0 },  // Frame gap beyond the delta field
+        { UINT32_MAX, 5, 5, 5, 5, 2048, 3, 3, true, false, 0, 0 },
+    };
+
+    state_codec_init(&a, 1);
+    state_codec_init(&b, 0);
+    for (size_t i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+        uint8_t player = 0;
+        size_t length = state_codec_encode(&a, &states[i], packet, sizeof(packet));
+        CHECK(length > 0 && length <= STATE_CODEC_MAX_PACKET);
+        CHECK_MSG(state_codec_decode(&b, packet, length, &out, &player), "state %zu", i);
+        CHECK_MSG(same_state(&out, &states[i]), "state %zu", i);
+        CHECK(player == 1);
+
+        length = state_codec_encode(&b, &reply, packet, sizeof(packet));
+        CHECK(state_codec_decode(&a, packet, length, &out, NULL));
+    }
+    CHECK(a.deltas_sent >= 3);
+    CHECK(a.keyframes_sent >= 3);
+
+    // Truncated packets are rejected, and so is a buffer too small to encode
+    size_t length = state_codec_encode(&a, &states[1], packet, sizeof(packet));
+    CHECK(!state_codec_decode(&b, packet, length - 1, &out, NULL));
+    CHECK(b.malformed == 1);
+    CHECK(state_codec_encode(&a, &states[1], packet, 2) == 0);
+}
+
+static void test_world_hash(void) {
+    static state_codec_t a, b;
+    uint8_t packet[STATE_CODEC_MAX_PACKET];
+    state_codec_car_t state = { .frame = 100, .position_x = 5000, .velocity_x = 300 }, out, reply = {0};
+
+    state_codec_init(&a, 0);
+    state_codec_init(&b, 1);
+
+    // A keyframe has no room, so the hash is left out rather than the state
+    state.hash_valid = true;
+    state.hash_frame = 96;
+    state.hash = 0xdeadbeef;
+    size_t length = state_codec_encode(&a, &state, packet, sizeof(packet));
+    CHECK(a.keyframes_sent == 1 && length <= STATE_CODEC_MAX_PACKET);
+    CHECK(state_codec_decode(&b, packet, length, &out, NULL));
+    CHECK(same_state(&out, &state) && !out.hash_valid);
+    length = state_codec_encode(&b, &reply, packet, sizeof(packet));
+    CHECK(state_codec_decode(&a, packet, length, &out, NULL));
+
+    // Deltas carry it, with the frame it was taken at, in 5 more bytes at most
+    size_t without = 0;
+    for (uint32_t i = 1; i <= 20; i++) {
+        state.frame = 100 + 3 * i;
+        state.position_x += 15;
+        state.hash_frame = state.frame - i;
+        state.hash = 0x9e3779b9u * i;
+        state.hash_valid = i % 2 == 0;
+        length = state_codec_encode(&a, &state, packet, sizeof(packet));
+        CHECK(length > 0 && length <= STATE_CODEC_MAX_PACKET);
+        CHECK_MSG(state_codec_decode(&b, packet, length, &out, NULL), "packet %u", i);
+        CHECK(same_state(&out, &state));
+        CHECK(out.hash_valid == state.hash_valid);
+        if (state.hash_valid) {
+            CHECK(out.hash_frame == state.hash_frame && out.hash == state.hash);
+            CHECK(length <= without + 5);
+        } else {
+            without = length;
+        }
+        length = state_codec_encode(&b, &reply, packet, sizeof(packet));
+        CHECK(state_codec_decode(&a, packet, length, &out, NULL));
+    }
+    CHECK(a.deltas_sent == 20);
+
+    // A hash too old for the age field, or from a later frame, stays home
+    state.frame += 3;
+    state.hash_valid = true;
+    state.hash_frame = state.frame - (1u << STATE_CODEC_HASH_AGE_BITS);
+    length = state_codec_encode(&a, &state, packet, sizeof(packet));
+    CHECK(state_codec_decode(&b, packet, length, &out, NULL) && !out.hash_valid);
+    state.frame += 3;
+    state.hash_frame = state.frame + 1;
+    length = state_codec_encode(&a, &state, packet, sizeof(packet));
+    CHECK(state_codec_decode(&b, packet, length, &out, NULL) && !out.hash_valid);
+
+    // Quantising starts without one
+    memset(&world, 0, sizeof(world));
+    state_codec_quantise(&world, 0, 7, &state);
+    CHECK(!state.hash_valid);
+}
+
+int main(void) {
+    RUN_TEST(test_quantisation_error);
+    RUN_TEST(test_round_trip_clean);
+    RUN_TEST(test_loss_and_keyframe_fallback);
+    RUN_TEST(test_extreme_values);
+    RUN_TEST(test_world_hash);
+    return host_test_finish();
+}
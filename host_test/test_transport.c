@@ -0,0 +1,233 @@
+// Transports under the netcode: the link simulator's latency, jitter, loss
+// and reordering, the loopback pair's connection events and frames, and
+// two UDP sockets on localhost finding each other, timing out and carrying
+// frames through the same impairments.
+#include "host_test.h"
+#include "link_sim.h"
+#include "transport_loopback.h"
+#include "transport_udp.h"
+#include <string.h>
+
+#define PACKETS 2000
+
+static int64_t sim_now_us;
+
+static int64_t sim_clock(void) {
+    return sim_now_us;
+}
+
+// Collects what a poll hands over
+typedef struct {
+    int connected;
+    int disconnected;
+    int frames;
+    uint8_t last[FRAME_BATCH_MAX_SIZE];
+    size_t last_length;
+} events_t;
+
+static void collect(void *context, transport_event_t event, const uint8_t *data, size_t length) {
+    events_t *events = context;
+    switch (event) {
+        case TRANSPORT_CONNECTED: events->connected++; break;
+        case TRANSPORT_DISCONNECTED: events->disconnected++; break;
+        case TRANSPORT_FRAME:
+            events->frames++;
+            memcpy(events->last, data, length);
+            events->last_length = length;
+            break;
+    }
+}
+
+// Sends PACKETS numbered packets one every 10 ms, receiving as they fall
+// due, and counts the ones that arrive after a later-numbered one
+static void run_link(link_sim_t *link, uint32_t *arrived, uint32_t *out_of_order, int64_t *max_delay_us,
+                     int64_t *min_delay_us) {
+    static int64_t sent_at[PACKETS];
+    uint8_t buffer[LINK_SIM_MAX_PACKET];
+    uint32_t highest = 0;
+    *arrived = *out_of_order = 0;
+    *max_delay_us = 0;
+    *min_delay_us = INT64_MAX;
+
+    for (int64_t now = 0; now < (int64_t)PACKETS * 10000 + 1000000; now += 1000) {
+        if (now % 10000 == 0 && now / 10000 < PACKETS) {
+            uint32_t sequence = (uint32_t)(now / 10000) + 1;
+            uint8_t data[8] = {0};
+            memcpy(data, &sequence, 4);
+            sent_at[sequence - 1] = now;
+            link_sim_send(link, data, sizeof(data), now);
+        }
+        size_t length;
+        while ((length = link_sim_receive(link, now, buffer)) > 0) {
+            uint32_t sequence;
+            memcpy(&sequence, buffer, 4);
+            int64_t delay = now - sent_at[sequence - 1];
+            if (delay > *max_delay_us) *max_delay_us = delay;
+            if (delay < *min_delay_us) *min_delay_us = delay;
+            if (sequence < highest) (*out_of_order)++;
+            if (sequence > highest) highest = sequence;
+            (*arrived)++;
+        }
+    }
+}
+
+static void test_link_sim(void) {
+    link_sim_t link;
+    uint32_t arrived, out_of_order;
+    int64_t max_delay, min_delay;
+
+    // Latency alone: everything, in order, exactly late
+    link_sim_init(&link, &(link_sim_config_t){ .latency_us = 30000, .seed = 1 });
+    run_link(&link, &arrived, &out_of_order, &max_delay, &min_delay);
+    CHECK(arrived == PACKETS && out_of_order == 0);
+    CHECK(min_delay == 30000 && max_delay == 30000);
+
+    // Jitter spreads the delay but, as on BLE, keeps the order
+    link_sim_init(&link, &(link_sim_config_t){ .latency_us = 20000, .jitter_us = 40000, .seed = 2 });
+    run_link(&link, &arrived, &out_of_order, &max_delay, &min_delay);
+    printf("  jitter 40 ms: delay %lld..%lld ms\n", (long long)min_delay / 1000, (long long)max_delay / 1000);
+    CHECK(arrived == PACKETS && out_of_order == 0);
+    CHECK(min_delay >= 20000 && max_delay > 50000);
+
+    // Loss and reordering at about the rates asked for
+    link_sim_init(&link, &(link_sim_config_t){ .latency_us = 20000, .jitter_us = 10000, .loss_percent = 10,
+                                               .reorder_percent = 5, .seed = 3 });
+    run_link(&link, &arrived, &out_of_order, &max_delay, &min_delay);
+    printf("  10%% loss, 5%% reorder: %u of %d arrived, %u out of order\n", arrived, PACKETS, out_of_order);
+    CHECK(link.lost == PACKETS - arrived);
+    CHECK(arrived > PACKETS * 86 / 100 && arrived < PACKETS * 94 / 100);
+    CHECK(out_of_order > PACKETS * 3 / 100 && out_of_order < PACKETS * 7 / 100);
+    CHECK(out_of_order <= link.reordered);
+
+    // Same seed, same link
+    link_sim_t again;
+    link_sim_init(&again, &link.config);
+    uint32_t arrived_again, out_of_order_again;
+    run_link(&again, &arrived_again, &out_of_order_again, &max_delay, &min_delay);
+    CHECK(arrived_again == arrived && out_of_order_again == out_of_order);
+
+    // A full queue drops rather than grows
+    link_sim_init(&link, &(link_sim_config_t){ .latency_us = 1000000 });
+    uint8_t data[4] = {0};
+    for (int i = 0; i < LINK_SIM_QUEUE + 5; i++) link_sim_send(&link, data, sizeof(data), 0);
+    CHECK(link.count == LINK_SIM_QUEUE && link.overflowed == 5);
+    CHECK(!link_sim_send(&link, data, LINK_SIM_MAX_PACKET + 1, 0));
+}
+
+static void test_loopback(void) {
+    static transport_loopback_t loopback;
+    transport_t a, b;
+    events_t events_a = {0}, events_b = {0};
+
+    sim_now_us = 0;
+    transport_loopback_init(&loopback, &(link_sim_config_t){ .latency_us = 25000, .seed = 4 }, sim_clock, 0);
+    transport_loopback_endpoint(&loopback, 0, &a);
+    transport_loopback_endpoint(&loopback, 1, &b);
+    CHECK(transport_frame_size(&a) == FRAME_BATCH_MAX_SIZE);
+
+    // Up once each end has polled
+    CHECK(!transport_connected(&a));
+    transport_poll(&a, collect, &events_a);
+    transport_poll(&b, collect, &events_b);
+    CHECK(events_a.connected == 1 && events_b.connected == 1);
+    CHECK(transport_connected(&a) && transport_connected(&b));
+
+    const uint8_t frame[] = { 1, 2, 3, 4, 5 };
+    CHECK(transport_send(&a, frame, sizeof(frame)));
+    sim_now_us = 24000;
+    transport_poll(&b, collect, &events_b);
+    CHECK(events_b.frames == 0);
+    sim_now_us = 25000;
+    transport_poll(&b, collect, &events_b);
+    CHECK(events_b.frames == 1 && events_b.last_length == sizeof(frame));
+    CHECK(memcmp(events_b.last, frame, sizeof(frame)) == 0);
+    transport_poll(&a, collect, &events_a);
+    CHECK(events_a.frames == 0);
+
+    // Down loses what is in flight and refuses sends
+    CHECK(transport_send(&b, frame, sizeof(frame)));
+    transport_loopback_set_up(&loopback, false);
+    CHECK(!transport_send(&b, frame, sizeof(frame)));
+    sim_now_us = 100000;
+    transport_poll(&a, collect, &events_a);
+    CHECK(events_a.disconnected == 1 && events_a.frames == 0);
+    CHECK(!transport_connected(&a));
+
+    transport_loopback_set_up(&loopback, true);
+    transport_poll(&a, collect, &events_a);
+    transport_poll(&b, collect, &events_b);
+    CHECK(events_a.connected == 2 && events_b.connected == 2 && events_b.disconnected == 1);
+
+    // Frames no larger than the configured MTU
+    transport_loopback_init(&loopback, &(link_sim_config_t){0}, sim_clock, FRAME_BATCH_MIN_SIZE);
+    transport_loopback_endpoint(&loopback, 0, &a);
+    uint8_t large[FRAME_BATCH_MIN_SIZE + 1] = {0};
+    CHECK(!transport_send(&a, large, sizeof(large)));
+    CHECK(transport_send(&a, large, FRAME_BATCH_MIN_SIZE));
+}
+
+static void test_udp(void) {
+    static transport_udp_t a, b;
+    transport_t ta, tb;
+    events_t events_a = {0}, events_b = {0};
+    link_sim_config_t clean = {0};
+
+    sim_now_us = 0;
+    if (!transport_udp_open(&a, 0, 0, &clean, sim_clock, 0) || !transport_udp_open(&b, 0, a.port, &clean, sim_clock, 0)) {
+        printf("  no UDP sockets here, skipped\n");
+        return;
+    }
+    transport_udp_set_peer(&a, b.port);
+    transport_udp_endpoint(&a, &ta);
+    transport_udp_endpoint(&b, &tb);
+
+    // Hellos bring both ends up
+    CHECK(!transport_connected(&ta));
+    for (int i = 0; i < 4; i++) {
+        transport_poll(&ta, collect, &events_a);
+        transport_poll(&tb, collect, &events_b);
+        sim_now_us += 1000;
+    }
+    CHECK(events_a.connected == 1 && events_b.connected == 1);
+    CHECK(transport_connected(&ta) && transport_connected(&tb));
+    CHECK(events_a.frames == 0 && events_b.frames == 0);
+
+    const uint8_t frame[] = { 9, 8, 7, 6 };
+    CHECK(transport_send(&ta, frame, sizeof(frame)));
+    transport_poll(&tb, collect, &events_b);
+    CHECK(events_b.frames == 1 && memcmp(events_b.last, frame, sizeof(frame)) == 0);
+
+    // The link_sim holds frames back until due
+    a.outbound.config.latency_us = 40000;
+    CHECK(transport_send(&ta, frame, sizeof(frame)));
+    transport_poll(&tb, collect, &events_b);
+    CHECK(events_b.frames == 1);
+    sim_now_us += 40000;
+    transport_poll(&ta, collect, &events_a);
+    transport_poll(&tb, collect, &events_b);
+    CHECK(events_b.frames == 2);
+
+    // Keepalives hold the link up while idle; silence takes it down
+    for (int i = 0; i < 30; i++) {
+        sim_now_us += 100000;
+        transport_poll(&ta, collect, &events_a);
+        transport_poll(&tb, collect, &events_b);
+    }
+    CHECK(events_a.disconnected == 0 && events_b.disconnected == 0);
+    CHECK(a.keepalives_sent > 0);
+    transport_udp_close(&b);
+    for (int i = 0; i < 25; i++) {
+        sim_now_us += 100000;
+        transport_poll(&ta, collect, &events_a);
+    }
+    CHECK(events_a.disconnected == 1 && !transport_connected(&ta));
+    CHECK(!transport_send(&ta, frame, sizeof(frame)));
+    transport_udp_close(&a);
+}
+
+int main(void) {
+    RUN_TEST(test_link_sim);
+    RUN_TEST(test_loopback);
+    RUN_TEST(test_udp);
+    return host_test_finish();
+}
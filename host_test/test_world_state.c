@@ -0,0 +1,210 @@
+// World serialisation: a raced world round-trips through every section
+// combination bit for bit, the layout is the documented size, malformed
+// or foreign data is refused without touching the world, and the hash
+// tells apart states that differ in a single bit.
+#include "host_test.h"
+#include "world_state.h"
+#include <string.h>
+
+#define MAP_SIZE 64
+#define DT (1.0f / 60.0f)
+
+static uint8_t tiles[MAP_SIZE * MAP_SIZE];
+
+// Square circuit with a gate on each edge, driven for a while with varied
+// inputs so progress, sector times and the broadphase are all filled
+static void setup_world(physics_world_t *world, uint32_t frames) {
+    physics_tilemap_t map = { tiles, MAP_SIZE, MAP_SIZE, INT_TO_FIXED16(16) };
+    physics_set_tilemap(&map);
+    physics_set_centreline(NULL, 0);
+
+    memset(world, 0, sizeof(physics_world_t));
+    static const int gates[4][2] = { { 500, 200 }, { 800, 500 }, { 500, 800 }, { 200, 500 } };
+    for (int i = 0; i < 4; i++) {
+        world->checkpoints[i].position = (vec2_t){ INT_TO_FIXED16(gates[i][0]), INT_TO_FIXED16(gates[i][1]) };
+        world->checkpoints[i].radius = INT_TO_FIXED16(60);
+        world->checkpoints[i].index = (uint8_t)i;
+    }
+    world->checkpoint_count = 4;
+    world->total_laps = 2;
+    for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+        world->cars[i].mass = INT_TO_FIXED16(1000);
+        world->cars[i].position = (vec2_t){ INT_TO_FIXED16(440 + 40 * i), INT_TO_FIXED16(200) };
+    }
+    physics_start_race(world);
+
+    uint32_t rng = 3;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        for (int i = 0; i < PHYSICS_MAX_CARS; i++) {
+            physics_input_t input = { .throttle = (uint8_t)(host_rand(&rng) % 101),
+                                      .steering = (int8_t)((int)(host_rand(&rng) % 61) - 30) };
+            physics_apply_input(&world->cars[i], &input, DT);
+        }
+        physics_update(world, DT);
+    }
+}
+
+// Field by field: the world struct has padding, so memcmp would not do
+static bool worlds_equal(const physics_world_t *a, const physics_world_t *b) {
+    bool equal = a->checkpoint_count == b->checkpoint_count && a->total_laps == b->total_laps &&
+                 a->track_length == b->track_length && a->broadphase.count == b->broadphase.count &&
+                 memcmp(a->broadphase.order, b->broadphase.order, a->broadphase.count) == 0;
+    for (int i = 0; i < PHYSICS_MAX_CARS && equal; i++) {
+        const physics_car_progress_t *p = &a->progress[i], *q = &b->progress[i];
+        equal = memcmp(&a->cars[i], &b->cars[i], sizeof(car_physics_t)) == 0 &&
+                p->next_checkpoint == q->next_checkpoint && p->lap == q->lap &&
+                p->rewind_depth == q->rewind_depth && p->wrong_way == q->wrong_way &&
+                p->lap_start_time == q->lap_start_time && p->sector_start_time == q->sector_start_time &&
+                p->last_lap_time == q->last_lap_time && p->best_lap_time == q->best_lap_time &&
+                memcmp(p->sector_times, q->sector_times, sizeof(p->sector_times)) == 0 &&
+                p->segment == q->segment && p->lap_distance == q->lap_distance &&
+                p->race_distance == q->race_distance && p->gap_to_leader == q->gap_to_leader &&
+                p->position == q->position && a->race_time[i] == b->race_time[i] &&
+                a->race_time_ns[i] == b->race_time_ns[i] && a->race_finished[i] == b->race_finished[i];
+    }
+    for (int i = 0; i < a->checkpoint_count && equal; i++) {
+        const checkpoint_t *c = &a->checkpoints[i], *d = &b->checkpoints[i];
+        equal = c->position.x == d->position.x && c->position.y == d->position.y && c->radius == d->radius &&
+                c->gate_a.x == d->gate_a.x && c->gate_a.y == d->gate_a.y && c->gate_b.x == d->gate_b.x &&
+                c->gate_b.y == d->gate_b.y && c->forward.x == d->forward.x && c->forward.y == d->forward.y &&
+                c->index == d->index;
+    }
+    return equal;
+}
+
+static void test_round_trip(void) {
+    static physics_world_t world, loaded;
+    uint8_t buffer[WORLD_STATE_MAX_SIZE];
+    uint32_t frame = 0;
+    uint8_t sections = 0;
+
+    setup_world(&world, 900);
+    CHECK(world.race_time[0] > 0);
+
+    // Everything into a zeroed world
+    size_t length = world_state_save(&world, 900, WORLD_STATE_ALL, buffer, sizeof(buffer));
+    size_t expected = WORLD_STATE_HEADER_SIZE + PHYSICS_MAX_CARS * WORLD_STATE_CAR_SIZE(4) + 2 +
+                      world.broadphase.count + 9 + 4 * WORLD_STATE_CHECKPOINT_SIZE;
+    printf("  %zu bytes for %d cars and 4 gates, %zu in memory\n", length, PHYSICS_MAX_CARS,
+           sizeof(physics_world_t));
+    CHECK(length == expected);
+    CHECK(world_state_info(buffer, length, &sections, &frame) && sections == WORLD_STATE_ALL && frame == 900);
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(world_state_load(buffer, length, &loaded, &frame) && frame == 900);
+    CHECK(worlds_equal(&world, &loaded));
+
+    // Saving the loaded world gives the same bytes
+    uint8_t again[WORLD_STATE_MAX_SIZE];
+    CHECK(world_state_save(&loaded, 900, WORLD_STATE_ALL, again, sizeof(again)) == length);
+    CHECK(memcmp(buffer, again, length) == 0);
+
+    // The dynamic section alone rewinds a world on the same track
+    length = world_state_save(&world, 900, WORLD_STATE_DYNAMIC, buffer, sizeof(buffer));
+    CHECK(length == (size_t)WORLD_STATE_HEADER_SIZE + PHYSICS_MAX_CARS * WORLD_STATE_CAR_SIZE(4) + 2 +
+                    world.broadphase.count);
+    physics_world_t later = world;
+    for (int i = 0; i < 60; i++) {
+        physics_update(&later, DT);
+    }
+    CHECK(!worlds_equal(&world, &later));
+    CHECK(world_state_load(buffer, length, &later, NULL));
+    CHECK(worlds_equal(&world, &later));
+    CHECK(world_state_hash_world(&later, 900) == world_state_hash(buffer, length));
+
+    // And carries on exactly as the original
+    for (int i = 0; i < 120; i++) {
+        physics_update(&world, DT);
+        physics_update(&later, DT);
+    }
+    CHECK(worlds_equal(&world, &later));
+
+    // The race section alone sets up the track and leaves the cars be
+    length = world_state_save(&world, 0, WORLD_STATE_RACE, buffer, sizeof(buffer));
+    memcpy(&loaded, &world, sizeof(loaded));
+    memset(loaded.checkpoints, 0, sizeof(loaded.checkpoints));
+    loaded.checkpoint_count = 0;
+    loaded.total_laps = 0;
+    CHECK(world_state_load(buffer, length, &loaded, NULL));
+    CHECK(worlds_equal(&world, &loaded));
+}
+
+static void test_refused(void) {
+    static physics_world_t world, target;
+    uint8_t buffer[WORLD_STATE_MAX_SIZE];
+
+    setup_world(&world, 120);
+    size_t length = world_state_save(&world, 120, WORLD_STATE_ALL, buffer, sizeof(buffer));
+    CHECK(world_state_save(&world, 120, WORLD_STATE_ALL, buffer, length - 1) == 0);
+
+    memset(&target, 0, sizeof(target));
+    physics_world_t before = target;
+    uint8_t bad[WORLD_STATE_MAX_SIZE];
+
+    // Truncated, overlong, and each header field wrong in turn
+    CHECK(!world_state_load(buffer, length - 1, &target, NULL));
+    memcpy(bad, buffer, length);
+    bad[length] = 0;
+    CHECK(!world_state_load(bad, length + 1, &target, NULL));
+    for (int field = 0; field < 5; field++) {
+        memcpy(bad, buffer, length);
+        switch (field) {
+            case 0: bad[0] ^= 1; break;                          // Magic
+            case 1: bad[1] = WORLD_STATE_VERSION + 1; break;     // A newer layout
+            case 2: bad[2] |= 0x80; break;                       // Unknown section
+            case 3: bad[3] = PHYSICS_MAX_CHECKPOINTS + 1; break;
+            case 4: bad[4] ^= 1; break;                          // Built for another car count
+        }
+        CHECK_MSG(!world_state_load(bad, length, &target, NULL), "header field %d", field);
+    }
+    CHECK(memcmp(&target, &before, sizeof(target)) == 0);
+
+    // A dynamic section for a different track
+    length = world_state_save(&world, 120, WORLD_STATE_DYNAMIC, buffer, sizeof(buffer));
+    target.checkpoint_count = 3;
+    CHECK(!world_state_load(buffer, length, &target, NULL));
+    target.checkpoint_count = 4;
+    CHECK(world_state_load(buffer, length, &target, NULL));
+}
+
+static void test_hash(void) {
+    static physics_world_t world;
+    uint8_t buffer[WORLD_STATE_DYNAMIC_MAX_SIZE];
+
+    setup_world(&world, 300);
+    size_t length = world_state_save(&world, 300, WORLD_STATE_DYNAMIC, buffer, sizeof(buffer));
+    uint64_t hash = world_state_hash(buffer, length);
+    CHECK(hash == world_state_hash_world(&world, 300));
+    CHECK(hash != world_state_hash_world(&world, 301));
+
+    // Every single-bit flip changes the hash, and the low 32 bits sent in
+    // state packets too
+    int same = 0, same_low = 0;
+    for (size_t bit = 0; bit < length * 8; bit++) {
+        buffer[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        uint64_t flipped = world_state_hash(buffer, length);
+        buffer[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        same += flipped == hash;
+        same_low += (uint32_t)flipped == (uint32_t)hash;
+    }
+    CHECK(same == 0);
+    CHECK(same_low == 0);
+
+    // Lengths that are not a multiple of eight, zero bytes included
+    uint8_t zeros[16] = {0};
+    for (size_t a = 0; a < sizeof(zeros); a++) {
+        for (size_t b = a + 1; b <= sizeof(zeros); b++) {
+            CHECK(world_state_hash(zeros, a) != world_state_hash(zeros, b));
+        }
+    }
+
+    // A stale car in the world changes the world's hash
+    world.cars[1].angular_vel ^= 1;
+    CHECK(world_state_hash_world(&world, 300) != hash);
+}
+
+int main(void) {
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_refused);
+    RUN_TEST(test_hash);
+    return host_test_finish();
+}
@@ -5,10 +5,15 @@
 #include "ble.h"
 #include "protocol.h"
 #include "asset_loader.h"
+#include "scheduler.h"
+#include "render_snapshot.h"
+#include "input_replay.h"
+#include "world_state.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <stdatomic.h>
 
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -19,7 +24,8 @@
 
 static const char *TAG = "game_loop";
 
-static game_state_t current_state = GAME_STATE_MENU;
+// Written by the frame task, read by the simulation tasks on the other core
+static _Atomic game_state_t current_state = GAME_STATE_MENU;
 static game_config_t game_config;
 static bool game_running = false;
 static esp_timer_handle_t game_timer;
@@ -28,6 +34,62 @@ static uint32_t frame_count = 0;
 static uint32_t last_frame_time = 0;
 static float current_fps = 0.0f;
 static physics_world_t physics_world;
+static affine2_t world_to_screen;
+
+// Subsystem rates; physics runs at PHYSICS_RATE_HZ, network and frame rates
+// come from game_config
+#define GAME_IMU_RATE_HZ 200
+
+static scheduler_t scheduler;
+static int imu_task = -1;
+static int physics_task = -1;
+static int network_task = -1;
+static int frame_task = -1;
+
+// Pipelined mode: simulation stays on the calling task (core 0) and the frame
+// task runs on its own scheduler pinned to the other core
+#define GAME_RENDER_CORE 1
+#define GAME_RENDER_TASK_STACK 8192
+#define GAME_RENDER_TASK_PRIORITY 5
+
+static scheduler_t render_scheduler;
+static scheduler_t *frame_scheduler = &scheduler;
+static TaskHandle_t loop_task_handle;
+
+// Physics publishes, render consumes; render never touches physics_world
+static render_snapshot_buffer_t render_snapshots;
+static const render_snapshot_t *frame_snapshot;
+static bool frame_snapshot_fresh;
+static uint32_t physics_step = 0;
+static atomic_bool race_start_pending;
+
+// Networked races step through the rollback engine; it is only touched on
+// the simulation core (physics task and ble_poll callbacks)
+static rollback_t rollback;
+static bool rollback_active = false;
+static uint32_t rollback_local_frame = 0;  // Next frame to take a local input for
+
+// Each race's inputs, kept in RAM while racing and written to the track
+// partition's SPIFFS once it ends; about 1-2 bytes a frame, so 32 KB holds
+// several minutes. Physics task only.
+#define GAME_REPLAY_MAX_SIZE 32768
+#define GAME_REPLAY_PATH "/tracks/last_race.rpl"
+static input_replay_recorder_t replay_recorder;
+static uint8_t replay_buffer[GAME_REPLAY_MAX_SIZE];
+static bool replay_recording = false;
+
+// Key presses taken by the frame task at the start of each frame
+static uint32_t frame_key_presses;
+
+// game_set_config can be called from any task; each scheduler loop applies
+// the new rates to its own tasks when the generation changes
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+static atomic_uint config_generation;
+
+// Input-to-photon latency: input sample time to the flush that shows it
+static int64_t latency_total_us = 0;
+static uint32_t latency_samples = 0;
+static uint32_t latency_max_us = 0;
 
 // Forward declarations
 static void game_update_menu(void);
@@ -36,6 +98,16 @@ static void game_update_countdown(void);
 static void game_update_racing(void);
 static void game_update_results(void);
 static void game_render(void);
+static void game_task_imu(void *arg, uint32_t period_us);
+static void game_task_physics(void *arg, uint32_t period_us);
+static void game_save_replay(void);
+static void game_task_network(void *arg, uint32_t period_us);
+static void game_task_frame(void *arg, uint32_t period_us);
+static void game_scheduler_loop(scheduler_t *sched);
+static void game_apply_config(scheduler_t *sched);
+static void game_render_task(void *arg);
+static bool game_key_pressed(key_code_t key);
+static void game_handle_ble_event(uint8_t event_type, const uint8_t *data, uint16_t length);
 
 esp_err_t game_loop_init(void)
 {
@@ -45,12 +117,21 @@ esp_err_t game_loop_init(void)
     game_config.target_fps = 30;
     game_config.enable_half_res = false;
     game_config.enable_imu_steering = true;
-    game_config.net_update_rate = 20; // Hz
+    game_config.net_update_rate = 30; // Hz; state deltas are a third the size of the old packets
+    game_config.enable_pipelined_render = true;
+    game_config.track_id = 0;  // default.trk, loaded below
+    game_config.race_seed = 0;
     
     frame_count = 0;
     last_frame_time = 0;
     current_fps = 0.0f;
     
+    // World to screen projection: 1/100 scale around the display centre
+    affine2_t scale, centre;
+    affine2_scaling(&scale, FIXED16_ONE / 100, FIXED16_ONE / 100);
+    affine2_translation(&centre, INT_TO_FIXED16(DISPLAY_WIDTH / 2), INT_TO_FIXED16(DISPLAY_HEIGHT / 2));
+    affine2_compose(&world_to_screen, &centre, &scale);
+
     // Initialize physics system
     esp_err_t ret = physics_init();
     if (ret != ESP_OK) {
@@ -69,7 +150,6 @@ esp_err_t game_loop_init(void)
         physics_world.checkpoints[i].position.y = fixed_mul(FLOAT_TO_FIXED16(200), fixed_sin(angle));
         physics_world.checkpoints[i].radius = PHYSICS_CHECKPOINT_RADIUS;
         physics_world.checkpoints[i].index = i;
-        physics_world.checkpoints[i].passed = false;
     }
     
     // Initialize track system
@@ -112,13 +192,15 @@ esp_err_t game_loop_init(void)
         
         // Initialize physics with track data
         physics_world.checkpoint_count = default_track->checkpoint_count;
+        physics_world.total_laps = default_track->lap_count;
         for (int i = 0; i < default_track->checkpoint_count; i++) {
             physics_world.checkpoints[i].position.x = INT_TO_FIXED16(default_track->checkpoints[i].x);
             physics_world.checkpoints[i].position.y = INT_TO_FIXED16(default_track->checkpoints[i].y);
             physics_world.checkpoints[i].radius = INT_TO_FIXED16(default_track->checkpoints[i].radius);
             physics_world.checkpoints[i].index = default_track->checkpoints[i].index;
-            physics_world.checkpoints[i].passed = false;
         }
+
+        track_bind_physics(default_track);
     } else {
         ESP_LOGW(TAG, "Using fallback track data");
         physics_world.checkpoint_count = 4;
@@ -128,14 +210,20 @@ esp_err_t game_loop_init(void)
             physics_world.checkpoints[i].position.y = fixed_mul(FLOAT_TO_FIXED16(200), fixed_sin(angle));
             physics_world.checkpoints[i].radius = PHYSICS_CHECKPOINT_RADIUS;
             physics_world.checkpoints[i].index = i;
-            physics_world.checkpoints[i].passed = false;
         }
     }
     
     // Initialize cars
     physics_reset_race(&physics_world);
+
+    // Give the renderer a valid snapshot before the first physics step
+    render_snapshot_init(&render_snapshots);
+    render_snapshot_capture(render_snapshot_begin(&render_snapshots), &physics_world, 0, esp_timer_get_time(), 0);
+    render_snapshot_publish(&render_snapshots);
+    atomic_init(&race_start_pending, false);
     
     // Initialize BLE and protocol
+    ble_register_callback(game_handle_ble_event);
     esp_err_t ble_ret = ble_init();
     if (ble_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize BLE");
@@ -156,70 +244,50 @@ void game_loop_run(void)
 {
     ESP_LOGI(TAG, "Starting game loop");
     game_running = true;
-    
-    uint32_t frame_start_time, frame_end_time;
-    uint32_t target_frame_time = 1000 / game_config.target_fps;
-    uint32_t last_physics_update = 0;
-    
-    while (game_running) {
-        frame_start_time = esp_timer_get_time() / 1000;
-        
-        // Handle input
-        input_update();
-        
-        // Update physics at fixed timestep
-        uint32_t current_time = esp_timer_get_time() / 1000;
-        if (current_state == GAME_STATE_RACING && 
-            (current_time - last_physics_update) >= 16) {  // 60Hz physics
-            physics_update(&physics_world, 0.016f);
-            last_physics_update = current_time;
-        }
-        
-        // Update game state
-        switch (current_state) {
-            case GAME_STATE_MENU:
-                game_update_menu();
-                break;
-            case GAME_STATE_LOBBY:
-                game_update_lobby();
-                break;
-            case GAME_STATE_COUNTDOWN:
-                game_update_countdown();
-                break;
-            case GAME_STATE_RACING:
-                game_update_racing();
-                break;
-            case GAME_STATE_RESULTS:
-                game_update_results();
-                break;
-            case GAME_STATE_SETTINGS:
-                // TODO: Settings menu
-                break;
-        }
-        
-        // Render frame
-        game_render();
-        
-        frame_end_time = esp_timer_get_time() / 1000;
-        uint32_t frame_time = frame_end_time - frame_start_time;
-        
-        // Frame pacing
-        if (frame_time < target_frame_time) {
-            vTaskDelay(pdMS_TO_TICKS(target_frame_time - frame_time));
-        }
-        
-        // Update FPS counter
-        frame_count++;
-        if (frame_count % 60 == 0) {
-            uint32_t current_time = esp_timer_get_time() / 1000;
-            if (last_frame_time > 0) {
-                current_fps = 60000.0f / (current_time - last_frame_time);
-            }
-            last_frame_time = current_time;
-            ESP_LOGD(TAG, "FPS: %.2f", current_fps);
+
+    // Each subsystem ticks at its own rate; lower priority values run first
+    scheduler_init(&scheduler, esp_timer_get_time);
+    imu_task = scheduler_add_task(&scheduler, &(scheduler_task_config_t){
+        .name = "imu", .rate_hz = GAME_IMU_RATE_HZ, .priority = 0, .max_catch_up = 2, .fn = game_task_imu
+    });
+    physics_task = scheduler_add_task(&scheduler, &(scheduler_task_config_t){
+        .name = "physics", .rate_hz = PHYSICS_RATE_HZ, .priority = 1, .max_catch_up = 4, .fn = game_task_physics
+    });
+    network_task = scheduler_add_task(&scheduler, &(scheduler_task_config_t){
+        .name = "network", .rate_hz = game_config.net_update_rate, .priority = 2, .max_catch_up = 1,
+        .fn = game_task_network
+    });
+
+    // Frame N renders on the other core while frame N+1 simulates here
+    frame_scheduler = &scheduler;
+    if (game_config.enable_pipelined_render) {
+        scheduler_init(&render_scheduler, esp_timer_get_time);
+        frame_scheduler = &render_scheduler;
+    }
+    frame_task = scheduler_add_task(frame_scheduler, &(scheduler_task_config_t){
+        .name = "frame", .rate_hz = game_config.target_fps, .priority = 3, .max_catch_up = 1, .fn = game_task_frame
+    });
+
+    loop_task_handle = xTaskGetCurrentTaskHandle();
+    if (game_config.enable_pipelined_render) {
+        if (xTaskCreatePinnedToCore(game_render_task, "game_render", GAME_RENDER_TASK_STACK, NULL,
+                                    GAME_RENDER_TASK_PRIORITY, NULL, GAME_RENDER_CORE) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start render task, rendering on the simulation core");
+            frame_scheduler = &scheduler;
+            frame_task = scheduler_add_task(&scheduler, &(scheduler_task_config_t){
+                .name = "frame", .rate_hz = game_config.target_fps, .priority = 3, .max_catch_up = 1,
+                .fn = game_task_frame
+            });
         }
     }
-    
+
+    game_scheduler_loop(&scheduler);
+
+    // Wait for the render task to finish its last frame
+    if (frame_scheduler == &render_scheduler) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
     ESP_LOGI(TAG, "Game loop stopped");
     
     ble_deinit();
@@ -241,8 +309,8 @@ void game_loop_deinit(void)
 
 void game_set_state(game_state_t state)
 {
-    ESP_LOGI(TAG, "Game state changing: %d -> %d", current_state, state);
-    current_state = state;
+    game_state_t previous = atomic_exchange(&current_state, state);
+    ESP_LOGI(TAG, "Game state changing: %d -> %d", previous, state);
     
     // State transition logic
     switch (state) {
@@ -269,12 +337,17 @@ void game_set_state(game_state_t state)
 
 game_state_t game_get_state(void)
 {
-    return current_state;
+    return atomic_load(&current_state);
 }
 
 void game_set_config(const game_config_t *config)
 {
+    taskENTER_CRITICAL(&config_lock);
     memcpy(&game_config, config, sizeof(game_config_t));
+    taskEXIT_CRITICAL(&config_lock);
+
+    // The scheduler loops pick the new rates up on their next pass
+    atomic_fetch_add(&config_generation, 1);
 }
 
 const game_config_t* game_get_config(void)
@@ -295,10 +368,8 @@ uint32_t game_get_frame_time_ms(void)
 // Game state update functions
 static void game_update_menu(void)
 {
-    const input_state_t *input = input_get_state();
-    
     // Check for menu navigation
-    if (input_key_just_pressed(KEY_ENTER)) {
+    if (game_key_pressed(KEY_ENTER)) {
         game_set_state(GAME_STATE_LOBBY);
     }
     
@@ -307,21 +378,17 @@ static void game_update_menu(void)
     
     // Draw menu text (placeholder)
     display_fill_rect(300, 300, 120, 60, 0xFFFF);
-    (void)input; // Suppress unused variable warning
 }
 
 static void game_update_lobby(void)
 {
-    const input_state_t *input = input_get_state();
-    
     // Check for lobby actions
-    if (input_key_just_pressed(KEY_ESC)) {
+    if (game_key_pressed(KEY_ESC)) {
         game_set_state(GAME_STATE_MENU);
     }
     
     // Lobby rendering
     display_clear(0x07E0); // Green background
-    (void)input; // Suppress unused variable warning
 }
 
 static void game_update_countdown(void)
@@ -337,8 +404,9 @@ static void game_update_countdown(void)
     uint32_t elapsed = (esp_timer_get_time() / 1000) - countdown_start;
     
     if (elapsed > 3000) { // 3 second countdown
+        // Physics owns the world; it starts the race on its next step
+        atomic_store(&race_start_pending, true);
         game_set_state(GAME_STATE_RACING);
-        physics_start_race(&physics_world);
         countdown_init = false;
     }
     
@@ -353,44 +421,29 @@ static void game_update_countdown(void)
 
 static void game_update_racing(void)
 {
-    // Handle racing input
-    float throttle = input_get_throttle();
-    float brake = input_get_brake();
-    float steering = input_get_steering();
-    
-    // Update car physics
-    if (physics_world.car_count > 0 && physics_world.cars != NULL) {
-        physics_handle_input(&physics_world.cars[0], throttle, brake, steering, 0.016f);
-    }
-    
+    // Render from the latest published physics step
+    frame_snapshot = render_snapshot_acquire(&render_snapshots, &frame_snapshot_fresh);
+
     // Check if race finished
-    if (physics_check_race_finished(&physics_world, 0)) {
+    if (frame_snapshot->cars[0].finished) {
         game_set_state(GAME_STATE_RESULTS);
     }
     
     // Check for race end condition
-    if (input_key_just_pressed(KEY_ESC)) {
+    if (game_key_pressed(KEY_ESC)) {
         game_set_state(GAME_STATE_RESULTS);
     }
     
-    // Send game state to remote player via BLE
-    if (ble_is_connected()) {
-        game_state_packet_t game_state;
-        if (physics_world.car_count > 0 && physics_world.cars != NULL) {
-            protocol_pack_game_state(&physics_world, &physics_world.cars[0], &game_state);
-            ble_send_game_state(&game_state);
-        }
-    }
-    
     // Racing rendering
     display_clear(0x001F); // Blue background for sky
     
     // TODO: Render Mode-7 track using physics world
     // For now, render simple car based on physics
-    if (physics_world.car_count > 0 && physics_world.cars != NULL) {
-        car_physics_t *car1 = &physics_world.cars[0];
-        int car_x = 360 + (FIXED16_TO_INT(car1->position.x) / 100);
-        int car_y = 360 + (FIXED16_TO_INT(car1->position.y) / 100);
+    if (frame_snapshot->car_count > 0) {
+        const render_car_t *car1 = &frame_snapshot->cars[0];
+        vec2_t screen = affine2_transform(&world_to_screen, car1->position);
+        int car_x = FIXED16_TO_INT(screen.x);
+        int car_y = FIXED16_TO_INT(screen.y);
         
         // Clamp to screen bounds
         car_x = MAX(0, MIN(DISPLAY_WIDTH - 16, car_x));
@@ -400,10 +453,11 @@ static void game_update_racing(void)
     }
     
     // Render remote car if connected
-    if (ble_is_connected() && physics_world.car_count > 1 && physics_world.cars != NULL) {
-        car_physics_t *car2 = &physics_world.cars[1];
-        int remote_car_x = 360 + (FIXED16_TO_INT(car2->position.x) / 100);
-        int remote_car_y = 360 + (FIXED16_TO_INT(car2->position.y) / 100);
+    if (ble_is_connected() && frame_snapshot->car_count > 1) {
+        const render_car_t *car2 = &frame_snapshot->cars[1];
+        vec2_t remote_screen = affine2_transform(&world_to_screen, car2->position);
+        int remote_car_x = FIXED16_TO_INT(remote_screen.x);
+        int remote_car_y = FIXED16_TO_INT(remote_screen.y);
         
         remote_car_x = MAX(0, MIN(DISPLAY_WIDTH - 16, remote_car_x));
         remote_car_y = MAX(0, MIN(DISPLAY_HEIGHT - 16, remote_car_y));
@@ -414,16 +468,13 @@ static void game_update_racing(void)
 
 static void game_update_results(void)
 {
-    const input_state_t *input = input_get_state();
-    
     // Check for menu navigation
-    if (input_key_just_pressed(KEY_ENTER)) {
+    if (game_key_pressed(KEY_ENTER)) {
         game_set_state(GAME_STATE_MENU);
     }
     
     // Results rendering
     display_clear(0xFFE0); // Yellow background
-    (void)input; // Suppress unused variable warning
 }
 
 static void game_render(void)
@@ -431,4 +482,307 @@ static void game_render(void)
     // Flush display buffer
     display_flush();
     display_swap_buffers();
-}
\ No newline at end of file
+}
+
+// Scheduler tasks
+static void game_task_imu(void *arg, uint32_t period_us)
+{
+    input_update_imu();
+}
+
+static void game_task_physics(void *arg, uint32_t period_us)
+{
+    // Deliver BLE events queued by the NimBLE task since the last step
+    ble_poll();
+    if (ble_is_connected()) {
+        protocol_clock_poll();
+    }
+
+    // Input is sampled on this core, next to the IMU task, so a step never
+    // sees a half-updated input state; the frame task only takes key presses
+    input_update();
+
+    // Read the state before the start flag: the countdown sets the flag
+    // first, so seeing RACING here means a pending start is visible too
+    game_state_t state = atomic_load(&current_state);
+
+    // Short connection intervals from the countdown on; menus save power
+    if (ble_is_connected()) {
+        protocol_link_control(state == GAME_STATE_COUNTDOWN || state == GAME_STATE_RACING,
+                              scheduler_get_task(&scheduler, network_task)->config.rate_hz);
+        protocol_telemetry_poll();
+    }
+
+    if (atomic_exchange(&race_start_pending, false)) {
+        physics_start_race(&physics_world);
+
+        // Both peers start frame 0 from the same world
+        rollback_active = ble_is_connected();
+        if (rollback_active) {
+            protocol_stats_t stats;
+            protocol_get_stats(&stats);
+            rollback_init(&rollback, &physics_world, stats.is_host ? 0 : 1, 1.0f / PHYSICS_RATE_HZ);
+            rollback_local_frame = 0;
+            // The host's clock defines the frame timeline both peers pace to
+            if (stats.is_host) {
+                protocol_start_timeline();
+            }
+        }
+        protocol_set_rollback(rollback_active ? &rollback : NULL);
+
+        taskENTER_CRITICAL(&config_lock);
+        uint8_t track_id = game_config.track_id;
+        uint32_t race_seed = game_config.race_seed;
+        taskEXIT_CRITICAL(&config_lock);
+
+        // Offline races replay the local car alone; the others are not
+        // driven by inputs
+        input_replay_record_init(&replay_recorder, replay_buffer, sizeof(replay_buffer),
+                                 rollback_active ? ROLLBACK_PLAYERS : 1, track_id, race_seed);
+        replay_recording = true;
+    }
+
+    if (state != GAME_STATE_RACING) {
+        // A start that lands between the state read and the flag opens the
+        // recorder while state is stale; nothing is recorded until the
+        // next step sees RACING, so only a race that ran is saved
+        if (replay_recording && replay_recorder.frames > 0) {
+            game_save_replay();
+        }
+        return;
+    }
+
+    // period_us is rounded down; step by the exact rate so race time keeps up
+    float delta_time = 1.0f / PHYSICS_RATE_HZ;
+    int64_t input_time = input_get_state()->timestamp_us;
+
+    if (rollback_active) {
+        // The shared timeline runs this step as 0, 1 or 2 frames, so a
+        // peer whose clock runs fast or who started late stays level
+        int frames = protocol_pace_frames(rollback.frame);
+        int advanced = 0;
+        while (advanced < frames) {
+            // Inputs are queued per frame until the engine advances; while
+            // it stalls waiting for the peer, the frame's input is already
+            // stored
+            if (rollback.frame == rollback_local_frame) {
+                physics_input_t input = physics_quantise_input(input_get_throttle(), input_get_brake(),
+                                                               input_get_steering(), 0);
+                rollback_add_local_input(&rollback, &input);
+                protocol_store_frame_input(&input, rollback.frame);
+                rollback_local_frame++;
+            }
+            if (!rollback_advance(&rollback)) {
+                break;
+            }
+            advanced++;
+        }
+        protocol_check_desync();
+        input_replay_record_rollback(&replay_recorder, &rollback, UINT32_MAX);
+        // A packet every step, stalled or not, resends whatever the peer
+        // has not acked and carries our ack for its frames
+        uint8_t packet[INPUT_HISTORY_MAX_PACKET];
+        size_t length = protocol_encode_input_history(packet, sizeof(packet));
+        if (length) {
+            ble_send_input_history(packet, (uint16_t)length);
+        }
+        if (advanced == 0) {
+            return;
+        }
+    } else {
+        // Rollback races simulate the remote car from its inputs; without
+        // an engine it is shown from its states, smoothed over the jitter
+        state_codec_car_t remote;
+        if (protocol_sample_remote_state(&remote)) {
+            state_codec_apply(&remote, &physics_world, 1);
+        }
+
+        // Apply the latest input to the local car, quantised as it is
+        // recorded so the replay drives it the same, then step the world
+        physics_input_t input = physics_quantise_input(input_get_throttle(), input_get_brake(),
+                                                       input_get_steering(), 0);
+        input_replay_record_frame(&replay_recorder, &input);
+        physics_apply_input(&physics_world.cars[0], &input, delta_time);
+        physics_update(&physics_world, delta_time);
+    }
+
+    // Hand the renderer an immutable copy of this step
+    render_snapshot_capture(render_snapshot_begin(&render_snapshots), &physics_world, ++physics_step,
+                            esp_timer_get_time(), input_time);
+    render_snapshot_publish(&render_snapshots);
+}
+
+// The race is over, so a flash write here holds up nothing. The final hash
+// is only kept if it is of the last recorded frame: a rollback race may
+// end ahead of what the peer confirmed.
+static void game_save_replay(void)
+{
+    uint32_t frame = replay_recorder.frames;
+    uint64_t hash = 0;
+    bool hash_valid;
+    if (rollback_active) {
+        hash_valid = rollback_confirmed_hash(&rollback, &frame, &hash) && frame == replay_recorder.frames;
+    } else {
+        hash = world_state_hash_world(&physics_world, frame);
+        hash_valid = true;
+    }
+
+    size_t length = input_replay_record_finish(&replay_recorder, hash_valid, hash);
+    replay_recording = false;
+    if (!input_replay_save(GAME_REPLAY_PATH, replay_buffer, length)) {
+        ESP_LOGW(TAG, "Could not write replay to %s", GAME_REPLAY_PATH);
+        return;
+    }
+    ESP_LOGI(TAG, "Replay of %lu frames saved, %u bytes%s", (unsigned long)replay_recorder.frames,
+             (unsigned)length, (replay_recorder.flags & INPUT_REPLAY_TRUNCATED) ? " (truncated)" : "");
+}
+
+static void game_task_network(void *arg, uint32_t period_us)
+{
+    // Send game state to remote player via BLE
+    if (atomic_load(&current_state) != GAME_STATE_RACING || !ble_is_connected()) {
+        return;
+    }
+
+    // Delta against what the peer last acked; 7-11 bytes while racing
+    uint8_t packet[STATE_CODEC_MAX_PACKET];
+    uint8_t car = rollback_active ? rollback.local_player : 0;
+    uint32_t frame = rollback_active ? rollback.frame : physics_step;
+    size_t length = protocol_encode_game_state(&physics_world, car, frame, packet, sizeof(packet));
+    if (length > 0) {
+        ble_send_state_delta(packet, (uint16_t)length);
+    }
+}
+
+static void game_task_frame(void *arg, uint32_t period_us)
+{
+    // Input is sampled by the physics task; take the presses since last frame
+    frame_key_presses = input_take_key_presses();
+
+    // Update game state
+    switch (atomic_load(&current_state)) {
+        case GAME_STATE_MENU:
+            game_update_menu();
+            break;
+        case GAME_STATE_LOBBY:
+            game_update_lobby();
+            break;
+        case GAME_STATE_COUNTDOWN:
+            game_update_countdown();
+            break;
+        case GAME_STATE_RACING:
+            game_update_racing();
+            break;
+        case GAME_STATE_RESULTS:
+            game_update_results();
+            break;
+        case GAME_STATE_SETTINGS:
+            // TODO: Settings menu
+            break;
+    }
+
+    // Render frame
+    game_render();
+
+    // A new snapshot is on screen once the flush returns
+    if (atomic_load(&current_state) == GAME_STATE_RACING && frame_snapshot_fresh &&
+        frame_snapshot->input_time_us > 0) {
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - frame_snapshot->input_time_us);
+        latency_total_us += latency;
+        latency_samples++;
+        latency_max_us = MAX(latency_max_us, latency);
+        frame_snapshot_fresh = false;
+    }
+
+    // Update FPS counter
+    frame_count++;
+    if (frame_count % 60 == 0) {
+        uint32_t current_time = esp_timer_get_time() / 1000;
+        if (last_frame_time > 0) {
+            current_fps = 60000.0f / (current_time - last_frame_time);
+        }
+        last_frame_time = current_time;
+
+        const scheduler_task_t *physics = scheduler_get_task(&scheduler, physics_task);
+        const scheduler_task_t *frame = scheduler_get_task(frame_scheduler, frame_task);
+        ESP_LOGD(TAG, "FPS: %.2f, physics overruns %lu skipped %lu, frame overruns %lu max %lu us",
+                 current_fps, (unsigned long)physics->overruns, (unsigned long)physics->skipped,
+                 (unsigned long)frame->overruns, (unsigned long)frame->max_duration_us);
+        if (latency_samples > 0) {
+            ESP_LOGD(TAG, "Input-to-photon %lu us avg, %lu us max (%s), %lu snapshots dropped",
+                     (unsigned long)(latency_total_us / latency_samples), (unsigned long)latency_max_us,
+                     frame_scheduler == &render_scheduler ? "pipelined" : "serial",
+                     (unsigned long)render_snapshots.dropped);
+        }
+    }
+}
+
+static void game_scheduler_loop(scheduler_t *sched)
+{
+    unsigned applied_generation = 0;
+
+    while (game_running) {
+        unsigned generation = atomic_load(&config_generation);
+        if (generation != applied_generation) {
+            game_apply_config(sched);
+            applied_generation = generation;
+        }
+
+        int64_t wait_us = scheduler_run_due(sched);
+
+        // Whatever the tasks queued this pass, input, state and clock
+        // messages alike, goes out packed into one notification
+        if (sched == &scheduler) {
+            ble_flush();
+        }
+
+        // Sleep until the next deadline; always yield at least one tick
+        TickType_t ticks = pdMS_TO_TICKS(wait_us / 1000);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+}
+
+// Apply the configured rates to the tasks that run on this scheduler; only
+// called from the task that runs it
+static void game_apply_config(scheduler_t *sched)
+{
+    taskENTER_CRITICAL(&config_lock);
+    uint32_t net_update_rate = game_config.net_update_rate;
+    uint32_t target_fps = game_config.target_fps;
+    taskEXIT_CRITICAL(&config_lock);
+
+    if (sched == &scheduler) {
+        scheduler_set_rate(sched, network_task, net_update_rate);
+    }
+    if (sched == frame_scheduler) {
+        scheduler_set_rate(sched, frame_task, target_fps);
+    }
+}
+
+static bool game_key_pressed(key_code_t key)
+{
+    return (frame_key_presses & INPUT_KEY_BIT(key)) != 0;
+}
+
+// Runs from ble_poll at the start of each physics step
+static void game_handle_ble_event(uint8_t event_type, const uint8_t *data, uint16_t length)
+{
+    if (event_type == 2 && data) {  // Remote car state
+        // Buffered for playout; the physics step applies it
+        state_codec_car_t state;
+        protocol_decode_game_state(data, length, &state);
+    } else if (event_type == 3 && data) {  // Remote input history
+        protocol_decode_input_history(data, length);
+    } else if (event_type == 4 && data) {  // Config, including clock sync
+        protocol_handle_config(data, length);
+    }
+}
+
+static void game_render_task(void *arg)
+{
+    ESP_LOGI(TAG, "Render task running on core %d", xPortGetCoreID());
+    game_scheduler_loop(&render_scheduler);
+
+    xTaskNotifyGive(loop_task_handle);
+    vTaskDelete(NULL);
+}
@@ -20,6 +20,9 @@ typedef struct {
     bool enable_half_res;
     bool enable_imu_steering;
     uint8_t net_update_rate;
+    bool enable_pipelined_render;  // Render on the second core from published snapshots
+    uint8_t track_id;              // Track of the next race, as agreed in the lobby
+    uint32_t race_seed;            // Seed of the next race, recorded with its replay
 } game_config_t;
 
 esp_err_t game_loop_init(void);